@@ -2,16 +2,32 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <set>
 #include <sstream>
 #include <cctype>
+#include <cmath>
 #include <algorithm>
-#include <iomanip>
 #include <clocale>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <unordered_map>
+#include <memory>
+#include <deque>
+#include <functional>
+#include <langinfo.h>
 
-using namespace std;
+#include "regen_internal.h"
+#include "regen_c.h"
 
-// 系统语言检测
-bool isChineseLocale() {
+namespace regen {
+namespace detail {
+
+UiLanguage currentLanguage = LANG_EN;
+bool localeIsUtf8 = false;
+
+// 根据环境变量确定界面语言
+UiLanguage detectLanguage() {
     const char* lang = getenv("LANG");
     if (lang == nullptr) lang = getenv("LC_ALL");
     if (lang == nullptr) lang = getenv("LC_MESSAGES");
@@ -19,24 +35,381 @@ bool isChineseLocale() {
     if (lang != nullptr) {
         string langStr(lang);
         transform(langStr.begin(), langStr.end(), langStr.begin(), ::tolower);
-        return langStr.find("zh_cn") != string::npos || 
-               langStr.find("zh-tw") != string::npos ||
-               langStr.find("zh_hk") != string::npos ||
-               langStr.find("zh_sg") != string::npos;
+        if (langStr.find("zh_cn") != string::npos || 
+            langStr.find("zh-tw") != string::npos ||
+            langStr.find("zh_hk") != string::npos ||
+            langStr.find("zh_sg") != string::npos) {
+            return LANG_ZH;
+        }
     }
-    return false;
+    return LANG_EN;
 }
 
-// 双语文本结构
-struct I18NText {
-    string en;
-    string zh;
-    
-    string str() const {
-        return isChineseLocale() ? zh : en;
-    }
+// 设置本地化并确定界面语言, 之后不再读取环境变量
+void initLocale() {
+    setlocale(LC_ALL, "");
+    currentLanguage = detectLanguage();
+    localeIsUtf8 = strcmp(nl_langinfo(CODESET), "UTF-8") == 0;
+}
+
+// 静态消息表: 每行依次为 LANG_EN、LANG_ZH 的文本, 新增语言时在每行末尾追加一列
+const char* const MESSAGES[][LANG_COUNT] = {
+    // MSG_HELP
+    {"Regen - Regular Expression Generator\n\n"
+     "Usage:\n"
+     "  regen [options] [pattern]\n"
+     "  regen --wizard\n\n"
+     "Options:\n"
+     "  -p, --preset <name>      Use preset pattern (email, url, ip, date, time, phone, hex, credit-card)\n"
+     "  -m, --match-whole        Match whole line (add ^ and $)\n"
+     "  -i, --case-insensitive   Case insensitive (ASCII; with --utf8 also Latin, Greek and Cyrillic letters)\n"
+     "  --multiline              Multiline mode\n"
+     "  --dotall                 Dot matches all characters (including newline)\n"
+     "  --utf8, --bytes          Match ., \\W \\D \\S and negated classes per UTF-8 character or per byte\n"
+     "                           (default follows the locale's character set)\n"
+     "  -e, --explain            Output regex explanation\n"
+     "  -f, --format <format>    Output format (regex, cpp, cpp-dfa, c-dfa, python, java, javascript, go, rust)\n"
+     "  --scan [file...]         Scan files (default stdin) and print offset and text of each match\n"
+     "  --presets <a,b,...>      Scan for several presets in one pass, print preset:offset:length:text\n"
+     "  --all-presets            Scan for all presets in one pass\n"
+     "  --threads <n>            Number of scanning threads (0 means one per CPU core)\n"
+     "  --no-cache               Do not read or write the compiled automaton cache (~/.cache/regen)\n"
+     "  --cache-size <MB>        Size limit of the automaton cache, least recently used are removed (default 64)\n"
+     "  --dfa-cache-mb <MB>      Memory budget of each lazy DFA while scanning (default 64)\n"
+     "  --scan-stats             Print lazy DFA cache statistics to stderr after scanning\n"
+     "  --validate <preset> [file...]  Check one value per line (ip octets, calendar dates, Luhn for credit-card,\n"
+     "                           email lengths); one JSON object per line with --json\n"
+     "  --count                  With --validate, print only the numbers of valid and invalid lines\n"
+     "  --generate <N>           Print N random strings matching the pattern (reproducible with --seed, --threads)\n"
+     "  --negative               With --generate, print near-miss strings that do not match\n"
+     "  --learn <pos> [neg]      Infer a whole-line pattern from positive (and negative) samples, one per line\n"
+     "  --from-wordlist <file>   Build a prefix- and suffix-shared pattern from literal words, one per line\n"
+     "  --redact <presets> [file...]  Copy input to stdout with matches of the presets (comma-separated) masked\n"
+     "  --mask <text>            With --redact, the replacement text (default ****)\n"
+     "  --redact-key <key>       With --redact, replace each match with a keyed hash (equal values, equal tokens)\n"
+     "  --optimize               Rewrite the pattern into an equivalent, simpler form and show both sizes\n"
+     "  --analyze                Analyze catastrophic backtracking (ReDoS) risk in backtracking engines\n"
+     "  --stats                  Report AST, NFA and minimized DFA sizes, table bytes, prefilter, engine and\n"
+     "                           backtracking cost (table or --json); exits 1 if the DFA exceeds its budget\n"
+     "  --profile[=<file>]       Time parse, compile, input, prefilter, match and output phases (bytes and\n"
+     "                           allocations too), summarize on stderr and write a Chrome/Perfetto trace (trace.json)\n"
+     "  --equiv <A> <B>          Check whether A and B match the same whole strings, else print the shortest\n"
+     "                           string only one of them matches\n"
+     "  --subset <A> <B>         Check whether every whole string A matches is matched by B\n"
+     "  --bench [pattern...]     Time regen's engine and std::regex on synthetic corpora (default all presets)\n"
+     "  --bench-size <MB>        Corpus size per pattern (default 4)\n"
+     "  --density <0..1>         Fraction of lines containing a match (default 0.1)\n"
+     "  --seed <n>               Corpus random seed (default 1)\n"
+     "  --runs <n>               Runs per measurement, fastest is reported (default 3)\n"
+     "  --json                   Print results as JSON\n"
+     "  --batch <file|->         One job per line (pattern or -p preset plus per-line options), NDJSON output\n"
+     "  --serve <socket>         Stay resident on a Unix socket (mode 0600) and answer one JSON request per line\n"
+     "  -w, --wizard             Enter wizard mode\n"
+     "  -h, --help               Show this help message\n\n"
+     "Examples:\n"
+     "  regen -p email\n"
+     "  regen --wizard\n"
+     "  regen -m -i \"\\d+\" \"Match one or more digits\"\n"
+     "  regen --scan -p email access.log\n"
+     "  regen --bench --bench-size 16 --density 0.05\n"
+     "  regen --batch jobs.txt -f python\n",
+     "Regen - 正则表达式生成工具\n\n"
+     "用法:\n"
+     "  regen [选项] [模式]\n"
+     "  regen --wizard\n\n"
+     "选项:\n"
+     "  -p, --preset <name>      使用预设模式 (email, url, ip, date, time, phone, hex, credit-card)\n"
+     "  -m, --match-whole        匹配整行 (添加 ^ 和 $)\n"
+     "  -i, --case-insensitive   不区分大小写 (ASCII; --utf8 下还包括拉丁、希腊和西里尔字母)\n"
+     "  --multiline              多行模式\n"
+     "  --dotall                 dot匹配所有字符(包括换行符)\n"
+     "  --utf8, --bytes          ., \\W \\D \\S 和取反字符类按 UTF-8 字符或按字节匹配 (默认取决于本地化字符集)\n"
+     "  -e, --explain            输出正则表达式的解释\n"
+     "  -f, --format <format>    输出格式 (regex, cpp, cpp-dfa, c-dfa, python, java, javascript, go, rust)\n"
+     "  --scan [文件...]         扫描文件(默认标准输入), 输出每个匹配的偏移量和文本\n"
+     "  --presets <a,b,...>      单遍扫描多个预设, 输出 预设:偏移:长度:文本\n"
+     "  --all-presets            单遍扫描所有预设\n"
+     "  --threads <n>            扫描使用的线程数 (0 表示 CPU 核数)\n"
+     "  --no-cache               不读写编译后自动机的缓存 (~/.cache/regen)\n"
+     "  --cache-size <MB>        自动机缓存的大小上限, 超出时删除最久未用的 (默认 64)\n"
+     "  --dfa-cache-mb <MB>      扫描时每个惰性 DFA 的内存预算 (默认 64)\n"
+     "  --scan-stats             扫描结束后向标准错误输出惰性 DFA 缓存的统计\n"
+     "  --validate <预设> [文件...]  逐行校验值 (IP 每段范围、日历日期、信用卡 Luhn 校验、邮箱长度等);\n"
+     "                           与 --json 一起时每行输出一个 JSON 对象\n"
+     "  --count                  与 --validate 一起使用, 只输出合法和不合法的行数\n"
+     "  --generate <N>           输出 N 个匹配模式的随机字符串 (可用 --seed 复现, 可用 --threads 并行)\n"
+     "  --negative               与 --generate 一起使用, 输出不匹配的近似串\n"
+     "  --learn <正例> [反例]    从正例 (和反例) 文件归纳整行匹配的模式, 每行一个样本\n"
+     "  --from-wordlist <文件>   把每行一个的字面量合成为共享前缀和后缀的模式\n"
+     "  --redact <预设> [文件...]  把输入复制到标准输出, 预设 (逗号分隔) 的匹配替换为掩码\n"
+     "  --mask <文本>            与 --redact 一起使用, 替换文本 (默认 ****)\n"
+     "  --redact-key <密钥>      与 --redact 一起使用, 把匹配替换为带密钥的散列 (相同的值得到相同的记号)\n"
+     "  --optimize               输出前对模式做保持语义的优化改写, 并显示优化前后的大小\n"
+     "  --analyze                分析模式在回溯引擎中的灾难性回溯 (ReDoS) 风险\n"
+     "  --stats                  报告语法树、NFA 和最小化 DFA 的规模、转移表字节数、预过滤、引擎和回溯代价\n"
+     "                           (表格或 --json); DFA 超出预算时退出码为 1\n"
+     "  --profile[=<文件>]       按阶段 (解析、编译、读入、预过滤、匹配、输出) 统计时间、字节和分配次数,\n"
+     "                           汇总输出到标准错误, 并写出 Chrome/Perfetto 跟踪 (默认 trace.json)\n"
+     "  --equiv <A> <B>          判断 A 和 B 能完整匹配的字符串是否相同, 不同时输出只被其中一个匹配的最短串\n"
+     "  --subset <A> <B>         判断 A 能完整匹配的字符串是否都能被 B 完整匹配\n"
+     "  --bench [模式...]        在合成语料上测量 regen 引擎和 std::regex (默认所有预设)\n"
+     "  --bench-size <MB>        每个模式的语料大小 (默认 4)\n"
+     "  --density <0..1>         含匹配的行所占比例 (默认 0.1)\n"
+     "  --seed <n>               语料随机种子 (默认 1)\n"
+     "  --runs <n>               每项测量的运行次数, 取最快 (默认 3)\n"
+     "  --json                   以 JSON 输出结果\n"
+     "  --batch <文件|->         每行一个任务 (模式或 -p 预设, 加上本行的选项), 以 NDJSON 输出结果\n"
+     "  --serve <套接字>         常驻在 Unix 套接字 (权限 0600) 上, 每行一个 JSON 请求\n"
+     "  -w, --wizard             进入向导模式\n"
+     "  -h, --help               显示帮助信息\n\n"
+     "示例:\n"
+     "  regen -p email\n"
+     "  regen --wizard\n"
+     "  regen -m -i \"\\d+\" \"匹配一个或多个数字\"\n"
+     "  regen --scan -p email access.log\n"
+     "  regen --bench --bench-size 16 --density 0.05\n"
+     "  regen --batch jobs.txt -f python\n"},
+    {"------------------------------------------------------------\n", "------------------------------------\n"},
+    {"Generated Result:\n", "生成结果:\n"},
+    {"Regular Expression: ", "正则表达式: "},
+    {"Optimized: ", "优化: "},
+    {"Description: ", "描述: "},
+    {"Preset pattern: {}", "预设模式: {}"},
+    {"Custom pattern", "自定义模式"},
+    {"{} -> {} bytes ({}%)", "{} -> {} 字节 ({}%)"},
+    {"; cost {} -> {} (capturing groups {} -> {}, extra branches {} -> {}, class members {} -> {})",
+     "; 代价 {} -> {} (捕获组 {} -> {}, 多出的分支 {} -> {}, 字符类成员 {} -> {})"},
+    {", original: ", ", 原模式: "},
+    // 错误
+    {"Error: {} requires an argument\n", "错误: {} 需要参数\n"},
+    {"Error: {} takes exactly two patterns, got {}\nUsage: regen {} [options] <A> <B>\n",
+     "错误: {} 需要恰好两个模式, 实际为 {} 个\n用法: regen {} [选项] <A> <B>\n"},
+    {"Error: Unknown preset pattern '{}'\n", "错误: 未知的预设模式 '{}'\n"},
+    {"Error: Regular expression pattern is required\n", "错误: 需要提供正则表达式模式\n"},
+    {"Error: Cannot read file '{}': {}\n", "错误: 无法读取文件 '{}': {}\n"},
+    {"Error: Cannot compile regular expression: {}\n", "错误: 无法编译正则表达式: {}\n"},
+    {"Error: Cannot analyze regular expression: {}\n", "错误: 无法分析正则表达式: {}\n"},
+    {"Error: Cannot listen on '{}': {}\n", "错误: 无法监听 '{}': {}\n"},
+    {"Listening on {}\n", "正在监听 {}\n"},
+    // 向导
+    {"Regen Wizard Mode - Interactive Regular Expression Generator\n", "Regen 向导模式 - 交互式正则表达式生成\n"},
+    {"Select generation mode:\n"
+     "1. Use preset pattern\n"
+     "2. Custom build pattern\n"
+     "3. Combine multiple patterns\n",
+     "选择生成模式:\n"
+     "1. 使用预设模式\n"
+     "2. 自定义构建模式\n"
+     "3. 组合多个模式\n"},
+    {"Enter your choice (1-3)", "请输入选择(1-3)"},
+    {"Enter your choice (1-2)", "请输入选择(1-2)"},
+    {"\nAvailable preset patterns:\n", "\n可用的预设模式:\n"},
+    {"\nEnter preset pattern name", "\n输入预设模式名称"},
+    {"\nCustom Regular Expression Builder\n", "\n自定义正则表达式构建\n"},
+    {"Enter regular expression pattern", "输入正则表达式模式"},
+    {"Enter pattern description (optional)", "输入模式描述(可选)"},
+    {"\nCombine Multiple Regular Expression Patterns\n", "\n组合多个正则表达式模式\n"},
+    {"\nCurrent pattern: ", "\n当前模式: "},
+    {"None\n", "无\n"},
+    {"\n1. Add preset pattern\n"
+     "2. Add custom pattern\n"
+     "3. Finish building\n",
+     "\n1. 添加预设模式\n"
+     "2. 添加自定义模式\n"
+     "3. 完成构建\n"},
+    {"\nRegular Expression Options:\n", "\n正则表达式选项:\n"},
+    {"Match whole line (add ^ and $)? (y/n)", "匹配整行(添加 ^ 和 $)? (y/n)"},
+    {"Case insensitive? (y/n)", "不区分大小写? (y/n)"},
+    {"Multiline mode? (y/n)", "多行模式? (y/n)"},
+    {"Dot matches all characters (including newline)? (y/n)", "dot匹配所有字符(包括换行符)? (y/n)"},
+    {"Output regex explanation? (y/n)", "输出正则表达式解释? (y/n)"},
+    {"Optimize the regular expression? (y/n)", "优化正则表达式? (y/n)"},
+    {"\nOutput Format Options:\n"
+     "1. Plain regular expression\n"
+     "2. With language code snippet\n",
+     "\n输出格式选项:\n"
+     "1. 纯正则表达式\n"
+     "2. 带语言代码片段\n"},
+    {"\nAvailable languages:\n"
+     "  cpp - C++\n"
+     "  cpp-dfa - C++ (standalone minimized DFA matcher)\n"
+     "  c-dfa - C (standalone minimized DFA matcher)\n"
+     "  python - Python\n"
+     "  java - Java\n"
+     "  javascript - JavaScript\n"
+     "  go - Go\n"
+     "  rust - Rust\n",
+     "\n可用的语言:\n"
+     "  cpp - C++\n"
+     "  cpp-dfa - C++ (独立的最小化 DFA 匹配器)\n"
+     "  c-dfa - C (独立的最小化 DFA 匹配器)\n"
+     "  python - Python\n"
+     "  java - Java\n"
+     "  javascript - JavaScript\n"
+     "  go - Go\n"
+     "  rust - Rust\n"},
+    {"Enter language", "输入语言"},
+    // 解释
+    {"Regular Expression Explanation:\n", "正则表达式解释:\n"},
+    {"  Cannot parse: {}\n", "  无法解析: {}\n"},
+    {"(empty)", "(空)"},
+    {"Match any digit (0-9)", "匹配任何数字 (0-9)"},
+    {"Match any word character (letter, digit, underscore)", "匹配任何单词字符 (字母、数字、下划线)"},
+    {"Match any whitespace character", "匹配任何空白字符"},
+    {"Match any non-digit character", "匹配任何非数字字符"},
+    {"Match any non-word character", "匹配任何非单词字符"},
+    {"Match any non-whitespace character", "匹配任何非空白字符"},
+    {"Match any single character", "匹配任何单个字符 (包括换行符)"},
+    {"Match any single character (except newline)", "匹配任何单个字符 (换行符除外)"},
+    {"Match any character in the set", "匹配字符集中的任意一个字符"},
+    {"Match any character not in the set", "匹配不在字符集中的任意字符"},
+    {"Match character '{}'", "匹配字符 '{}'"},
+    {"Match the text \"{}\"", "匹配文本 \"{}\""},
+    {"Match a newline", "匹配换行符"},
+    {"Match a carriage return", "匹配回车符"},
+    {"Match a tab", "匹配制表符"},
+    {"Match byte {}", "匹配字节 {}"},
+    {"Match the start of a line", "匹配行的开头"},
+    {"Match the end of a line", "匹配行的结尾"},
+    {"Match the start of the text", "匹配文本的开头"},
+    {"Match the end of the text", "匹配文本的结尾"},
+    {"Match a word boundary", "匹配单词边界"},
+    {"Match a non-word boundary", "匹配非单词边界"},
+    {"Match the empty string", "匹配空串"},
+    {"Backreference: match group {} again", "反向引用: 再次匹配捕获组 {} 匹配到的文本"},
+    {"Backreference", "反向引用"},
+    {"Match in sequence:", "依次匹配:"},
+    {"Match one of {} alternatives:", "匹配以下 {} 个分支之一:"},
+    {"Alternative {}:", "分支 {}:"},
+    {"Non-capturing group:", "非捕获组:"},
+    {"Capturing group {}:", "捕获组 {}:"},
+    {"Lookahead: followed by", "先行断言: 后面必须是"},
+    {"Negative lookahead: not followed by", "否定先行断言: 后面不能是"},
+    {"Lookbehind: preceded by", "后行断言: 前面必须是"},
+    {"Negative lookbehind: not preceded by", "否定后行断言: 前面不能是"},
+    {"repeated zero or more times", "重复零次或多次"},
+    {"repeated one or more times", "重复一次或多次"},
+    {"optional (zero or one time)", "可选 (零次或一次)"},
+    {"repeated exactly {} times", "重复 {} 次"},
+    {"repeated at least {} times", "重复至少 {} 次"},
+    {"repeated {} to {} times", "重复 {} 到 {} 次"},
+    {", as few as possible (lazy)", ", 尽可能少 (懒惰)"},
+    {"Built-in matcher: unsupported ({})\n", "内置匹配器: 不支持 ({})\n"},
+    {"Prefilter: {}\n", "预过滤: {}\n"},
+    {"Engine: lazy DFA; bit-parallel Glushkov ({} positions) finds match starts and replaces NFA simulation "
+     "if the DFA cache thrashes\n",
+     "引擎: 惰性 DFA; 位并行 Glushkov ({} 个位置) 确定匹配起点, 并在 DFA 缓存抖动时代替 NFA 模拟\n"},
+    {"Engine: lazy DFA (bit-parallel Glushkov not applicable: {})\n", "引擎: 惰性 DFA (不能使用位并行 Glushkov: {})\n"},
+    {"more than 64 positions", "超过 64 个位置"},
+    {"uses anchors or word boundaries", "含有锚点或单词边界"},
+    {"matches the empty string", "可以匹配空串"},
+    // ReDoS 分析
+    {"exponential O(2^n)", "指数级 O(2^n)"},
+    {"polynomial O(n^{})", "多项式 O(n^{})"},
+    {"linear O(n)", "线性 O(n)"},
+    {", ", "、"},
+    {"quantifier {} can split the same input in exponentially many ways "
+     "(nested quantifiers or overlapping alternatives)",
+     "量词 {} 可以用指数多种方式划分同一段输入 (嵌套量词或重叠分支)"},
+    {"unanchored search retries {} at every start position and each try runs to the end of input",
+     "非锚定搜索在每个起点重新尝试 {}, 每次都扫描到输入末尾"},
+    {"unanchored search retries the adjacent overlapping quantifiers {} at every start position",
+     "非锚定搜索在每个起点重新尝试相邻且重叠的量词 {}"},
+    {"adjacent quantifiers {} match the same characters and can split the input in polynomially many ways",
+     "相邻量词 {} 可以匹配相同的字符, 同一段输入有多项式多种划分"},
+    {"WARNING: catastrophic backtracking risk, worst case {}\n", "警告: 该模式在回溯引擎中有灾难性回溯风险, 最坏 {}\n"},
+    {"Limit the input length or use a linear-time engine (RE2, Go regexp, Rust regex)\n\n",
+     "请限制输入长度, 或改用线性时间引擎 (RE2、Go regexp、Rust regex)\n\n"},
+    {"Cause: ", "原因: "},
+    {"Attack input: ", "攻击输入: "},
+    {"Attack input: none found that makes the match attempt fail; the risk is structural and unconfirmed",
+     "攻击输入: 未找到使匹配尝试失败的输入, 风险来自模式结构, 尚未确认"},
+    {"Worst case in backtracking engines: ", "回溯引擎最坏复杂度: "},
+    {"Affected: Python re, Java, JavaScript, C++ std::regex (backtracking engines)\n",
+     "受影响: Python re、Java、JavaScript、C++ std::regex (回溯引擎)\n"},
+    {"Not affected: Go regexp, Rust regex, regen --scan (linear-time engines)\n",
+     "不受影响: Go regexp、Rust regex、regen --scan (线性时间引擎)\n"},
+    {"Note: the pattern is too complex to analyze exhaustively\n", "注意: 模式过于复杂, 分析未覆盖所有路径\n"},
+    {"Cannot generate a DFA matcher: {}, use -f cpp instead", "无法生成 DFA 匹配器: {}, 请改用 -f cpp"},
+    // 基准测试
+    {"Corpus: {} MB per pattern, density {}, seed {}, best of {} runs\n\n",
+     "语料: 每个模式 {} MB, 匹配密度 {}, 种子 {}, 取 {} 次中最快\n\n"},
+    {"Pattern", "模式"},
+    {"Engine", "引擎"},
+    {"Matches", "匹配数"},
+    {"Time(ms)", "时间(ms)"},
+    {"MB/s", "MB/s"},
+    {"Matches/s", "匹配/s"},
+    {"Peak RSS", "峰值内存"},
+    {"failed: ", "失败: "},
+    {"Warning: match counts differ for '{}' (regen {}, std::regex {})\n",
+     "警告: '{}' 的匹配数不一致 (regen {}, std::regex {})\n"},
+    // 校验
+    {"Valid: {}\nInvalid: {}\n", "有效: {}\n无效: {}\n"},
+    // 样本生成
+    {"Error: no single-line string matching '{}' could be generated\n",
+     "错误: 无法生成匹配 '{}' 的单行字符串\n"},
+    {"Error: no near-miss string for '{}' could be generated (almost every string matches)\n",
+     "错误: 无法为 '{}' 生成近似串 (几乎所有字符串都匹配)\n"},
+    // 模式学习
+    {"Learned from {} positive and {} negative samples (alternatives: {})",
+     "从 {} 个正例和 {} 个反例学习得到 (分支数: {})"},
+    {"Error: no positive samples in '{}'\n", "错误: '{}' 中没有正例\n"},
+    {"Error: '{}' is both a positive and a negative sample\n", "错误: '{}' 同时是正例和反例\n"},
+    {"Error: the learned pattern rejects {} positive and accepts {} negative samples\n",
+     "错误: 学到的模式拒绝了 {} 个正例, 接受了 {} 个反例\n"},
+    // 词表
+    {"{} words (trie nodes: {}, minimized states: {})", "{} 个单词 (字典树节点: {}, 最小化后的状态: {})"},
+    {"Error: no words in '{}'\n", "错误: '{}' 中没有单词\n"},
+    // 资源报告
+    {"AST nodes", "语法树节点"},
+    {"NFA states", "NFA 状态"},
+    {"{} forward, {} reverse", "正向 {}, 反向 {}"},
+    {"Minimized DFA states", "最小化 DFA 状态"},
+    {"{} search, {} reverse, {} whole-input", "搜索 {}, 反向 {}, 整体匹配 {}"},
+    {"exceeds budget ({})", "超出预算 ({})"},
+    {"Transition tables", "转移表"},
+    {"{} bytes ({} byte classes; {} bytes without them)", "{} 字节 ({} 个字节类; 不压缩时 {} 字节)"},
+    {"Prefilter", "预过滤"},
+    {"lazy DFA + bit-parallel Glushkov ({} positions)", "惰性 DFA + 位并行 Glushkov ({} 个位置)"},
+    {"lazy DFA ({})", "惰性 DFA ({})"},
+    {"Backtracking steps/byte", "回溯每字节步数"},
+    {"{}, about {} for a {}-byte input", "{}, 约 {} (输入 {} 字节时)"},
+    {"not analyzed ({})", "未分析 ({})"},
+    {"Error: Cannot compute statistics: {}\n", "错误: 无法统计正则表达式: {}\n"},
+    // 阶段剖析
+    {"Profile: {} ms wall time, {} threads (phase times are summed over threads)\n",
+     "剖析: 墙钟时间 {} ms, {} 个线程 (各阶段时间为所有线程之和)\n"},
+    {"Phase", "阶段"},
+    {"Bytes", "字节"},
+    {"Allocations", "分配次数"},
+    {"Events", "事件数"},
+    {"Trace: {} (open in ui.perfetto.dev or chrome://tracing)\n", "跟踪: {} (用 ui.perfetto.dev 或 chrome://tracing 打开)\n"},
+    {"Error: Cannot write trace '{}': {}\n", "错误: 无法写入跟踪文件 '{}': {}\n"},
+    // 语言比较
+    {"Equivalent: both patterns match exactly the same strings\n", "等价: 两个模式匹配的字符串完全相同\n"},
+    {"Not equivalent\n", "不等价\n"},
+    {"Contained: every string the first pattern matches is matched by the second\n",
+     "包含: 第一个模式匹配的字符串都被第二个模式匹配\n"},
+    {"Not contained\n", "不包含\n"},
+    {"Shortest distinguishing string: {} (matched only by the first pattern)\n",
+     "最短的区分串: {} (只被第一个模式匹配)\n"},
+    {"Shortest distinguishing string: {} (matched only by the second pattern)\n",
+     "最短的区分串: {} (只被第二个模式匹配)\n"},
+    {"Error: Cannot compare patterns: {}\n", "错误: 无法比较模式: {}\n"},
+    // 扫描统计
+    {"Lazy DFA cache: {} MB per automaton\n", "惰性 DFA 缓存: 每个自动机 {} MB\n"},
+    {"  {}: automata {}, transitions {}, hit rate {}%, states built {} (peak {}), flushes {}, byte classes {}\n",
+     "  {}: {} 个自动机, {} 次转移, 命中率 {}%, 构造 {} 个状态 (峰值 {}), 清空 {} 次, {} 个字节类\n"},
+    {"  {}: cache thrashing, automata switched to NFA simulation: {}\n",
+     "  {}: 缓存抖动, {} 个自动机改用 NFA 模拟\n"},
+    {"combined", "组合"},
+    {"forward", "正向"},
+    {"reverse", "反向"}
 };
 
+static_assert(sizeof(MESSAGES) / sizeof(MESSAGES[0]) == MSG_COUNT, "MESSAGES must have one row per MessageId");
+
 // 预设正则表达式模式
 const map<string, pair<string, string>> PRESET_PATTERNS = {
     {"email", {R"([a-zA-Z0-9._%+-]+@[a-zA-Z0-9.-]+\.[a-zA-Z]{2,})", 
@@ -52,290 +425,14 @@ const map<string, pair<string, string>> PRESET_PATTERNS = {
     {"credit-card", {R"(\d{4}[- ]?\d{4}[- ]?\d{4}[- ]?\d{4})", "信用卡号码"}}
 };
 
-// 正则表达式组件
-struct RegexComponent {
-    string pattern;
-    I18NText description;
-};
-
-// 生成选项
-struct GenerationOptions {
-    bool matchWholeLine = false;
-    bool caseInsensitive = false;
-    bool multiline = false;
-    bool dotAll = false;
-    bool outputExplanation = false;
-    string outputFormat = "regex";
-    string language = "";
-};
-
-// 打印帮助信息
-void printHelp() {
-    if (isChineseLocale()) {
-        cout << "Regen - 正则表达式生成工具\n\n";
-        cout << "用法:\n";
-        cout << "  regen [选项] [模式]\n";
-        cout << "  regen --wizard\n\n";
-        cout << "选项:\n";
-        cout << "  -p, --preset <name>      使用预设模式 (email, url, ip, date, time, phone, hex, credit-card)\n";
-        cout << "  -m, --match-whole        匹配整行 (添加 ^ 和 $)\n";
-        cout << "  -i, --case-insensitive   不区分大小写\n";
-        cout << "  --multiline              多行模式\n";
-        cout << "  --dotall                 dot匹配所有字符(包括换行符)\n";
-        cout << "  -e, --explain            输出正则表达式的解释\n";
-        cout << "  -f, --format <format>    输出格式 (regex, cpp, python, java, javascript, go, rust)\n";
-        cout << "  -w, --wizard             进入向导模式\n";
-        cout << "  -h, --help               显示帮助信息\n\n";
-        cout << "示例:\n";
-        cout << "  regen -p email\n";
-        cout << "  regen --wizard\n";
-        cout << "  regen -m -i \"\\d+\" \"匹配一个或多个数字\"\n";
-    } else {
-        cout << "Regen - Regular Expression Generator\n\n";
-        cout << "Usage:\n";
-        cout << "  regen [options] [pattern]\n";
-        cout << "  regen --wizard\n\n";
-        cout << "Options:\n";
-        cout << "  -p, --preset <name>      Use preset pattern (email, url, ip, date, time, phone, hex, credit-card)\n";
-        cout << "  -m, --match-whole        Match whole line (add ^ and $)\n";
-        cout << "  -i, --case-insensitive   Case insensitive\n";
-        cout << "  --multiline              Multiline mode\n";
-        cout << "  --dotall                 Dot matches all characters (including newline)\n";
-        cout << "  -e, --explain            Output regex explanation\n";
-        cout << "  -f, --format <format>    Output format (regex, cpp, python, java, javascript, go, rust)\n";
-        cout << "  -w, --wizard             Enter wizard mode\n";
-        cout << "  -h, --help               Show this help message\n\n";
-        cout << "Examples:\n";
-        cout << "  regen -p email\n";
-        cout << "  regen --wizard\n";
-        cout << "  regen -m -i \"\\d+\" \"Match one or more digits\"\n";
-    }
-}
-
-// 获取用户输入
-string getInput(const I18NText& prompt, const string& defaultValue = "") {
-    cout << prompt.str();
-    if (!defaultValue.empty()) {
-        cout << " [" << defaultValue << "]";
-    }
-    cout << ": ";
-    
-    string input;
-    getline(cin, input);
-    
-    if (input.empty() && !defaultValue.empty()) {
-        return defaultValue;
-    }
-    return input;
-}
-
-// 生成正则表达式解释
-string generateExplanation(const string& pattern) {
-    stringstream explanation;
-    
-    if (isChineseLocale()) {
-        explanation << "正则表达式解释:\n";
-    } else {
-        explanation << "Regular Expression Explanation:\n";
-    }
-    
-    size_t i = 0;
-    while (i < pattern.length()) {
-        char c = pattern[i];
-        
-        switch (c) {
-            case '\\':
-                if (i + 1 < pattern.length()) {
-                    char next = pattern[i + 1];
-                    if (isChineseLocale()) {
-                        switch (next) {
-                            case 'd': explanation << "  \\d - 匹配任何数字 (0-9)\n"; break;
-                            case 'w': explanation << "  \\w - 匹配任何单词字符 (字母、数字、下划线)\n"; break;
-                            case 's': explanation << "  \\s - 匹配任何空白字符\n"; break;
-                            case 'D': explanation << "  \\D - 匹配任何非数字字符\n"; break;
-                            case 'W': explanation << "  \\W - 匹配任何非单词字符\n"; break;
-                            case 'S': explanation << "  \\S - 匹配任何非空白字符\n"; break;
-                            case 'b': explanation << "  \\b - 匹配单词边界\n"; break;
-                            case 'B': explanation << "  \\B - 匹配非单词边界\n"; break;
-                            case '\\': explanation << "  \\\\ - 匹配反斜杠字符\n"; break;
-                            default: explanation << "  \\" << next << " - 匹配转义字符 '" << next << "'\n"; break;
-                        }
-                    } else {
-                        switch (next) {
-                            case 'd': explanation << "  \\d - Match any digit (0-9)\n"; break;
-                            case 'w': explanation << "  \\w - Match any word character (letter, digit, underscore)\n"; break;
-                            case 's': explanation << "  \\s - Match any whitespace character\n"; break;
-                            case 'D': explanation << "  \\D - Match any non-digit character\n"; break;
-                            case 'W': explanation << "  \\W - Match any non-word character\n"; break;
-                            case 'S': explanation << "  \\S - Match any non-whitespace character\n"; break;
-                            case 'b': explanation << "  \\b - Match a word boundary\n"; break;
-                            case 'B': explanation << "  \\B - Match a non-word boundary\n"; break;
-                            case '\\': explanation << "  \\\\ - Match a backslash character\n"; break;
-                            default: explanation << "  \\" << next << " - Match escaped character '" << next << "'\n"; break;
-                        }
-                    }
-                    i += 2;
-                } else {
-                    if (isChineseLocale()) {
-                        explanation << "  \\ - 匹配反斜杠字符\n";
-                    } else {
-                        explanation << "  \\ - Match a backslash character\n";
-                    }
-                    i++;
-                }
-                break;
-                
-            case '^':
-                if (isChineseLocale()) {
-                    explanation << "  ^ - 匹配行的开头\n";
-                } else {
-                    explanation << "  ^ - Match the start of a line\n";
-                }
-                i++;
-                break;
-                
-            case '$':
-                if (isChineseLocale()) {
-                    explanation << "  $ - 匹配行的结尾\n";
-                } else {
-                    explanation << "  $ - Match the end of a line\n";
-                }
-                i++;
-                break;
-                
-            case '.':
-                if (isChineseLocale()) {
-                    explanation << "  . - 匹配任何单个字符(换行符除外)\n";
-                } else {
-                    explanation << "  . - Match any single character (except newline)\n";
-                }
-                i++;
-                break;
-                
-            case '[': {
-                size_t end = pattern.find(']', i);
-                if (end != string::npos) {
-                    string charClass = pattern.substr(i, end - i + 1);
-                    if (isChineseLocale()) {
-                        explanation << "  " << charClass << " - 匹配字符集中的任意一个字符\n";
-                    } else {
-                        explanation << "  " << charClass << " - Match any character in the set\n";
-                    }
-                    i = end + 1;
-                } else {
-                    if (isChineseLocale()) {
-                        explanation << "  [ - 未闭合的字符集\n";
-                    } else {
-                        explanation << "  [ - Unclosed character set\n";
-                    }
-                    i++;
-                }
-                break;
-            }
-                
-            case '(': {
-                size_t end = pattern.find(')', i);
-                if (end != string::npos) {
-                    string group = pattern.substr(i, end - i + 1);
-                    if (isChineseLocale()) {
-                        explanation << "  " << group << " - 捕获组\n";
-                    } else {
-                        explanation << "  " << group << " - Capturing group\n";
-                    }
-                    i = end + 1;
-                } else {
-                    if (isChineseLocale()) {
-                        explanation << "  ( - 未闭合的捕获组\n";
-                    } else {
-                        explanation << "  ( - Unclosed capturing group\n";
-                    }
-                    i++;
-                }
-                break;
-            }
-                
-            case '{': {
-                size_t end = pattern.find('}', i);
-                if (end != string::npos) {
-                    string quantifier = pattern.substr(i, end - i + 1);
-                    if (isChineseLocale()) {
-                        explanation << "  " << quantifier << " - 量词，指定前面元素的重复次数\n";
-                    } else {
-                        explanation << "  " << quantifier << " - Quantifier, specifies how many times the preceding element can occur\n";
-                    }
-                    i = end + 1;
-                } else {
-                    if (isChineseLocale()) {
-                        explanation << "  { - 未闭合的量词\n";
-                    } else {
-                        explanation << "  { - Unclosed quantifier\n";
-                    }
-                    i++;
-                }
-                break;
-            }
-                
-            case '*':
-                if (isChineseLocale()) {
-                    explanation << "  * - 匹配前面的元素零次或多次\n";
-                } else {
-                    explanation << "  * - Match the preceding element zero or more times\n";
-                }
-                i++;
-                break;
-                
-            case '+':
-                if (isChineseLocale()) {
-                    explanation << "  + - 匹配前面的元素一次或多次\n";
-                } else {
-                    explanation << "  + - Match the preceding element one or more times\n";
-                }
-                i++;
-                break;
-                
-            case '?':
-                if (isChineseLocale()) {
-                    explanation << "  ? - 匹配前面的元素零次或一次\n";
-                } else {
-                    explanation << "  ? - Match the preceding element zero or one time\n";
-                }
-                i++;
-                break;
-                
-            case '|':
-                if (isChineseLocale()) {
-                    explanation << "  | - 或操作符\n";
-                } else {
-                    explanation << "  | - OR operator\n";
-                }
-                i++;
-                break;
-                
-            default:
-                if (isalnum(c)) {
-                    if (isChineseLocale()) {
-                        explanation << "  " << c << " - 匹配字符 '" << c << "'\n";
-                    } else {
-                        explanation << "  " << c << " - Match character '" << c << "'\n";
-                    }
-                } else {
-                    if (isChineseLocale()) {
-                        explanation << "  " << c << " - 特殊字符\n";
-                    } else {
-                        explanation << "  " << c << " - Special character\n";
-                    }
-                }
-                i++;
-                break;
-        }
-    }
-    
-    return explanation.str();
-}
-
 // 根据语言生成代码片段
-string generateCodeSnippet(const string& pattern, const string& language, const GenerationOptions& options) {
+string generateCodeSnippet(const ParsedPattern& parsed, const string& pattern, const string& language,
+                           const GenerationOptions& options) {
     stringstream code;
+    if (language == "cpp-dfa" || language == "c-dfa") {
+        return generateDfaCode(parsed, language == "c-dfa");
+    }
+    code << backtrackingWarning(parsed, language, options);
     
     string escapedPattern;
     for (char c : pattern) {
@@ -438,448 +535,3946 @@ string generateCodeSnippet(const string& pattern, const string& language, const
     return code.str();
 }
 
-// 向导模式
-void wizardMode() {
-    if (isChineseLocale()) {
-        cout << "Regen 向导模式 - 交互式正则表达式生成\n";
-        cout << "------------------------------------\n\n";
+// ============================================================
+// 正则引擎: 递归下降解析 -> Thompson NFA -> 惰性 DFA
+// 扫描时间与输入长度成线性关系, 不会回溯
+// ============================================================
+
+// 解码 text[pos] 开始的多字节 UTF-8 序列并返回其长度; ASCII、非法、超长编码或截断的序列返回 0,
+// 由调用者按单个字节处理
+int decodeUtf8(const string& text, size_t pos, uint32_t& codepoint) {
+    unsigned char lead = static_cast<unsigned char>(text[pos]);
+    int length;
+    uint32_t minimum;
+    if (lead >= 0xC2 && lead <= 0xDF) {
+        length = 2; minimum = 0x80; codepoint = lead & 0x1F;
+    } else if (lead >= 0xE0 && lead <= 0xEF) {
+        length = 3; minimum = 0x800; codepoint = lead & 0x0F;
+    } else if (lead >= 0xF0 && lead <= 0xF4) {
+        length = 4; minimum = 0x10000; codepoint = lead & 0x07;
     } else {
-        cout << "Regen Wizard Mode - Interactive Regular Expression Generator\n";
-        cout << "------------------------------------------------------------\n\n";
+        return 0;
     }
-    
-    vector<RegexComponent> components;
-    GenerationOptions options;
-    
-    // 选择模式
-    if (isChineseLocale()) {
-        cout << "选择生成模式:\n";
-        cout << "1. 使用预设模式\n";
-        cout << "2. 自定义构建模式\n";
-        cout << "3. 组合多个模式\n";
+    if (pos + length > text.size()) return 0;
+    for (int k = 1; k < length; ++k) {
+        unsigned char c = static_cast<unsigned char>(text[pos + k]);
+        if ((c & 0xC0) != 0x80) return 0;
+        codepoint = (codepoint << 6) | (c & 0x3F);
+    }
+    if (codepoint < minimum || codepoint > MAX_CODEPOINT || (codepoint >= 0xD800 && codepoint <= 0xDFFF)) return 0;
+    return length;
+}
+
+void appendUtf8(string& out, uint32_t codepoint) {
+    if (codepoint < 0x80) {
+        out.push_back(static_cast<char>(codepoint));
+    } else if (codepoint < 0x800) {
+        out.push_back(static_cast<char>(0xC0 | (codepoint >> 6)));
+        out.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+    } else if (codepoint < 0x10000) {
+        out.push_back(static_cast<char>(0xE0 | (codepoint >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
     } else {
-        cout << "Select generation mode:\n";
-        cout << "1. Use preset pattern\n";
-        cout << "2. Custom build pattern\n";
-        cout << "3. Combine multiple patterns\n";
+        out.push_back(static_cast<char>(0xF0 | (codepoint >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
     }
-    
-    string choice = getInput(isChineseLocale() ? 
-        I18NText{"请输入选择(1-3)", "Enter your choice (1-3)"} : 
-        I18NText{"Enter your choice (1-3)", "请输入选择(1-3)"}, 
-        "1");
-    
-    if (choice == "1") {
-        // 预设模式
-        if (isChineseLocale()) {
-            cout << "\n可用的预设模式:\n";
-        } else {
-            cout << "\nAvailable preset patterns:\n";
-        }
-        
-        for (const auto& preset : PRESET_PATTERNS) {
-            cout << "  " << left << setw(12) << preset.first << " - " << preset.second.first;
-            if (isChineseLocale()) {
-                cout << " (" << preset.second.second << ")";
-            }
-            cout << "\n";
-        }
-        
-        string presetName = getInput(isChineseLocale() ? 
-            I18NText{"\n输入预设模式名称", "\nEnter preset pattern name"} : 
-            I18NText{"\nEnter preset pattern name", "\n输入预设模式名称"});
-        
-        if (PRESET_PATTERNS.find(presetName) != PRESET_PATTERNS.end()) {
-            components.push_back({PRESET_PATTERNS.at(presetName).first, 
-                isChineseLocale() ? 
-                    I18NText{"预设模式: " + presetName, "Preset pattern: " + presetName} : 
-                    I18NText{"Preset pattern: " + presetName, "预设模式: " + presetName}});
+}
+
+// 文本中不属于完整 UTF-8 字符的高位字节写作 \xNN, 其余原样保留
+string escapeStrayBytes(const string& text) {
+    string result;
+    for (size_t pos = 0; pos < text.size();) {
+        unsigned char c = static_cast<unsigned char>(text[pos]);
+        uint32_t codepoint;
+        int length = c >= 0x80 ? decodeUtf8(text, pos, codepoint) : 1;
+        if (length == 0) {
+            char hex[8];
+            snprintf(hex, sizeof(hex), "\\x%02x", c);
+            result += hex;
+            ++pos;
         } else {
-            if (isChineseLocale()) {
-                cerr << "错误: 未知的预设模式 '" << presetName << "'\n";
-            } else {
-                cerr << "Error: Unknown preset pattern '" << presetName << "'\n";
-            }
-            return;
+            result.append(text, pos, length);
+            pos += length;
         }
-    } else if (choice == "2") {
-        // 自定义模式
-        if (isChineseLocale()) {
-            cout << "\n自定义正则表达式构建\n";
-        } else {
-            cout << "\nCustom Regular Expression Builder\n";
-        }
-        
-        string pattern = getInput(isChineseLocale() ? 
-            I18NText{"输入正则表达式模式", "Enter regular expression pattern"} : 
-            I18NText{"Enter regular expression pattern", "输入正则表达式模式"});
-        
-        string description = getInput(isChineseLocale() ? 
-            I18NText{"输入模式描述(可选)", "Enter pattern description (optional)"} : 
-            I18NText{"Enter pattern description (optional)", "输入模式描述(可选)"}, "");
-        
-        components.push_back({pattern, 
-            isChineseLocale() ? 
-                I18NText{description.empty() ? "自定义模式" : description, 
-                         description.empty() ? "Custom pattern" : description} : 
-                I18NText{description.empty() ? "Custom pattern" : description, 
-                         description.empty() ? "自定义模式" : description}});
-    } else if (choice == "3") {
-        // 组合模式
-        if (isChineseLocale()) {
-            cout << "\n组合多个正则表达式模式\n";
+    }
+    return result;
+}
+
+// 简单的非 ASCII 大小写对应 (拉丁字母补充与扩展 A、希腊字母、西里尔字母), 没有对应时返回 codepoint 本身
+uint32_t otherCaseCodepoint(uint32_t c) {
+    if (c >= 0xC0 && c <= 0xDE && c != 0xD7) return c + 0x20;
+    if (c >= 0xE0 && c <= 0xFE && c != 0xF7) return c - 0x20;
+    if (c == 0xFF) return 0x178;
+    if (c == 0x178) return 0xFF;
+    if ((c >= 0x100 && c <= 0x12F) || (c >= 0x132 && c <= 0x137) || (c >= 0x14A && c <= 0x177)) return c ^ 1;
+    if ((c >= 0x139 && c <= 0x148) || (c >= 0x179 && c <= 0x17E)) return (c & 1) ? c + 1 : c - 1;
+    if (c >= 0x391 && c <= 0x3AB && c != 0x3A2) return c + 0x20;
+    if (c >= 0x3B1 && c <= 0x3CB && c != 0x3C2) return c - 0x20;
+    if (c >= 0x400 && c <= 0x40F) return c + 0x50;
+    if (c >= 0x410 && c <= 0x42F) return c + 0x20;
+    if (c >= 0x430 && c <= 0x44F) return c - 0x20;
+    if (c >= 0x450 && c <= 0x45F) return c - 0x50;
+    return c;
+}
+
+// 排序并合并重叠或相邻的区间
+void normalizeCodepoints(CodepointRanges& ranges) {
+    sort(ranges.begin(), ranges.end());
+    CodepointRanges merged;
+    for (const auto& range : ranges) {
+        if (!merged.empty() && range.first <= merged.back().second + 1) {
+            merged.back().second = max(merged.back().second, range.second);
         } else {
-            cout << "\nCombine Multiple Regular Expression Patterns\n";
+            merged.push_back(range);
         }
-        
-        while (true) {
-            if (isChineseLocale()) {
-                cout << "\n当前模式: ";
-            } else {
-                cout << "\nCurrent pattern: ";
-            }
-            
-            if (components.empty()) {
-                if (isChineseLocale()) {
-                    cout << "无\n";
-                } else {
-                    cout << "None\n";
-                }
-            } else {
-                for (const auto& comp : components) {
-                    cout << comp.pattern;
-                }
-                cout << "\n";
-            }
-            
-            if (isChineseLocale()) {
-                cout << "\n1. 添加预设模式\n";
-                cout << "2. 添加自定义模式\n";
-                cout << "3. 完成构建\n";
-            } else {
-                cout << "\n1. Add preset pattern\n";
-                cout << "2. Add custom pattern\n";
-                cout << "3. Finish building\n";
-            }
-            
-            string subChoice = getInput(isChineseLocale() ? 
-                I18NText{"请输入选择(1-3)", "Enter your choice (1-3)"} : 
-                I18NText{"Enter your choice (1-3)", "请输入选择(1-3)"}, 
-                "3");
-            
-            if (subChoice == "1") {
-                // 添加预设
-                if (isChineseLocale()) {
-                    cout << "\n可用的预设模式:\n";
-                } else {
-                    cout << "\nAvailable preset patterns:\n";
-                }
-                
-                for (const auto& preset : PRESET_PATTERNS) {
-                    cout << "  " << left << setw(12) << preset.first << " - " << preset.second.first;
-                    if (isChineseLocale()) {
-                        cout << " (" << preset.second.second << ")";
-                    }
-                    cout << "\n";
-                }
-                
-                string presetName = getInput(isChineseLocale() ? 
-                    I18NText{"\n输入预设模式名称", "\nEnter preset pattern name"} : 
-                    I18NText{"\nEnter preset pattern name", "\n输入预设模式名称"});
-                
-                if (PRESET_PATTERNS.find(presetName) != PRESET_PATTERNS.end()) {
-                    components.push_back({PRESET_PATTERNS.at(presetName).first, 
-                        isChineseLocale() ? 
-                            I18NText{"预设模式: " + presetName, "Preset pattern: " + presetName} : 
-                            I18NText{"Preset pattern: " + presetName, "预设模式: " + presetName}});
-                } else {
-                    if (isChineseLocale()) {
-                        cerr << "错误: 未知的预设模式 '" << presetName << "'\n";
-                    } else {
-                        cerr << "Error: Unknown preset pattern '" << presetName << "'\n";
-                    }
-                }
-            } else if (subChoice == "2") {
-                // 添加自定义
-                string pattern = getInput(isChineseLocale() ? 
-                    I18NText{"输入正则表达式模式", "Enter regular expression pattern"} : 
-                    I18NText{"Enter regular expression pattern", "输入正则表达式模式"});
-                
-                string description = getInput(isChineseLocale() ? 
-                    I18NText{"输入模式描述(可选)", "Enter pattern description (optional)"} : 
-                    I18NText{"Enter pattern description (optional)", "输入模式描述(可选)"}, "");
-                
-                components.push_back({pattern, 
-                    isChineseLocale() ? 
-                        I18NText{description.empty() ? "自定义模式" : description, 
-                                 description.empty() ? "Custom pattern" : description} : 
-                        I18NText{description.empty() ? "Custom pattern" : description, 
-                                 description.empty() ? "自定义模式" : description}});
-            } else if (subChoice == "3") {
-                break;
+    }
+    ranges.swap(merged);
+}
+
+// U+0080..U+10FFFF 中不在 ranges (已规范化) 内的部分
+CodepointRanges complementCodepoints(const CodepointRanges& ranges) {
+    CodepointRanges result;
+    uint32_t next = 0x80;
+    for (const auto& range : ranges) {
+        if (range.first > next) result.push_back(make_pair(next, range.first - 1));
+        next = range.second + 1;
+    }
+    if (next <= MAX_CODEPOINT) result.push_back(make_pair(next, MAX_CODEPOINT));
+    return result;
+}
+
+// 递归下降解析器
+class RegexParser {
+public:
+    RegexParser(const string& pattern, const GenerationOptions& options, RegexAst& ast)
+        : pattern(pattern), options(options), ast(ast) {}
+
+    bool parse(string& errorOut) {
+        ast.nodes.clear();
+        ast.children.clear();
+        ast.groupCount = 0;
+        ast.groupNames.assign(1, string());
+        ast.utf8 = options.utf8;
+        pos = 0;
+        error.clear();
+        int root = parseAlternation(0);
+        if (error.empty() && pos < pattern.size()) {
+            fail(pattern[pos] == ')' ? "unmatched ')'" : "unexpected character");
+        }
+        for (RegexNode& node : ast.nodes) {
+            if (node.type == NODE_BACKREF && node.group > ast.groupCount) {
+                pos = node.srcBegin;
+                fail("reference to a nonexistent group");
             }
         }
+        if (!error.empty()) {
+            errorOut = error + " at position " + to_string(pos);
+            return false;
+        }
+        ast.root = root;
+        return true;
     }
-    
-    // 组合所有模式
-    string finalPattern;
-    for (const auto& comp : components) {
-        finalPattern += comp.pattern;
+
+private:
+    const string& pattern;
+    const GenerationOptions& options;
+    RegexAst& ast;
+    size_t pos = 0;
+    int depth = 0;
+    string error;
+
+    int fail(const string& message) {
+        if (error.empty()) error = message;
+        return -1;
     }
-    
-    // 设置选项
-    if (isChineseLocale()) {
-        cout << "\n正则表达式选项:\n";
-    } else {
-        cout << "\nRegular Expression Options:\n";
+
+    bool atEnd() const { return pos >= pattern.size(); }
+
+    int addNode(const RegexNode& node) {
+        ast.nodes.push_back(node);
+        return static_cast<int>(ast.nodes.size()) - 1;
     }
-    
-    options.matchWholeLine = getInput(isChineseLocale() ? 
-        I18NText{"匹配整行(添加 ^ 和 $)? (y/n)", "Match whole line (add ^ and $)? (y/n)"} : 
-        I18NText{"Match whole line (add ^ and $)? (y/n)", "匹配整行(添加 ^ 和 $)? (y/n)"}, 
-        "n") == "y";
-    
-    options.caseInsensitive = getInput(isChineseLocale() ? 
-        I18NText{"不区分大小写? (y/n)", "Case insensitive? (y/n)"} : 
-        I18NText{"Case insensitive? (y/n)", "不区分大小写? (y/n)"}, 
-        "n") == "y";
-    
-    options.multiline = getInput(isChineseLocale() ? 
-        I18NText{"多行模式? (y/n)", "Multiline mode? (y/n)"} : 
-        I18NText{"Multiline mode? (y/n)", "多行模式? (y/n)"}, 
-        "n") == "y";
-    
-    options.dotAll = getInput(isChineseLocale() ? 
-        I18NText{"dot匹配所有字符(包括换行符)? (y/n)", "Dot matches all characters (including newline)? (y/n)"} : 
-        I18NText{"Dot matches all characters (including newline)? (y/n)", "dot匹配所有字符(包括换行符)? (y/n)"}, 
-        "n") == "y";
-    
-    options.outputExplanation = getInput(isChineseLocale() ? 
-        I18NText{"输出正则表达式解释? (y/n)", "Output regex explanation? (y/n)"} : 
-        I18NText{"Output regex explanation? (y/n)", "输出正则表达式解释? (y/n)"}, 
-        "y") == "y";
-    
-    // 输出格式
-    if (isChineseLocale()) {
-        cout << "\n输出格式选项:\n";
-        cout << "1. 纯正则表达式\n";
-        cout << "2. 带语言代码片段\n";
-    } else {
-        cout << "\nOutput Format Options:\n";
-        cout << "1. Plain regular expression\n";
-        cout << "2. With language code snippet\n";
+
+    int addComposite(RegexNodeType type, const vector<int>& kids, size_t begin) {
+        RegexNode node;
+        node.type = type;
+        node.childBegin = static_cast<int>(ast.children.size());
+        node.childCount = static_cast<int>(kids.size());
+        node.srcBegin = static_cast<int>(begin);
+        node.srcEnd = static_cast<int>(pos);
+        ast.children.insert(ast.children.end(), kids.begin(), kids.end());
+        return addNode(node);
     }
-    
-    string formatChoice = getInput(isChineseLocale() ? 
-        I18NText{"请输入选择(1-2)", "Enter your choice (1-2)"} : 
-        I18NText{"Enter your choice (1-2)", "请输入选择(1-2)"}, 
-        "1");
-    
-    if (formatChoice == "2") {
-        if (isChineseLocale()) {
-            cout << "\n可用的语言:\n";
-            cout << "  cpp - C++\n";
-            cout << "  python - Python\n";
-            cout << "  java - Java\n";
-            cout << "  javascript - JavaScript\n";
-            cout << "  go - Go\n";
-            cout << "  rust - Rust\n";
-        } else {
-            cout << "\nAvailable languages:\n";
-            cout << "  cpp - C++\n";
-            cout << "  python - Python\n";
-            cout << "  java - Java\n";
-            cout << "  javascript - JavaScript\n";
-            cout << "  go - Go\n";
-            cout << "  rust - Rust\n";
-        }
-        
-        options.language = getInput(isChineseLocale() ? 
-            I18NText{"输入语言", "Enter language"} : 
-            I18NText{"Enter language", "输入语言"});
-        options.outputFormat = "code";
+
+    int addSet(const ByteSet& set, char shorthand, size_t begin, const CodepointRanges& codepoints = CodepointRanges()) {
+        RegexNode node;
+        node.type = NODE_SET;
+        node.set = set;
+        node.codepoints = codepoints;
+        node.shorthand = shorthand;
+        node.srcBegin = static_cast<int>(begin);
+        node.srcEnd = static_cast<int>(pos);
+        return addNode(node);
     }
-    
-    // 应用选项
-    if (options.matchWholeLine) {
-        finalPattern = "^" + finalPattern + "$";
+
+    int addAssert(AssertKind kind, size_t begin) {
+        RegexNode node;
+        node.type = NODE_ASSERT;
+        node.assertion = kind;
+        node.srcBegin = static_cast<int>(begin);
+        node.srcEnd = static_cast<int>(pos);
+        return addNode(node);
     }
-    
-    // 输出结果
-    if (isChineseLocale()) {
-        cout << "\n生成结果:\n";
-        cout << "------------------------------------\n";
-        cout << "正则表达式: " << finalPattern << "\n";
-    } else {
-        cout << "\nGenerated Result:\n";
-        cout << "------------------------------------------------------------\n";
-        cout << "Regular Expression: " << finalPattern << "\n";
+
+    // UTF-8 模式下取反后的集合不匹配单独的高位字节, 改为匹配 ranges 以外的所有非 ASCII 码点
+    void invertUtf8(ByteSet& set, CodepointRanges& ranges) const {
+        set.bits[2] = set.bits[3] = 0;
+        normalizeCodepoints(ranges);
+        ranges = complementCodepoints(ranges);
     }
-    
-    if (options.outputExplanation) {
-        cout << "\n" << generateExplanation(finalPattern) << "\n";
+
+    void foldCase(ByteSet& set) const {
+        if (!options.caseInsensitive) return;
+        for (int c = 'a'; c <= 'z'; ++c) {
+            if (set.has(static_cast<unsigned char>(c)) || set.has(static_cast<unsigned char>(c - 32))) {
+                set.add(static_cast<unsigned char>(c));
+                set.add(static_cast<unsigned char>(c - 32));
+            }
+        }
     }
-    
-    if (options.outputFormat == "code" && !options.language.empty()) {
-        string code = generateCodeSnippet(finalPattern, options.language, options);
-        if (!code.empty()) {
-            cout << "\n" << code << "\n";
+
+    // UTF-8 模式下码点区间也加入另一种大小写 (只有 U+00C0..U+045F 中有对应)
+    void foldCase(ByteSet& set, CodepointRanges& codepoints) const {
+        foldCase(set);
+        if (!options.caseInsensitive || !options.utf8) return;
+        size_t count = codepoints.size();
+        for (size_t k = 0; k < count; ++k) {
+            uint32_t hi = min<uint32_t>(codepoints[k].second, 0x45F);
+            for (uint32_t c = max<uint32_t>(codepoints[k].first, 0xC0); c <= hi; ++c) {
+                uint32_t other = otherCaseCodepoint(c);
+                if (other != c) codepoints.push_back(make_pair(other, other));
+            }
         }
+        normalizeCodepoints(codepoints);
     }
-    
-    if (isChineseLocale()) {
-        cout << "------------------------------------\n";
-    } else {
-        cout << "------------------------------------------------------------\n";
+
+    int parseAlternation(size_t begin) {
+        vector<int> branches;
+        while (true) {
+            int branch = parseConcat();
+            if (branch < 0) return -1;
+            branches.push_back(branch);
+            if (atEnd() || pattern[pos] != '|') break;
+            ++pos;
+        }
+        if (branches.size() == 1) return branches[0];
+        return addComposite(NODE_ALTERNATE, branches, begin);
     }
-}
 
-// 直接参数模式
-void directMode(const vector<string>& args) {
-    string pattern;
-    string description;
-    GenerationOptions options;
-    bool usePreset = false;
-    string presetName;
-    
-    // 解析参数
-    for (size_t i = 1; i < args.size(); ++i) {
-        if (args[i] == "-h" || args[i] == "--help") {
-            printHelp();
-            return;
-        } else if (args[i] == "-w" || args[i] == "--wizard") {
-            wizardMode();
-            return;
-        } else if (args[i] == "-p" || args[i] == "--preset") {
-            if (i + 1 < args.size()) {
-                usePreset = true;
-                presetName = args[++i];
+    int parseConcat() {
+        size_t begin = pos;
+        vector<int> items;
+        while (!atEnd() && pattern[pos] != '|' && pattern[pos] != ')') {
+            int item = parseRepeat();
+            if (item < 0) return -1;
+            items.push_back(item);
+        }
+        if (items.empty()) {
+            RegexNode node;
+            node.srcBegin = node.srcEnd = static_cast<int>(begin);
+            return addNode(node);
+        }
+        if (items.size() == 1) return items[0];
+        return addComposite(NODE_CONCAT, items, begin);
+    }
+
+    // 解析 {n} {n,} {n,m}, 不合法时按字面量 '{' 处理
+    bool parseBraces(int& minCount, int& maxCount) {
+        size_t p = pos + 1;
+        auto readNumber = [&](int& value) {
+            size_t start = p;
+            long long v = 0;
+            while (p < pattern.size() && isdigit(static_cast<unsigned char>(pattern[p]))) {
+                v = v * 10 + (pattern[p] - '0');
+                if (v > 100000) v = 100000;
+                ++p;
+            }
+            value = static_cast<int>(v);
+            return p > start;
+        };
+        if (!readNumber(minCount)) return false;
+        maxCount = minCount;
+        if (p < pattern.size() && pattern[p] == ',') {
+            ++p;
+            if (!readNumber(maxCount)) maxCount = -1;
+        }
+        if (p >= pattern.size() || pattern[p] != '}') return false;
+        pos = p + 1;
+        return true;
+    }
+
+    int parseRepeat() {
+        size_t begin = pos;
+        int atom = parseAtom();
+        if (atom < 0) return -1;
+        while (!atEnd()) {
+            char c = pattern[pos];
+            int minCount, maxCount;
+            if (c == '*') {
+                minCount = 0; maxCount = -1; ++pos;
+            } else if (c == '+') {
+                minCount = 1; maxCount = -1; ++pos;
+            } else if (c == '?') {
+                minCount = 0; maxCount = 1; ++pos;
+            } else if (c == '{' && parseBraces(minCount, maxCount)) {
+                if (maxCount != -1 && maxCount < minCount) return fail("invalid repeat range");
+                if (minCount > 1000 || maxCount > 1000) return fail("repeat count too large");
             } else {
-                if (isChineseLocale()) {
-                    cerr << "错误: --preset 需要参数\n";
-                } else {
-                    cerr << "Error: --preset requires an argument\n";
-                }
-                return;
+                break;
+            }
+            bool greedy = true;
+            if (!atEnd() && pattern[pos] == '?') {
+                greedy = false;
+                ++pos;
+            } else if (!atEnd() && pattern[pos] == '+') {
+                return fail("possessive quantifiers are not supported");
+            }
+            vector<int> kids(1, atom);
+            atom = addComposite(NODE_REPEAT, kids, begin);
+            RegexNode& node = ast.nodes[atom];
+            node.minRepeat = minCount;
+            node.maxRepeat = maxCount;
+            node.greedy = greedy;
+        }
+        return atom;
+    }
+
+    int parseAtom() {
+        size_t begin = pos;
+        char c = pattern[pos];
+        switch (c) {
+            case '(':
+                return parseGroup();
+            case '[': {
+                ByteSet set;
+                CodepointRanges codepoints;
+                if (!parseClass(set, codepoints)) return -1;
+                return addSet(set, 0, begin, codepoints);
+            }
+            case '.': {
+                ++pos;
+                ByteSet set;
+                set.invert();
+                if (!options.dotAll) set.bits[0] &= ~(uint64_t(1) << '\n');
+                CodepointRanges codepoints;
+                if (options.utf8) invertUtf8(set, codepoints);
+                return addSet(set, '.', begin, codepoints);
             }
-        } else if (args[i] == "-m" || args[i] == "--match-whole") {
-            options.matchWholeLine = true;
-        } else if (args[i] == "-i" || args[i] == "--case-insensitive") {
-            options.caseInsensitive = true;
-        } else if (args[i] == "--multiline") {
-            options.multiline = true;
-        } else if (args[i] == "--dotall") {
-            options.dotAll = true;
-        } else if (args[i] == "-e" || args[i] == "--explain") {
-            options.outputExplanation = true;
-        } else if (args[i] == "-f" || args[i] == "--format") {
-            if (i + 1 < args.size()) {
-                options.outputFormat = args[++i];
-                if (options.outputFormat != "regex") {
-                    options.language = options.outputFormat;
-                    options.outputFormat = "code";
+            case '^':
+                ++pos;
+                return addAssert(options.multiline ? ASSERT_LINE_BEGIN : ASSERT_TEXT_BEGIN, begin);
+            case '$':
+                ++pos;
+                return addAssert(options.multiline ? ASSERT_LINE_END : ASSERT_TEXT_END, begin);
+            case '*':
+            case '+':
+            case '?':
+                return fail("nothing to repeat");
+            case '\\':
+                return parseEscapeAtom();
+            default: {
+                // UTF-8 模式下多字节字符是一个原子, 量词作用于整个字符
+                uint32_t codepoint;
+                int length = options.utf8 ? decodeUtf8(pattern, pos, codepoint) : 0;
+                if (length > 0 && options.caseInsensitive && otherCaseCodepoint(codepoint) != codepoint) {
+                    pos += length;
+                    CodepointRanges codepoints(1, make_pair(codepoint, codepoint));
+                    ByteSet set;
+                    foldCase(set, codepoints);
+                    return addSet(set, 0, begin, codepoints);
                 }
-            } else {
-                if (isChineseLocale()) {
-                    cerr << "错误: --format 需要参数\n";
-                } else {
-                    cerr << "Error: --format requires an argument\n";
+                if (length > 0) {
+                    vector<int> bytes;
+                    for (int k = 0; k < length; ++k) {
+                        ByteSet set;
+                        set.add(static_cast<unsigned char>(pattern[pos++]));
+                        bytes.push_back(addSet(set, 0, pos - 1));
+                    }
+                    return addComposite(NODE_CONCAT, bytes, begin);
                 }
-                return;
+                ++pos;
+                ByteSet set;
+                set.add(static_cast<unsigned char>(c));
+                foldCase(set);
+                return addSet(set, 0, begin);
             }
-        } else if (pattern.empty()) {
-            pattern = args[i];
-        } else if (description.empty()) {
-            description = args[i];
         }
     }
-    
-    // 获取模式
-    if (usePreset) {
-        if (PRESET_PATTERNS.find(presetName) != PRESET_PATTERNS.end()) {
-            pattern = PRESET_PATTERNS.at(presetName).first;
-            description = isChineseLocale() ? 
-                ("预设模式: " + presetName) : 
-                ("Preset pattern: " + presetName);
-        } else {
-            if (isChineseLocale()) {
-                cerr << "错误: 未知的预设模式 '" << presetName << "'\n";
-            } else {
-                cerr << "Error: Unknown preset pattern '" << presetName << "'\n";
-            }
-            return;
+
+    // 读取 <name> 或 P<name> 中到 terminator 为止的组名, pos 指向组名第一个字符
+    bool readGroupName(char terminator, string& name) {
+        size_t end = pattern.find(terminator, pos);
+        if (end == string::npos) {
+            pos = pattern.size();
+            fail("unterminated group name");
+            return false;
         }
-    } else if (pattern.empty()) {
-        if (isChineseLocale()) {
-            cerr << "错误: 需要提供正则表达式模式\n";
-        } else {
-            cerr << "Error: Regular expression pattern is required\n";
+        name = pattern.substr(pos, end - pos);
+        if (name.empty()) {
+            fail("empty group name");
+            return false;
         }
-        printHelp();
-        return;
-    }
-    
-    // 应用选项
-    if (options.matchWholeLine) {
-        pattern = "^" + pattern + "$";
+        pos = end + 1;
+        return true;
     }
-    
-    // 输出结果
-    if (isChineseLocale()) {
-        cout << "生成结果:\n";
-        cout << "------------------------------------\n";
-        cout << "正则表达式: " << pattern << "\n";
-        if (!description.empty()) {
-            cout << "描述: " << description << "\n";
-        }
-    } else {
-        cout << "Generated Result:\n";
-        cout << "------------------------------------------------------------\n";
-        cout << "Regular Expression: " << pattern << "\n";
-        if (!description.empty()) {
-            cout << "Description: " << description << "\n";
+
+    int namedGroup(const string& name) const {
+        for (size_t k = 1; k < ast.groupNames.size(); ++k) {
+            if (ast.groupNames[k] == name) return static_cast<int>(k);
         }
+        return -1;
     }
-    
-    if (options.outputExplanation) {
-        cout << "\n" << generateExplanation(pattern) << "\n";
+
+    int addBackref(int group, size_t begin) {
+        RegexNode node;
+        node.type = NODE_BACKREF;
+        node.group = group;
+        node.srcBegin = static_cast<int>(begin);
+        node.srcEnd = static_cast<int>(pos);
+        return addNode(node);
     }
-    
-    if (options.outputFormat == "code" && !options.language.empty()) {
-        string code = generateCodeSnippet(pattern, options.language, options);
-        if (!code.empty()) {
-            cout << "\n" << code << "\n";
+
+    int parseGroup() {
+        size_t begin = pos;
+        ++pos;
+        bool capturing = true;
+        bool lookaround = false;
+        bool lookBehind = false;
+        bool negated = false;
+        string name;
+        if (pattern.compare(pos, 2, "?:") == 0) {
+            capturing = false;
+            pos += 2;
+        } else if (pattern.compare(pos, 2, "?=") == 0 || pattern.compare(pos, 2, "?!") == 0) {
+            lookaround = true;
+            negated = pattern[pos + 1] == '!';
+            pos += 2;
+        } else if (pattern.compare(pos, 3, "?<=") == 0 || pattern.compare(pos, 3, "?<!") == 0) {
+            lookaround = lookBehind = true;
+            negated = pattern[pos + 2] == '!';
+            pos += 3;
+        } else if (pattern.compare(pos, 3, "?P=") == 0) {
+            pos += 3;
+            if (!readGroupName(')', name)) return -1;
+            int group = namedGroup(name);
+            if (group < 0) return fail("reference to an undefined group name");
+            return addBackref(group, begin);
+        } else if (pattern.compare(pos, 2, "?<") == 0 || pattern.compare(pos, 3, "?P<") == 0) {
+            pos += pattern[pos + 1] == 'P' ? 3 : 2;
+            if (!readGroupName('>', name)) return -1;
+            if (namedGroup(name) >= 0) return fail("duplicate group name");
+        } else if (!atEnd() && pattern[pos] == '?') {
+            return fail("inline flags are not supported");
         }
+        capturing = capturing && !lookaround;
+        int index = 0;
+        if (capturing) {
+            index = ++ast.groupCount;
+            ast.groupNames.push_back(name);
+        }
+        if (++depth > 500) return fail("groups nested too deeply");
+        int inner = parseAlternation(pos);
+        --depth;
+        if (inner < 0) return -1;
+        if (atEnd() || pattern[pos] != ')') return fail("missing ')'");
+        ++pos;
+        vector<int> kids(1, inner);
+        int group = addComposite(lookaround ? NODE_LOOKAROUND : NODE_GROUP, kids, begin);
+        RegexNode& node = ast.nodes[group];
+        node.capturing = capturing;
+        node.group = index;
+        node.lookBehind = lookBehind;
+        node.negated = negated;
+        return group;
     }
-    
-    if (isChineseLocale()) {
-        cout << "------------------------------------\n";
-    } else {
-        cout << "------------------------------------------------------------\n";
-    }
-}
 
-int main(int argc, char* argv[]) {
-    // 设置本地化
-    setlocale(LC_ALL, "");
-    
-    vector<string> args(argv, argv + argc);
-    
-    if (argc == 1) {
-        printHelp();
-        return 0;
+    static int hexValue(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
     }
-    
-    // 检查是否是向导模式
-    for (const auto& arg : args) {
-        if (arg == "-w" || arg == "--wizard") {
-            wizardMode();
-            return 0;
+
+    // 解析转义序列中的字符集合 (\d \w \s 及单字符转义), pos 指向 '\\'; \xNN 总是单个字节
+    bool parseEscapeSet(ByteSet& set, char& shorthand, CodepointRanges& codepoints) {
+        if (pos + 1 >= pattern.size()) {
+            fail("trailing backslash");
+            return false;
         }
-    }
-    
-    // 直接参数模式
-    directMode(args);
-    
-    return 0;
-}
\ No newline at end of file
+        char c = pattern[pos + 1];
+        pos += 2;
+        shorthand = 0;
+        switch (c) {
+            case 'd': case 'D':
+                set.addRange('0', '9');
+                break;
+            case 'w': case 'W':
+                set.addRange('a', 'z');
+                set.addRange('A', 'Z');
+                set.addRange('0', '9');
+                set.add('_');
+                break;
+            case 's': case 'S':
+                set.add(' '); set.add('\t'); set.add('\n');
+                set.add('\r'); set.add('\f'); set.add('\v');
+                break;
+            case 'n': set.add('\n'); return true;
+            case 't': set.add('\t'); return true;
+            case 'r': set.add('\r'); return true;
+            case 'f': set.add('\f'); return true;
+            case 'v': set.add('\v'); return true;
+            case '0': set.add('\0'); return true;
+            case 'x': {
+                if (pos + 1 < pattern.size() && hexValue(pattern[pos]) >= 0 && hexValue(pattern[pos + 1]) >= 0) {
+                    set.add(static_cast<unsigned char>(hexValue(pattern[pos]) * 16 + hexValue(pattern[pos + 1])));
+                    pos += 2;
+                    return true;
+                }
+                fail("invalid \\x escape");
+                return false;
+            }
+            default:
+                if (isdigit(static_cast<unsigned char>(c))) {
+                    fail("backreferences are not allowed in a character class");
+                    return false;
+                }
+                if (isalpha(static_cast<unsigned char>(c))) {
+                    fail(string("unsupported escape \\") + c);
+                    return false;
+                }
+                set.add(static_cast<unsigned char>(c));
+                foldCase(set);
+                return true;
+        }
+        shorthand = c;
+        if (isupper(static_cast<unsigned char>(c))) {
+            set.invert();
+            if (options.utf8) invertUtf8(set, codepoints);
+        }
+        return true;
+    }
+
+    int parseEscapeAtom() {
+        size_t begin = pos;
+        if (pos + 1 < pattern.size()) {
+            char c = pattern[pos + 1];
+            AssertKind kind;
+            bool isAssert = true;
+            switch (c) {
+                case 'b': kind = ASSERT_WORD_BOUNDARY; break;
+                case 'B': kind = ASSERT_NOT_WORD_BOUNDARY; break;
+                case 'A': kind = ASSERT_TEXT_BEGIN; break;
+                case 'z': kind = ASSERT_TEXT_END; break;
+                default: isAssert = false; kind = ASSERT_TEXT_END; break;
+            }
+            if (isAssert) {
+                pos += 2;
+                return addAssert(kind, begin);
+            }
+            // 反向引用 \1..\99 和 \k<name>
+            if (c >= '1' && c <= '9') {
+                int group = c - '0';
+                pos += 2;
+                if (!atEnd() && isdigit(static_cast<unsigned char>(pattern[pos])) &&
+                    group * 10 + (pattern[pos] - '0') <= ast.groupCount) {
+                    group = group * 10 + (pattern[pos] - '0');
+                    ++pos;
+                }
+                return addBackref(group, begin);
+            }
+            if (c == 'k' && pos + 2 < pattern.size() && pattern[pos + 2] == '<') {
+                pos += 3;
+                string name;
+                if (!readGroupName('>', name)) return -1;
+                int group = namedGroup(name);
+                if (group < 0) return fail("reference to an undefined group name");
+                return addBackref(group, begin);
+            }
+        }
+        ByteSet set;
+        char shorthand;
+        CodepointRanges codepoints;
+        if (!parseEscapeSet(set, shorthand, codepoints)) return -1;
+        return addSet(set, shorthand, begin, codepoints);
+    }
+
+    // UTF-8 模式下 [lo, hi] 中 ASCII 部分加入字节集, 其余作为码点区间
+    static void addCodepointRange(ByteSet& set, CodepointRanges& codepoints, uint32_t lo, uint32_t hi) {
+        if (lo < 0x80) set.addRange(static_cast<unsigned char>(lo), static_cast<unsigned char>(min<uint32_t>(hi, 0x7F)));
+        if (hi >= 0x80) codepoints.push_back(make_pair(max<uint32_t>(lo, 0x80), hi));
+    }
+
+    // 读取字符类中的一个字面字符; UTF-8 模式下的多字节字符按码点返回, wide 置为 true
+    int readClassChar(bool& wide) {
+        uint32_t codepoint;
+        int length = options.utf8 ? decodeUtf8(pattern, pos, codepoint) : 0;
+        if (length > 0) {
+            wide = true;
+            pos += length;
+            return static_cast<int>(codepoint);
+        }
+        return static_cast<unsigned char>(pattern[pos++]);
+    }
+
+    bool parseClass(ByteSet& result, CodepointRanges& codepoints) {
+        ++pos;
+        bool negated = false;
+        if (!atEnd() && pattern[pos] == '^') {
+            negated = true;
+            ++pos;
+        }
+        ByteSet set;
+        bool first = true;
+        while (true) {
+            if (atEnd()) {
+                fail("missing ']'");
+                return false;
+            }
+            char c = pattern[pos];
+            if (c == ']' && !first) {
+                ++pos;
+                break;
+            }
+            first = false;
+            int lo;
+            bool wide = false;  // 范围端点中有多字节字符时按码点处理
+            if (c == '\\') {
+                if (pos + 1 < pattern.size() && pattern[pos + 1] == 'b') {
+                    lo = '\b';
+                    pos += 2;
+                } else {
+                    ByteSet escaped;
+                    char shorthand;
+                    if (!parseEscapeSet(escaped, shorthand, codepoints)) return false;
+                    if (shorthand != 0 || escaped.count() != 1) {
+                        set.merge(escaped);
+                        continue;
+                    }
+                    lo = 0;
+                    while (!escaped.has(static_cast<unsigned char>(lo))) ++lo;
+                }
+            } else {
+                lo = readClassChar(wide);
+            }
+            // 范围 a-z
+            if (pos + 1 < pattern.size() && pattern[pos] == '-' && pattern[pos + 1] != ']') {
+                ++pos;
+                int hi;
+                if (pattern[pos] == '\\') {
+                    ByteSet escaped;
+                    char shorthand;
+                    CodepointRanges ignored;
+                    if (!parseEscapeSet(escaped, shorthand, ignored)) return false;
+                    if (shorthand != 0 || escaped.count() != 1) {
+                        fail("invalid character class range");
+                        return false;
+                    }
+                    hi = 0;
+                    while (!escaped.has(static_cast<unsigned char>(hi))) ++hi;
+                } else {
+                    hi = readClassChar(wide);
+                }
+                if (hi < lo) {
+                    fail("invalid character class range");
+                    return false;
+                }
+                if (wide) {
+                    addCodepointRange(set, codepoints, lo, hi);
+                } else {
+                    set.addRange(static_cast<unsigned char>(lo), static_cast<unsigned char>(hi));
+                }
+            } else if (wide) {
+                addCodepointRange(set, codepoints, lo, lo);
+            } else {
+                set.add(static_cast<unsigned char>(lo));
+            }
+        }
+        foldCase(set, codepoints);
+        if (negated) {
+            set.invert();
+            if (options.utf8) invertUtf8(set, codepoints);
+        } else {
+            normalizeCodepoints(codepoints);
+        }
+        result = set;
+        return true;
+    }
+};
+
+// 将模式解析为语法树
+bool parseRegex(const string& pattern, const GenerationOptions& options, RegexAst& ast, string& error) {
+    RegexParser parser(pattern, options, ast);
+    return parser.parse(error);
+}
+
+void parsePattern(const string& pattern, const GenerationOptions& options, ParsedPattern& parsed) {
+    parsed.pattern = pattern;
+    parsed.error.clear();
+    parseRegex(pattern, options, parsed.ast, parsed.error);
+}
+
+// 内置匹配器只支持正则语言: 环视和反向引用需要回溯引擎
+bool matcherSupports(const RegexAst& ast, string& error) {
+    for (const RegexNode& node : ast.nodes) {
+        if (node.type == NODE_LOOKAROUND) {
+            error = "lookaround is not supported by the matcher at position " + to_string(node.srcBegin);
+            return false;
+        }
+        if (node.type == NODE_BACKREF) {
+            error = "backreferences are not supported by the matcher at position " + to_string(node.srcBegin);
+            return false;
+        }
+    }
+    return true;
+}
+
+// ============================================================
+// 正则表达式解释: 按语法树逐层描述, 嵌套结构缩进显示
+// ============================================================
+
+// 捕获组的显示形式: 编号, 命名组再附加 "名字"
+struct GroupLabel {
+    int group;
+    const string& name;
+};
+
+ostream& operator<<(ostream& out, const GroupLabel& label) {
+    out << label.group;
+    if (!label.name.empty()) out << " \"" << label.name << "\"";
+    return out;
+}
+
+class RegexExplainer {
+public:
+    explicit RegexExplainer(const ParsedPattern& parsed) : ast(parsed.ast), pattern(parsed.pattern) {}
+
+    void explain(ostream& stream) {
+        out = &stream;
+        explainBody(ast.root, 1);
+    }
+
+private:
+    const RegexAst& ast;
+    const string& pattern;
+    ostream* out = nullptr;
+
+    // 输出缩进、节点在模式中的原文和分隔符, 描述由调用者接着写
+    ostream& begin(int depth, int srcBegin, int srcEnd) {
+        for (int k = 0; k < depth; ++k) out->write("  ", 2);
+        if (srcBegin < 0 || srcEnd <= srcBegin) {
+            *out << msg(MSG_EMPTY);
+        } else {
+            *out << escapeStrayBytes(pattern.substr(srcBegin, srcEnd - srcBegin));
+        }
+        return *out << " - ";
+    }
+
+    ostream& begin(int depth, const RegexNode& node) { return begin(depth, node.srcBegin, node.srcEnd); }
+
+    GroupLabel groupLabel(int group) const {
+        static const string unnamed;
+        bool named = group < static_cast<int>(ast.groupNames.size());
+        return GroupLabel{group, named ? ast.groupNames[group] : unnamed};
+    }
+
+    // 可以并入文本的可打印字面量, 返回其字节, 否则返回 -1
+    int printableLiteral(const RegexNode& node) const {
+        if (node.type != NODE_SET || node.shorthand != 0 || node.srcBegin < 0) return -1;
+        const char* text = pattern.data() + node.srcBegin;
+        int length = node.srcEnd - node.srcBegin;
+        int c = -1;
+        if (length == 1) {
+            c = static_cast<unsigned char>(text[0]);
+        } else if (length == 2 && text[0] == '\\' && !isalnum(static_cast<unsigned char>(text[1]))) {
+            c = static_cast<unsigned char>(text[1]);
+        }
+        return c >= 0x20 && c < 0x7f ? c : -1;
+    }
+
+    // 可以并入文本的字面字符, 把原文追加到 text; UTF-8 模式下的多字节字符整体算一个字符
+    bool literalText(const RegexNode& node, string& text) const {
+        int c = printableLiteral(node);
+        if (c >= 0) {
+            text.push_back(static_cast<char>(c));
+            return true;
+        }
+        if (!ast.utf8 || node.srcBegin < 0 || node.shorthand != 0) return false;
+        if (node.type != NODE_CONCAT && node.type != NODE_SET) return false;
+        uint32_t codepoint;
+        int length = decodeUtf8(pattern, node.srcBegin, codepoint);
+        if (length == 0 || length != node.srcEnd - node.srcBegin) return false;
+        text.append(pattern, node.srcBegin, length);
+        return true;
+    }
+
+    bool isCharacter(const RegexNode& node) const {
+        string text;
+        return literalText(node, text);
+    }
+
+    void writeSet(const RegexNode& node) {
+        switch (node.shorthand) {
+            case 'd': *out << msg(MSG_EXPLAIN_DIGIT); return;
+            case 'w': *out << msg(MSG_EXPLAIN_WORD); return;
+            case 's': *out << msg(MSG_EXPLAIN_SPACE); return;
+            case 'D': *out << msg(MSG_EXPLAIN_NOT_DIGIT); return;
+            case 'W': *out << msg(MSG_EXPLAIN_NOT_WORD); return;
+            case 'S': *out << msg(MSG_EXPLAIN_NOT_SPACE); return;
+            case '.':
+                *out << msg(node.set.has('\n') ? MSG_EXPLAIN_ANY : MSG_EXPLAIN_ANY_EXCEPT_NEWLINE);
+                return;
+            default:
+                break;
+        }
+        if (pattern[node.srcBegin] == '[') {
+            bool negated = node.srcEnd - node.srcBegin > 1 && pattern[node.srcBegin + 1] == '^';
+            *out << msg(negated ? MSG_EXPLAIN_NOT_IN_SET : MSG_EXPLAIN_IN_SET);
+            return;
+        }
+        string text;
+        if (literalText(node, text)) {
+            printMessage(*out, MSG_EXPLAIN_CHARACTER, text);
+            return;
+        }
+        int byte = 0;
+        while (byte < 256 && !node.set.has(static_cast<unsigned char>(byte))) ++byte;
+        switch (byte) {
+            case '\n': *out << msg(MSG_EXPLAIN_NEWLINE); return;
+            case '\r': *out << msg(MSG_EXPLAIN_CARRIAGE_RETURN); return;
+            case '\t': *out << msg(MSG_EXPLAIN_TAB); return;
+            default: {
+                char hex[8];
+                snprintf(hex, sizeof(hex), "0x%02x", byte);
+                printMessage(*out, MSG_EXPLAIN_BYTE, hex);
+                return;
+            }
+        }
+    }
+
+    // 量词单独作为一行的开头时首字母大写
+    void writeQuantifier(const RegexNode& node, bool capitalize) {
+        int lo = node.minRepeat;
+        int hi = node.maxRepeat;
+        MessageId id = MSG_QUANTIFIER_RANGE;
+        if (lo == 0 && hi == -1) {
+            id = MSG_QUANTIFIER_STAR;
+        } else if (lo == 1 && hi == -1) {
+            id = MSG_QUANTIFIER_PLUS;
+        } else if (lo == 0 && hi == 1) {
+            id = MSG_QUANTIFIER_OPTIONAL;
+        } else if (lo == hi) {
+            id = MSG_QUANTIFIER_EXACT;
+        } else if (hi == -1) {
+            id = MSG_QUANTIFIER_AT_LEAST;
+        }
+        const char* text = msg(id);
+        if (capitalize && *text >= 'a' && *text <= 'z') {
+            *out << static_cast<char>(*text - 'a' + 'A');
+            ++text;
+        }
+        writeFormatted(*out, text, lo, hi);
+        if (!node.greedy) *out << msg(MSG_QUANTIFIER_LAZY);
+    }
+
+    // 连接的各项依次列出, 相邻的可打印字面量合并为一段文本
+    void explainItems(int id, int depth) {
+        const RegexNode& node = ast.node(id);
+        for (int k = 0; k < node.childCount;) {
+            int end = k;
+            while (end < node.childCount && isCharacter(ast.node(ast.child(node, end)))) ++end;
+            if (end - k < 2) {
+                explainNode(ast.child(node, k), depth);
+                ++k;
+                continue;
+            }
+            string text;
+            for (int j = k; j < end; ++j) literalText(ast.node(ast.child(node, j)), text);
+            begin(depth, ast.node(ast.child(node, k)).srcBegin, ast.node(ast.child(node, end - 1)).srcEnd);
+            printMessage(*out, MSG_EXPLAIN_TEXT, text);
+            *out << '\n';
+            k = end;
+        }
+    }
+
+    // 复合节点的内容缩进一层列出
+    void explainBody(int id, int depth) {
+        if (ast.node(id).type == NODE_CONCAT && !isCharacter(ast.node(id))) {
+            explainItems(id, depth);
+        } else {
+            explainNode(id, depth);
+        }
+    }
+
+    void explainNode(int id, int depth) {
+        const RegexNode& node = ast.node(id);
+        switch (node.type) {
+            case NODE_EMPTY:
+                begin(depth, node) << msg(MSG_EXPLAIN_EMPTY_STRING) << '\n';
+                break;
+            case NODE_SET:
+                begin(depth, node);
+                writeSet(node);
+                *out << '\n';
+                break;
+            case NODE_ASSERT:
+                begin(depth, node) << msg(static_cast<MessageId>(MSG_EXPLAIN_LINE_BEGIN + node.assertion)) << '\n';
+                break;
+            case NODE_BACKREF:
+                printMessage(begin(depth, node), MSG_EXPLAIN_BACKREF, groupLabel(node.group));
+                *out << '\n';
+                break;
+            case NODE_CONCAT:
+                if (isCharacter(node)) {
+                    begin(depth, node);
+                    writeSet(node);
+                    *out << '\n';
+                    break;
+                }
+                begin(depth, node) << msg(MSG_EXPLAIN_SEQUENCE) << '\n';
+                explainItems(id, depth + 1);
+                break;
+            case NODE_ALTERNATE:
+                printMessage(begin(depth, node), MSG_EXPLAIN_ALTERNATIVES, node.childCount);
+                *out << '\n';
+                for (int k = 0; k < node.childCount; ++k) {
+                    int branch = ast.child(node, k);
+                    if (ast.node(branch).type == NODE_CONCAT && !isCharacter(ast.node(branch))) {
+                        printMessage(begin(depth + 1, ast.node(branch)), MSG_EXPLAIN_ALTERNATIVE, k + 1);
+                        *out << '\n';
+                        explainItems(branch, depth + 2);
+                    } else {
+                        explainNode(branch, depth + 1);
+                    }
+                }
+                break;
+            case NODE_GROUP:
+                if (node.capturing) {
+                    printMessage(begin(depth, node), MSG_EXPLAIN_CAPTURING, groupLabel(node.group));
+                } else {
+                    begin(depth, node) << msg(MSG_EXPLAIN_NON_CAPTURING);
+                }
+                *out << '\n';
+                explainBody(ast.child(node, 0), depth + 1);
+                break;
+            case NODE_LOOKAROUND:
+                begin(depth, node) << msg(static_cast<MessageId>(MSG_EXPLAIN_LOOKAHEAD + (node.lookBehind ? 2 : 0) +
+                                                                 (node.negated ? 1 : 0)))
+                                   << '\n';
+                explainBody(ast.child(node, 0), depth + 1);
+                break;
+            case NODE_REPEAT: {
+                const RegexNode& body = ast.node(ast.child(node, 0));
+                begin(depth, node);
+                if (body.type == NODE_SET || body.type == NODE_BACKREF || isCharacter(body)) {
+                    if (body.type != NODE_BACKREF) {
+                        writeSet(body);
+                    } else {
+                        *out << msg(MSG_EXPLAIN_BACKREF_SHORT);
+                    }
+                    *out << ", ";
+                    writeQuantifier(node, false);
+                    *out << '\n';
+                } else {
+                    writeQuantifier(node, true);
+                    *out << ":\n";
+                    explainBody(ast.child(node, 0), depth + 1);
+                }
+                break;
+            }
+        }
+    }
+};
+
+// 生成正则表达式解释
+string generateExplanation(const ParsedPattern& parsed) {
+    stringstream explanation;
+    explanation << msg(MSG_EXPLANATION_TITLE);
+    if (!parsed.valid()) {
+        printMessage(explanation, MSG_CANNOT_PARSE, parsed.error);
+        return explanation.str();
+    }
+    RegexExplainer explainer(parsed);
+    explainer.explain(explanation);
+    return explanation.str();
+}
+
+// ============================================================
+// 模式优化: 在语法树上做保持匹配语义的改写, 再打印回正则表达式
+// ============================================================
+
+// 单个字节的正则写法; inClass 时按字符类内部的规则转义
+string formatRegexByte(unsigned char c, bool inClass) {
+    switch (c) {
+        case '\n': return "\\n";
+        case '\t': return "\\t";
+        case '\r': return "\\r";
+        case '\f': return "\\f";
+        case '\v': return "\\v";
+        default: break;
+    }
+    if (c < 0x20 || c >= 0x7f) {
+        char escaped[8];
+        snprintf(escaped, sizeof(escaped), "\\x%02x", c);
+        return escaped;
+    }
+    const char* special = inClass ? "\\]-^[" : "\\.^$|?*+()[]{}/";
+    if (strchr(special, c) != nullptr) return string("\\") + static_cast<char>(c);
+    return string(1, static_cast<char>(c));
+}
+
+// 所有简写类; 从示例归纳出的模式使用它们
+const char* const ALL_SHORTHANDS = "dwsDWS.";
+
+// 模式原文用到的简写类 (\d \w \s \D \W \S 和字符类外的 .). 简写在各目标语言中含义不同
+// (Python 的 \d \w 匹配 Unicode 字符, JavaScript 和 Java 的 . 不匹配 \r), 规范写法只沿用原文已有的简写
+string sourceShorthands(const string& source) {
+    string used;
+    bool inClass = false;
+    for (size_t k = 0; k < source.size(); ++k) {
+        char c = source[k];
+        if (c == '\\' && k + 1 < source.size()) {
+            char next = source[++k];
+            if (strchr("dwsDWS", next) != nullptr && used.find(next) == string::npos) used.push_back(next);
+        } else if (inClass) {
+            inClass = c != ']';
+        } else if (c == '[') {
+            inClass = true;
+        } else if (c == '.' && used.find('.') == string::npos) {
+            used.push_back('.');
+        }
+    }
+    return used;
+}
+
+// 把字节集合写成最短的常用写法: 简写类 (仅限 shorthands 中的)、单字符或 [...] / [^...]
+string formatByteSet(const ByteSet& input, const GenerationOptions& options, const string& shorthands) {
+    ByteSet digits, word, space, dot;
+    digits.addRange('0', '9');
+    word = digits;
+    word.addRange('a', 'z');
+    word.addRange('A', 'Z');
+    word.add('_');
+    space.add(' '); space.add('\t'); space.add('\n');
+    space.add('\r'); space.add('\f'); space.add('\v');
+    dot.invert();
+    if (!options.dotAll) dot.remove('\n');
+
+    auto allowed = [&](char shorthand) { return shorthands.find(shorthand) != string::npos; };
+    // Java 的 \v 是纵向空白类, 垂直制表符写成 \x0b
+    auto spell = [&](unsigned char c, bool inClass) {
+        return c == '\v' && options.language == "java" ? string("\\x0b") : formatRegexByte(c, inClass);
+    };
+    if (input == dot && allowed('.')) return ".";
+    const pair<const ByteSet*, char> classes[] = {{&digits, 'd'}, {&word, 'w'}, {&space, 's'}};
+    for (const auto& shorthand : classes) {
+        ByteSet negated = *shorthand.first;
+        negated.invert();
+        char upper = static_cast<char>(toupper(shorthand.second));
+        if (input == *shorthand.first && allowed(shorthand.second)) return string("\\") + shorthand.second;
+        if (input == negated && allowed(upper)) return string("\\") + upper;
+    }
+    if (input.count() == 256) return "[\\s\\S]";
+
+    bool negate = input.count() > 128;
+    ByteSet set = input;
+    if (negate) set.invert();
+    string body;
+    if (set.contains(word) && allowed('w')) {
+        body += "\\w";
+        for (int c = 0; c < 256; ++c) {
+            if (word.has(static_cast<unsigned char>(c))) set.remove(static_cast<unsigned char>(c));
+        }
+    } else if (set.contains(digits) && allowed('d')) {
+        body += "\\d";
+        for (int c = '0'; c <= '9'; ++c) set.remove(static_cast<unsigned char>(c));
+    }
+    // 不区分大小写时, 折叠出的大写字母由标志覆盖
+    if (options.caseInsensitive) {
+        for (int c = 'A'; c <= 'Z'; ++c) {
+            if (set.has(static_cast<unsigned char>(c + 32))) set.remove(static_cast<unsigned char>(c));
+        }
+    }
+    if (!negate && body.empty() && set.count() == 1) {
+        int c = 0;
+        while (!set.has(static_cast<unsigned char>(c))) ++c;
+        return spell(static_cast<unsigned char>(c), false);
+    }
+    for (int c = 0; c < 256;) {
+        if (!set.has(static_cast<unsigned char>(c))) {
+            ++c;
+            continue;
+        }
+        // 范围只在同一类字节内使用: 数字、小写字母、大写字母、控制字节 (含 DEL) 或高位字节,
+        // 其余可打印字节逐个列出, 不写 \--: 或 @-Z 这样难读的范围
+        int last = c;
+        if (isdigit(c)) last = '9';
+        else if (islower(c)) last = 'z';
+        else if (isupper(c)) last = 'Z';
+        else if (c < 0x20) last = 0x1f;
+        else if (c >= 0x7f) last = 0xff;
+        int end = c;
+        while (end < last && set.has(static_cast<unsigned char>(end + 1))) ++end;
+        bool range = end >= c + 2;
+        if (!range) end = c;
+        body += spell(static_cast<unsigned char>(c), true);
+        if (range) body += "-" + spell(static_cast<unsigned char>(end), true);
+        c = end + 1;
+    }
+    return (negate ? "[^" : "[") + body + "]";
+}
+
+// 量词的写法
+string formatQuantifier(int minRepeat, int maxRepeat, bool greedy) {
+    string out;
+    if (minRepeat == 0 && maxRepeat == -1) out = "*";
+    else if (minRepeat == 1 && maxRepeat == -1) out = "+";
+    else if (minRepeat == 0 && maxRepeat == 1) out = "?";
+    else if (minRepeat == maxRepeat) out = "{" + to_string(minRepeat) + "}";
+    else if (maxRepeat == -1) out = "{" + to_string(minRepeat) + ",}";
+    else out = "{" + to_string(minRepeat) + "," + to_string(maxRepeat) + "}";
+    return greedy ? out : out + "?";
+}
+
+// 把语法树打印成正则表达式; 来自原始模式的叶子保留原写法 (除非规范写法更短)
+class RegexPrinter {
+public:
+    RegexPrinter(const RegexAst& ast, const string& source, const GenerationOptions& options)
+        : ast(ast), source(source), options(options), shorthands(sourceShorthands(source)) {}
+
+    string print() const { return print(ast.root); }
+
+    string print(int id) const {
+        string out;
+        append(id, out);
+        return out;
+    }
+
+private:
+    const RegexAst& ast;
+    const string& source;
+    const GenerationOptions& options;
+    string shorthands;
+
+    bool hasSource(const RegexNode& node) const {
+        return node.srcBegin >= 0 && node.srcEnd > node.srcBegin && static_cast<size_t>(node.srcEnd) <= source.size();
+    }
+
+    void append(int id, string& out) const {
+        const RegexNode& node = ast.node(id);
+        switch (node.type) {
+            case NODE_EMPTY:
+                break;
+            case NODE_SET: {
+                // 码点集合没有按字节的规范写法, 总是照抄原文
+                string canonical = node.codepoints.empty() ? formatByteSet(node.set, options, shorthands) : string();
+                size_t length = static_cast<size_t>(node.srcEnd - node.srcBegin);
+                if (hasSource(node) && (!node.codepoints.empty() || length <= canonical.size())) {
+                    out.append(source, node.srcBegin, node.srcEnd - node.srcBegin);
+                } else {
+                    out += canonical;
+                }
+                break;
+            }
+            case NODE_ASSERT:
+                if (hasSource(node)) {
+                    out.append(source, node.srcBegin, node.srcEnd - node.srcBegin);
+                } else {
+                    static const char* const spellings[] = {"^", "$", "^", "$", "\\b", "\\B"};
+                    out += spellings[node.assertion];
+                }
+                break;
+            case NODE_CONCAT:
+                for (int k = 0; k < node.childCount; ++k) {
+                    int child = ast.child(node, k);
+                    bool wrap = ast.node(child).type == NODE_ALTERNATE;
+                    if (wrap) out += "(?:";
+                    append(child, out);
+                    if (wrap) out += ")";
+                }
+                break;
+            case NODE_ALTERNATE:
+                for (int k = 0; k < node.childCount; ++k) {
+                    if (k > 0) out += "|";
+                    append(ast.child(node, k), out);
+                }
+                break;
+            case NODE_GROUP:
+                out += node.capturing ? "(" : "(?:";
+                append(ast.child(node, 0), out);
+                out += ")";
+                break;
+            case NODE_LOOKAROUND:
+                out += node.lookBehind ? (node.negated ? "(?<!" : "(?<=") : (node.negated ? "(?!" : "(?=");
+                append(ast.child(node, 0), out);
+                out += ")";
+                break;
+            case NODE_BACKREF:
+                if (hasSource(node)) {
+                    out.append(source, node.srcBegin, node.srcEnd - node.srcBegin);
+                } else {
+                    out += "\\" + to_string(node.group);
+                }
+                break;
+            case NODE_REPEAT: {
+                int child = ast.child(node, 0);
+                RegexNodeType type = ast.node(child).type;
+                bool wrap = type == NODE_CONCAT || type == NODE_ALTERNATE || type == NODE_REPEAT || type == NODE_EMPTY;
+                if (wrap) out += "(?:";
+                append(child, out);
+                if (wrap) out += ")";
+                out += formatQuantifier(node.minRepeat, node.maxRepeat, node.greedy);
+                break;
+            }
+        }
+    }
+};
+
+// 改写规则:
+//   分组      (x) (?:x) -> x, 需要时由打印器补 (?:...)
+//   量词      x{1} -> x, (x+)* -> x*, (x{1,2}){3} -> x{3,6}
+//   相邻重复  \d\d\d -> \d{3}, aa* -> a+ (仅在更短时)
+//   分支      公共前缀 ab|ac -> a(?:b|c), 公共后缀及锚点 ^a$|^b$ -> ^(?:a|b)$,
+//             相邻单字符分支合并为字符类 a|b|[c-d] -> [a-d], x| -> x?
+// 分支只在相邻时合并, 保持最左优先的匹配顺序
+class RegexOptimizer {
+public:
+    RegexOptimizer(const RegexAst& input, const string& source, const GenerationOptions& options, RegexAst& output)
+        : input(input), output(output), printer(output, source, options) {}
+
+    void optimize() {
+        output.nodes.clear();
+        output.children.clear();
+        output.groupCount = 0;
+        output.root = rewrite(input.root);
+    }
+
+private:
+    const RegexAst& input;
+    RegexAst& output;
+    RegexPrinter printer;
+
+    int addNode(RegexNode node, const vector<int>& kids) {
+        node.childBegin = static_cast<int>(output.children.size());
+        node.childCount = static_cast<int>(kids.size());
+        output.children.insert(output.children.end(), kids.begin(), kids.end());
+        output.nodes.push_back(node);
+        return static_cast<int>(output.nodes.size()) - 1;
+    }
+
+    int makeEmpty() {
+        RegexNode node;
+        node.srcBegin = node.srcEnd = -1;
+        return addNode(node, vector<int>());
+    }
+
+    int makeSet(const ByteSet& set) {
+        RegexNode node;
+        node.type = NODE_SET;
+        node.set = set;
+        node.srcBegin = node.srcEnd = -1;
+        return addNode(node, vector<int>());
+    }
+
+    const RegexNode& at(int id) const { return output.nodes[id]; }
+
+    bool isByteSet(int id) const { return at(id).type == NODE_SET && at(id).codepoints.empty(); }
+
+    bool sameTree(int a, int b) const {
+        const RegexNode& x = at(a);
+        const RegexNode& y = at(b);
+        if (x.type != y.type || x.childCount != y.childCount) return false;
+        switch (x.type) {
+            case NODE_SET:
+                return x.set == y.set && x.codepoints == y.codepoints;
+            case NODE_ASSERT:
+                return x.assertion == y.assertion;
+            case NODE_REPEAT:
+                if (x.minRepeat != y.minRepeat || x.maxRepeat != y.maxRepeat || x.greedy != y.greedy) return false;
+                break;
+            default:
+                break;
+        }
+        for (int k = 0; k < x.childCount; ++k) {
+            if (!sameTree(output.child(x, k), output.child(y, k))) return false;
+        }
+        return true;
+    }
+
+    int rewrite(int id) {
+        const RegexNode& node = input.node(id);
+        switch (node.type) {
+            case NODE_GROUP:
+                return rewrite(input.child(node, 0));
+            case NODE_REPEAT:
+                return makeRepeat(rewrite(input.child(node, 0)), node.minRepeat, node.maxRepeat, node.greedy);
+            case NODE_CONCAT: {
+                vector<int> items;
+                for (int k = 0; k < node.childCount; ++k) items.push_back(rewrite(input.child(node, k)));
+                return makeConcat(items);
+            }
+            case NODE_ALTERNATE: {
+                vector<vector<int>> branches;
+                for (int k = 0; k < node.childCount; ++k) {
+                    int branch = rewrite(input.child(node, k));
+                    if (at(branch).type == NODE_ALTERNATE) {
+                        for (int j = 0; j < at(branch).childCount; ++j) {
+                            branches.push_back(itemsOf(output.child(at(branch), j)));
+                        }
+                    } else {
+                        branches.push_back(itemsOf(branch));
+                    }
+                }
+                return makeAlternate(branches);
+            }
+            default: {
+                RegexNode copy = node;
+                return addNode(copy, vector<int>());
+            }
+        }
+    }
+
+    bool nullable(int id) const {
+        const RegexNode& node = at(id);
+        switch (node.type) {
+            case NODE_SET:
+                return false;
+            case NODE_CONCAT:
+                for (int k = 0; k < node.childCount; ++k) {
+                    if (!nullable(output.child(node, k))) return false;
+                }
+                return true;
+            case NODE_ALTERNATE:
+                for (int k = 0; k < node.childCount; ++k) {
+                    if (nullable(output.child(node, k))) return true;
+                }
+                return false;
+            case NODE_REPEAT:
+                return node.minRepeat == 0 || nullable(output.child(node, 0));
+            case NODE_GROUP:
+                return nullable(output.child(node, 0));
+            default:
+                return true;
+        }
+    }
+
+    vector<int> itemsOf(int id) const {
+        const RegexNode& node = at(id);
+        if (node.type == NODE_EMPTY) return vector<int>();
+        if (node.type != NODE_CONCAT) return vector<int>(1, id);
+        vector<int> items;
+        for (int k = 0; k < node.childCount; ++k) items.push_back(output.child(node, k));
+        return items;
+    }
+
+    int makeRepeat(int body, int minRepeat, int maxRepeat, bool greedy) {
+        if (minRepeat == 1 && maxRepeat == 1) return body;
+        if (maxRepeat == 0 || at(body).type == NODE_EMPTY) return makeEmpty();
+        const RegexNode& inner = at(body);
+        // 循环体可以匹配空串时, 空迭代的处理在各引擎中不同, 不合并
+        if (inner.type == NODE_REPEAT && greedy && inner.greedy && !nullable(output.child(inner, 0))) {
+            int innerBody = output.child(inner, 0);
+            // x{a,b} 恰好重复 k 次等于 x{ka,kb}
+            if (minRepeat == maxRepeat) {
+                int low = inner.minRepeat * minRepeat;
+                int high = inner.maxRepeat == -1 ? -1 : inner.maxRepeat * minRepeat;
+                if (low <= 1000 && high <= 1000) return makeRepeat(innerBody, low, high, true);
+            }
+            // 下限为 0/1、上限为 1/无限的嵌套量词可以合并: (x+)* -> x*, (x?)+ -> x*
+            bool simpleOuter = minRepeat <= 1 && (maxRepeat == 1 || maxRepeat == -1);
+            bool simpleInner = inner.minRepeat <= 1 && (inner.maxRepeat == 1 || inner.maxRepeat == -1);
+            if (simpleOuter && simpleInner) {
+                int high = maxRepeat == 1 && inner.maxRepeat == 1 ? 1 : -1;
+                return makeRepeat(innerBody, minRepeat * inner.minRepeat, high, true);
+            }
+        }
+        RegexNode node;
+        node.type = NODE_REPEAT;
+        node.minRepeat = minRepeat;
+        node.maxRepeat = maxRepeat;
+        node.greedy = greedy;
+        node.srcBegin = node.srcEnd = -1;
+        return addNode(node, vector<int>(1, body));
+    }
+
+    // 单字节原子及其贪婪重复次数
+    bool asCountedSet(int id, int& base, int& low, int& high) const {
+        const RegexNode& node = at(id);
+        if (node.type == NODE_SET) {
+            base = id;
+            low = high = 1;
+            return true;
+        }
+        if (node.type == NODE_REPEAT && node.greedy && at(output.child(node, 0)).type == NODE_SET) {
+            base = output.child(node, 0);
+            low = node.minRepeat;
+            high = node.maxRepeat;
+            return true;
+        }
+        return false;
+    }
+
+    int makeConcat(const vector<int>& parts) {
+        vector<int> flat;
+        for (int part : parts) {
+            vector<int> items = itemsOf(part);
+            flat.insert(flat.end(), items.begin(), items.end());
+        }
+        // 相邻的同一单字节原子合并成一个计数重复, 仅在写法更短时采用
+        vector<int> items;
+        for (size_t i = 0; i < flat.size();) {
+            int base, low, high;
+            if (!asCountedSet(flat[i], base, low, high)) {
+                items.push_back(flat[i++]);
+                continue;
+            }
+            size_t j = i + 1;
+            size_t before = printer.print(flat[i]).size();
+            int nextBase, nextLow, nextHigh;
+            while (j < flat.size() && asCountedSet(flat[j], nextBase, nextLow, nextHigh) && sameTree(base, nextBase)) {
+                low += nextLow;
+                high = high == -1 || nextHigh == -1 ? -1 : high + nextHigh;
+                before += printer.print(flat[j]).size();
+                ++j;
+            }
+            size_t after = printer.print(base).size() + formatQuantifier(low, high, true).size();
+            if (j - i > 1 && after < before && low <= 1000 && high <= 1000) {
+                items.push_back(makeRepeat(base, low, high, true));
+            } else {
+                items.insert(items.end(), flat.begin() + i, flat.begin() + j);
+            }
+            i = j;
+        }
+        if (items.empty()) return makeEmpty();
+        if (items.size() == 1) return items[0];
+        RegexNode node;
+        node.type = NODE_CONCAT;
+        node.srcBegin = node.srcEnd = -1;
+        return addNode(node, items);
+    }
+
+    int makeAlternate(vector<vector<int>> branches) {
+        if (branches.size() == 1) return makeConcat(branches[0]);
+
+        // 所有分支共同的后缀 (包括 $ 等锚点) 移到分支外
+        vector<int> suffix;
+        while (true) {
+            bool common = true;
+            for (const vector<int>& branch : branches) {
+                common = common && !branch.empty() && sameTree(branch.back(), branches[0].back());
+            }
+            if (!common) break;
+            suffix.insert(suffix.begin(), branches[0].back());
+            for (vector<int>& branch : branches) branch.pop_back();
+        }
+
+        // 相邻且首项相同的分支提取公共前缀
+        vector<int> alternatives;
+        for (size_t i = 0; i < branches.size();) {
+            size_t j = i + 1;
+            while (j < branches.size() && !branches[i].empty() && !branches[j].empty() &&
+                   sameTree(branches[i][0], branches[j][0])) {
+                ++j;
+            }
+            if (j - i > 1) {
+                vector<vector<int>> rests;
+                for (size_t k = i; k < j; ++k) rests.push_back(vector<int>(branches[k].begin() + 1, branches[k].end()));
+                vector<int> parts;
+                parts.push_back(branches[i][0]);
+                parts.push_back(makeAlternate(rests));
+                alternatives.push_back(makeConcat(parts));
+            } else {
+                alternatives.push_back(makeConcat(branches[i]));
+            }
+            i = j;
+        }
+
+        // 相邻的单字节分支合并为一个字符类 (码点集合无法按字节写出, 不参与合并)
+        vector<int> merged;
+        for (int alternative : alternatives) {
+            if (!merged.empty() && isByteSet(merged.back()) && isByteSet(alternative)) {
+                ByteSet set = at(merged.back()).set;
+                set.merge(at(alternative).set);
+                merged.back() = makeSet(set);
+            } else {
+                merged.push_back(alternative);
+            }
+        }
+
+        int result;
+        if (merged.size() > 1 && at(merged.back()).type == NODE_EMPTY) {
+            // x|y| -> (?:x|y)?
+            merged.pop_back();
+            result = makeRepeat(buildAlternate(merged), 0, 1, true);
+        } else if (merged.size() > 1 && at(merged.front()).type == NODE_EMPTY) {
+            // |x|y 优先匹配空串 -> (?:x|y)??
+            merged.erase(merged.begin());
+            result = makeRepeat(buildAlternate(merged), 0, 1, false);
+        } else {
+            result = buildAlternate(merged);
+        }
+        if (suffix.empty()) return result;
+        suffix.insert(suffix.begin(), result);
+        return makeConcat(suffix);
+    }
+
+    int buildAlternate(const vector<int>& alternatives) {
+        if (alternatives.size() == 1) return alternatives[0];
+        RegexNode node;
+        node.type = NODE_ALTERNATE;
+        node.srcBegin = node.srcEnd = -1;
+        return addNode(node, alternatives);
+    }
+};
+
+// 集合写成字符类时的成员数: 连续区间个数, 取反写法更少时按取反计; 简写类和码点区间各算一个
+int classMembers(const RegexNode& node) {
+    if (node.shorthand != 0) return 1;
+    int runs[2] = {0, 0};
+    for (int negated = 0; negated < 2; ++negated) {
+        bool previous = false;
+        for (int c = 0; c < 256; ++c) {
+            bool member = node.set.has(static_cast<unsigned char>(c)) != (negated == 1);
+            if (member && !previous) ++runs[negated];
+            previous = member;
+        }
+    }
+    return min(runs[0], runs[1]) + static_cast<int>(node.codepoints.size());
+}
+
+PatternCost patternCost(const RegexAst& ast) {
+    PatternCost cost;
+    for (const RegexNode& node : ast.nodes) {
+        if (node.type == NODE_GROUP && node.capturing) ++cost.capturingGroups;
+        if (node.type == NODE_ALTERNATE) cost.extraBranches += node.childCount - 1;
+        if (node.type == NODE_SET) cost.classMembers += classMembers(node);
+    }
+    return cost;
+}
+
+// 优化模式, 结果连同语法树写入 output. 改写按回溯引擎的代价取舍, 不按长度: 代价更低时保留
+// (捕获组改为非捕获组会变长), 代价相同时只保留更短的写法; 含环视或反向引用 (改写会打乱组编号)
+// 或无法重新解析时保留原模式
+void optimizePattern(const ParsedPattern& input, const GenerationOptions& options, ParsedPattern& output) {
+    string error;
+    if (input.valid() && matcherSupports(input.ast, error)) {
+        RegexAst optimized;
+        RegexOptimizer optimizer(input.ast, input.pattern, options, optimized);
+        optimizer.optimize();
+        string printed = RegexPrinter(optimized, input.pattern, options).print();
+        int before = patternCost(input.ast).total();
+        if (printed != input.pattern) {
+            parsePattern(printed, options, output);
+            int after = output.valid() ? patternCost(output.ast).total() : before + 1;
+            if (after < before || (after == before && printed.size() < input.pattern.size())) return;
+        }
+    }
+    output = input;
+}
+
+// 优化前后的大小和代价, 例如 "95 -> 88 bytes (-7.4%); cost 30 -> 24 (...), original: ..."
+string describeOptimization(const string& before, const string& after, const GenerationOptions& options) {
+    stringstream out;
+    double change = before.empty() ? 0 : 100.0 * (static_cast<double>(after.size()) - before.size()) / before.size();
+    char percent[32];
+    snprintf(percent, sizeof(percent), change > 0 ? "%+.1f" : "%.1f", change);
+    printMessage(out, MSG_SIZE_CHANGE, before.size(), after.size(), percent);
+    ParsedPattern first, second;
+    parsePattern(before, options, first);
+    parsePattern(after, options, second);
+    if (first.valid() && second.valid()) {
+        PatternCost x = patternCost(first.ast), y = patternCost(second.ast);
+        printMessage(out, MSG_COST_CHANGE, x.total(), y.total(), x.capturingGroups, y.capturingGroups,
+                     x.extraBranches, y.extraBranches, x.classMembers, y.classMembers);
+    }
+    if (after != before) out << msg(MSG_ORIGINAL) << before;
+    return out.str();
+}
+
+// Thompson 构造: compile(node, next) 返回进入该节点的状态, 节点匹配后转到 next
+class NfaCompiler {
+public:
+    NfaCompiler(const RegexAst& ast, RegexProgram& program, bool reverse)
+        : ast(ast), program(program), reverse(reverse), setIndexOfNode(ast.nodes.size(), -1) {}
+
+    bool compile(int patternId, string& error) {
+        int start = compileRoot(patternId, error);
+        if (start < 0) return false;
+        program.start = start;
+        if (!reverse) addUnanchoredPrefix(program);
+        return true;
+    }
+
+    // 编译整个模式并以 MATCH(patternId) 结尾, 返回入口状态, 失败返回 -1
+    int compileRoot(int patternId, string& error) {
+        if (!matcherSupports(ast, error)) return -1;
+        int match = newState(NFA_MATCH, patternId, -1);
+        int start = compileNode(ast.root, match);
+        if (tooLarge) {
+            error = "pattern too large";
+            return -1;
+        }
+        return start;
+    }
+
+    // 在 program.start 之前加上惰性的 (?s:.)*? 循环, 用于非锚定搜索
+    static void addUnanchoredPrefix(RegexProgram& program) {
+        ByteSet any;
+        any.invert();
+        program.sets.push_back(any);
+        NfaState loop = {NFA_SPLIT, 0, program.start, static_cast<int>(program.states.size()) + 1, -1};
+        NfaState step = {NFA_SET, 0, static_cast<int>(program.states.size()), -1,
+                         static_cast<int>(program.sets.size()) - 1};
+        program.states.push_back(loop);
+        program.states.push_back(step);
+        program.unanchoredStart = loop.out1 - 1;
+    }
+
+private:
+    const RegexAst& ast;
+    RegexProgram& program;
+    bool reverse;
+    vector<int> setIndexOfNode;
+    bool tooLarge = false;
+
+    enum { MAX_STATES = 4000000 };
+
+    int newState(NfaOp op, int out, int out1) {
+        if (program.states.size() >= static_cast<size_t>(MAX_STATES)) {
+            tooLarge = true;
+            return 0;
+        }
+        NfaState state;
+        state.op = static_cast<uint8_t>(op);
+        state.assertion = 0;
+        state.out = out;
+        state.out1 = out1;
+        state.setIndex = -1;
+        program.states.push_back(state);
+        return static_cast<int>(program.states.size()) - 1;
+    }
+
+    void setSplit(int split, int preferred, int other) {
+        if (tooLarge) return;
+        program.states[split].out = preferred;
+        program.states[split].out1 = other;
+    }
+
+    int compileNode(int id, int next) {
+        if (tooLarge) return 0;
+        const RegexNode& node = ast.node(id);
+        switch (node.type) {
+            case NODE_EMPTY:
+                return next;
+            case NODE_SET: {
+                if (setIndexOfNode[id] < 0) {
+                    setIndexOfNode[id] = static_cast<int>(program.sets.size());
+                    program.sets.push_back(node.set);
+                }
+                int state = newState(NFA_SET, next, -1);
+                if (!tooLarge) program.states[state].setIndex = setIndexOfNode[id];
+                return state;
+            }
+            case NODE_CONCAT: {
+                int current = next;
+                if (reverse) {
+                    for (int k = 0; k < node.childCount; ++k) current = compileNode(ast.child(node, k), current);
+                } else {
+                    for (int k = node.childCount - 1; k >= 0; --k) current = compileNode(ast.child(node, k), current);
+                }
+                return current;
+            }
+            case NODE_ALTERNATE: {
+                int current = compileNode(ast.child(node, node.childCount - 1), next);
+                for (int k = node.childCount - 2; k >= 0; --k) {
+                    int branch = compileNode(ast.child(node, k), next);
+                    current = newState(NFA_SPLIT, branch, current);
+                }
+                return current;
+            }
+            case NODE_GROUP:
+                return compileNode(ast.child(node, 0), next);
+            case NODE_ASSERT: {
+                AssertKind kind = node.assertion;
+                if (reverse) {
+                    // 反向扫描时行首/行尾、文本首/尾互换
+                    switch (kind) {
+                        case ASSERT_LINE_BEGIN: kind = ASSERT_LINE_END; break;
+                        case ASSERT_LINE_END: kind = ASSERT_LINE_BEGIN; break;
+                        case ASSERT_TEXT_BEGIN: kind = ASSERT_TEXT_END; break;
+                        case ASSERT_TEXT_END: kind = ASSERT_TEXT_BEGIN; break;
+                        default: break;
+                    }
+                }
+                if (kind == ASSERT_LINE_BEGIN) program.usesLineBegin = true;
+                if (kind == ASSERT_TEXT_BEGIN) program.usesTextBegin = true;
+                if (kind == ASSERT_WORD_BOUNDARY || kind == ASSERT_NOT_WORD_BOUNDARY) program.usesWordBoundary = true;
+                int state = newState(NFA_ASSERT, next, -1);
+                if (!tooLarge) program.states[state].assertion = static_cast<uint8_t>(kind);
+                return state;
+            }
+            case NODE_REPEAT:
+                return compileRepeat(node, next);
+            case NODE_LOOKAROUND:
+            case NODE_BACKREF:
+                break;  // compileRoot 已拒绝
+        }
+        return next;
+    }
+
+    int compileRepeat(const RegexNode& node, int next) {
+        int body = ast.child(node, 0);
+        int current = next;
+        int mandatory = node.minRepeat;
+        if (node.maxRepeat == -1) {
+            if (mandatory > 0) {
+                // x+ : 进入循环体, 结束后回到分叉
+                int split = newState(NFA_SPLIT, -1, -1);
+                int entry = compileNode(body, split);
+                if (node.greedy) setSplit(split, entry, next);
+                else setSplit(split, next, entry);
+                current = entry;
+                --mandatory;
+            } else {
+                int split = newState(NFA_SPLIT, -1, -1);
+                int entry = compileNode(body, split);
+                if (node.greedy) setSplit(split, entry, next);
+                else setSplit(split, next, entry);
+                current = split;
+            }
+        } else {
+            // x{n,m}: 可选部分嵌套为 (x(x)?)?
+            for (int k = 0; k < node.maxRepeat - node.minRepeat && !tooLarge; ++k) {
+                int entry = compileNode(body, current);
+                current = node.greedy ? newState(NFA_SPLIT, entry, next) : newState(NFA_SPLIT, next, entry);
+            }
+        }
+        for (int k = 0; k < mandatory && !tooLarge; ++k) {
+            current = compileNode(body, current);
+        }
+        return current;
+    }
+};
+
+// ============================================================
+// 必需字面量分析与 SIMD 预过滤
+// ============================================================
+
+// 字节在典型文本/日志中的常见程度 (越大越常见), 用于挑选稀有字节
+int byteFrequencyRank(unsigned char c) {
+    static const char* const common = " etaoinsrhldcumfpgwybvkxjqz";
+    const char* found = c != 0 ? strchr(common, c) : nullptr;
+    if (found != nullptr) return 255 - static_cast<int>(found - common);
+    if (isdigit(c)) return 200;
+    if (isupper(c)) return 190;
+    switch (c) {
+        case '.': case '\n': case '/': case '-': case ':': case '=': case ',': case '_':
+            return 180;
+        case '"': case '\'': case '(': case ')': case '[': case ']': case ';': case '\t': case '\r':
+            return 150;
+        case '&': case '?': case '+': case '*': case '<': case '>': case '{': case '}': case '!':
+            return 110;
+        case '@': case '#': case '%': case '$': case '~': case '^': case '|': case '\\': case '`':
+            return 60;
+        default:
+            return c >= 128 ? 40 : 20;
+    }
+}
+
+// 每个匹配都必须包含的字面量: 精确串、前缀、后缀和内部串
+struct LiteralInfo {
+    bool exact = true;
+    string text;     // exact 时为整个匹配
+    string prefix;
+    string suffix;
+    vector<string> inner;
+};
+
+class LiteralAnalyzer {
+public:
+    explicit LiteralAnalyzer(const RegexAst& ast) : ast(ast) {}
+
+    LiteralInfo analyze(int id) const {
+        const RegexNode& node = ast.node(id);
+        LiteralInfo info;
+        switch (node.type) {
+            case NODE_EMPTY:
+            case NODE_ASSERT:
+                break;
+            case NODE_LOOKAROUND:
+            case NODE_BACKREF:
+                info.exact = false;
+                break;
+            case NODE_SET:
+                if (node.set.count() == 1) {
+                    int c = 0;
+                    while (!node.set.has(static_cast<unsigned char>(c))) ++c;
+                    info.text.assign(1, static_cast<char>(c));
+                } else {
+                    info.exact = false;
+                }
+                break;
+            case NODE_GROUP:
+                return analyze(ast.child(node, 0));
+            case NODE_CONCAT:
+                info = analyze(ast.child(node, 0));
+                for (int k = 1; k < node.childCount; ++k) info = concat(info, analyze(ast.child(node, k)));
+                break;
+            case NODE_ALTERNATE: {
+                info.exact = false;
+                LiteralInfo first = normalize(analyze(ast.child(node, 0)));
+                info.prefix = first.prefix;
+                info.suffix = first.suffix;
+                for (int k = 1; k < node.childCount; ++k) {
+                    LiteralInfo branch = normalize(analyze(ast.child(node, k)));
+                    size_t n = 0;
+                    while (n < info.prefix.size() && n < branch.prefix.size() && info.prefix[n] == branch.prefix[n]) ++n;
+                    info.prefix.resize(n);
+                    n = 0;
+                    while (n < info.suffix.size() && n < branch.suffix.size() &&
+                           info.suffix[info.suffix.size() - 1 - n] == branch.suffix[branch.suffix.size() - 1 - n]) ++n;
+                    info.suffix = info.suffix.substr(info.suffix.size() - n);
+                }
+                break;
+            }
+            case NODE_REPEAT: {
+                if (node.minRepeat == 0) {
+                    info.exact = node.maxRepeat == 0;
+                    break;
+                }
+                LiteralInfo body = analyze(ast.child(node, 0));
+                if (body.exact && node.maxRepeat == node.minRepeat) {
+                    for (int k = 0; k < node.minRepeat && info.text.size() < MAX_LITERAL; ++k) info.text += body.text;
+                    if (info.text.size() >= MAX_LITERAL) info = normalize(info);
+                    break;
+                }
+                info.exact = false;
+                if (body.exact) {
+                    for (int k = 0; k < node.minRepeat && info.prefix.size() < MAX_LITERAL; ++k) info.prefix += body.text;
+                    info.suffix = info.prefix;
+                } else {
+                    info.prefix = body.prefix;
+                    info.suffix = body.suffix;
+                    info.inner = body.inner;
+                }
+                break;
+            }
+        }
+        return info;
+    }
+
+    // 所有必需的字面量
+    static vector<string> required(const LiteralInfo& info) {
+        vector<string> result;
+        if (info.exact) {
+            if (!info.text.empty()) result.push_back(info.text);
+            return result;
+        }
+        if (!info.prefix.empty()) result.push_back(info.prefix);
+        if (!info.suffix.empty()) result.push_back(info.suffix);
+        for (const string& s : info.inner) {
+            if (!s.empty()) result.push_back(s);
+        }
+        return result;
+    }
+
+private:
+    const RegexAst& ast;
+    enum { MAX_LITERAL = 64 };
+
+    static LiteralInfo normalize(LiteralInfo info) {
+        if (info.exact) {
+            info.exact = false;
+            info.prefix = info.suffix = info.text.substr(0, MAX_LITERAL);
+        }
+        return info;
+    }
+
+    static LiteralInfo concat(const LiteralInfo& left, const LiteralInfo& right) {
+        LiteralInfo result;
+        if (left.exact && right.exact) {
+            result.text = left.text + right.text;
+            if (result.text.size() > MAX_LITERAL) result = normalize(result);
+            return result;
+        }
+        result.exact = false;
+        result.prefix = left.exact ? left.text + right.prefix : left.prefix;
+        result.suffix = right.exact ? left.suffix + right.text : right.suffix;
+        result.inner = left.inner;
+        result.inner.insert(result.inner.end(), right.inner.begin(), right.inner.end());
+        if (!left.exact && !right.exact) result.inner.push_back(left.suffix + right.prefix);
+        if (result.prefix.size() > MAX_LITERAL) result.prefix.resize(MAX_LITERAL);
+        if (result.suffix.size() > MAX_LITERAL) result.suffix = result.suffix.substr(result.suffix.size() - MAX_LITERAL);
+        return result;
+    }
+};
+
+// 沿必经路径收集的字节集合 (每个匹配至少包含其中一个字节)
+void collectRequiredSets(const RegexAst& ast, int id, vector<ByteSet>& sets) {
+    const RegexNode& node = ast.node(id);
+    switch (node.type) {
+        case NODE_SET:
+            sets.push_back(node.set);
+            break;
+        case NODE_GROUP:
+        case NODE_CONCAT:
+            for (int k = 0; k < node.childCount; ++k) collectRequiredSets(ast, ast.child(node, k), sets);
+            break;
+        case NODE_REPEAT:
+            if (node.minRepeat > 0) collectRequiredSets(ast, ast.child(node, 0), sets);
+            break;
+        default:
+            break;
+    }
+}
+
+// 从语法树中选出最稀有的必需字面量或字节集合作为预过滤器
+Prefilter choosePrefilter(const RegexAst& ast) {
+    Prefilter prefilter;
+    LiteralAnalyzer analyzer(ast);
+    vector<string> literals = LiteralAnalyzer::required(analyzer.analyze(ast.root));
+
+    // 按锚点字节的稀有程度打分: 单字节看其频率, 多字节同时比较两个最稀有的字节
+    int bestScore = 1 << 30;
+    for (const string& literal : literals) {
+        vector<int> ranks;
+        for (char c : literal) ranks.push_back(byteFrequencyRank(static_cast<unsigned char>(c)));
+        sort(ranks.begin(), ranks.end());
+        int score = ranks.size() == 1 ? ranks[0] : (ranks[0] + ranks[1]) / 2 - 48;
+        score = score * 64 - static_cast<int>(min<size_t>(literal.size(), 16));
+        if (score < bestScore) {
+            bestScore = score;
+            prefilter.literal = literal;
+        }
+    }
+    // 常见字节作为锚点时候选过多, 不值得预过滤
+    if (!prefilter.literal.empty() && bestScore < 200 * 64) {
+        const string& literal = prefilter.literal;
+        if (literal.size() == 1) {
+            prefilter.kind = PREFILTER_BYTES;
+            prefilter.bytes[0] = static_cast<unsigned char>(literal[0]);
+            prefilter.byteCount = 1;
+            prefilter.literal.clear();
+            return prefilter;
+        }
+        prefilter.kind = PREFILTER_LITERAL;
+        vector<size_t> order(literal.size());
+        for (size_t k = 0; k < order.size(); ++k) order[k] = k;
+        stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return byteFrequencyRank(static_cast<unsigned char>(literal[a])) <
+                   byteFrequencyRank(static_cast<unsigned char>(literal[b]));
+        });
+        prefilter.rareOffset = order[0];
+        prefilter.secondOffset = order[1];
+        return prefilter;
+    }
+    prefilter.literal.clear();
+
+    // 没有字面量时, 退而使用不超过三个字节的稀有集合
+    vector<ByteSet> sets;
+    collectRequiredSets(ast, ast.root, sets);
+    int bestSetScore = 1 << 30;
+    for (const ByteSet& set : sets) {
+        int n = set.count();
+        if (n < 1 || n > 3) continue;
+        int score = 0;
+        for (int c = 0; c < 256; ++c) {
+            if (set.has(static_cast<unsigned char>(c))) score = max(score, byteFrequencyRank(static_cast<unsigned char>(c)));
+        }
+        if (score < 200 && score < bestSetScore) {
+            bestSetScore = score;
+            prefilter.kind = PREFILTER_BYTES;
+            prefilter.byteCount = 0;
+            for (int c = 0; c < 256; ++c) {
+                if (set.has(static_cast<unsigned char>(c))) prefilter.bytes[prefilter.byteCount++] = static_cast<unsigned char>(c);
+            }
+        }
+    }
+    return prefilter;
+}
+
+// 一个 UTF-8 字节序列模式: 每个位置一个字节范围
+typedef vector<pair<uint8_t, uint8_t>> Utf8Sequence;
+
+// 把码点区间 [lo, hi] 切成若干段, 每段的 UTF-8 编码都可以写成逐字节范围的连接:
+// 先按编码长度切开, 再让每段除首字节外的低位要么覆盖 80-BF 全部, 要么首尾字节相同. 代理区不可编码, 跳过
+void utf8Sequences(uint32_t lo, uint32_t hi, vector<Utf8Sequence>& out) {
+    vector<pair<uint32_t, uint32_t>> pending(1, make_pair(lo, hi));
+    while (!pending.empty()) {
+        uint32_t first = pending.back().first;
+        uint32_t last = pending.back().second;
+        pending.pop_back();
+        if (first > last) continue;
+        if (first <= 0xDFFF && last >= 0xD800) {
+            if (last > 0xDFFF) pending.push_back(make_pair(0xE000u, last));
+            if (first < 0xD800) pending.push_back(make_pair(first, 0xD7FFu));
+            continue;
+        }
+        bool split = false;
+        static const uint32_t lengthLimits[] = {0x7F, 0x7FF, 0xFFFF};
+        for (uint32_t limit : lengthLimits) {
+            if (first <= limit && limit < last) {
+                pending.push_back(make_pair(limit + 1, last));
+                pending.push_back(make_pair(first, limit));
+                split = true;
+                break;
+            }
+        }
+        for (int k = 1; k < 4 && !split; ++k) {
+            uint32_t low = (uint32_t(1) << (6 * k)) - 1;  // 末尾 k 个续字节的位
+            if ((first & ~low) == (last & ~low)) continue;
+            if ((first & low) != 0) {
+                pending.push_back(make_pair((first | low) + 1, last));
+                pending.push_back(make_pair(first, first | low));
+                split = true;
+            } else if ((last & low) != low) {
+                pending.push_back(make_pair(last & ~low, last));
+                pending.push_back(make_pair(first, (last & ~low) - 1));
+                split = true;
+            }
+        }
+        if (split) continue;
+        string from, to;
+        appendUtf8(from, first);
+        appendUtf8(to, last);
+        Utf8Sequence sequence;
+        for (size_t k = 0; k < from.size(); ++k) {
+            sequence.push_back(make_pair(static_cast<uint8_t>(from[k]), static_cast<uint8_t>(to[k])));
+        }
+        out.push_back(sequence);
+    }
+}
+
+// 把带码点区间的集合节点原地改写为字节序列的分支 (单字节部分在前), 之后的编译步骤只处理字节;
+// 各分支的首字节互不相同, 分支顺序不影响最左优先的结果. 没有这类节点时返回 false, 不复制语法树
+bool expandUtf8(const RegexAst& ast, RegexAst& expanded) {
+    bool found = false;
+    for (const RegexNode& node : ast.nodes) found = found || !node.codepoints.empty();
+    if (!found) return false;
+    expanded = ast;
+    size_t count = expanded.nodes.size();
+    vector<Utf8Sequence> sequences;
+    for (size_t id = 0; id < count; ++id) {
+        if (expanded.nodes[id].codepoints.empty()) continue;
+        RegexNode original = expanded.nodes[id];
+        auto addNode = [&](RegexNode node, const vector<int>& kids) {
+            node.srcBegin = original.srcBegin;
+            node.srcEnd = original.srcEnd;
+            node.childBegin = static_cast<int>(expanded.children.size());
+            node.childCount = static_cast<int>(kids.size());
+            expanded.children.insert(expanded.children.end(), kids.begin(), kids.end());
+            expanded.nodes.push_back(node);
+            return static_cast<int>(expanded.nodes.size()) - 1;
+        };
+        RegexNode byteNode;
+        byteNode.type = NODE_SET;
+        vector<int> alternatives;
+        if (original.set.count() > 0) {
+            byteNode.set = original.set;
+            alternatives.push_back(addNode(byteNode, vector<int>()));
+        }
+        sequences.clear();
+        for (const auto& range : original.codepoints) utf8Sequences(range.first, range.second, sequences);
+        for (const Utf8Sequence& sequence : sequences) {
+            vector<int> bytes;
+            for (const auto& range : sequence) {
+                byteNode.set = ByteSet();
+                byteNode.set.addRange(range.first, range.second);
+                bytes.push_back(addNode(byteNode, vector<int>()));
+            }
+            RegexNode concat;
+            concat.type = NODE_CONCAT;
+            alternatives.push_back(addNode(concat, bytes));
+        }
+        RegexNode& node = expanded.nodes[id];
+        node.codepoints.clear();
+        if (alternatives.empty()) {
+            node.set = ByteSet();
+            continue;
+        }
+        node.type = NODE_ALTERNATE;
+        node.childBegin = static_cast<int>(expanded.children.size());
+        node.childCount = static_cast<int>(alternatives.size());
+        expanded.children.insert(expanded.children.end(), alternatives.begin(), alternatives.end());
+    }
+    return true;
+}
+
+// 匹配只能由 consumable 中的字节组成, 因此不会跨越其他字节
+ByteSet consumableBytes(const RegexAst& ast) {
+    ByteSet result;
+    for (const RegexNode& node : ast.nodes) {
+        if (node.type == NODE_SET) result.merge(node.set);
+    }
+    return result;
+}
+
+bool compilePattern(const RegexAst& source, CompiledPattern& compiled, string& error) {
+    if (!matcherSupports(source, error)) return false;
+    RegexAst expanded;
+    const RegexAst& ast = expandUtf8(source, expanded) ? expanded : source;
+    compiled.consumable = consumableBytes(ast);
+    compiled.prefilter = choosePrefilter(ast);
+    NfaCompiler forwardCompiler(ast, compiled.forward, false);
+    if (!forwardCompiler.compile(0, error)) return false;
+    NfaCompiler reverseCompiler(ast, compiled.reverse, true);
+    return reverseCompiler.compile(0, error);
+}
+
+bool compilePattern(const string& pattern, const GenerationOptions& options, CompiledPattern& compiled, string& error) {
+    RegexAst ast;
+    return parseRegex(pattern, options, ast, error) && compilePattern(ast, compiled, error);
+}
+
+bool compilePatternSet(const vector<pair<string, string>>& namedPatterns, const GenerationOptions& options,
+                       CompiledPatternSet& compiled, string& error) {
+    compiled.patterns.resize(namedPatterns.size());
+    int start = -1;
+    for (size_t k = 0; k < namedPatterns.size(); ++k) {
+        const string& pattern = namedPatterns[k].second;
+        compiled.names.push_back(namedPatterns[k].first);
+        RegexAst ast;
+        if (!parseRegex(pattern, options, ast, error) || !compilePattern(ast, compiled.patterns[k], error)) {
+            error = namedPatterns[k].first + ": " + error;
+            return false;
+        }
+        RegexAst expanded;
+        NfaCompiler compiler(expandUtf8(ast, expanded) ? expanded : ast, compiled.combined, false);
+        int entry = compiler.compileRoot(static_cast<int>(k), error);
+        if (entry < 0) return false;
+        if (start < 0) {
+            start = entry;
+        } else {
+            NfaState split = {NFA_SPLIT, 0, start, entry, -1};
+            compiled.combined.states.push_back(split);
+            start = static_cast<int>(compiled.combined.states.size()) - 1;
+        }
+    }
+    compiled.combined.start = start;
+    NfaCompiler::addUnanchoredPrefix(compiled.combined);
+    return true;
+}
+
+// ============================================================
+// 完全展开的 DFA: DFA 代码生成和语言比较共用
+// ============================================================
+
+enum DenseDfaFlag {
+    DFA_FLAG_MATCH = 1,  // 在进入该状态的字节之前结束了一个匹配
+    DFA_FLAG_EOF = 2     // 输入在该状态结束时匹配
+};
+
+// 完全展开的 DFA, 状态 0 为死状态
+struct DenseDfa {
+    vector<int> next;        // 状态数 × 256
+    vector<uint8_t> flags;
+    int start[4] = {0, 0, 0, 0};  // 按 ScanContext 索引
+
+    int stateCount() const { return static_cast<int>(flags.size()); }
+};
+
+// 从惰性 DFA 展开所有可达状态; 状态数超过 maxStates 时失败
+bool buildDenseDfa(const RegexProgram& program, bool leftmostFirst, bool anchored, bool allContexts, int maxStates,
+                   DenseDfa& dfa) {
+    LazyDfa lazy(program, leftmostFirst, static_cast<size_t>(-1));
+    vector<int> denseOf(1, 0);
+    vector<int> lazyOf(1, LazyDfa::DEAD);
+    vector<int> classTarget;
+    dfa.next.clear();
+    dfa.flags.assign(1, 0);
+    auto dense = [&](int state) {
+        if (state >= static_cast<int>(denseOf.size())) denseOf.resize(state + 1, -1);
+        if (denseOf[state] < 0) {
+            denseOf[state] = static_cast<int>(lazyOf.size());
+            lazyOf.push_back(state);
+            dfa.flags.push_back(static_cast<uint8_t>((lazy.isMatchState(state) ? DFA_FLAG_MATCH : 0) |
+                                                     (lazy.matchesAtEnd(state) ? DFA_FLAG_EOF : 0)));
+        }
+        return denseOf[state];
+    };
+    dfa.start[CTX_EDGE] = dense(lazy.startState(lazy.edgeContext(), anchored));
+    if (allContexts) {
+        dfa.start[CTX_NEWLINE] = dense(lazy.startState(lazy.contextOf('\n'), anchored));
+        dfa.start[CTX_WORD] = dense(lazy.startState(lazy.contextOf('a'), anchored));
+        dfa.start[CTX_OTHER] = dense(lazy.startState(lazy.contextOf(' '), anchored));
+    } else {
+        dfa.start[CTX_NEWLINE] = dfa.start[CTX_WORD] = dfa.start[CTX_OTHER] = dfa.start[CTX_EDGE];
+    }
+    for (size_t current = 0; current < lazyOf.size(); ++current) {
+        if (static_cast<int>(lazyOf.size()) > maxStates) return false;
+        dfa.next.resize((current + 1) * 256, 0);
+        if (current == 0) continue;
+        // 同一字节类的转移相同, 每类只计算一次
+        const uint8_t* classes = lazy.byteClasses();
+        classTarget.assign(lazy.classCount(), -1);
+        for (int byte = 0; byte < 256; ++byte) {
+            int& target = classTarget[classes[byte]];
+            if (target < 0) {
+                target = dense(lazy.computeNext(lazyOf[current], static_cast<unsigned char>(byte)) & ~LazyDfa::SPECIAL);
+            }
+            dfa.next[current * 256 + byte] = target;
+        }
+    }
+    return true;
+}
+
+// ============================================================
+// ReDoS 分析: 回溯引擎 (Python、Java、JavaScript、std::regex) 的耗时取决于
+// 同一输入有多少条匹配路径。在保留路径重数的 Glushkov 自动机上检测
+// 指数歧义 (EDA) 和多项式歧义 (IDA), 并用内置匹配器验证构造的攻击串
+// ============================================================
+
+// 集合中最易读的代表字节: 字母数字优先, 其次可打印字符
+uint8_t representativeByte(const ByteSet& set) {
+    const char* preferred = "abcdefghijklmnopqrstuvwxyz0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    for (const char* p = preferred; *p; ++p) {
+        if (set.has(static_cast<uint8_t>(*p))) return static_cast<uint8_t>(*p);
+    }
+    for (int c = 0x20; c < 0x7f; ++c) {
+        if (set.has(static_cast<uint8_t>(c))) return static_cast<uint8_t>(c);
+    }
+    for (int c = 0; c < 256; ++c) {
+        if (set.has(static_cast<uint8_t>(c))) return static_cast<uint8_t>(c);
+    }
+    return 0;
+}
+
+// 集合中最多 limit 个字节, 按 representativeByte 的偏好排列; 用于换用其他字节构造泵串
+string readableBytes(const ByteSet& set, size_t limit) {
+    string out;
+    vector<char> taken(256, 0);
+    auto take = [&](int c) {
+        if (out.size() >= limit || taken[c] || !set.has(static_cast<uint8_t>(c))) return;
+        taken[c] = 1;
+        out.push_back(static_cast<char>(c));
+    };
+    const char* preferred = "abcdefghijklmnopqrstuvwxyz0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    for (const char* p = preferred; *p; ++p) take(static_cast<uint8_t>(*p));
+    for (int c = 0x20; c < 0x7f; ++c) take(c);
+    for (int c = 0; c < 256; ++c) take(c);
+    return out;
+}
+
+// 迭代式 Tarjan 强连通分量; 分量编号按逆拓扑序分配 (汇点先编号)
+vector<int> stronglyConnected(int count, const function<void(int, vector<int>&)>& neighbors, int& componentCount) {
+    vector<int> component(count, -1), index(count, -1), low(count, 0);
+    vector<char> onStack(count, 0);
+    vector<int> stack;
+    struct Frame {
+        int node;
+        vector<int> next;
+        size_t cursor;
+    };
+    vector<Frame> frames;
+    int counter = 0;
+    componentCount = 0;
+    for (int root = 0; root < count; ++root) {
+        if (index[root] >= 0) continue;
+        frames.push_back(Frame{root, vector<int>(), 0});
+        neighbors(root, frames.back().next);
+        index[root] = low[root] = counter++;
+        stack.push_back(root);
+        onStack[root] = 1;
+        while (!frames.empty()) {
+            Frame& frame = frames.back();
+            if (frame.cursor < frame.next.size()) {
+                int next = frame.next[frame.cursor++];
+                if (index[next] < 0) {
+                    index[next] = low[next] = counter++;
+                    stack.push_back(next);
+                    onStack[next] = 1;
+                    frames.push_back(Frame{next, vector<int>(), 0});
+                    neighbors(next, frames.back().next);
+                } else if (onStack[next]) {
+                    low[frame.node] = min(low[frame.node], index[next]);
+                }
+                continue;
+            }
+            int node = frame.node;
+            if (low[node] == index[node]) {
+                int member;
+                do {
+                    member = stack.back();
+                    stack.pop_back();
+                    onStack[member] = 0;
+                    component[member] = componentCount;
+                } while (member != node);
+                ++componentCount;
+            }
+            frames.pop_back();
+            if (!frames.empty()) low[frames.back().node] = min(low[frames.back().node], low[node]);
+        }
+    }
+    return component;
+}
+
+class AmbiguityAnalyzer {
+public:
+    AmbiguityAnalyzer(const string& pattern, const RegexAst& ast, const GenerationOptions& options)
+        : pattern(pattern), ast(ast), options(options) {}
+
+    bool analyze(RedosReport& report, string& error) {
+        if (!buildAutomaton(error)) return false;
+        computeComponents();
+        report = RedosReport();
+        vector<RedosReport> candidates;
+        findExponential(candidates);
+        findPolynomial(candidates);
+        bool complete = budget > 0;
+        const RedosReport* unconfirmed = nullptr;
+        for (RedosReport& candidate : candidates) {
+            Verdict verdict = verify(candidate);
+            if (verdict == VERDICT_CONFIRMED) {
+                report = candidate;
+                report.complete = complete;
+                return true;
+            }
+            if (verdict == VERDICT_UNKNOWN && !unconfirmed) unconfirmed = &candidate;
+        }
+        // 歧义存在, 但在搜索上限内既没有构造出攻击串也没能排除: 仍报告结构上的风险, 标记为未验证、分析不完整.
+        // 所有候选都被排除 (泵串本身就使尝试匹配成功, 或穷举所有后缀都会匹配) 时才是线性
+        if (unconfirmed) {
+            report = *unconfirmed;
+            report.verified = false;
+            complete = false;
+        }
+        report.complete = complete;
+        return true;
+    }
+
+    // 把攻击串片段展开成实际字符串
+    static string expandAttack(const vector<AttackSegment>& attack) {
+        string text;
+        for (const AttackSegment& segment : attack) {
+            for (size_t k = 0; k < segment.repeat; ++k) text += segment.text;
+        }
+        return text;
+    }
+
+private:
+    enum { MAX_POSITIONS = 20000, MAX_EDGES = 2000000, MAX_PAIR_STATES = 4000000 };
+    typedef vector<pair<int, int>> Counts;  // (状态, 路径数), 路径数在 2 处饱和
+
+    struct Fragment {
+        Counts first;
+        Counts last;
+        int nullable = 0;
+    };
+
+    const string& pattern;
+    const RegexAst& ast;
+    const GenerationOptions& options;
+    vector<ByteSet> sets;           // 进入状态时读入的字节集合; 状态 0 为初始状态
+    vector<int> origin;             // 状态对应的语法树节点, -1 表示初始状态或隐式前缀
+    vector<Counts> follow;
+    vector<vector<int>> edges;      // 展开路径重数后的转移
+    vector<int> component;
+    int componentCount = 0;
+    vector<char> looping;           // 分量内存在环
+    int anyState = -1;              // 非锚定搜索的隐式 .*? 前缀
+    bool tooLarge = false;
+    long long budget = 20000000;    // 乘积自动机的搜索步数预算
+
+    static int saturate(int n) { return n > 2 ? 2 : n; }
+
+    static Counts merge(const Counts& a, const Counts& b, int weight) {
+        if (weight == 0 || b.empty()) return a;
+        Counts out;
+        out.reserve(a.size() + b.size());
+        size_t i = 0, j = 0;
+        while (i < a.size() || j < b.size()) {
+            if (j == b.size() || (i < a.size() && a[i].first < b[j].first)) {
+                out.push_back(a[i++]);
+            } else if (i == a.size() || b[j].first < a[i].first) {
+                out.push_back(make_pair(b[j].first, saturate(b[j].second * weight)));
+                ++j;
+            } else {
+                out.push_back(make_pair(a[i].first, saturate(a[i].second + b[j].second * weight)));
+                ++i;
+                ++j;
+            }
+        }
+        return out;
+    }
+
+    void link(const Counts& from, const Counts& to) {
+        for (const auto& source : from) {
+            for (const auto& target : to) {
+                follow[source.first].push_back(make_pair(target.first, saturate(source.second * target.second)));
+            }
+            if (follow[source.first].size() > MAX_EDGES / 16) tooLarge = true;
+        }
+    }
+
+    Fragment concat(const Fragment& a, const Fragment& b) {
+        link(a.last, b.first);
+        Fragment out;
+        out.first = merge(a.first, b.first, a.nullable);
+        out.last = merge(b.last, a.last, b.nullable);
+        out.nullable = saturate(a.nullable * b.nullable);
+        return out;
+    }
+
+    Fragment alternate(const Fragment& a, const Fragment& b) {
+        Fragment out;
+        out.first = merge(a.first, b.first, 1);
+        out.last = merge(a.last, b.last, 1);
+        out.nullable = saturate(a.nullable + b.nullable);
+        return out;
+    }
+
+    // x+ : 每次迭代结束都可以回到循环体开头
+    Fragment plus(const Fragment& body) {
+        link(body.last, body.first);
+        return body;
+    }
+
+    Fragment empty() {
+        Fragment out;
+        out.nullable = 1;
+        return out;
+    }
+
+    int newState(const ByteSet& set, int node) {
+        sets.push_back(set);
+        origin.push_back(node);
+        follow.push_back(Counts());
+        if (sets.size() > MAX_POSITIONS) tooLarge = true;
+        return static_cast<int>(sets.size()) - 1;
+    }
+
+    // 每次调用都为叶子创建新位置, 计数重复因此被展开
+    Fragment build(int id) {
+        const RegexNode& node = ast.node(id);
+        if (tooLarge) return empty();
+        switch (node.type) {
+            case NODE_SET: {
+                Fragment out;
+                int state = newState(node.set, id);
+                out.first.push_back(make_pair(state, 1));
+                out.last.push_back(make_pair(state, 1));
+                return out;
+            }
+            case NODE_CONCAT: {
+                Fragment out = empty();
+                for (int k = 0; k < node.childCount; ++k) out = concat(out, build(ast.child(node, k)));
+                return out;
+            }
+            case NODE_ALTERNATE: {
+                Fragment out = build(ast.child(node, 0));
+                for (int k = 1; k < node.childCount; ++k) out = alternate(out, build(ast.child(node, k)));
+                return out;
+            }
+            case NODE_GROUP:
+                return build(ast.child(node, 0));
+            case NODE_REPEAT: {
+                int body = ast.child(node, 0);
+                int mandatory = node.minRepeat;
+                Fragment out = empty();
+                if (node.maxRepeat == -1) {
+                    for (int k = 1; k < mandatory; ++k) out = concat(out, build(body));
+                    Fragment loop = plus(build(body));
+                    if (mandatory == 0) loop = alternate(loop, empty());
+                    return concat(out, loop);
+                }
+                for (int k = 0; k < mandatory; ++k) out = concat(out, build(body));
+                // x{m,n} 的可选部分与回溯引擎一致: (x(x(x)?)?)?
+                Fragment tail = empty();
+                for (int k = node.minRepeat; k < node.maxRepeat && !tooLarge; ++k) {
+                    tail = alternate(concat(build(body), tail), empty());
+                }
+                return concat(out, tail);
+            }
+            default:
+                return empty();
+        }
+    }
+
+    // 模式是否只能在文本开头匹配 (此时搜索不会在每个起点重试)
+    bool anchoredAtStart(int id) const {
+        const RegexNode& node = ast.node(id);
+        switch (node.type) {
+            case NODE_ASSERT:
+                return node.assertion == ASSERT_TEXT_BEGIN ||
+                       (node.assertion == ASSERT_LINE_BEGIN && !options.multiline);
+            case NODE_GROUP:
+                return anchoredAtStart(ast.child(node, 0));
+            case NODE_CONCAT:
+                return node.childCount > 0 && anchoredAtStart(ast.child(node, 0));
+            case NODE_ALTERNATE:
+                for (int k = 0; k < node.childCount; ++k) {
+                    if (!anchoredAtStart(ast.child(node, k))) return false;
+                }
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    bool buildAutomaton(string& error) {
+        Fragment start;
+        start.last.push_back(make_pair(newState(ByteSet(), -1), 1));
+        Fragment pattern = build(ast.root);
+        if (!anchoredAtStart(ast.root)) {
+            ByteSet all;
+            all.addRange(0, 255);
+            anyState = newState(all, -1);
+            Fragment prefix;
+            prefix.first.push_back(make_pair(anyState, 1));
+            prefix.last = prefix.first;
+            start = concat(start, alternate(plus(prefix), empty()));
+        }
+        concat(start, pattern);
+        if (tooLarge) {
+            error = "pattern is too large to analyze";
+            return false;
+        }
+
+        // 路径数为 2 的转移复制目标状态, 使两条路径经过不同的状态
+        int positions = static_cast<int>(sets.size());
+        vector<int> cloneOf(positions, -1);
+        edges.assign(positions, vector<int>());
+        for (int state = 0; state < positions; ++state) {
+            Counts& targets = follow[state];
+            sort(targets.begin(), targets.end());
+            Counts combined;
+            for (const auto& target : targets) {
+                if (!combined.empty() && combined.back().first == target.first) {
+                    combined.back().second = saturate(combined.back().second + target.second);
+                } else {
+                    combined.push_back(target);
+                }
+            }
+            targets.swap(combined);
+        }
+        vector<pair<int, int>> clones;
+        for (int state = 0; state < positions; ++state) {
+            for (const auto& target : follow[state]) {
+                edges[state].push_back(target.first);
+                if (target.second < 2) continue;
+                if (cloneOf[target.first] < 0) {
+                    cloneOf[target.first] = static_cast<int>(sets.size());
+                    sets.push_back(sets[target.first]);
+                    origin.push_back(origin[target.first]);
+                    clones.push_back(make_pair(cloneOf[target.first], target.first));
+                }
+                edges[state].push_back(cloneOf[target.first]);
+            }
+        }
+        edges.resize(sets.size());
+        for (const auto& clone : clones) edges[clone.first] = edges[clone.second];
+        return true;
+    }
+
+    void computeComponents() {
+        component = stronglyConnected(static_cast<int>(sets.size()), [this](int state, vector<int>& out) {
+            out = edges[state];
+        }, componentCount);
+        looping.assign(componentCount, 0);
+        vector<int> sizes(componentCount, 0);
+        for (size_t state = 0; state < sets.size(); ++state) ++sizes[component[state]];
+        for (size_t state = 0; state < sets.size(); ++state) {
+            if (sizes[component[state]] > 1) looping[component[state]] = 1;
+            for (int next : edges[state]) {
+                if (next == static_cast<int>(state)) looping[component[state]] = 1;
+            }
+        }
+    }
+
+    vector<int> membersOf(int comp) const {
+        vector<int> members;
+        for (size_t state = 0; state < sets.size(); ++state) {
+            if (component[state] == comp) members.push_back(static_cast<int>(state));
+        }
+        return members;
+    }
+
+    // 从初始状态到 target 的最短输入
+    string shortestPrefix(int target) const {
+        vector<int> parent(sets.size(), -2);
+        deque<int> queue;
+        parent[0] = -1;
+        queue.push_back(0);
+        while (!queue.empty()) {
+            int state = queue.front();
+            queue.pop_front();
+            if (state == target) break;
+            for (int next : edges[state]) {
+                if (parent[next] != -2) continue;
+                parent[next] = state;
+                queue.push_back(next);
+            }
+        }
+        string word;
+        for (int state = target; state > 0 && parent[state] >= 0; state = parent[state]) {
+            word.push_back(static_cast<char>(representativeByte(sets[state])));
+        }
+        reverse(word.begin(), word.end());
+        return word;
+    }
+
+    // 分量内从 from 到 to 的最短输入 (from == to 时为空)
+    string pathWithin(int from, int to) const {
+        if (from == to) return string();
+        map<int, int> parent;
+        deque<int> queue;
+        parent[from] = -1;
+        queue.push_back(from);
+        while (!queue.empty() && parent.find(to) == parent.end()) {
+            int state = queue.front();
+            queue.pop_front();
+            for (int next : edges[state]) {
+                if (component[next] != component[from] || parent.count(next)) continue;
+                parent[next] = state;
+                queue.push_back(next);
+            }
+        }
+        string word;
+        for (int state = to; state != from; state = parent[state]) {
+            word.push_back(static_cast<char>(representativeByte(sets[state])));
+        }
+        reverse(word.begin(), word.end());
+        return word;
+    }
+
+    // 包含分量所有位置的无上限量词: 默认取最内层;
+    // outermost 时取其位置全部落在分量内的最外层量词 (嵌套量词中引起歧义的外层)
+    pair<int, int> loopSpan(int comp, bool outermost = false) const {
+        vector<int> parent(ast.nodes.size(), -1);
+        for (size_t id = 0; id < ast.nodes.size(); ++id) {
+            const RegexNode& node = ast.nodes[id];
+            for (int k = 0; k < node.childCount; ++k) parent[ast.child(node, k)] = static_cast<int>(id);
+        }
+        map<int, int> hits;
+        set<int> origins;
+        int positions = 0;
+        for (size_t state = 0; state < sets.size(); ++state) {
+            if (component[state] != comp || origin[state] < 0) continue;
+            ++positions;
+            origins.insert(origin[state]);
+            set<int> seen;
+            for (int id = parent[origin[state]]; id >= 0; id = parent[id]) {
+                if (ast.nodes[id].type == NODE_REPEAT && ast.nodes[id].maxRepeat == -1 && seen.insert(id).second) {
+                    ++hits[id];
+                }
+            }
+        }
+        auto width = [this](int id) { return ast.nodes[id].srcEnd - ast.nodes[id].srcBegin; };
+        auto inside = [&](int id) {
+            vector<int> pending(1, id);
+            while (!pending.empty()) {
+                const RegexNode& node = ast.nodes[pending.back()];
+                if (node.type == NODE_SET && !origins.count(pending.back())) return false;
+                pending.pop_back();
+                for (int k = 0; k < node.childCount; ++k) pending.push_back(ast.child(node, k));
+            }
+            return true;
+        };
+        int best = -1;
+        for (const auto& hit : hits) {
+            if (hit.second != positions) continue;
+            if (outermost && best >= 0 && !inside(hit.first)) continue;
+            if (best < 0 || (outermost ? width(hit.first) > width(best) : width(hit.first) < width(best))) {
+                best = hit.first;
+            }
+        }
+        if (best < 0) return make_pair(0, 0);
+        return make_pair(ast.nodes[best].srcBegin, ast.nodes[best].srcEnd);
+    }
+
+    // 指数风险: 分量内某状态 q 存在两条不同的、读同一输入的 q -> q 路径,
+    // 即 (q, q) 与某个 (p, p'), p != p' 在成对乘积自动机的同一强连通分量中
+    void findExponential(vector<RedosReport>& candidates) {
+        for (int comp = 0; comp < componentCount && budget > 0; ++comp) {
+            if (!looping[comp]) continue;
+            vector<int> members = membersOf(comp);
+            long long n = static_cast<long long>(members.size());
+            if (n * n > MAX_PAIR_STATES) {
+                budget = 0;
+                break;
+            }
+            map<int, int> local;
+            for (size_t k = 0; k < members.size(); ++k) local[members[k]] = static_cast<int>(k);
+            auto pairEdges = [&](int pairState, vector<pair<int, uint8_t>>& out) {
+                out.clear();
+                int a = members[pairState / n];
+                int b = members[pairState % n];
+                for (int x : edges[a]) {
+                    if (component[x] != comp) continue;
+                    for (int y : edges[b]) {
+                        if (component[y] != comp) continue;
+                        ByteSet common = sets[x];
+                        bool overlap = false;
+                        for (int w = 0; w < 4; ++w) {
+                            common.bits[w] &= sets[y].bits[w];
+                            overlap = overlap || common.bits[w] != 0;
+                        }
+                        --budget;
+                        if (overlap) out.push_back(make_pair(local[x] * static_cast<int>(n) + local[y],
+                                                             representativeByte(common)));
+                    }
+                }
+            };
+            int pairComponents = 0;
+            vector<pair<int, uint8_t>> scratch;
+            vector<int> pairComponent = stronglyConnected(static_cast<int>(n * n), [&](int pairState, vector<int>& out) {
+                pairEdges(pairState, scratch);
+                out.clear();
+                for (const auto& edge : scratch) out.push_back(edge.first);
+            }, pairComponents);
+            if (budget <= 0) break;
+            vector<int> diagonal(pairComponents, -1), offDiagonal(pairComponents, -1);
+            for (int k = 0; k < n * n; ++k) {
+                if (k / n == k % n) {
+                    if (diagonal[pairComponent[k]] < 0) diagonal[pairComponent[k]] = k;
+                } else if (offDiagonal[pairComponent[k]] < 0) {
+                    offDiagonal[pairComponent[k]] = k;
+                }
+            }
+            for (int pc = 0; pc < pairComponents; ++pc) {
+                if (diagonal[pc] < 0 || offDiagonal[pc] < 0) continue;
+                auto route = [&](int from, int to) {
+                    map<int, pair<int, uint8_t>> parent;
+                    deque<int> queue;
+                    parent[from] = make_pair(-1, 0);
+                    queue.push_back(from);
+                    vector<pair<int, uint8_t>> out;
+                    while (!queue.empty() && !parent.count(to)) {
+                        int state = queue.front();
+                        queue.pop_front();
+                        pairEdges(state, out);
+                        for (const auto& edge : out) {
+                            if (pairComponent[edge.first] != pc || parent.count(edge.first)) continue;
+                            parent[edge.first] = make_pair(state, edge.second);
+                            queue.push_back(edge.first);
+                        }
+                    }
+                    string word;
+                    for (int state = to; state != from; state = parent[state].first) {
+                        word.push_back(static_cast<char>(parent[state].second));
+                    }
+                    reverse(word.begin(), word.end());
+                    return word;
+                };
+                int q = members[diagonal[pc] / n];
+                RedosReport candidate;
+                candidate.risk = RISK_EXPONENTIAL;
+                candidate.loops.push_back(loopSpan(comp, true));
+                string pump = route(diagonal[pc], offDiagonal[pc]) + route(offDiagonal[pc], diagonal[pc]);
+                candidate.attack.push_back(AttackSegment{shortestPrefix(q), 1});
+                candidate.attack.push_back(AttackSegment{pump, 30});
+                candidates.push_back(candidate);
+                break;
+            }
+        }
+    }
+
+    // 多项式风险: 两个循环分量 A -> B 之间存在 p∈A, q∈B 和输入 w,
+    // 使 p -w-> p, p -w-> q, q -w-> q; 这样的分量链长度 d 给出 O(n^(d+1)) 的回溯
+    struct Pump {
+        int from;        // A 中的 p
+        int to;          // B 中的 q
+        string word;
+    };
+    struct Connection {
+        int target = -1;
+        vector<Pump> pumps;  // 不同的 (p, q) 或换用集合中其他字节得到的候选, 按发现顺序
+    };
+    // 每对分量最多收集的泵串数; 找到第一个后最多再尝试的 (p, q) 数
+    enum { MAX_PUMPS = 6, MAX_EXTRA_PAIRS = 16 };
+
+    bool connected(int a, int b, Connection& connection) {
+        vector<int> from = membersOf(a), to = membersOf(b);
+        // 三元组中间分量限制在 A 可达且可达 B 的状态上
+        vector<char> forward(sets.size(), 0), backward(sets.size(), 0);
+        deque<int> queue;
+        for (int state : from) {
+            forward[state] = 1;
+            queue.push_back(state);
+        }
+        while (!queue.empty()) {
+            int state = queue.front();
+            queue.pop_front();
+            for (int next : edges[state]) {
+                if (!forward[next]) {
+                    forward[next] = 1;
+                    queue.push_back(next);
+                }
+            }
+        }
+        bool reachable = false;
+        for (int state : to) reachable = reachable || forward[state];
+        if (!reachable) return false;
+        vector<vector<int>> reverseEdges(sets.size());
+        for (size_t state = 0; state < sets.size(); ++state) {
+            for (int next : edges[state]) reverseEdges[next].push_back(static_cast<int>(state));
+        }
+        for (int state : to) {
+            backward[state] = 1;
+            queue.push_back(state);
+        }
+        while (!queue.empty()) {
+            int state = queue.front();
+            queue.pop_front();
+            for (int previous : reverseEdges[state]) {
+                if (!backward[previous]) {
+                    backward[previous] = 1;
+                    queue.push_back(previous);
+                }
+            }
+        }
+
+        typedef unsigned long long Key;
+        const Key width = static_cast<Key>(sets.size());
+        int extraPairs = 0;
+        for (int p : from) {
+            for (int q : to) {
+                if (connection.pumps.size() >= MAX_PUMPS ||
+                    (!connection.pumps.empty() && ++extraPairs > MAX_EXTRA_PAIRS)) {
+                    break;
+                }
+                Key start = (static_cast<Key>(p) * width + p) * width + q;
+                Key goal = (static_cast<Key>(p) * width + q) * width + q;
+                unordered_map<Key, pair<Key, uint8_t>> parent;
+                deque<Key> triples;
+                parent[start] = make_pair(start, 0);
+                triples.push_back(start);
+                bool found = false;
+                while (!triples.empty() && !found && budget > 0) {
+                    Key state = triples.front();
+                    triples.pop_front();
+                    int x = static_cast<int>(state / width / width);
+                    int y = static_cast<int>(state / width % width);
+                    int z = static_cast<int>(state % width);
+                    for (int nx : edges[x]) {
+                        if (component[nx] != a) continue;
+                        for (int ny : edges[y]) {
+                            if (!forward[ny] || !backward[ny]) continue;
+                            for (int nz : edges[z]) {
+                                if (component[nz] != b) continue;
+                                --budget;
+                                ByteSet common = sets[nx];
+                                bool overlap = false;
+                                for (int w = 0; w < 4; ++w) {
+                                    common.bits[w] &= sets[ny].bits[w] & sets[nz].bits[w];
+                                    overlap = overlap || common.bits[w] != 0;
+                                }
+                                if (!overlap) continue;
+                                Key next = (static_cast<Key>(nx) * width + ny) * width + nz;
+                                if (parent.count(next)) continue;
+                                parent[next] = make_pair(state, representativeByte(common));
+                                if (next == goal) found = true;
+                                triples.push_back(next);
+                            }
+                        }
+                    }
+                }
+                if (!found) continue;
+                string word;
+                vector<ByteSet> steps;  // 每一步三个状态共同接受的字节
+                for (Key state = goal; state != start; state = parent[state].first) {
+                    word.push_back(static_cast<char>(parent[state].second));
+                    ByteSet common = sets[state / width / width];
+                    for (int w = 0; w < 4; ++w) {
+                        common.bits[w] &= sets[state / width % width].bits[w] & sets[state % width].bits[w];
+                    }
+                    steps.push_back(common);
+                }
+                reverse(word.begin(), word.end());
+                reverse(steps.begin(), steps.end());
+                connection.target = b;
+                connection.pumps.push_back(Pump{p, q, word});
+                // 同一路径上每一步换用集合中的其他字节: 代表字节可能恰好让模式的其余部分匹配成功
+                for (size_t variant = 1; variant < 3 && connection.pumps.size() < MAX_PUMPS; ++variant) {
+                    string other;
+                    for (const ByteSet& step : steps) {
+                        string bytes = readableBytes(step, variant + 1);
+                        other.push_back(bytes[min(variant, bytes.size() - 1)]);
+                    }
+                    bool seen = false;
+                    for (const Pump& pump : connection.pumps) seen = seen || (pump.to == q && pump.word == other);
+                    if (!seen) connection.pumps.push_back(Pump{p, q, other});
+                }
+            }
+            if (connection.pumps.size() >= MAX_PUMPS || extraPairs > MAX_EXTRA_PAIRS) break;
+        }
+        return !connection.pumps.empty();
+    }
+
+    void findPolynomial(vector<RedosReport>& candidates) {
+        vector<int> loops;
+        for (int comp = 0; comp < componentCount; ++comp) {
+            if (looping[comp]) loops.push_back(comp);
+        }
+        // Tarjan 按逆拓扑序编号, 编号小的分量在后面; 从汇点向前计算最长链
+        map<int, int> chainLength;
+        map<int, Connection> successor;
+        for (int a : loops) {
+            chainLength[a] = 0;
+            for (int b : loops) {
+                if (b >= a || budget <= 0) continue;
+                Connection connection;
+                if (!connected(a, b, connection)) continue;
+                if (chainLength[b] + 1 > chainLength[a]) {
+                    chainLength[a] = chainLength[b] + 1;
+                    successor[a] = connection;
+                }
+            }
+        }
+        vector<pair<int, int>> starts;
+        for (const auto& entry : chainLength) {
+            if (entry.second > 0) starts.push_back(make_pair(-entry.second, entry.first));
+        }
+        sort(starts.begin(), starts.end());
+        for (const auto& start : starts) {
+            int degree = -start.first;
+            // 使总步数约为 1e10: 每段重复 n 次, 回溯需要约 n^(degree+1) 步
+            double perSegment = pow(1e10, 1.0 / (degree + 1));
+            // 第 k 个候选在链上每一跳使用第 k 个泵串 (不足时用最后一个)
+            size_t variants = 1;
+            for (int comp = start.second; successor.count(comp); comp = successor[comp].target) {
+                variants = max(variants, successor[comp].pumps.size());
+            }
+            for (size_t variant = 0; variant < variants; ++variant) {
+                auto pick = [&](int comp) -> const Pump& {
+                    const vector<Pump>& pumps = successor[comp].pumps;
+                    return pumps[min(variant, pumps.size() - 1)];
+                };
+                RedosReport candidate;
+                candidate.risk = RISK_POLYNOMIAL;
+                candidate.degree = degree + 1;
+                int comp = start.second;
+                int position = pick(comp).from;
+                candidate.implicitPrefix = anyState >= 0 && component[anyState] == comp;
+                candidate.attack.push_back(
+                    AttackSegment{candidate.implicitPrefix ? string() : shortestPrefix(position), 1});
+                if (!candidate.implicitPrefix) candidate.loops.push_back(loopSpan(comp));
+                while (successor.count(comp)) {
+                    const Pump& pump = pick(comp);
+                    candidate.attack.push_back(AttackSegment{pathWithin(position, pump.from), 1});
+                    size_t repeat = static_cast<size_t>(perSegment / max<size_t>(pump.word.size(), 1));
+                    candidate.attack.push_back(AttackSegment{pump.word, min<size_t>(max<size_t>(repeat, 2), 100000)});
+                    position = pump.to;
+                    comp = successor[comp].target;
+                    candidate.loops.push_back(loopSpan(comp));
+                }
+                candidates.push_back(candidate);
+            }
+        }
+    }
+
+    enum { MAX_VERIFY_STATES = 20000, MAX_SUFFIX_LENGTH = 8, MAX_SUFFIX_SETS = 4096 };
+    enum Verdict {
+        VERDICT_CONFIRMED,  // 找到使尝试失败的攻击串
+        VERDICT_REFUTED,    // 这个候选的任何后缀都无法使尝试失败
+        VERDICT_UNKNOWN     // 超出搜索上限
+    };
+    // 编译结果和惰性 DFA 在所有候选间共用; DFA 只展开验证走到的状态
+    bool verifierBuilt = false;
+    CompiledPattern compiled;
+    unique_ptr<LazyDfa> anchoredDfa;
+
+    // 回溯引擎只有在一次尝试失败时才会穷举这次尝试的所有路径. 攻击的起点是串首; 风险来自隐式前缀时,
+    // 重复部分中的每个位置都是起点. 这些尝试都不能匹配: 整体搜索在别处 (例如后缀之后) 成功不影响攻击
+    Verdict verify(RedosReport& candidate) {
+        if (!verifierBuilt) {
+            verifierBuilt = true;
+            string error;
+            if (compilePattern(ast, compiled, error)) {
+                anchoredDfa.reset(new LazyDfa(compiled.forward, false, static_cast<size_t>(-1)));
+            }
+        }
+        if (!anchoredDfa) return VERDICT_CONFIRMED;
+        // 先用缩短的攻击串寻找后缀, 再验证完整攻击串
+        vector<AttackSegment> shortened = candidate.attack;
+        for (AttackSegment& segment : shortened) segment.repeat = min<size_t>(segment.repeat, 16);
+        string body = expandAttack(shortened);
+        string suffix;
+        Verdict verdict = failingSuffix(body, candidate.implicitPrefix ? body.size() : 1, suffix);
+        if (verdict != VERDICT_CONFIRMED) return verdict;
+        // 最左匹配的起点必须落在攻击的起点范围之外
+        string full = expandAttack(candidate.attack);
+        size_t first = string::npos;
+        PatternScanner scanner(compiled);
+        string text = full + suffix;
+        scanner.findAll(reinterpret_cast<const uint8_t*>(text.data()), text.size(),
+                        [&](size_t begin, size_t) { first = min(first, begin); });
+        if (first != string::npos && (candidate.implicitPrefix ? first < full.size() : first == 0)) {
+            return VERDICT_UNKNOWN;
+        }
+        if (!suffix.empty()) candidate.attack.push_back(AttackSegment{suffix, 1});
+        return VERDICT_CONFIRMED;
+    }
+
+    // 在锚定 DFA 上同时运行从 body 前 starts 个位置开始的尝试 (状态集合), 读完 body 后
+    // 广度优先搜索最短的后缀, 使所有尝试在读后缀途中和输入结束时都不匹配. 从串首开始的尝试必须活过整个 body,
+    // 回溯引擎才会在每次尝试中走完重复部分. 读 body 时首个尝试死亡或已有尝试匹配, 或不受上限截断地穷举完
+    // 所有状态集合仍找不到后缀时, 排除这个候选
+    Verdict failingSuffix(const string& body, size_t starts, string& suffix) {
+        LazyDfa& dfa = *anchoredDfa;
+        auto step = [&](int state, uint8_t byte) {
+            size_t index = (static_cast<size_t>(state) << dfa.classShift()) | dfa.byteClasses()[byte];
+            int32_t next = dfa.transitions()[index];
+            if (next == LazyDfa::UNKNOWN) next = dfa.computeNext(state, byte);
+            return static_cast<int>(next & ~LazyDfa::SPECIAL);
+        };
+        auto advance = [&](const vector<int>& from, uint8_t byte, vector<int>& to) {
+            to.clear();
+            for (int state : from) {
+                int next = step(state, byte);
+                if (next == LazyDfa::DEAD) continue;
+                if (dfa.isMatchState(next)) return false;
+                to.push_back(next);
+            }
+            sort(to.begin(), to.end());
+            to.erase(unique(to.begin(), to.end()), to.end());
+            return true;
+        };
+        auto acceptsAtEnd = [&](const vector<int>& states) {
+            for (int state : states) {
+                if (dfa.matchesAtEnd(state)) return true;
+            }
+            return false;
+        };
+        vector<int> active, next;
+        int first = dfa.startState(dfa.edgeContext(), true);
+        for (size_t k = 0; k < body.size(); ++k) {
+            first = step(first, static_cast<uint8_t>(body[k]));
+            if (first == LazyDfa::DEAD) return VERDICT_REFUTED;
+            if (k < starts) {
+                int context = k == 0 ? dfa.edgeContext() : dfa.contextOf(static_cast<uint8_t>(body[k - 1]));
+                active.push_back(dfa.startState(context, true));
+            }
+            if (!advance(active, static_cast<uint8_t>(body[k]), next)) return VERDICT_REFUTED;
+            active.swap(next);
+        }
+        suffix.clear();
+        if (!acceptsAtEnd(active)) return VERDICT_CONFIRMED;
+        // 后缀字节按易读程度尝试, 换行放在最后; Python 和 Java 的 $ 可以匹配结尾换行之前, 后缀不以换行结尾
+        string order = "!#@.-_/ ";
+        for (int c = 0x21; c < 0x7f; ++c) {
+            if (order.find(static_cast<char>(c)) == string::npos) order.push_back(static_cast<char>(c));
+        }
+        for (int c = 0; c < 256; ++c) {
+            if (c != '\n' && (c < 0x20 || c >= 0x7f)) order.push_back(static_cast<char>(c));
+        }
+        order.push_back('\n');
+        // 广度优先搜索的节点: 状态集合、父节点和读入的字节
+        vector<vector<int>> nodes(1, active);
+        vector<pair<int, char>> links(1, make_pair(-1, '\0'));
+        vector<int> depth(1, 0);
+        map<vector<int>, int> seen;
+        seen[active] = 0;
+        bool truncated = false;
+        for (size_t head = 0; head < nodes.size(); ++head) {
+            if (depth[head] >= MAX_SUFFIX_LENGTH || nodes.size() >= MAX_SUFFIX_SETS ||
+                dfa.stateCount() > MAX_VERIFY_STATES) {
+                truncated = true;
+                break;
+            }
+            for (char byte : order) {
+                if (!advance(nodes[head], static_cast<uint8_t>(byte), next) || seen.count(next)) continue;
+                int node = static_cast<int>(nodes.size());
+                seen[next] = node;
+                nodes.push_back(next);
+                links.push_back(make_pair(static_cast<int>(head), byte));
+                depth.push_back(depth[head] + 1);
+                if (acceptsAtEnd(next) || (byte == '\n' && !next.empty())) continue;
+                for (int k = node; links[k].first >= 0; k = links[k].first) suffix.push_back(links[k].second);
+                reverse(suffix.begin(), suffix.end());
+                // 所有尝试都已失败; 以换行结尾时再补一个字节
+                if (byte == '\n') suffix.push_back('!');
+                return VERDICT_CONFIRMED;
+            }
+        }
+        return truncated ? VERDICT_UNKNOWN : VERDICT_REFUTED;
+    }
+};
+
+// 分析模式在回溯引擎中的最坏复杂度
+bool analyzeBacktracking(const ParsedPattern& parsed, const GenerationOptions& options, RedosReport& report,
+                         string& error) {
+    if (!parsed.valid()) {
+        error = parsed.error;
+        return false;
+    }
+    if (!matcherSupports(parsed.ast, error)) return false;
+    AmbiguityAnalyzer analyzer(parsed.pattern, parsed.ast, options);
+    return analyzer.analyze(report, error);
+}
+
+// 攻击串的可读形式: "前缀" + "重复部分" × n + "后缀"
+string describeAttack(const vector<AttackSegment>& attack) {
+    string out;
+    for (const AttackSegment& segment : attack) {
+        if (segment.text.empty()) continue;
+        if (!out.empty()) out += " + ";
+        out += "\"";
+        for (unsigned char c : segment.text) {
+            if (c == '"' || c == '\\') {
+                out.push_back('\\');
+                out.push_back(static_cast<char>(c));
+            } else if (c == '\n') {
+                out += "\\n";
+            } else if (c < 0x20 || c >= 0x7f) {
+                char escaped[8];
+                snprintf(escaped, sizeof(escaped), "\\x%02x", c);
+                out += escaped;
+            } else {
+                out.push_back(static_cast<char>(c));
+            }
+        }
+        out += "\"";
+        if (segment.repeat != 1) out += " × " + to_string(segment.repeat);
+    }
+    return out.empty() ? "\"\"" : out;
+}
+
+string describeRisk(const RedosReport& report) {
+    switch (report.risk) {
+        case RISK_EXPONENTIAL:
+            return msg(MSG_RISK_EXPONENTIAL);
+        case RISK_POLYNOMIAL:
+            return formatMessage(MSG_RISK_POLYNOMIAL, report.degree);
+        default:
+            return msg(MSG_RISK_LINEAR);
+    }
+}
+
+// 风险成因, 引用模式中的量词
+string describeCause(const string& pattern, const RedosReport& report) {
+    vector<string> loops;
+    for (const auto& span : report.loops) {
+        if (span.second > span.first) loops.push_back("`" + pattern.substr(span.first, span.second - span.first) + "`");
+    }
+    string list;
+    for (size_t k = 0; k < loops.size(); ++k) list += (k == 0 ? "" : msg(MSG_LIST_SEPARATOR)) + loops[k];
+    if (report.risk == RISK_EXPONENTIAL) return formatMessage(MSG_CAUSE_EXPONENTIAL, list);
+    if (report.implicitPrefix && loops.size() == 1) return formatMessage(MSG_CAUSE_UNANCHORED_LOOP, list);
+    if (report.implicitPrefix) return formatMessage(MSG_CAUSE_UNANCHORED_ADJACENT, list);
+    return formatMessage(MSG_CAUSE_ADJACENT, list);
+}
+
+// 使用回溯引擎的目标语言
+bool usesBacktrackingEngine(const string& language) {
+    return language == "python" || language == "java" || language == "javascript" || language == "cpp";
+}
+
+// 代码片段开头的警告注释; 无风险时为空
+string backtrackingWarning(const ParsedPattern& parsed, const string& language, const GenerationOptions& options) {
+    if (!usesBacktrackingEngine(language)) return "";
+    const string& pattern = parsed.pattern;
+    RedosReport report;
+    string error;
+    if (!analyzeBacktracking(parsed, options, report, error) || report.risk == RISK_LINEAR) return "";
+    string comment = language == "python" ? "# " : "// ";
+    stringstream warning;
+    printMessage(warning << comment, MSG_WARNING_RISK, describeRisk(report));
+    warning << comment << msg(MSG_CAUSE) << describeCause(pattern, report) << "\n";
+    if (report.verified) {
+        warning << comment << msg(MSG_ATTACK_INPUT) << describeAttack(report.attack) << "\n";
+    } else {
+        warning << comment << msg(MSG_ATTACK_UNVERIFIED) << "\n";
+    }
+    warning << comment << msg(MSG_WARNING_ADVICE);
+    return warning.str();
+}
+
+// ============================================================
+// 独立 DFA 代码生成: 把惰性 DFA 完全展开、最小化, 输出不依赖任何库的 C/C++ 匹配器
+// ============================================================
+
+// Hopcroft 划分细化: 初始按标志划分; 先把转移完全相同的字节归为一类, 再按类维护逆转移.
+// 每次取出一个划分块作为分裂者, 按每个字节类把它的前驱所在的块一分为二; 被分裂的块不在工作表中时
+// 只需加入较小的一半, 总时间 O(类数 × n log n). 死状态保持编号 0
+void minimizeDenseDfa(DenseDfa& dfa) {
+    int n = dfa.stateCount();
+    if (n == 0) return;
+    map<vector<int>, int> classOf;
+    vector<int> byteClass(256);
+    vector<int> column(n);
+    for (int byte = 0; byte < 256; ++byte) {
+        for (int s = 0; s < n; ++s) column[s] = dfa.next[s * 256 + byte];
+        byteClass[byte] = classOf.emplace(column, static_cast<int>(classOf.size())).first->second;
+    }
+    int classCount = static_cast<int>(classOf.size());
+    vector<int> classByte(classCount);
+    for (int byte = 255; byte >= 0; --byte) classByte[byteClass[byte]] = byte;
+
+    // 逆转移按 (类, 目标) 存成 CSR: 类 c 中目标为 t 的源状态是 sources[offset[c*n+t], offset[c*n+t+1])
+    vector<int> offset(static_cast<size_t>(classCount) * n + 1, 0);
+    for (int c = 0; c < classCount; ++c) {
+        for (int s = 0; s < n; ++s) ++offset[static_cast<size_t>(c) * n + dfa.next[s * 256 + classByte[c]] + 1];
+    }
+    for (size_t k = 1; k < offset.size(); ++k) offset[k] += offset[k - 1];
+    vector<int> sources(offset.back());
+    {
+        vector<int> fill(offset.begin(), offset.end() - 1);
+        for (int c = 0; c < classCount; ++c) {
+            for (int s = 0; s < n; ++s) sources[fill[static_cast<size_t>(c) * n + dfa.next[s * 256 + classByte[c]]]++] = s;
+        }
+    }
+
+    // 划分: 同一块的状态在 elements 中连续, [first, past) 为块的范围, 被标记的状态移到块的前部
+    vector<int> elements(n), location(n), block(n);
+    vector<int> first, past, marked;
+    vector<char> pending;
+    {
+        map<int, vector<int>> byFlags;
+        for (int s = 0; s < n; ++s) byFlags[dfa.flags[s]].push_back(s);
+        int position = 0;
+        for (const auto& group : byFlags) {
+            first.push_back(position);
+            for (int s : group.second) {
+                elements[position] = s;
+                location[s] = position++;
+                block[s] = static_cast<int>(first.size()) - 1;
+            }
+            past.push_back(position);
+        }
+    }
+    int blockCount = static_cast<int>(first.size());
+    marked.assign(blockCount, 0);
+    pending.assign(blockCount, 1);
+    vector<int> worklist;
+    for (int b = 0; b < blockCount; ++b) worklist.push_back(b);
+    vector<int> splitter, touched;
+    while (!worklist.empty()) {
+        int current = worklist.back();
+        worklist.pop_back();
+        pending[current] = 0;
+        splitter.assign(elements.begin() + first[current], elements.begin() + past[current]);
+        for (int c = 0; c < classCount; ++c) {
+            for (int target : splitter) {
+                size_t key = static_cast<size_t>(c) * n + target;
+                for (int k = offset[key]; k < offset[key + 1]; ++k) {
+                    int s = sources[k];
+                    int b = block[s];
+                    int slot = first[b] + marked[b];
+                    if (location[s] < slot) continue;  // 已标记
+                    if (marked[b] == 0) touched.push_back(b);
+                    int other = elements[slot];
+                    swap(elements[slot], elements[location[s]]);
+                    location[other] = location[s];
+                    location[s] = slot;
+                    ++marked[b];
+                }
+            }
+            for (int b : touched) {
+                int count = marked[b];
+                marked[b] = 0;
+                if (count == past[b] - first[b]) continue;
+                // 标记的部分成为新块
+                int created = blockCount++;
+                first.push_back(first[b]);
+                past.push_back(first[b] + count);
+                marked.push_back(0);
+                first[b] += count;
+                for (int k = first[created]; k < past[created]; ++k) block[elements[k]] = created;
+                int smaller = past[created] - first[created] <= past[b] - first[b] ? created : b;
+                pending.push_back(0);
+                int added = pending[b] ? created : smaller;
+                pending[added] = 1;
+                worklist.push_back(added);
+            }
+            touched.clear();
+        }
+    }
+
+    // 死状态所在的块编号为 0, 其余按首次出现的顺序编号
+    vector<int> renumber(blockCount, -1);
+    renumber[block[0]] = 0;
+    int count = 1;
+    for (int s = 0; s < n; ++s) {
+        if (renumber[block[s]] < 0) renumber[block[s]] = count++;
+    }
+    DenseDfa minimized;
+    minimized.next.assign(static_cast<size_t>(count) * 256, 0);
+    minimized.flags.assign(count, 0);
+    for (int s = 0; s < n; ++s) {
+        int b = renumber[block[s]];
+        minimized.flags[b] = dfa.flags[s];
+        for (int byte = 0; byte < 256; ++byte) {
+            minimized.next[b * 256 + byte] = renumber[block[dfa.next[s * 256 + byte]]];
+        }
+    }
+    for (int c = 0; c < 4; ++c) minimized.start[c] = renumber[block[dfa.start[c]]];
+    dfa = minimized;
+}
+
+// 生成的匹配器使用的三个 DFA
+struct DfaMatcherTables {
+    DenseDfa forward;   // 非锚定、最左优先: 找到匹配结尾
+    DenseDfa reverse;   // 从结尾反向、锚定、最长: 找到匹配起点
+    DenseDfa full;      // 锚定、从文本开头: 整体匹配
+    vector<int> byteClass;
+    int classCount = 0;
+};
+
+bool buildDfaMatcherTables(const ParsedPattern& parsed, DfaMatcherTables& tables, string& error) {
+    CompiledPattern compiled;
+    if (!parsed.valid()) {
+        error = parsed.error;
+        return false;
+    }
+    if (!compilePattern(parsed.ast, compiled, error)) return false;
+    const int maxStates = DENSE_DFA_MAX_STATES;
+    if (!buildDenseDfa(compiled.forward, true, false, true, maxStates, tables.forward) ||
+        !buildDenseDfa(compiled.reverse, false, true, true, maxStates, tables.reverse) ||
+        !buildDenseDfa(compiled.forward, false, true, false, maxStates, tables.full)) {
+        error = "DFA exceeds " + to_string(maxStates) + " states";
+        return false;
+    }
+    minimizeDenseDfa(tables.forward);
+    minimizeDenseDfa(tables.reverse);
+    minimizeDenseDfa(tables.full);
+    // 在三个 DFA 中转移完全相同的字节归为同一类
+    map<vector<int>, int> classes;
+    tables.byteClass.assign(256, 0);
+    for (int byte = 0; byte < 256; ++byte) {
+        vector<int> column;
+        for (const DenseDfa* dfa : {&tables.forward, &tables.reverse, &tables.full}) {
+            for (int s = 0; s < dfa->stateCount(); ++s) column.push_back(dfa->next[s * 256 + byte]);
+        }
+        auto found = classes.emplace(column, static_cast<int>(classes.size()));
+        tables.byteClass[byte] = found.first->second;
+    }
+    tables.classCount = static_cast<int>(classes.size());
+    if (max(max(tables.forward.stateCount(), tables.reverse.stateCount()), tables.full.stateCount()) > 65535) {
+        error = "DFA exceeds 65535 states";
+        return false;
+    }
+    return true;
+}
+
+// ============================================================
+// 语言比较 (--equiv、--subset): 在两个最小化的整体匹配 DFA 的乘积上广度优先搜索最短的区分串
+// ============================================================
+
+// 乘积自动机的状态数上限
+const size_t PRODUCT_MAX_STATES = 4000000;
+
+// 锚定、最长匹配的整体匹配 DFA: 输入在标有 DFA_FLAG_EOF 的状态结束时, 模式匹配整个输入.
+// 比较的语言就是模式能完整匹配的字符串集合
+bool buildWholeMatchDfa(const ParsedPattern& parsed, DenseDfa& dfa, string& error) {
+    CompiledPattern compiled;
+    error = parsed.error;
+    if (!parsed.valid() || !compilePattern(parsed.ast, compiled, error)) return false;
+    if (!buildDenseDfa(compiled.forward, false, true, false, DENSE_DFA_MAX_STATES, dfa)) {
+        error = "DFA exceeds " + to_string(DENSE_DFA_MAX_STATES) + " states";
+        return false;
+    }
+    minimizeDenseDfa(dfa);
+    return true;
+}
+
+// 字节的易读程度, 越小越好: 字母数字, 其他可打印字符, 其余字节
+int readabilityRank(int byte) {
+    const char* preferred = "abcdefghijklmnopqrstuvwxyz0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    const char* found = byte != 0 ? strchr(preferred, byte) : nullptr;
+    if (found != nullptr) return static_cast<int>(found - preferred);
+    if (byte >= 0x20 && byte < 0x7f) return 100 + byte;
+    return 300 + byte;
+}
+
+// subset 为 false 时判断两个模式是否等价, 否则判断第一个是否包含于第二个
+bool compareLanguages(const ParsedPattern& first, const ParsedPattern& second, bool subset,
+                      LanguageComparison& result, string& error) {
+    DenseDfa a, b;
+    if (!buildWholeMatchDfa(first, a, error) || !buildWholeMatchDfa(second, b, error)) return false;
+    // 在两个 DFA 中转移都相同的字节等价, 每类只需尝试一个字节; 取最易读的, 并按易读程度排列,
+    // 这样广度优先搜索得到的最短区分串也尽量可读
+    map<vector<int>, int> classOf;
+    vector<int> representatives;
+    vector<int> column;
+    for (int byte = 0; byte < 256; ++byte) {
+        column.clear();
+        for (int s = 0; s < a.stateCount(); ++s) column.push_back(a.next[s * 256 + byte]);
+        for (int s = 0; s < b.stateCount(); ++s) column.push_back(b.next[s * 256 + byte]);
+        auto found = classOf.emplace(column, static_cast<int>(representatives.size()));
+        if (found.second) {
+            representatives.push_back(byte);
+        } else if (readabilityRank(byte) < readabilityRank(representatives[found.first->second])) {
+            representatives[found.first->second] = byte;
+        }
+    }
+    sort(representatives.begin(), representatives.end(),
+         [](int x, int y) { return readabilityRank(x) < readabilityRank(y); });
+
+    // 乘积状态 (sa, sb) 编号为 sa * |B| + sb; parent 和 via 用于还原路径
+    uint64_t width = static_cast<uint64_t>(b.stateCount());
+    unordered_map<uint64_t, int> visited;
+    vector<pair<int, int>> states;
+    vector<int> parent;
+    vector<uint8_t> via;
+    auto visit = [&](int sa, int sb, int from, int byte) {
+        if (visited.emplace(sa * width + sb, static_cast<int>(states.size())).second) {
+            states.push_back(make_pair(sa, sb));
+            parent.push_back(from);
+            via.push_back(static_cast<uint8_t>(byte));
+        }
+    };
+    visit(a.start[CTX_EDGE], b.start[CTX_EDGE], -1, 0);
+    for (size_t current = 0; current < states.size(); ++current) {
+        int sa = states[current].first;
+        int sb = states[current].second;
+        bool inA = (a.flags[sa] & DFA_FLAG_EOF) != 0;
+        bool inB = (b.flags[sb] & DFA_FLAG_EOF) != 0;
+        if (subset ? (inA && !inB) : inA != inB) {
+            result.holds = false;
+            result.witnessInFirst = inA;
+            result.witness.clear();
+            for (int k = static_cast<int>(current); parent[k] >= 0; k = parent[k]) {
+                result.witness.push_back(static_cast<char>(via[k]));
+            }
+            reverse(result.witness.begin(), result.witness.end());
+            return true;
+        }
+        // 第一个 DFA 已死时不会再有只被它匹配的串, 两边都死时不会再有任何区分串
+        if (sa == 0 && (subset || sb == 0)) continue;
+        if (states.size() > PRODUCT_MAX_STATES) {
+            error = "product automaton exceeds " + to_string(PRODUCT_MAX_STATES) + " states";
+            return false;
+        }
+        for (int byte : representatives) {
+            visit(a.next[sa * 256 + byte], b.next[sb * 256 + byte], static_cast<int>(current), byte);
+        }
+    }
+    result.holds = true;
+    return true;
+}
+
+// 输出以逗号分隔的数组内容, 每行若干项
+void emitNumbers(stringstream& code, const vector<int>& values, const string& indent) {
+    for (size_t k = 0; k < values.size(); ++k) {
+        if (k % 16 == 0) code << indent;
+        code << values[k] << (k + 1 < values.size() ? "," : "");
+        code << ((k % 16 == 15 || k + 1 == values.size()) ? "\n" : " ");
+    }
+}
+
+// cStyle 为 true 时生成 C 代码, 否则生成 C++ 头文件风格的代码
+string generateDfaCode(const ParsedPattern& parsed, bool cStyle) {
+    const string& pattern = parsed.pattern;
+    DfaMatcherTables tables;
+    string error;
+    stringstream code;
+    string comment = cStyle ? "/* " : "// ";
+    string commentEnd = cStyle ? " */" : "";
+    if (!buildDfaMatcherTables(parsed, tables, error)) {
+        printMessage(code << comment, MSG_DFA_UNAVAILABLE, error);
+        code << commentEnd << "\n";
+        return code.str();
+    }
+
+    string patternComment;
+    for (char c : pattern) {
+        patternComment += c;
+        if (cStyle && c == '*' && patternComment.size() > 1 && patternComment[patternComment.size() - 2] == '/') {
+            patternComment.insert(patternComment.size() - 1, " ");
+        }
+    }
+    if (cStyle && !patternComment.empty() && patternComment.back() == '*') patternComment += ' ';
+    bool needContext = false;
+    for (const DenseDfa* dfa : {&tables.forward, &tables.reverse}) {
+        for (int c = 1; c < 4; ++c) needContext = needContext || dfa->start[c] != dfa->start[CTX_EDGE];
+    }
+
+    string prefix = cStyle ? "regen_" : "";
+    string storage = "static const ";
+    string sizeType = cStyle ? "size_t" : "std::size_t";
+    auto stateType = [&](const DenseDfa& dfa) -> string {
+        if (dfa.stateCount() <= 256) return cStyle ? "unsigned char" : "std::uint8_t";
+        return cStyle ? "unsigned short" : "std::uint16_t";
+    };
+    auto emitDfa = [&](const DenseDfa& dfa, const string& name, const string& description) {
+        code << comment << description << ": " << dfa.stateCount() << " states" << commentEnd << "\n";
+        code << storage << stateType(dfa) << " " << prefix << name << "[" << dfa.stateCount() << "]["
+             << tables.classCount << "] = {\n";
+        for (int s = 0; s < dfa.stateCount(); ++s) {
+            vector<int> row(tables.classCount, 0);
+            for (int byte = 0; byte < 256; ++byte) row[tables.byteClass[byte]] = dfa.next[s * 256 + byte];
+            code << "    {";
+            for (int k = 0; k < tables.classCount; ++k) code << (k ? ", " : "") << row[k];
+            code << "}" << (s + 1 < dfa.stateCount() ? "," : "") << "\n";
+        }
+        code << "};\n";
+        code << storage << "unsigned char " << prefix << name << "_flags[" << dfa.stateCount() << "] = {\n";
+        vector<int> flags(dfa.flags.begin(), dfa.flags.end());
+        emitNumbers(code, flags, "    ");
+        code << "};\n";
+        code << storage << stateType(dfa) << " " << prefix << name << "_start[4] = {" << dfa.start[0] << ", "
+             << dfa.start[1] << ", " << dfa.start[2] << ", " << dfa.start[3] << "};\n\n";
+    };
+
+    code << comment << "Generated by regen: minimized DFA matcher for " << patternComment << commentEnd << "\n";
+    code << comment << "match(): whole input; search()/find_all(): leftmost-first, non-overlapping" << commentEnd
+         << "\n";
+    if (cStyle) {
+        code << "#include <stddef.h>\n\n";
+    } else {
+        code << "#include <cstddef>\n#include <cstdint>\n\nnamespace regen_dfa {\nnamespace detail {\n\n";
+    }
+    code << comment << "Byte classes: " << tables.classCount << commentEnd << "\n";
+    code << storage << "unsigned char " << prefix << "byte_class[256] = {\n";
+    emitNumbers(code, tables.byteClass, "    ");
+    code << "};\n";
+    if (needContext) {
+        // 上下文: 0 文本边界, 1 换行, 2 单词字符, 3 其他
+        vector<int> context(256, CTX_OTHER);
+        context['\n'] = CTX_NEWLINE;
+        for (int byte = 0; byte < 256; ++byte) {
+            if (isWordByte(byte)) context[byte] = CTX_WORD;
+        }
+        code << comment << "Context of the neighbouring byte: 1 newline, 2 word, 3 other (0 is the text edge)"
+             << commentEnd << "\n";
+        code << storage << "unsigned char " << prefix << "context[256] = {\n";
+        emitNumbers(code, context, "    ");
+        code << "};\n";
+    }
+    code << "\n";
+    emitDfa(tables.forward, "forward", "Forward search, leftmost-first");
+    emitDfa(tables.reverse, "reverse", "Reverse scan from the match end, longest");
+    emitDfa(tables.full, "full", "Anchored whole-input match");
+
+    string contextBefore = needContext ? prefix + "context[p[pos - 1]]" : "3";
+    string contextAfter = needContext ? prefix + "context[p[end]]" : "3";
+    string inlineKeyword = cStyle ? "static " : "inline ";
+    string byteType = "const unsigned char*";
+
+    // 最左匹配的结尾, 没有匹配时返回 -1
+    code << inlineKeyword << "long long " << prefix << "search_end(" << byteType << " p, " << sizeType << " len, "
+         << sizeType << " pos) {\n";
+    code << "    unsigned s = " << prefix << "forward_start[pos == 0 ? 0 : " << contextBefore << "];\n";
+    code << "    long long last = -1;\n";
+    code << "    for (" << sizeType << " i = pos; i < len; ++i) {\n";
+    code << "        s = " << prefix << "forward[s][" << prefix << "byte_class[p[i]]];\n";
+    code << "        if (s == 0) return last;\n";
+    code << "        if (" << prefix << "forward_flags[s] & 1) last = (long long)i;\n";
+    code << "    }\n";
+    code << "    if (" << prefix << "forward_flags[s] & 2) last = (long long)len;\n";
+    code << "    return last;\n";
+    code << "}\n\n";
+    // 匹配起点: 从 end 向前的最长反向匹配, 不早于 lower
+    code << inlineKeyword << sizeType << " " << prefix << "search_start(" << byteType << " p, " << sizeType << " len, "
+         << sizeType << " end, " << sizeType << " lower) {\n";
+    code << "    unsigned s = " << prefix << "reverse_start[end == len ? 0 : " << contextAfter << "];\n";
+    code << "    " << sizeType << " best = end;\n";
+    code << "    for (" << sizeType << " i = end; i > lower; --i) {\n";
+    code << "        s = " << prefix << "reverse[s][" << prefix << "byte_class[p[i - 1]]];\n";
+    code << "        if (s == 0) return best;\n";
+    code << "        if (" << prefix << "reverse_flags[s] & 1) best = i;\n";
+    code << "    }\n";
+    code << "    if (lower == 0) {\n";
+    code << "        if (" << prefix << "reverse_flags[s] & 2) best = 0;\n";
+    code << "    } else {\n";
+    code << "        s = " << prefix << "reverse[s][" << prefix << "byte_class[p[lower - 1]]];\n";
+    code << "        if (s != 0 && (" << prefix << "reverse_flags[s] & 1)) best = lower;\n";
+    code << "    }\n";
+    code << "    return best;\n";
+    code << "}\n\n";
+
+    if (cStyle) {
+        code << "/* 1 if the whole input matches */\n";
+        code << "int regen_match(const char* data, size_t len) {\n";
+        code << "    const unsigned char* p = (const unsigned char*)data;\n";
+        code << "    unsigned s = regen_full_start[0];\n";
+        code << "    for (size_t i = 0; i < len; ++i) {\n";
+        code << "        s = regen_full[s][regen_byte_class[p[i]]];\n";
+        code << "        if (s == 0) return 0;\n";
+        code << "    }\n";
+        code << "    return (regen_full_flags[s] & 2) != 0;\n";
+        code << "}\n\n";
+        code << "/* First match at or after `from`; 1 and [*start, *end) if found */\n";
+        code << "int regen_search(const char* data, size_t len, size_t from, size_t* start, size_t* end) {\n";
+        code << "    const unsigned char* p = (const unsigned char*)data;\n";
+        code << "    long long e = regen_search_end(p, len, from);\n";
+        code << "    if (e < 0) return 0;\n";
+        code << "    *end = (size_t)e;\n";
+        code << "    *start = regen_search_start(p, len, *end, from);\n";
+        code << "    return 1;\n";
+        code << "}\n\n";
+        code << "/* Calls callback(start, end, user) for every match; returns the number of matches */\n";
+        code << "size_t regen_find_all(const char* data, size_t len,\n";
+        code << "                      void (*callback)(size_t start, size_t end, void* user), void* user) {\n";
+        code << "    size_t pos = 0, count = 0, start, end;\n";
+        code << "    while (pos <= len && regen_search(data, len, pos, &start, &end)) {\n";
+        code << "        if (callback) callback(start, end, user);\n";
+        code << "        ++count;\n";
+        code << "        pos = end == start ? start + 1 : end;\n";
+        code << "    }\n";
+        code << "    return count;\n";
+        code << "}\n";
+    } else {
+        code << "}  // namespace detail\n\n";
+        code << "// True if the whole input matches\n";
+        code << "inline bool match(const char* data, std::size_t len) {\n";
+        code << "    const unsigned char* p = reinterpret_cast<const unsigned char*>(data);\n";
+        code << "    unsigned s = detail::full_start[0];\n";
+        code << "    for (std::size_t i = 0; i < len; ++i) {\n";
+        code << "        s = detail::full[s][detail::byte_class[p[i]]];\n";
+        code << "        if (s == 0) return false;\n";
+        code << "    }\n";
+        code << "    return (detail::full_flags[s] & 2) != 0;\n";
+        code << "}\n\n";
+        code << "// First match at or after `from`, as [start, end)\n";
+        code << "inline bool search(const char* data, std::size_t len, std::size_t from, std::size_t& start,\n";
+        code << "                   std::size_t& end) {\n";
+        code << "    const unsigned char* p = reinterpret_cast<const unsigned char*>(data);\n";
+        code << "    long long e = detail::search_end(p, len, from);\n";
+        code << "    if (e < 0) return false;\n";
+        code << "    end = static_cast<std::size_t>(e);\n";
+        code << "    start = detail::search_start(p, len, end, from);\n";
+        code << "    return true;\n";
+        code << "}\n\n";
+        code << "// Calls callback(start, end) for every match; returns the number of matches\n";
+        code << "template <typename Callback>\n";
+        code << "std::size_t find_all(const char* data, std::size_t len, Callback callback) {\n";
+        code << "    std::size_t pos = 0, count = 0, start, end;\n";
+        code << "    while (pos <= len && search(data, len, pos, start, end)) {\n";
+        code << "        callback(start, end);\n";
+        code << "        ++count;\n";
+        code << "        pos = end == start ? start + 1 : end;\n";
+        code << "    }\n";
+        code << "    return count;\n";
+        code << "}\n\n";
+        code << "}  // namespace regen_dfa\n";
+    }
+    return code.str();
+}
+
+// 与 PatternScanner 的选择一致: 正向和反向程序都满足条件时使用位并行自动机
+BitParallelStatus chooseBitParallel(const CompiledPattern& compiled, int& positions) {
+    BitParallelAutomaton forward, reverse;
+    BitParallelStatus status = forward.build(compiled.forward);
+    if (status == BIT_PARALLEL_OK) status = reverse.build(compiled.reverse);
+    positions = forward.positionCount();
+    return status;
+}
+
+MessageId bitParallelReason(BitParallelStatus status) {
+    return status == BIT_PARALLEL_TOO_MANY_POSITIONS ? MSG_ENGINE_TOO_MANY_POSITIONS
+           : status == BIT_PARALLEL_ASSERTIONS      ? MSG_ENGINE_ASSERTIONS
+                                                    : MSG_ENGINE_NULLABLE;
+}
+
+// 描述内置匹配器将如何执行该模式 (用于 -e 输出)
+string generateMatcherReport(const ParsedPattern& parsed) {
+    stringstream report;
+    CompiledPattern compiled;
+    string error = parsed.error;
+    if (!parsed.valid() || !compilePattern(parsed.ast, compiled, error)) {
+        printMessage(report, MSG_MATCHER_UNSUPPORTED, error);
+        return report.str();
+    }
+    printMessage(report, MSG_PREFILTER, compiled.prefilter.describe());
+    int positions = 0;
+    BitParallelStatus status = chooseBitParallel(compiled, positions);
+    if (status == BIT_PARALLEL_OK) {
+        printMessage(report, MSG_ENGINE_BIT_PARALLEL, positions);
+    } else {
+        printMessage(report, MSG_ENGINE_LAZY_DFA, msg(bitParallelReason(status)));
+    }
+    return report.str();
+}
+
+// ============================================================
+// 复杂度和资源报告 (--stats): 语法树、NFA、最小化 DFA 的规模, 以及所选引擎和回溯代价
+// ============================================================
+
+bool computePatternStats(const ParsedPattern& parsed, const GenerationOptions& options, PatternStats& stats,
+                         string& error) {
+    CompiledPattern compiled;
+    error = parsed.error;
+    if (!parsed.valid() || !compilePattern(parsed.ast, compiled, error)) return false;
+    stats.astNodes = parsed.ast.nodes.size();
+    stats.forwardStates = compiled.forward.states.size();
+    stats.reverseStates = compiled.reverse.states.size();
+    stats.prefilter = compiled.prefilter;
+    stats.engine = chooseBitParallel(compiled, stats.positions);
+    stats.redosAnalyzed = analyzeBacktracking(parsed, options, stats.redos, stats.redosError);
+
+    DfaMatcherTables tables;
+    stats.dfaWithinBudget = buildDfaMatcherTables(parsed, tables, stats.dfaError);
+    if (!stats.dfaWithinBudget) return true;
+    stats.byteClasses = tables.classCount;
+    stats.tableBytes = 256;
+    int k = 0;
+    for (const DenseDfa* dfa : {&tables.forward, &tables.reverse, &tables.full}) {
+        // 与生成代码的元素类型一致: 不超过 256 个状态时每项 1 字节, 否则 2 字节
+        size_t width = dfa->stateCount() <= 256 ? 1 : 2;
+        stats.dfaStates[k++] = dfa->stateCount();
+        stats.tableBytes += static_cast<size_t>(dfa->stateCount()) * tables.classCount * width;
+        stats.uncompressedBytes += static_cast<size_t>(dfa->stateCount()) * 256 * width;
+    }
+    return true;
+}
+
+// 回溯引擎处理每个输入字节的最坏步数 (不计常数因子), n 为输入长度
+string backtrackingStepsFormula(const RedosReport& report) {
+    if (report.risk == RISK_EXPONENTIAL) return "O(2^n/n)";
+    if (report.risk == RISK_POLYNOMIAL && report.degree > 2) return "O(n^" + to_string(report.degree - 1) + ")";
+    if (report.risk == RISK_POLYNOMIAL) return "O(n)";
+    return "O(1)";
+}
+
+double backtrackingStepsPerByte(const RedosReport& report, double length) {
+    if (report.risk == RISK_EXPONENTIAL) return pow(2.0, length) / length;
+    if (report.risk == RISK_POLYNOMIAL) return pow(length, report.degree - 1);
+    return 1;
+}
+
+// ============================================================
+// 库接口 (regen.h、regen_c.h): 结果以返回值给出, 不读写控制台
+// ============================================================
+
+}  // namespace detail
+
+namespace {
+
+detail::GenerationOptions generationOptions(const Options& options) {
+    detail::GenerationOptions result;
+    result.matchWholeLine = options.matchWholeLine;
+    result.caseInsensitive = options.caseInsensitive;
+    result.multiline = options.multiline;
+    result.dotAll = options.dotAll;
+    result.optimize = options.optimize;
+    result.utf8 = options.utf8;
+    return result;
+}
+
+// 被移动后的 Pattern 没有 state, 访问器返回这些值
+const string EMPTY_STRING;
+const string MOVED_FROM_ERROR = "pattern has been moved from";
+
+}  // namespace
+
+void setLanguage(Language language) {
+    detail::currentLanguage = language == LANGUAGE_CHINESE ? detail::LANG_ZH : detail::LANG_EN;
+}
+
+vector<string> presetNames() {
+    vector<string> names;
+    for (const auto& preset : detail::PRESET_PATTERNS) names.push_back(preset.first);
+    return names;
+}
+
+bool presetPattern(const string& name, string& pattern) {
+    auto preset = detail::PRESET_PATTERNS.find(name);
+    if (preset == detail::PRESET_PATTERNS.end()) return false;
+    pattern = preset->second.first;
+    return true;
+}
+
+string compose(const vector<string>& parts) {
+    string result;
+    for (const string& part : parts) {
+        detail::RegexAst ast;
+        string error;
+        bool alternation = parts.size() > 1 && detail::parseRegex(part, detail::GenerationOptions(), ast, error) &&
+                           ast.node(ast.root).type == detail::NODE_ALTERNATE;
+        result += alternation ? "(?:" + part + ")" : part;
+    }
+    return result;
+}
+
+struct Pattern::State {
+    detail::GenerationOptions options;
+    string original;
+    detail::ParsedPattern parsed;
+    bool compiled = false;
+    string compileError;
+    detail::CompiledPattern program;
+    unique_ptr<detail::PatternScanner> scanner;
+};
+
+Pattern::Pattern(const string& pattern, const Options& options) : state(new State) {
+    state->options = generationOptions(options);
+    state->original = options.matchWholeLine ? "^" + pattern + "$" : pattern;
+    detail::parsePattern(state->original, state->options, state->parsed);
+    if (options.optimize) {
+        detail::ParsedPattern optimized;
+        detail::optimizePattern(state->parsed, state->options, optimized);
+        swap(state->parsed, optimized);
+    }
+}
+
+Pattern::~Pattern() {}
+Pattern::Pattern(Pattern&& other) : state(move(other.state)) {}
+
+Pattern& Pattern::operator=(Pattern&& other) {
+    state = move(other.state);
+    return *this;
+}
+
+bool Pattern::valid() const { return state && state->parsed.valid(); }
+const string& Pattern::error() const { return state ? state->parsed.error : MOVED_FROM_ERROR; }
+const string& Pattern::original() const { return state ? state->original : EMPTY_STRING; }
+const string& Pattern::pattern() const { return state ? state->parsed.pattern : EMPTY_STRING; }
+
+string Pattern::explain() const {
+    if (!state) return string();
+    return detail::generateExplanation(state->parsed) + detail::generateMatcherReport(state->parsed);
+}
+
+string Pattern::code(const string& language) const {
+    if (!state) return string();
+    return detail::generateCodeSnippet(state->parsed, state->parsed.pattern, language, state->options);
+}
+
+bool Pattern::findAll(const char* data, size_t size, vector<Match>& matches, string& error) {
+    matches.clear();
+    if (!valid()) {
+        error = this->error();
+        return false;
+    }
+    if (!state->compiled) {
+        state->compiled = true;
+        if (detail::compilePattern(state->parsed.ast, state->program, state->compileError)) {
+            state->scanner.reset(new detail::PatternScanner(state->program));
+        }
+    }
+    if (!state->scanner) {
+        error = state->compileError;
+        return false;
+    }
+    state->scanner->findAll(reinterpret_cast<const uint8_t*>(data), size, [&](size_t start, size_t end) {
+        matches.push_back(Match{start, end - start});
+    });
+    return true;
+}
+
+bool Pattern::findAll(const string& text, vector<Match>& matches, string& error) {
+    return findAll(text.data(), text.size(), matches, error);
+}
+
+}  // namespace regen
+
+// C 接口: 异常不越过 FFI 边界, 分配失败时返回 NULL 或 -1
+struct regen_pattern {
+    regen::Pattern pattern;
+    string lastError;
+
+    regen_pattern(const char* source, const regen::Options& options) : pattern(source, options) {
+        lastError = pattern.error();
+    }
+};
+
+namespace {
+
+char* duplicateString(const string& text) {
+    char* copy = static_cast<char*>(malloc(text.size() + 1));
+    if (copy != nullptr) memcpy(copy, text.c_str(), text.size() + 1);
+    return copy;
+}
+
+}  // namespace
+
+extern "C" {
+
+void regen_set_language(int chinese) {
+    regen::setLanguage(chinese ? regen::LANGUAGE_CHINESE : regen::LANGUAGE_ENGLISH);
+}
+
+size_t regen_preset_count(void) {
+    return regen::detail::PRESET_PATTERNS.size();
+}
+
+const char* regen_preset_name(size_t index) {
+    if (index >= regen::detail::PRESET_PATTERNS.size()) return nullptr;
+    auto preset = regen::detail::PRESET_PATTERNS.begin();
+    advance(preset, index);
+    return preset->first.c_str();
+}
+
+const char* regen_preset(const char* name) {
+    auto preset = regen::detail::PRESET_PATTERNS.find(name);
+    return preset == regen::detail::PRESET_PATTERNS.end() ? nullptr : preset->second.first.c_str();
+}
+
+char* regen_compose(const char* const* parts, size_t count) {
+    try {
+        return duplicateString(regen::compose(vector<string>(parts, parts + count)));
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+regen_pattern* regen_pattern_new(const char* pattern, unsigned flags) {
+    regen::Options options;
+    options.matchWholeLine = (flags & REGEN_MATCH_WHOLE) != 0;
+    options.caseInsensitive = (flags & REGEN_CASE_INSENSITIVE) != 0;
+    options.multiline = (flags & REGEN_MULTILINE) != 0;
+    options.dotAll = (flags & REGEN_DOTALL) != 0;
+    options.optimize = (flags & REGEN_OPTIMIZE) != 0;
+    options.utf8 = (flags & REGEN_UTF8) != 0;
+    try {
+        return new regen_pattern(pattern, options);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void regen_pattern_free(regen_pattern* pattern) {
+    delete pattern;
+}
+
+const char* regen_pattern_error(const regen_pattern* pattern) {
+    return pattern->lastError.empty() ? nullptr : pattern->lastError.c_str();
+}
+
+const char* regen_pattern_source(const regen_pattern* pattern) {
+    return pattern->pattern.pattern().c_str();
+}
+
+char* regen_explain(const regen_pattern* pattern) {
+    try {
+        return duplicateString(pattern->pattern.explain());
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+char* regen_code(const regen_pattern* pattern, const char* language) {
+    try {
+        string code = pattern->pattern.code(language);
+        return code.empty() ? nullptr : duplicateString(code);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+int regen_find_all(regen_pattern* pattern, const char* data, size_t size, regen_match** matches, size_t* count) {
+    *matches = nullptr;
+    *count = 0;
+    try {
+        vector<regen::Match> found;
+        if (!pattern->pattern.findAll(data, size, found, pattern->lastError)) return -1;
+        if (found.empty()) return 0;
+        *matches = static_cast<regen_match*>(malloc(found.size() * sizeof(regen_match)));
+        if (*matches == nullptr) return -1;
+        for (size_t k = 0; k < found.size(); ++k) (*matches)[k] = regen_match{found[k].offset, found[k].length};
+        *count = found.size();
+        return 0;
+    } catch (...) {
+        return -1;
+    }
+}
+
+void regen_free(void* memory) {
+    free(memory);
+}
+
+}  // extern "C"
@@ -0,0 +1,79 @@
+// regen 库的 C++ 接口: 预设查询、模式组合、解释、代码生成和编译后的匹配
+// 所有结果以返回值给出, 库本身不读写控制台
+#ifndef REGEN_H
+#define REGEN_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#define REGEN_API __attribute__((visibility("default")))
+
+namespace regen {
+
+// 影响模式语义的选项
+struct Options {
+    bool matchWholeLine = false;   // 添加 ^ 和 $
+    bool caseInsensitive = false;
+    bool multiline = false;
+    bool dotAll = false;
+    bool optimize = false;         // 改写为等价且更简单的形式
+    bool utf8 = false;             // . 和取反字符类匹配整个 UTF-8 字符, 非 ASCII 字面量是一个原子
+};
+
+// 解释文本使用的语言, 对整个进程生效, 默认英文
+enum Language {
+    LANGUAGE_ENGLISH,
+    LANGUAGE_CHINESE
+};
+
+REGEN_API void setLanguage(Language language);
+
+// 预设模式的名称 (按字母顺序)
+REGEN_API std::vector<std::string> presetNames();
+
+// 查找预设模式, 名称未知时返回 false
+REGEN_API bool presetPattern(const std::string& name, std::string& pattern);
+
+// 依次连接多个模式; 含顶层分支的部分加上非捕获组, 不会与相邻部分混在一起
+REGEN_API std::string compose(const std::vector<std::string>& parts);
+
+// 一个匹配: 在输入中的字节偏移和长度
+struct Match {
+    std::size_t offset;
+    std::size_t length;
+};
+
+// 解析 (并按选项优化) 后的模式; 第一次匹配时编译自动机
+// 同一个对象不能在多个线程中同时调用 findAll; 被移动后的对象无效, 模式和解释为空串
+class REGEN_API Pattern {
+public:
+    explicit Pattern(const std::string& pattern, const Options& options = Options());
+    ~Pattern();
+    Pattern(Pattern&& other);
+    Pattern& operator=(Pattern&& other);
+
+    bool valid() const;
+    const std::string& error() const;     // 解析错误, 有效时为空
+    const std::string& original() const;  // 加上锚点后、优化前的模式
+    const std::string& pattern() const;   // 最终的模式
+
+    // 逐项解释, 以及内置匹配器的执行方式
+    std::string explain() const;
+
+    // 目标语言的代码片段 (cpp、cpp-dfa、c-dfa、python、java、javascript、go、rust), 未知语言返回空串
+    std::string code(const std::string& language) const;
+
+    // 查找所有不重叠的最左匹配; 模式无效或匹配器不支持时返回 false 并给出原因
+    bool findAll(const char* data, std::size_t size, std::vector<Match>& matches, std::string& error);
+    bool findAll(const std::string& text, std::vector<Match>& matches, std::string& error);
+
+private:
+    struct State;
+    std::unique_ptr<State> state;
+};
+
+}  // namespace regen
+
+#endif  // REGEN_H
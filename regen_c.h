@@ -0,0 +1,67 @@
+/* regen 库的 C 接口, 供其他语言通过 FFI 调用
+ * 返回的 char* 由 malloc 分配, 用 regen_free 释放; 返回的 const char* 归库所有 */
+#ifndef REGEN_C_H
+#define REGEN_C_H
+
+#include <stddef.h>
+
+#define REGEN_C_API __attribute__((visibility("default")))
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* regen_pattern_new 的选项位 */
+enum {
+    REGEN_MATCH_WHOLE = 1,
+    REGEN_CASE_INSENSITIVE = 2,
+    REGEN_MULTILINE = 4,
+    REGEN_DOTALL = 8,
+    REGEN_OPTIMIZE = 16,
+    REGEN_UTF8 = 32
+};
+
+typedef struct regen_pattern regen_pattern;
+
+typedef struct {
+    size_t offset;
+    size_t length;
+} regen_match;
+
+/* 解释文本的语言: 0 为英文, 非 0 为中文 */
+REGEN_C_API void regen_set_language(int chinese);
+
+/* 预设模式: 按下标枚举名称, 按名称查找模式; 越界或未知时返回 NULL */
+REGEN_C_API size_t regen_preset_count(void);
+REGEN_C_API const char* regen_preset_name(size_t index);
+REGEN_C_API const char* regen_preset(const char* name);
+
+/* 依次连接 count 个模式 */
+REGEN_C_API char* regen_compose(const char* const* parts, size_t count);
+
+/* 解析模式; 解析失败也返回对象, 由 regen_pattern_error 给出原因 (内存不足时返回 NULL) */
+REGEN_C_API regen_pattern* regen_pattern_new(const char* pattern, unsigned flags);
+REGEN_C_API void regen_pattern_free(regen_pattern* pattern);
+
+/* 最近一次的错误 (解析或编译), 没有时返回 NULL */
+REGEN_C_API const char* regen_pattern_error(const regen_pattern* pattern);
+
+/* 最终的模式 (加上锚点并优化后) */
+REGEN_C_API const char* regen_pattern_source(const regen_pattern* pattern);
+
+REGEN_C_API char* regen_explain(const regen_pattern* pattern);
+
+/* 未知语言返回 NULL */
+REGEN_C_API char* regen_code(const regen_pattern* pattern, const char* language);
+
+/* 查找所有匹配, *matches 用 regen_free 释放; 成功返回 0, 失败返回 -1 (原因见 regen_pattern_error) */
+REGEN_C_API int regen_find_all(regen_pattern* pattern, const char* data, size_t size, regen_match** matches,
+                               size_t* count);
+
+REGEN_C_API void regen_free(void* memory);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* REGEN_C_H */
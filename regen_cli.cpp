@@ -0,0 +1,4507 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <sstream>
+#include <cctype>
+#include <cmath>
+#include <algorithm>
+#include <iomanip>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <unordered_map>
+#include <memory>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <regex>
+#include <list>
+#include <csignal>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "regen_build_id.h"
+#include "regen_internal.h"
+
+// ============================================================
+// 命令行前端: 直接参数模式、向导模式以及扫描、基准测试、批处理、守护进程
+// ============================================================
+
+using namespace regen::detail;
+
+// 打印帮助信息
+void printHelp() {
+    cout << msg(MSG_HELP);
+}
+
+// 获取用户输入
+string getInput(const char* prompt, const string& defaultValue = "") {
+    cout << prompt;
+    if (!defaultValue.empty()) {
+        cout << " [" << defaultValue << "]";
+    }
+    cout << ": ";
+    
+    string input;
+    getline(cin, input);
+    
+    if (input.empty() && !defaultValue.empty()) {
+        return defaultValue;
+    }
+    return input;
+}
+
+// 只读映射的输入文件, 标准输入和管道读入内存
+class MappedFile {
+public:
+    MappedFile() {}
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() { close(); }
+
+    void close() {
+        if (mapped) munmap(const_cast<uint8_t*>(bytes), length);
+        mapped = false;
+        bytes = nullptr;
+        length = 0;
+        vector<uint8_t>().swap(buffer);
+    }
+
+    bool open(const string& path, string& error) {
+        int fd = path == "-" ? 0 : ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            error = strerror(errno);
+            return false;
+        }
+        struct stat info;
+        if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+            void* address = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (address != MAP_FAILED) {
+                madvise(address, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+                bytes = static_cast<const uint8_t*>(address);
+                length = static_cast<size_t>(info.st_size);
+                mapped = true;
+                if (fd != 0) ::close(fd);
+                return true;
+            }
+        }
+        char chunk[1 << 16];
+        ssize_t n;
+        while ((n = read(fd, chunk, sizeof(chunk))) > 0) {
+            buffer.insert(buffer.end(), chunk, chunk + n);
+        }
+        if (fd != 0) ::close(fd);
+        if (n < 0) {
+            error = strerror(errno);
+            return false;
+        }
+        bytes = buffer.data();
+        length = buffer.size();
+        return true;
+    }
+
+    const uint8_t* data() const { return bytes; }
+    size_t size() const { return length; }
+
+    // 已处理完的 [0, end) 不再需要: 映射的页从常驻内存中释放 (之后再访问会重新读入)
+    void release(size_t end) {
+        size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        size_t aligned = end / page * page;
+        if (mapped && aligned > 0) madvise(const_cast<uint8_t*>(bytes), aligned, MADV_DONTNEED);
+    }
+
+private:
+    const uint8_t* bytes = nullptr;
+    size_t length = 0;
+    bool mapped = false;
+    vector<uint8_t> buffer;
+};
+
+// 带缓冲的输出, 避免每个字段都经过 iostream
+class OutputBuffer {
+public:
+    explicit OutputBuffer(FILE* stream = stdout, size_t capacity = 1 << 16)
+        : stream(stream), capacity(capacity) {
+        buffer.reserve(capacity);
+    }
+
+    ~OutputBuffer() { flush(); }
+
+    void write(const char* data, size_t n) {
+        if (buffer.size() + n > capacity) {
+            flush();
+            if (n > capacity) {
+                fwrite(data, 1, n, stream);
+                return;
+            }
+        }
+        buffer.insert(buffer.end(), data, data + n);
+    }
+
+    void write(const string& text) { write(text.data(), text.size()); }
+
+    void put(char c) {
+        if (buffer.size() >= capacity) flush();
+        buffer.push_back(c);
+    }
+
+    void writeNumber(unsigned long long value) {
+        char digits[24];
+        int n = 0;
+        do {
+            digits[n++] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        } while (value != 0);
+        while (n > 0) put(digits[--n]);
+    }
+
+    void flush() {
+        if (!buffer.empty()) {
+            fwrite(buffer.data(), 1, buffer.size(), stream);
+            buffer.clear();
+        }
+        fflush(stream);
+    }
+
+private:
+    FILE* stream;
+    size_t capacity;
+    vector<char> buffer;
+};
+
+// JSON 字符串转义
+string jsonEscape(const string& text) {
+    string out;
+    for (unsigned char c : text) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (c < 0x20) {
+                    char escaped[8];
+                    snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    out += escaped;
+                } else {
+                    out.push_back(static_cast<char>(c));
+                }
+        }
+    }
+    return out;
+}
+
+// 终端显示宽度 (中文字符占两列)
+size_t displayWidth(const string& text) {
+    size_t display = 0;
+    for (unsigned char c : text) {
+        if ((c & 0xC0) != 0x80) display += c >= 0xE0 ? 2 : 1;
+    }
+    return display;
+}
+
+// 按终端显示宽度补齐
+string padColumn(const string& text, size_t width, bool alignLeft) {
+    size_t display = displayWidth(text);
+    string padding(display < width ? width - display : 0, ' ');
+    return alignLeft ? text + padding : padding + text;
+}
+
+// ============================================================
+// 阶段剖析 (--profile): 按阶段统计时间、字节和分配次数, 并输出 Chrome/Perfetto 跟踪
+// ============================================================
+
+// 每个线程的内存分配次数, 只在剖析时由下面替换的 operator new 累加; 阶段的分配数是进出阶段时的差值.
+// 不剖析时 operator new 只多检查一次 activeProfiler
+thread_local uint64_t threadAllocations = 0;
+
+enum ProfilePhase {
+    PHASE_PARSE,
+    PHASE_COMPILE,
+    PHASE_INPUT,
+    PHASE_PREFILTER,
+    PHASE_MATCH,
+    PHASE_OUTPUT,
+    PHASE_COUNT
+};
+
+const char* const PROFILE_PHASE_NAMES[PHASE_COUNT] = {"parse", "compile", "input", "prefilter", "match", "output"};
+
+class Profiler {
+public:
+    // 一段计时; 块扫描中预过滤的时间和字节记在 prefilter* 中, 汇总时从匹配阶段划到预过滤阶段
+    struct Event {
+        const char* name;
+        ProfilePhase phase;
+        size_t thread;
+        uint64_t begin;
+        uint64_t duration;
+        uint64_t bytes;
+        uint64_t allocations;
+        uint64_t prefilterNanoseconds;
+        uint64_t prefilterBytes;
+    };
+
+    explicit Profiler(const string& tracePath) : tracePath(tracePath), origin(now()) {}
+
+    static uint64_t now() {
+        return static_cast<uint64_t>(
+            chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    void record(const Event& event) {
+        lock_guard<mutex> guard(lock);
+        events.push_back(event);
+        threadCount = max(threadCount, event.thread + 1);
+    }
+
+    // 写出跟踪文件并向标准错误输出每个阶段的汇总; 跟踪文件写入失败时返回 false
+    bool finish() {
+        uint64_t wall = now() - origin;
+        bool written = writeTrace();
+        Totals totals[PHASE_COUNT];
+        for (const Event& event : events) {
+            Totals& phase = totals[event.phase];
+            phase.nanoseconds += event.duration - min(event.duration, event.prefilterNanoseconds);
+            phase.bytes += event.bytes - min(event.bytes, event.prefilterBytes);
+            phase.allocations += event.allocations;
+            ++phase.events;
+            if (event.prefilterNanoseconds > 0 || event.prefilterBytes > 0) {
+                totals[PHASE_PREFILTER].nanoseconds += event.prefilterNanoseconds;
+                totals[PHASE_PREFILTER].bytes += event.prefilterBytes;
+            }
+        }
+        char number[32];
+        snprintf(number, sizeof(number), "%.3f", wall / 1e6);
+        printMessage(cerr, MSG_PROFILE_SUMMARY, number, threadCount);
+        cerr << padColumn(msg(MSG_COLUMN_PHASE), 12, true) << padColumn(msg(MSG_COLUMN_TIME), 12, false)
+             << padColumn(msg(MSG_COLUMN_BYTES), 14, false) << padColumn(msg(MSG_COLUMN_ALLOCATIONS), 12, false)
+             << padColumn(msg(MSG_COLUMN_EVENTS), 10, false) << "\n";
+        for (int p = 0; p < PHASE_COUNT; ++p) {
+            const Totals& phase = totals[p];
+            if (phase.events == 0 && phase.nanoseconds == 0) continue;
+            snprintf(number, sizeof(number), "%.3f", phase.nanoseconds / 1e6);
+            cerr << padColumn(PROFILE_PHASE_NAMES[p], 12, true) << padColumn(number, 12, false)
+                 << padColumn(to_string(phase.bytes), 14, false) << padColumn(to_string(phase.allocations), 12, false)
+                 << padColumn(to_string(phase.events), 10, false) << "\n";
+        }
+        if (written) printMessage(cerr, MSG_PROFILE_TRACE, tracePath);
+        return written;
+    }
+
+private:
+    struct Totals {
+        uint64_t nanoseconds = 0;
+        uint64_t bytes = 0;
+        uint64_t allocations = 0;
+        uint64_t events = 0;
+    };
+
+    string tracePath;
+    uint64_t origin;
+    mutex lock;
+    vector<Event> events;
+    size_t threadCount = 1;
+
+    // Trace Event 格式: 每段计时是一个完整事件 (ph "X"), 时间以微秒为单位; 线程 0 是主线程
+    bool writeTrace() {
+        FILE* file = fopen(tracePath.c_str(), "w");
+        if (file == nullptr) {
+            printMessage(cerr, MSG_ERROR_PROFILE_WRITE, tracePath, strerror(errno));
+            return false;
+        }
+        fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+        for (size_t t = 0; t < threadCount; ++t) {
+            fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%zu,\"args\":{\"name\":\"%s%s\"}},\n",
+                    t, t == 0 ? "main" : "worker ", t == 0 ? "" : to_string(t).c_str());
+        }
+        for (size_t k = 0; k < events.size(); ++k) {
+            const Event& event = events[k];
+            fprintf(file,
+                    "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%zu,\"ts\":%.3f,\"dur\":%.3f,"
+                    "\"args\":{\"bytes\":%llu,\"allocations\":%llu",
+                    event.name, PROFILE_PHASE_NAMES[event.phase], event.thread,
+                    (event.begin - origin) / 1e3, event.duration / 1e3, static_cast<unsigned long long>(event.bytes),
+                    static_cast<unsigned long long>(event.allocations));
+            if (event.prefilterNanoseconds > 0 || event.prefilterBytes > 0) {
+                fprintf(file, ",\"prefilter_us\":%.3f,\"prefilter_bytes\":%llu", event.prefilterNanoseconds / 1e3,
+                        static_cast<unsigned long long>(event.prefilterBytes));
+            }
+            fprintf(file, "}}%s\n", k + 1 < events.size() ? "," : "");
+        }
+        fprintf(file, "]}\n");
+        bool ok = !ferror(file);
+        if (fclose(file) != 0) ok = false;
+        if (!ok) printMessage(cerr, MSG_ERROR_PROFILE_WRITE, tracePath, strerror(errno));
+        return ok;
+    }
+};
+
+// 未指定 --profile 时为空, 计时点只检查这一个指针; 工作线程启动前设置, 运行期间不变
+Profiler* activeProfiler = nullptr;
+
+// 替换全局 operator new 以在剖析时统计分配次数; 数组和 nothrow 版本默认转发到这里
+void* operator new(size_t size) {
+    if (activeProfiler != nullptr) ++threadAllocations;
+    while (true) {
+        void* memory = malloc(size == 0 ? 1 : size);
+        if (memory != nullptr) return memory;
+        new_handler handler = get_new_handler();
+        if (handler == nullptr) throw bad_alloc();
+        handler();
+    }
+}
+
+// 不内联: 否则编译器在调用处看到 new 出的指针交给 free, 误报 -Wmismatched-new-delete
+__attribute__((noinline)) void operator delete(void* memory) noexcept { free(memory); }
+
+// 作用域计时: 构造时开始, 析构时记录
+class ProfileScope {
+public:
+    ProfileScope(ProfilePhase phase, const char* name, size_t thread = 0, uint64_t bytes = 0)
+        : profiler(activeProfiler) {
+        if (profiler == nullptr) return;
+        event = Profiler::Event{name, phase, thread, Profiler::now(), 0, bytes, threadAllocations, 0, 0};
+    }
+
+    ~ProfileScope() {
+        if (profiler == nullptr) return;
+        event.duration = Profiler::now() - event.begin;
+        event.allocations = threadAllocations - event.allocations;
+        profiler->record(event);
+    }
+
+    void setBytes(uint64_t bytes) { event.bytes = bytes; }
+
+    void setPrefilter(const PrefilterProfile& prefilter) {
+        event.prefilterNanoseconds = prefilter.nanoseconds;
+        event.prefilterBytes = prefilter.bytes;
+    }
+
+private:
+    Profiler* profiler;
+    Profiler::Event event{};
+};
+
+// 工作窃取线程池: 任务按轮转分配到各线程的队列, 空闲线程从其他队列窃取;
+// 所有线程都从队首取任务, 使完成顺序尽量接近输入顺序
+class WorkStealingPool {
+public:
+    explicit WorkStealingPool(size_t threadCount) {
+        for (size_t k = 0; k < threadCount; ++k) queues.push_back(unique_ptr<TaskQueue>(new TaskQueue));
+    }
+
+    // work(线程编号, 任务编号), 所有任务完成后返回
+    void run(size_t taskCount, const function<void(size_t, size_t)>& work) {
+        for (size_t task = 0; task < taskCount; ++task) {
+            queues[task % queues.size()]->tasks.push_back(task);
+        }
+        vector<thread> threads;
+        for (size_t worker = 0; worker < queues.size(); ++worker) {
+            threads.push_back(thread([this, worker, &work]() {
+                size_t task;
+                while (take(worker, task)) work(worker, task);
+            }));
+        }
+        for (thread& t : threads) t.join();
+    }
+
+private:
+    struct TaskQueue {
+        mutex lock;
+        deque<size_t> tasks;
+    };
+    vector<unique_ptr<TaskQueue>> queues;
+
+    bool take(size_t worker, size_t& task) {
+        for (size_t k = 0; k < queues.size(); ++k) {
+            TaskQueue& queue = *queues[(worker + k) % queues.size()];
+            lock_guard<mutex> guard(queue.lock);
+            if (!queue.tasks.empty()) {
+                task = queue.tasks.front();
+                queue.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+// 每个线程独立的扫描器: 扫描 [begin, end) 并把格式化后的结果追加到 output
+class ScanWorker {
+public:
+    virtual ~ScanWorker() {}
+    virtual void scan(const string& prefix, const uint8_t* data, size_t size, size_t begin, size_t end,
+                      string& output) = 0;
+    // 惰性 DFA 统计, 依次为组合、正向、反向自动机
+    virtual void addStats(DfaStats& combined, DfaStats& forward, DfaStats& reverse) const = 0;
+    // --profile: 记录预过滤所用的时间 (没有预过滤器的扫描器忽略)
+    virtual void setPrefilterProfile(PrefilterProfile*) {}
+};
+
+void appendNumber(string& output, unsigned long long value) {
+    char digits[24];
+    int n = 0;
+    do {
+        digits[n++] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    while (n > 0) output.push_back(digits[--n]);
+}
+
+class SinglePatternWorker : public ScanWorker {
+public:
+    SinglePatternWorker(const CompiledPattern& pattern, size_t cacheLimit) : scanner(pattern, cacheLimit) {}
+
+    void scan(const string& prefix, const uint8_t* data, size_t size, size_t begin, size_t end,
+              string& output) override {
+        scanner.findAll(data, size, begin, end, [&](size_t start, size_t stop) {
+            // 块末尾的空匹配属于下一块
+            if (start == end && end != size) return;
+            output += prefix;
+            appendNumber(output, start);
+            output.push_back(':');
+            output.append(reinterpret_cast<const char*>(data + start), stop - start);
+            output.push_back('\n');
+        });
+    }
+
+    void addStats(DfaStats&, DfaStats& forward, DfaStats& reverse) const override {
+        scanner.addStats(forward, reverse);
+    }
+
+    void setPrefilterProfile(PrefilterProfile* profile) override { scanner.setPrefilterProfile(profile); }
+
+private:
+    PatternScanner scanner;
+};
+
+class MultiPatternWorker : public ScanWorker {
+public:
+    MultiPatternWorker(const CompiledPatternSet& set, size_t cacheLimit) : set(set), scanner(set, cacheLimit) {}
+
+    // 各模式的匹配由各自的扫描器确认, 先后次序按模式分组; 输出前按 (起点, 模式编号) 排成输入顺序
+    void scan(const string& prefix, const uint8_t* data, size_t size, size_t begin, size_t end,
+              string& output) override {
+        hits.clear();
+        scanner.findAll(data, size, begin, end, [&](int id, size_t start, size_t stop) {
+            hits.push_back(Hit{start, id, stop});
+        });
+        sort(hits.begin(), hits.end(), [](const Hit& a, const Hit& b) {
+            return a.start != b.start ? a.start < b.start : a.id < b.id;
+        });
+        for (const Hit& hit : hits) {
+            output += prefix;
+            output += set.names[hit.id];
+            output.push_back(':');
+            appendNumber(output, hit.start);
+            output.push_back(':');
+            appendNumber(output, hit.stop - hit.start);
+            output.push_back(':');
+            output.append(reinterpret_cast<const char*>(data + hit.start), hit.stop - hit.start);
+            output.push_back('\n');
+        }
+    }
+
+    void addStats(DfaStats& combined, DfaStats& forward, DfaStats& reverse) const override {
+        scanner.addStats(combined, forward, reverse);
+    }
+
+private:
+    struct Hit {
+        size_t start;
+        int id;
+        size_t stop;
+    };
+
+    const CompiledPatternSet& set;
+    MultiPatternScanner scanner;
+    vector<Hit> hits;
+};
+
+// 块边界: nominal 之后第一个不可消耗字节 (优先换行符) 的下一个位置, 匹配不会跨越该边界
+size_t alignChunkBoundary(const uint8_t* data, size_t size, size_t nominal, const ByteSet& consumable) {
+    if (nominal == 0 || nominal >= size) return min(nominal, size);
+    size_t pos = nominal - 1;
+    if (!consumable.has('\n')) {
+        const void* newline = memchr(data + pos, '\n', size - pos);
+        return newline != nullptr ? static_cast<size_t>(static_cast<const uint8_t*>(newline) - data) + 1 : size;
+    }
+    while (pos < size && consumable.has(data[pos])) ++pos;
+    return pos < size ? pos + 1 : size;
+}
+
+struct ScanSettings {
+    size_t threads = 1;
+    size_t dfaCacheLimit = 64u << 20;  // 每个惰性 DFA 的内存预算 (字节)
+    bool printStats = false;
+    bool useCache = true;
+    size_t cacheLimit = 64u << 20;  // 缓存目录的总大小上限 (字节)
+};
+
+// --scan-stats: 每类自动机一行, 多个线程和模式的统计合并在一起
+void printScanStats(const ScanSettings& settings, const DfaStats& combined, const DfaStats& forward,
+                    const DfaStats& reverse) {
+    stringstream budget;
+    budget << setprecision(3) << settings.dfaCacheLimit / 1048576.0;
+    printMessage(cerr, MSG_DFA_STATS_HEADER, budget.str());
+    const pair<MessageId, const DfaStats*> rows[] = {
+        make_pair(MSG_DFA_COMBINED, &combined), make_pair(MSG_DFA_FORWARD, &forward),
+        make_pair(MSG_DFA_REVERSE, &reverse)};
+    for (const auto& row : rows) {
+        const DfaStats& stats = *row.second;
+        if (stats.automata == 0) continue;
+        stringstream hitRate;
+        if (stats.steps == 0) {
+            hitRate << "-";
+        } else {
+            hitRate << fixed << setprecision(2)
+                    << 100.0 * static_cast<double>(stats.steps - min(stats.misses, stats.steps)) / stats.steps;
+        }
+        printMessage(cerr, MSG_DFA_STATS_ROW, msg(row.first), stats.automata, stats.steps, hitRate.str(), stats.built,
+                     stats.peakStates, stats.flushes, stats.byteClasses);
+        if (stats.simulating > 0) printMessage(cerr, MSG_DFA_STATS_FALLBACK, msg(row.first), stats.simulating);
+    }
+}
+
+// 扫描驱动: 把文件切成与行(或不可消耗字节)对齐的块, 在工作窃取线程池上扫描,
+// 并按输入顺序输出结果
+int runScan(const vector<string>& files, const ByteSet& consumable, const ScanSettings& settings,
+            const function<ScanWorker*()>& makeWorker) {
+    struct ScanFile {
+        string path;
+        size_t chunkCount = 1;
+        once_flag opened;
+        MappedFile map;
+        string error;
+        atomic<size_t> remaining;
+    };
+    struct ScanTask {
+        size_t file;
+        size_t chunk;
+    };
+
+    vector<string> inputs = files;
+    if (inputs.empty()) inputs.push_back("-");
+    bool showFileName = inputs.size() > 1;
+    size_t threads = max<size_t>(settings.threads, 1);
+
+    // 单线程时块只用于限制内存; 多线程时每个文件至少分成 4 倍线程数的块 (每块不小于 1MB)
+    const size_t maxChunk = 64u << 20;
+    const size_t minChunk = 1u << 20;
+    vector<unique_ptr<ScanFile>> scanFiles;
+    vector<ScanTask> tasks;
+    for (size_t f = 0; f < inputs.size(); ++f) {
+        unique_ptr<ScanFile> file(new ScanFile);
+        file->path = inputs[f];
+        struct stat info;
+        if (inputs[f] != "-" && stat(inputs[f].c_str(), &info) == 0 && S_ISREG(info.st_mode)) {
+            size_t size = static_cast<size_t>(info.st_size);
+            size_t chunks = (size + maxChunk - 1) / maxChunk;
+            if (threads > 1) chunks = max(chunks, min(size / minChunk, threads * 4));
+            file->chunkCount = max<size_t>(chunks, 1);
+        }
+        file->remaining = file->chunkCount;
+        for (size_t c = 0; c < file->chunkCount; ++c) tasks.push_back(ScanTask{f, c});
+        scanFiles.push_back(move(file));
+    }
+
+    vector<string> results(tasks.size());
+    vector<string> errors(tasks.size());
+    vector<char> done(tasks.size(), 0);
+    mutex lock;
+    condition_variable taskDone;
+    condition_variable windowMoved;
+    size_t written = 0;
+    const size_t window = threads * 8;  // 限制已完成但尚未输出的块数
+
+    // thread 是 --profile 跟踪中的线程编号: 0 为主线程, 工作线程从 1 开始
+    auto execute = [&](ScanWorker& worker, size_t index, size_t thread) {
+        const ScanTask& task = tasks[index];
+        ScanFile& file = *scanFiles[task.file];
+        call_once(file.opened, [&]() {
+            ProfileScope scope(PHASE_INPUT, "open", thread);
+            string error;
+            if (!file.map.open(file.path, error)) file.error = error;
+            scope.setBytes(file.map.size());
+        });
+        if (!file.error.empty()) {
+            if (task.chunk == 0) errors[index] = file.error;
+        } else {
+            const uint8_t* data = file.map.data();
+            size_t size = file.map.size();
+            size_t begin = alignChunkBoundary(data, size, size / file.chunkCount * task.chunk, consumable);
+            size_t end = task.chunk + 1 == file.chunkCount
+                             ? size
+                             : alignChunkBoundary(data, size, size / file.chunkCount * (task.chunk + 1), consumable);
+            if (begin < end || (begin == end && end == size && task.chunk + 1 == file.chunkCount)) {
+                ProfileScope scope(PHASE_MATCH, "scan chunk", thread, end - begin);
+                PrefilterProfile prefilter;
+                if (activeProfiler != nullptr) worker.setPrefilterProfile(&prefilter);
+                worker.scan(showFileName ? file.path + ":" : string(), data, size, begin, end, results[index]);
+                if (activeProfiler != nullptr) {
+                    worker.setPrefilterProfile(nullptr);
+                    scope.setPrefilter(prefilter);
+                }
+            }
+        }
+        if (--file.remaining == 0) file.map.close();
+    };
+
+    OutputBuffer out;
+    bool anyMatch = false;
+    bool anyError = false;
+    auto emit = [&](size_t index) {
+        if (!errors[index].empty()) {
+            out.flush();
+            printMessage(cerr, MSG_ERROR_READ_FILE, scanFiles[tasks[index].file]->path, errors[index]);
+            anyError = true;
+        }
+        if (!results[index].empty()) anyMatch = true;
+        ProfileScope scope(PHASE_OUTPUT, "write", 0, results[index].size());
+        out.write(results[index]);
+        string().swap(results[index]);
+    };
+
+    vector<unique_ptr<ScanWorker>> workers;
+    for (size_t k = 0; k < threads; ++k) workers.push_back(unique_ptr<ScanWorker>(makeWorker()));
+    if (threads == 1) {
+        for (size_t index = 0; index < tasks.size(); ++index) {
+            execute(*workers[0], index, 0);
+            emit(index);
+        }
+    } else {
+        WorkStealingPool pool(threads);
+        thread scanning([&]() {
+            pool.run(tasks.size(), [&](size_t worker, size_t index) {
+                {
+                    unique_lock<mutex> guard(lock);
+                    windowMoved.wait(guard, [&]() { return index < written + window; });
+                }
+                execute(*workers[worker], index, worker + 1);
+                lock_guard<mutex> guard(lock);
+                done[index] = 1;
+                taskDone.notify_all();
+            });
+        });
+        // 主线程按顺序输出已完成的块
+        for (size_t index = 0; index < tasks.size(); ++index) {
+            {
+                unique_lock<mutex> guard(lock);
+                taskDone.wait(guard, [&]() { return done[index] != 0; });
+            }
+            emit(index);
+            lock_guard<mutex> guard(lock);
+            written = index + 1;
+            windowMoved.notify_all();
+        }
+        scanning.join();
+    }
+    out.flush();
+    if (settings.printStats) {
+        DfaStats combined, forward, reverse;
+        for (const auto& worker : workers) worker->addStats(combined, forward, reverse);
+        printScanStats(settings, combined, forward, reverse);
+    }
+    if (anyError) return 2;
+    return anyMatch ? 0 : 1;
+}
+
+// 自动机缓存: 同一组模式和选项再次扫描时, 直接 mmap 缓存文件, 跳过解析和编译.
+// 文件由头部和载荷组成, 只含定宽整数和以偏移表示的数据, 与载入地址无关:
+//   头部: 魔数, 格式版本, 字节序标记, 构建指纹, 载荷长度, 载荷的 FNV-1a 校验和
+//   载荷: 缓存键原文, 模式个数, 各模式的名称和 CompiledPattern, 是否有组合程序及组合程序
+// 程序的状态表和字节集表按内存布局原样写入并按 8 字节对齐, 载入时 RegexProgram 直接引用映射的页面,
+// 不再复制; 映射由 CompiledPatternSet::storage 持有到扫描结束. 写入是先写临时文件再改名, 淘汰是 unlink,
+// 已映射的文件内容不会在扫描过程中改变
+// 文件名是键原文的 64 位散列; 键原文含格式版本、构建指纹、选项和所有模式, 载入时逐字比较以排除碰撞
+const char AUTOMATON_CACHE_MAGIC[8] = {'r', 'e', 'g', 'e', 'n', 'a', 'c', '\n'};
+const uint32_t AUTOMATON_CACHE_VERSION = 2;
+const uint32_t AUTOMATON_CACHE_BYTE_ORDER = 0x01020304;
+const size_t AUTOMATON_CACHE_HEADER = 40;
+const size_t AUTOMATON_CACHE_ALIGNMENT = 8;
+
+uint64_t fnv1a(const uint8_t* data, size_t size) {
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t k = 0; k < size; ++k) {
+        hash ^= data[k];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// 构建指纹: 原样写入的表的布局常量加上构建标识 (git describe 和核心源码的校验和, 见 Makefile);
+// 布局或编译器输出可能变化的构建之间不共享缓存
+uint64_t automatonCacheFingerprint() {
+    string text = REGEN_BUILD_ID;
+    const size_t layout[] = {sizeof(NfaState), alignof(NfaState), offsetof(NfaState, op), offsetof(NfaState, assertion),
+                             offsetof(NfaState, out), offsetof(NfaState, out1), offsetof(NfaState, setIndex),
+                             sizeof(ByteSet), alignof(ByteSet), sizeof(int), sizeof(size_t)};
+    for (size_t value : layout) text += " " + to_string(value);
+    return fnv1a(reinterpret_cast<const uint8_t*>(text.data()), text.size());
+}
+
+class CacheWriter {
+public:
+    vector<uint8_t> bytes;
+
+    void raw(const void* data, size_t size) {
+        const uint8_t* begin = static_cast<const uint8_t*>(data);
+        bytes.insert(bytes.end(), begin, begin + size);
+    }
+    void u8(uint8_t value) { bytes.push_back(value); }
+    void u32(uint32_t value) { raw(&value, sizeof(value)); }
+    void u64(uint64_t value) { raw(&value, sizeof(value)); }
+    void text(const string& value) {
+        u64(value.size());
+        raw(value.data(), value.size());
+    }
+    void set(const ByteSet& value) { raw(value.bits, sizeof(value.bits)); }
+    // 载荷从头部之后开始, 头部长度是对齐的倍数, 所以按载荷内的偏移对齐即可
+    void align() { bytes.resize((bytes.size() + AUTOMATON_CACHE_ALIGNMENT - 1) / AUTOMATON_CACHE_ALIGNMENT *
+                                AUTOMATON_CACHE_ALIGNMENT, 0); }
+
+    void program(const RegexProgram& value) {
+        u32(static_cast<uint32_t>(value.start));
+        u32(static_cast<uint32_t>(value.unanchoredStart));
+        u8(static_cast<uint8_t>((value.usesLineBegin ? 1 : 0) | (value.usesTextBegin ? 2 : 0) |
+                                (value.usesWordBoundary ? 4 : 0)));
+        align();
+        u64(value.states.size());
+        for (const NfaState& state : value.states) {
+            // 逐字段复制到清零的副本, 填充字节固定为 0, 同样的程序得到同样的文件
+            NfaState copy;
+            memset(&copy, 0, sizeof(copy));
+            copy.op = state.op;
+            copy.assertion = state.assertion;
+            copy.out = state.out;
+            copy.out1 = state.out1;
+            copy.setIndex = state.setIndex;
+            raw(&copy, sizeof(copy));
+        }
+        u64(value.sets.size());
+        for (const ByteSet& byteSet : value.sets) set(byteSet);
+    }
+
+    void pattern(const CompiledPattern& value) {
+        program(value.forward);
+        program(value.reverse);
+        set(value.consumable);
+        const Prefilter& prefilter = value.prefilter;
+        u8(static_cast<uint8_t>(prefilter.kind));
+        u8(static_cast<uint8_t>(prefilter.byteCount));
+        raw(prefilter.bytes, sizeof(prefilter.bytes));
+        text(prefilter.literal);
+        u64(prefilter.rareOffset);
+        u64(prefilter.secondOffset);
+    }
+};
+
+// 按顺序读取载荷, 任何越界或不一致都使 ok() 变为 false; 读出的状态编号都经过范围检查,
+// 损坏的缓存只会被当作未命中, 不会让扫描器越界. 状态表和字节集表不复制, 程序直接引用 data 中的内容
+class CacheReader {
+public:
+    CacheReader(const uint8_t* data, size_t size) : data(data), size(size) {}
+
+    bool ok() const { return good; }
+    bool atEnd() const { return good && pos == size; }
+
+    void raw(void* out, size_t length) {
+        if (!good || size - pos < length) {
+            good = false;
+            memset(out, 0, length);
+            return;
+        }
+        memcpy(out, data + pos, length);
+        pos += length;
+    }
+    uint8_t u8() {
+        uint8_t value;
+        raw(&value, sizeof(value));
+        return value;
+    }
+    uint32_t u32() {
+        uint32_t value;
+        raw(&value, sizeof(value));
+        return value;
+    }
+    uint64_t u64() {
+        uint64_t value;
+        raw(&value, sizeof(value));
+        return value;
+    }
+    // 元素个数, 超出剩余字节时视为损坏
+    size_t count(size_t elementSize) {
+        uint64_t value = u64();
+        if (good && value > (size - pos) / elementSize) good = false;
+        return good ? static_cast<size_t>(value) : 0;
+    }
+    string text() {
+        size_t length = count(1);
+        string value(reinterpret_cast<const char*>(data + pos), good ? length : 0);
+        pos += value.size();
+        return value;
+    }
+    ByteSet set() {
+        ByteSet value;
+        raw(value.bits, sizeof(value.bits));
+        return value;
+    }
+    void align() {
+        size_t aligned = (pos + AUTOMATON_CACHE_ALIGNMENT - 1) / AUTOMATON_CACHE_ALIGNMENT * AUTOMATON_CACHE_ALIGNMENT;
+        if (!good || aligned > size) {
+            good = false;
+            return;
+        }
+        pos = aligned;
+    }
+    // 让 table 引用载荷中的一张表: 元素个数之后紧跟按内存布局排列的元素
+    template <typename T>
+    void table(ProgramTable<T>& value) {
+        size_t length = count(sizeof(T));
+        if (good && reinterpret_cast<uintptr_t>(data + pos) % alignof(T) != 0) good = false;
+        if (!good) return;
+        value.view(reinterpret_cast<const T*>(data + pos), length);
+        pos += length * sizeof(T);
+    }
+
+    void program(RegexProgram& value, size_t patternCount) {
+        value.start = static_cast<int32_t>(u32());
+        value.unanchoredStart = static_cast<int32_t>(u32());
+        uint8_t flags = u8();
+        value.usesLineBegin = (flags & 1) != 0;
+        value.usesTextBegin = (flags & 2) != 0;
+        value.usesWordBoundary = (flags & 4) != 0;
+        align();
+        table(value.states);
+        table(value.sets);
+        if (!good) return;
+
+        int states = static_cast<int>(value.states.size());
+        int sets = static_cast<int>(value.sets.size());
+        auto inRange = [](int index, int limit) { return index >= 0 && index < limit; };
+        bool valid = inRange(value.start, states) && (value.unanchoredStart == -1 || inRange(value.unanchoredStart, states));
+        for (const NfaState& state : value.states) {
+            switch (state.op) {
+                case NFA_SET: valid = valid && inRange(state.out, states) && inRange(state.setIndex, sets); break;
+                case NFA_SPLIT: valid = valid && inRange(state.out, states) && inRange(state.out1, states); break;
+                case NFA_EPSILON: valid = valid && inRange(state.out, states); break;
+                case NFA_ASSERT:
+                    valid = valid && inRange(state.out, states) && state.assertion <= ASSERT_NOT_WORD_BOUNDARY;
+                    break;
+                case NFA_MATCH: valid = valid && inRange(state.out, static_cast<int>(patternCount)); break;
+                default: valid = false; break;
+            }
+        }
+        good = valid;
+    }
+
+    void pattern(CompiledPattern& value) {
+        program(value.forward, 1);
+        program(value.reverse, 1);
+        value.consumable = set();
+        Prefilter& prefilter = value.prefilter;
+        uint8_t kind = u8();
+        prefilter.byteCount = u8();
+        raw(prefilter.bytes, sizeof(prefilter.bytes));
+        prefilter.literal = text();
+        prefilter.rareOffset = static_cast<size_t>(u64());
+        prefilter.secondOffset = static_cast<size_t>(u64());
+        prefilter.kind = static_cast<PrefilterKind>(kind);
+        if (kind == PREFILTER_BYTES) {
+            good = good && prefilter.byteCount >= 1 && prefilter.byteCount <= 3;
+        } else if (kind == PREFILTER_LITERAL) {
+            good = good && prefilter.rareOffset < prefilter.literal.size() &&
+                   prefilter.secondOffset < prefilter.literal.size();
+        } else {
+            good = good && kind == PREFILTER_NONE;
+        }
+    }
+
+private:
+    const uint8_t* data;
+    size_t size;
+    size_t pos = 0;
+    bool good = true;
+};
+
+// $XDG_CACHE_HOME/regen 或 ~/.cache/regen, 都没有时返回空串
+string automatonCacheDirectory() {
+    const char* base = getenv("XDG_CACHE_HOME");
+    if (base != nullptr && base[0] == '/') return string(base) + "/regen";
+    const char* home = getenv("HOME");
+    if (home != nullptr && home[0] != '\0') return string(home) + "/.cache/regen";
+    return string();
+}
+
+// 缓存键原文: 格式版本、构建指纹、影响编译结果的选项, 以及 (名称, 模式) 列表; combined 区分单模式和多模式扫描
+string automatonCacheKey(const vector<pair<string, string>>& namedPatterns, bool combined,
+                         const GenerationOptions& options) {
+    char fingerprint[20];
+    snprintf(fingerprint, sizeof(fingerprint), " %016llx", static_cast<unsigned long long>(automatonCacheFingerprint()));
+    string key = "regen-automaton " + to_string(AUTOMATON_CACHE_VERSION) + fingerprint + (combined ? " set " : " single ");
+    key += options.matchWholeLine ? 'm' : '-';
+    key += options.caseInsensitive ? 'i' : '-';
+    key += options.multiline ? 'l' : '-';
+    key += options.dotAll ? 's' : '-';
+    key += options.optimize ? 'o' : '-';
+    key += options.utf8 ? 'u' : '-';
+    for (const auto& named : namedPatterns) {
+        key += '\n' + to_string(named.first.size()) + ':' + named.first;
+        key += to_string(named.second.size()) + ':' + named.second;
+    }
+    return key;
+}
+
+string automatonCachePath(const string& directory, const string& key) {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.automaton",
+             static_cast<unsigned long long>(fnv1a(reinterpret_cast<const uint8_t*>(key.data()), key.size())));
+    return directory + "/" + name;
+}
+
+// 命中时填充 compiled (程序的表引用映射, 映射交给 compiled.storage) 并刷新文件时间 (淘汰按最近使用顺序);
+// 任何不一致都当作未命中
+bool loadAutomatonCache(const string& key, size_t patternCount, bool combined, CompiledPatternSet& compiled) {
+    string directory = automatonCacheDirectory();
+    if (directory.empty()) return false;
+    int fd = ::open(automatonCachePath(directory, key).c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) ||
+        static_cast<size_t>(info.st_size) < AUTOMATON_CACHE_HEADER) {
+        ::close(fd);
+        return false;
+    }
+    size_t size = static_cast<size_t>(info.st_size);
+    void* address = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (address == MAP_FAILED) {
+        ::close(fd);
+        return false;
+    }
+    const uint8_t* data = static_cast<const uint8_t*>(address);
+
+    CacheReader header(data, AUTOMATON_CACHE_HEADER);
+    char magic[8];
+    header.raw(magic, sizeof(magic));
+    bool hit = memcmp(magic, AUTOMATON_CACHE_MAGIC, sizeof(magic)) == 0 &&
+               header.u32() == AUTOMATON_CACHE_VERSION && header.u32() == AUTOMATON_CACHE_BYTE_ORDER &&
+               header.u64() == automatonCacheFingerprint();
+    uint64_t payloadSize = header.u64();
+    uint64_t checksum = header.u64();
+    hit = hit && payloadSize == size - AUTOMATON_CACHE_HEADER &&
+          fnv1a(data + AUTOMATON_CACHE_HEADER, size - AUTOMATON_CACHE_HEADER) == checksum;
+
+    if (hit) {
+        CacheReader payload(data + AUTOMATON_CACHE_HEADER, size - AUTOMATON_CACHE_HEADER);
+        hit = payload.text() == key && payload.u64() == patternCount;
+        for (size_t k = 0; hit && k < patternCount; ++k) {
+            compiled.names.push_back(payload.text());
+            compiled.patterns.push_back(CompiledPattern());
+            payload.pattern(compiled.patterns.back());
+            hit = payload.ok();
+        }
+        hit = hit && payload.u8() == (combined ? 1 : 0);
+        if (hit && combined) payload.program(compiled.combined, patternCount);
+        hit = hit && payload.atEnd();
+    }
+    if (hit) {
+        compiled.storage = shared_ptr<const void>(address, [size](const void* mapped) {
+            munmap(const_cast<void*>(mapped), size);
+        });
+        futimens(fd, nullptr);
+    } else {
+        compiled = CompiledPatternSet();
+        munmap(address, size);
+    }
+    ::close(fd);
+    return hit;
+}
+
+// 按最近使用时间从旧到新删除缓存文件, 直到总大小不超过 limit
+void evictAutomatonCache(const string& directory, size_t limit) {
+    DIR* listing = opendir(directory.c_str());
+    if (listing == nullptr) return;
+    vector<pair<time_t, pair<string, size_t>>> entries;  // (修改时间, (路径, 大小))
+    size_t total = 0;
+    while (dirent* entry = readdir(listing)) {
+        string name = entry->d_name;
+        const string suffix = ".automaton";
+        if (name.size() <= suffix.size() || name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0) {
+            continue;
+        }
+        string path = directory + "/" + name;
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0 || !S_ISREG(info.st_mode)) continue;
+        entries.push_back(make_pair(info.st_mtime, make_pair(path, static_cast<size_t>(info.st_size))));
+        total += static_cast<size_t>(info.st_size);
+    }
+    closedir(listing);
+    sort(entries.begin(), entries.end());
+    for (size_t k = 0; k < entries.size() && total > limit; ++k) {
+        if (unlink(entries[k].second.first.c_str()) == 0) total -= entries[k].second.second;
+    }
+}
+
+// 写入临时文件后改名, 并发的扫描不会读到写了一半的缓存; 失败时静默放弃 (缓存只影响启动时间)
+void storeAutomatonCache(const string& key, bool combined, const CompiledPatternSet& compiled, size_t limit) {
+    string directory = automatonCacheDirectory();
+    if (directory.empty()) return;
+    CacheWriter payload;
+    payload.text(key);
+    payload.u64(compiled.patterns.size());
+    for (size_t k = 0; k < compiled.patterns.size(); ++k) {
+        payload.text(compiled.names[k]);
+        payload.pattern(compiled.patterns[k]);
+    }
+    payload.u8(combined ? 1 : 0);
+    if (combined) payload.program(compiled.combined);
+    if (AUTOMATON_CACHE_HEADER + payload.bytes.size() > limit) return;
+
+    CacheWriter file;
+    file.raw(AUTOMATON_CACHE_MAGIC, sizeof(AUTOMATON_CACHE_MAGIC));
+    file.u32(AUTOMATON_CACHE_VERSION);
+    file.u32(AUTOMATON_CACHE_BYTE_ORDER);
+    file.u64(automatonCacheFingerprint());
+    file.u64(payload.bytes.size());
+    file.u64(fnv1a(payload.bytes.data(), payload.bytes.size()));
+    file.raw(payload.bytes.data(), payload.bytes.size());
+
+    // 只为 ~/.cache 之下的两级目录创建; 已存在时 mkdir 失败无妨
+    size_t parent = directory.rfind('/');
+    if (parent != string::npos && parent > 0) mkdir(directory.substr(0, parent).c_str(), 0700);
+    mkdir(directory.c_str(), 0700);
+    string path = automatonCachePath(directory, key);
+    string temporary = path + "." + to_string(getpid()) + ".tmp";
+    int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if (fd < 0) return;
+    size_t written = 0;
+    while (written < file.bytes.size()) {
+        ssize_t n = write(fd, file.bytes.data() + written, file.bytes.size() - written);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        written += static_cast<size_t>(n);
+    }
+    bool complete = ::close(fd) == 0 && written == file.bytes.size();
+    if (!complete || rename(temporary.c_str(), path.c_str()) != 0) {
+        unlink(temporary.c_str());
+        return;
+    }
+    evictAutomatonCache(directory, limit);
+}
+
+// 扫描和分析使用的语法树: 解析, 并按选项做优化改写
+void parseForMatching(const string& pattern, const GenerationOptions& options, ParsedPattern& parsed) {
+    parsePattern(pattern, options, parsed);
+    if (options.optimize) {
+        ParsedPattern optimized;
+        optimizePattern(parsed, options, optimized);
+        swap(parsed, optimized);
+    }
+}
+
+// 从自动机缓存载入, 载入时间记在编译阶段
+bool loadCache(const string& key, size_t patternCount, bool combined, CompiledPatternSet& compiled) {
+    ProfileScope scope(PHASE_COMPILE, "load cache");
+    return loadAutomatonCache(key, patternCount, combined, compiled);
+}
+
+// 扫描模式: 对文件应用模式并输出 [文件:]偏移:匹配文本
+int scanMode(const string& pattern, const GenerationOptions& options, const vector<string>& files,
+             const ScanSettings& settings) {
+    vector<pair<string, string>> namedPatterns(1, make_pair(string(), pattern));
+    string key = automatonCacheKey(namedPatterns, false, options);
+    CompiledPatternSet compiled;
+    if (!settings.useCache || !loadCache(key, 1, false, compiled)) {
+        ParsedPattern parsed;
+        {
+            ProfileScope scope(PHASE_PARSE, "parse", 0, pattern.size());
+            parseForMatching(pattern, options, parsed);
+        }
+        compiled.names.push_back(string());
+        compiled.patterns.resize(1);
+        string error = parsed.error;
+        ProfileScope scope(PHASE_COMPILE, "compile");
+        if (!parsed.valid() || !compilePattern(parsed.ast, compiled.patterns[0], error)) {
+            printMessage(cerr, MSG_ERROR_COMPILE, error);
+            return 2;
+        }
+        if (settings.useCache) storeAutomatonCache(key, false, compiled, settings.cacheLimit);
+    }
+    const CompiledPattern& program = compiled.patterns[0];
+    return runScan(files, program.consumable, settings, [&]() -> ScanWorker* {
+        return new SinglePatternWorker(program, settings.dfaCacheLimit);
+    });
+}
+
+// 编译一组预设 (或从自动机缓存载入); 失败时输出错误并返回 false
+bool compilePresetSet(const vector<string>& presetNames, const GenerationOptions& options, const ScanSettings& settings,
+                      CompiledPatternSet& compiled) {
+    vector<pair<string, string>> namedPatterns;
+    for (const string& name : presetNames) {
+        string pattern;
+        if (!regen::presetPattern(name, pattern)) {
+            printMessage(cerr, MSG_ERROR_UNKNOWN_PRESET, name);
+            return false;
+        }
+        if (options.matchWholeLine) pattern = "^" + pattern + "$";
+        namedPatterns.push_back(make_pair(name, pattern));
+    }
+
+    string key = automatonCacheKey(namedPatterns, true, options);
+    if (!settings.useCache || !loadCache(key, namedPatterns.size(), true, compiled)) {
+        string error;
+        // 预设组合的解析和编译在 compilePatternSet 中一并完成, 记为一个编译阶段
+        ProfileScope scope(PHASE_COMPILE, "parse and compile");
+        if (!compilePatternSet(namedPatterns, options, compiled, error)) {
+            printMessage(cerr, MSG_ERROR_COMPILE, error);
+            return false;
+        }
+        if (settings.useCache) storeAutomatonCache(key, true, compiled, settings.cacheLimit);
+    }
+    return true;
+}
+
+// 多预设扫描模式: 单遍输出 [文件:]预设:偏移:长度:匹配文本
+int multiScanMode(const vector<string>& presetNames, const vector<string>& files, const GenerationOptions& options,
+                  const ScanSettings& settings) {
+    CompiledPatternSet compiled;
+    if (!compilePresetSet(presetNames, options, settings, compiled)) return 2;
+    ByteSet consumable;
+    for (const CompiledPattern& pattern : compiled.patterns) consumable.merge(pattern.consumable);
+    return runScan(files, consumable, settings, [&]() -> ScanWorker* {
+        return new MultiPatternWorker(compiled, settings.dfaCacheLimit);
+    });
+}
+
+// ============================================================
+// 脱敏模式 (--redact): 把预设的匹配替换为掩码或带密钥的散列, 其余字节原样输出
+// ============================================================
+
+// SipHash-2-4: 带密钥的散列, 同一个值总是得到同一个记号, 没有密钥则无法由记号反推或验证猜测
+uint64_t sipHash(uint64_t k0, uint64_t k1, const uint8_t* data, size_t size) {
+    uint64_t v0 = k0 ^ 0x736f6d6570736575ULL;
+    uint64_t v1 = k1 ^ 0x646f72616e646f6dULL;
+    uint64_t v2 = k0 ^ 0x6c7967656e657261ULL;
+    uint64_t v3 = k1 ^ 0x7465646279746573ULL;
+    auto rotate = [](uint64_t x, int bits) { return (x << bits) | (x >> (64 - bits)); };
+    auto sipRound = [&]() {
+        v0 += v1; v1 = rotate(v1, 13); v1 ^= v0; v0 = rotate(v0, 32);
+        v2 += v3; v3 = rotate(v3, 16); v3 ^= v2;
+        v0 += v3; v3 = rotate(v3, 21); v3 ^= v0;
+        v2 += v1; v1 = rotate(v1, 17); v1 ^= v2; v2 = rotate(v2, 32);
+    };
+    size_t full = size & ~static_cast<size_t>(7);
+    for (size_t k = 0; k < full; k += 8) {
+        uint64_t m = 0;
+        for (int b = 7; b >= 0; --b) m = (m << 8) | data[k + b];
+        v3 ^= m;
+        sipRound();
+        sipRound();
+        v0 ^= m;
+    }
+    uint64_t last = static_cast<uint64_t>(size) << 56;
+    for (size_t k = full; k < size; ++k) last |= static_cast<uint64_t>(data[k]) << (8 * (k - full));
+    v3 ^= last;
+    sipRound();
+    sipRound();
+    v0 ^= last;
+    v2 ^= 0xff;
+    for (int k = 0; k < 4; ++k) sipRound();
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+struct RedactSettings {
+    string mask = "****";
+    bool hashed = false;  // 用 --redact-key 的带密钥散列代替固定掩码
+    string key;
+};
+
+// 逐段处理输入: 匹配之间的原文以指向输入的 iovec 交给 writev, 只有散列记号需要写入缓冲;
+// 匹配按起点排序, 重叠或相邻的匹配 (来自不同预设) 合并为一段
+class Redactor {
+public:
+    Redactor(const CompiledPatternSet& set, const RedactSettings& settings, size_t cacheLimit)
+        : scanner(set, cacheLimit), settings(settings) {
+        const uint8_t* key = reinterpret_cast<const uint8_t*>(settings.key.data());
+        key0 = sipHash(0, 0, key, settings.key.size());
+        key1 = sipHash(1, 0, key, settings.key.size());
+    }
+
+    // 处理 [begin, end); 与 MultiPatternScanner::findAll 的要求相同, end 之前的字节不可消耗 (或 end == size).
+    // 返回前把本段全部写出, 之后调用者可以复用或释放输入
+    bool process(const uint8_t* data, size_t size, size_t begin, size_t end) {
+        spans.clear();
+        scanner.findAll(data, size, begin, end, [&](int, size_t start, size_t stop) {
+            spans.push_back(make_pair(start, stop));
+        });
+        sort(spans.begin(), spans.end());
+        size_t cursor = begin;
+        for (size_t k = 0; k < spans.size();) {
+            size_t start = spans[k].first;
+            size_t stop = spans[k].second;
+            for (++k; k < spans.size() && spans[k].first <= stop; ++k) stop = max(stop, spans[k].second);
+            if (start < cursor) start = cursor;
+            if (!append(data + cursor, start - cursor)) return false;
+            if (!replace(data + start, stop - start)) return false;
+            cursor = stop;
+        }
+        return append(data + cursor, end - cursor) && flush();
+    }
+
+private:
+    static const size_t MAX_VECTORS = 1024;
+    static const size_t TOKEN_LENGTH = 16;
+
+    MultiPatternScanner scanner;
+    const RedactSettings& settings;
+    uint64_t key0 = 0;
+    uint64_t key1 = 0;
+    vector<pair<size_t, size_t>> spans;
+    struct iovec vectors[MAX_VECTORS];
+    size_t vectorCount = 0;
+    char tokens[MAX_VECTORS * TOKEN_LENGTH];  // 散列记号, 每个 iovec 最多一个
+    size_t tokenBytes = 0;
+
+    bool append(const void* data, size_t n) {
+        if (n == 0) return true;
+        if (vectorCount == MAX_VECTORS && !flush()) return false;
+        vectors[vectorCount].iov_base = const_cast<void*>(data);
+        vectors[vectorCount].iov_len = n;
+        ++vectorCount;
+        return true;
+    }
+
+    bool replace(const uint8_t* match, size_t n) {
+        if (!settings.hashed) return append(settings.mask.data(), settings.mask.size());
+        if (vectorCount == MAX_VECTORS && !flush()) return false;
+        uint64_t hash = sipHash(key0, key1, match, n);
+        char* token = tokens + tokenBytes;
+        for (size_t k = 0; k < TOKEN_LENGTH; ++k) token[k] = "0123456789abcdef"[(hash >> (60 - 4 * k)) & 15];
+        tokenBytes += TOKEN_LENGTH;
+        return append(token, TOKEN_LENGTH);
+    }
+
+    // writev 可能只写出一部分, 从断点继续
+    bool flush() {
+        struct iovec* next = vectors;
+        size_t remaining = vectorCount;
+        while (remaining > 0) {
+            ssize_t written = writev(STDOUT_FILENO, next, static_cast<int>(remaining));
+            if (written < 0 && errno == EINTR) continue;
+            if (written < 0) return false;
+            size_t done = static_cast<size_t>(written);
+            while (remaining > 0 && done >= next->iov_len) {
+                done -= next->iov_len;
+                ++next;
+                --remaining;
+            }
+            if (remaining > 0) {
+                next->iov_base = static_cast<char*>(next->iov_base) + done;
+                next->iov_len -= done;
+            }
+        }
+        vectorCount = 0;
+        tokenBytes = 0;
+        return true;
+    }
+};
+
+// 每段的名义大小: 内存占用与文件大小无关
+const size_t REDACT_WINDOW = 1u << 20;
+
+// 普通文件: 按段处理 mmap 的内容, 写出的页随即从常驻内存中释放
+bool redactMapped(Redactor& redactor, MappedFile& file, const ByteSet& consumable) {
+    const uint8_t* data = file.data();
+    size_t size = file.size();
+    size_t begin = 0;
+    while (begin < size) {
+        size_t end = alignChunkBoundary(data, size, min(begin + REDACT_WINDOW, size), consumable);
+        if (!redactor.process(data, size, begin, end)) return false;
+        file.release(end);
+        begin = end;
+    }
+    return true;
+}
+
+// 管道和终端: 分块读入缓冲, 处理到最后一个不可消耗字节为止, 其余 (连同前一个字节作为上下文) 留到下一轮;
+// 只有一段可被匹配消耗的字节长于缓冲时缓冲才会变大
+bool redactStream(Redactor& redactor, int fd, const ByteSet& consumable, string& error) {
+    vector<uint8_t> buffer(REDACT_WINDOW);
+    size_t begin = 0;
+    size_t available = 0;
+    bool eof = false;
+    while (!eof || begin < available) {
+        if (!eof) {
+            if (available == buffer.size()) buffer.resize(buffer.size() * 2);
+            ssize_t n = read(fd, buffer.data() + available, buffer.size() - available);
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0) {
+                error = strerror(errno);
+                return false;
+            }
+            if (n == 0) eof = true;
+            available += static_cast<size_t>(n);
+        }
+        size_t end = available;
+        if (!eof) {
+            // 本段之后至少要留一个字节, 匹配器据此判断段尾的上下文
+            size_t pos = available - 1;
+            while (pos > begin && consumable.has(buffer[pos - 1])) --pos;
+            if (pos <= begin) continue;
+            end = pos;
+        }
+        if (end > begin && !redactor.process(buffer.data(), available, begin, end)) return false;
+        if (eof) break;
+        size_t keep = end - 1;
+        memmove(buffer.data(), buffer.data() + keep, available - keep);
+        available -= keep;
+        begin = 1;
+    }
+    return true;
+}
+
+// 脱敏模式: 依次处理各输入, 结果连续写到标准输出
+int redactMode(const vector<string>& presetNames, const vector<string>& files, const GenerationOptions& options,
+               const ScanSettings& scanSettings, const RedactSettings& settings) {
+    CompiledPatternSet compiled;
+    if (!compilePresetSet(presetNames, options, scanSettings, compiled)) return 2;
+    ByteSet consumable;
+    for (const CompiledPattern& pattern : compiled.patterns) consumable.merge(pattern.consumable);
+
+    vector<string> inputs = files;
+    if (inputs.empty()) inputs.push_back("-");
+    bool anyError = false;
+    for (const string& path : inputs) {
+        Redactor redactor(compiled, settings, scanSettings.dfaCacheLimit);
+        int fd = path == "-" ? 0 : ::open(path.c_str(), O_RDONLY);
+        string error;
+        struct stat info;
+        bool ok;
+        if (fd < 0) {
+            error = strerror(errno);
+            ok = false;
+        } else if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode)) {
+            if (fd != 0) ::close(fd);
+            MappedFile file;
+            ok = file.open(path, error) && redactMapped(redactor, file, consumable);
+        } else {
+            ok = redactStream(redactor, fd, consumable, error);
+            if (fd != 0) ::close(fd);
+        }
+        if (!ok) {
+            // 写出失败 (例如管道已关闭) 时没有必要继续
+            if (error.empty()) return 2;
+            printMessage(cerr, MSG_ERROR_READ_FILE, path, error);
+            anyError = true;
+        }
+    }
+    return anyError ? 2 : 0;
+}
+
+// ReDoS 分析模式: 报告模式在回溯引擎中的最坏复杂度和攻击串
+int analyzeMode(const ParsedPattern& parsed, const GenerationOptions& options) {
+    const string& pattern = parsed.pattern;
+    RedosReport report;
+    string error;
+    if (!analyzeBacktracking(parsed, options, report, error)) {
+        printMessage(cerr, MSG_ERROR_ANALYZE, error);
+        return 2;
+    }
+    cout << msg(MSG_REGULAR_EXPRESSION) << pattern << "\n";
+    cout << msg(MSG_WORST_CASE) << describeRisk(report) << "\n";
+    if (report.risk != RISK_LINEAR) {
+        cout << msg(MSG_CAUSE) << describeCause(pattern, report) << "\n";
+        if (report.verified) {
+            cout << msg(MSG_ATTACK_INPUT) << describeAttack(report.attack) << "\n";
+        } else {
+            cout << msg(MSG_ATTACK_UNVERIFIED) << "\n";
+        }
+        cout << msg(MSG_AFFECTED_ENGINES);
+        cout << msg(MSG_UNAFFECTED_ENGINES);
+    }
+    if (!report.complete) {
+        cout << msg(MSG_ANALYSIS_INCOMPLETE);
+    }
+    return report.risk == RISK_LINEAR ? 0 : 1;
+}
+
+// ============================================================
+// 预设校验 (--validate): 每行一个值, 判断是否合法
+// ============================================================
+
+// 专用校验器先按预设正则的整行匹配形式检查语法 (接受的字符串是 -m 下预设正则所接受的子集),
+// 再做正则表达不了的语义检查: IP 每段不超过 255, 日期的月份和当月天数, 时间的范围, 信用卡的 Luhn 校验.
+// 定长的数字段用 32 位 SWAR 一次检查 4 个字节, 没有逐字节分支
+inline uint32_t loadWord(const uint8_t* p) {
+    uint32_t word;
+    memcpy(&word, p, sizeof(word));
+    return word;
+}
+
+// 4 个字节都是 ASCII 数字: 高半字节为 3, 且低半字节加 6 后不向高半字节进位
+inline bool allDigits(uint32_t word) {
+    return (word & 0xF0F0F0F0u) == 0x30303030u && ((word + 0x06060606u) & 0xF0F0F0F0u) == 0x30303030u;
+}
+
+inline bool isDigitByte(uint8_t c) { return static_cast<uint8_t>(c - '0') < 10; }
+
+inline int twoDigits(const uint8_t* p) { return (p[0] - '0') * 10 + (p[1] - '0'); }
+
+// (\d{1,3}\.){3}\d{1,3}, 每段 0-255
+bool validateIp(const uint8_t* p, size_t n) {
+    size_t i = 0;
+    for (int part = 0; part < 4; ++part) {
+        if (part > 0) {
+            if (i >= n || p[i] != '.') return false;
+            ++i;
+        }
+        size_t begin = i;
+        unsigned value = 0;
+        while (i < n && i - begin < 3 && isDigitByte(p[i])) value = value * 10 + (p[i++] - '0');
+        if (i == begin || value > 255) return false;
+    }
+    return i == n;
+}
+
+// \d{4}-\d{2}-\d{2}, 公历的月份和当月天数 (含闰年)
+bool validateDate(const uint8_t* p, size_t n) {
+    if (n != 10 || p[4] != '-' || p[7] != '-') return false;
+    uint8_t monthDay[4] = {p[5], p[6], p[8], p[9]};
+    if (!allDigits(loadWord(p)) || !allDigits(loadWord(monthDay))) return false;
+    int year = twoDigits(p) * 100 + twoDigits(p + 2);
+    int month = twoDigits(p + 5);
+    int day = twoDigits(p + 8);
+    static const int DAYS[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    if (month < 1 || month > 12 || day < 1) return false;
+    bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    return day <= DAYS[month - 1] + (month == 2 && leap ? 1 : 0);
+}
+
+// \d{2}:\d{2}(:\d{2})?, 00:00 到 23:59:59
+bool validateTime(const uint8_t* p, size_t n) {
+    if ((n != 5 && n != 8) || p[2] != ':') return false;
+    uint8_t hourMinute[4] = {p[0], p[1], p[3], p[4]};
+    if (!allDigits(loadWord(hourMinute)) || twoDigits(p) > 23 || twoDigits(p + 3) > 59) return false;
+    return n == 5 || (p[5] == ':' && isDigitByte(p[6]) && isDigitByte(p[7]) && twoDigits(p + 6) <= 59);
+}
+
+// #?([a-fA-F0-9]{6}|[a-fA-F0-9]{3})
+bool validateHex(const uint8_t* p, size_t n) {
+    if (n > 0 && p[0] == '#') {
+        ++p;
+        --n;
+    }
+    if (n != 3 && n != 6) return false;
+    for (size_t i = 0; i < n; ++i) {
+        uint8_t lower = p[i] | 0x20;
+        if (!isDigitByte(p[i]) && !(lower >= 'a' && lower <= 'f')) return false;
+    }
+    return true;
+}
+
+// \d{4}[- ]?\d{4}[- ]?\d{4}[- ]?\d{4}, 16 位数字满足 Luhn 校验
+bool validateCreditCard(const uint8_t* p, size_t n) {
+    static const int DOUBLED[10] = {0, 2, 4, 6, 8, 1, 3, 5, 7, 9};
+    int sum = 0;
+    size_t i = 0;
+    for (int group = 0; group < 4; ++group) {
+        if (group > 0 && i < n && (p[i] == '-' || p[i] == ' ')) ++i;
+        if (n - i < 4 || !allDigits(loadWord(p + i))) return false;
+        // 从左数第奇数位 (16 位卡号中从右数第偶数位) 加倍
+        sum += DOUBLED[p[i] - '0'] + (p[i + 1] - '0') + DOUBLED[p[i + 2] - '0'] + (p[i + 3] - '0');
+        i += 4;
+    }
+    return i == n && sum % 10 == 0;
+}
+
+// 邮箱的长度限制 (RFC 5321): 整体不超过 254 字节, 本地部分不超过 64 字节, 域名每段 1 到 63 字节;
+// 在预设正则整行匹配之后检查
+bool validateEmailLengths(const uint8_t* p, size_t n) {
+    if (n > 254) return false;
+    const void* at = memchr(p, '@', n);
+    if (at == nullptr) return false;
+    size_t domain = static_cast<size_t>(static_cast<const uint8_t*>(at) - p) + 1;
+    if (domain - 1 > 64) return false;
+    size_t label = 0;
+    for (size_t i = domain; i < n; ++i) {
+        if (p[i] != '.') {
+            if (++label > 63) return false;
+        } else {
+            if (label == 0) return false;
+            label = 0;
+        }
+    }
+    return label != 0;
+}
+
+typedef bool (*PresetValidator)(const uint8_t*, size_t);
+
+PresetValidator presetValidator(const string& preset) {
+    if (preset == "ip") return validateIp;
+    if (preset == "date") return validateDate;
+    if (preset == "time") return validateTime;
+    if (preset == "hex") return validateHex;
+    if (preset == "credit-card") return validateCreditCard;
+    return nullptr;
+}
+
+// 预设正则表达不了、在整行匹配之后再做的检查
+PresetValidator presetRefinement(const string& preset) {
+    if (preset == "email") return validateEmailLengths;
+    return nullptr;
+}
+
+// 逐行校验: 行尾的 \r 不属于值; onLine(行, 长度, 是否合法)
+template <typename Validator, typename Callback>
+void validateLines(const uint8_t* data, size_t size, Validator isValid, Callback onLine) {
+    size_t pos = 0;
+    while (pos < size) {
+        const void* newline = memchr(data + pos, '\n', size - pos);
+        size_t end = newline != nullptr ? static_cast<size_t>(static_cast<const uint8_t*>(newline) - data) : size;
+        size_t length = end - pos;
+        if (length > 0 && data[end - 1] == '\r') --length;
+        onLine(data + pos, length, isValid(data + pos, length));
+        pos = end + 1;
+    }
+}
+
+struct ValidateSettings {
+    bool countOnly = false;
+    bool json = false;
+};
+
+// 校验模式: 默认每行输出 [文件:]valid:值 或 [文件:]invalid:值, --json 时每行输出一个 JSON 对象,
+// --count 只输出数量; 全部合法时返回 0, 有不合法的行时返回 1
+int validateMode(const string& preset, const vector<string>& files, const GenerationOptions& options,
+                 const ValidateSettings& settings) {
+    string presetPattern;
+    if (!regen::presetPattern(preset, presetPattern)) {
+        printMessage(cerr, MSG_ERROR_UNKNOWN_PRESET, preset);
+        return 2;
+    }
+    // 没有专用校验器的预设按整行匹配预设正则, 再做 presetRefinement 的检查
+    PresetValidator specialized = presetValidator(preset);
+    PresetValidator refinement = presetRefinement(preset);
+    CompiledPattern compiled;
+    unique_ptr<PatternScanner> scanner;
+    if (specialized == nullptr) {
+        string error;
+        if (!compilePattern("^(?:" + presetPattern + ")$", options, compiled, error)) {
+            printMessage(cerr, MSG_ERROR_COMPILE, error);
+            return 2;
+        }
+        scanner.reset(new PatternScanner(compiled));
+    }
+    auto isValid = [&](const uint8_t* value, size_t length) {
+        if (specialized != nullptr) return specialized(value, length);
+        bool matched = false;
+        scanner->findAll(value, length, [&](size_t, size_t) { matched = true; });
+        return matched && (refinement == nullptr || refinement(value, length));
+    };
+
+    vector<string> inputs = files;
+    if (inputs.empty()) inputs.push_back("-");
+    bool showFileName = inputs.size() > 1;
+    unsigned long long valid = 0;
+    unsigned long long invalid = 0;
+    bool anyError = false;
+    OutputBuffer out;
+    for (const string& path : inputs) {
+        MappedFile file;
+        string error;
+        if (!file.open(path, error)) {
+            out.flush();
+            printMessage(cerr, MSG_ERROR_READ_FILE, path, error);
+            anyError = true;
+            continue;
+        }
+        validateLines(file.data(), file.size(), isValid, [&](const uint8_t* value, size_t length, bool ok) {
+            ++(ok ? valid : invalid);
+            if (settings.countOnly) return;
+            if (settings.json) {
+                out.put('{');
+                if (showFileName) out.write("\"file\":\"" + jsonEscape(path) + "\",");
+                out.write("\"value\":\"" + jsonEscape(string(reinterpret_cast<const char*>(value), length)) +
+                          (ok ? "\",\"valid\":true}\n" : "\",\"valid\":false}\n"));
+                return;
+            }
+            if (showFileName) {
+                out.write(path);
+                out.put(':');
+            }
+            out.write(ok ? "valid:" : "invalid:", ok ? 6 : 8);
+            out.write(reinterpret_cast<const char*>(value), length);
+            out.put('\n');
+        });
+    }
+    if (settings.countOnly) {
+        if (settings.json) {
+            out.write("{\"preset\":\"" + jsonEscape(preset) + "\",\"valid\":" + to_string(valid) +
+                      ",\"invalid\":" + to_string(invalid) + "}\n");
+        } else {
+            out.write(formatMessage(MSG_VALIDATE_COUNTS, valid, invalid));
+        }
+    }
+    out.flush();
+    if (anyError) return 2;
+    return invalid == 0 ? 0 : 1;
+}
+
+// 快速伪随机数生成器 (splitmix64), 相同种子产生相同序列
+class FastRandom {
+public:
+    explicit FastRandom(uint64_t seed) : state(seed) {}
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    // [0, bound) 内的均匀整数; 一次 64 位抽取拆成几段使用: bound 不超过 256 时每段 16 位
+    // (相对偏差不超过 bound / 65536), 否则每段 32 位
+    uint32_t below(uint32_t bound) {
+        if (bound <= 256) return static_cast<uint32_t>((take(16) * bound) >> 16);
+        return static_cast<uint32_t>((take(32) * bound) >> 32);
+    }
+
+    double unit() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+
+private:
+    uint64_t state;
+    uint64_t pool = 0;  // 当前抽取中尚未使用的位
+    int poolBits = 0;
+
+    uint64_t take(int bits) {
+        if (poolBits < bits) {
+            pool = next();
+            poolBits = 64;
+        }
+        uint64_t value = pool & ((uint64_t(1) << bits) - 1);
+        pool >>= bits;
+        poolBits -= bits;
+        return value;
+    }
+};
+
+// 按语法树随机生成一个能被模式匹配的样本串; 断言不产生字符
+// 构造时把语法树展平成生成指令: 相邻的单字节集合并为字面量, 每个字节集的候选字节预先算好;
+// 生成时直接写入调用者的缓冲区, 调用者先留出 maxLength() 个字节
+class SampleGenerator {
+public:
+    SampleGenerator(const RegexAst& ast, FastRandom& random) : random(random) {
+        bound = saturatingAdd(compile(ast, ast.root), 1);  // 近似串可能多重复一个字节
+        pool.append(LITERAL_SLACK, '\0');
+    }
+
+    // 写样本时需要的空间: 样本 (含近似串) 的最大长度, 加上成组写入时可能越过结尾的字节
+    size_t maxLength() const { return saturatingAdd(bound, LITERAL_SLACK); }
+
+    // 在 out 处写一个样本, 返回样本的结尾
+    char* generate(char* out) { return run(0, ops.size(), out); }
+
+    void generate(string& out) {
+        size_t begin = out.size();
+        out.resize(begin + maxLength());
+        out.resize(generate(&out[begin]) - out.data());
+    }
+
+    // 近似样本: 先生成一个样本, 再替换某个字节为字节集之外的字节, 或删除、重复一个字节.
+    // 结果不一定不匹配 (例如 a* 删掉一个字节仍匹配), 由调用者检查
+    char* generateNearMiss(char* out) {
+        positions.clear();
+        sampleBegin = out;
+        recording = true;
+        char* end = run(0, ops.size(), out);
+        recording = false;
+        size_t length = static_cast<size_t>(end - out);
+        uint32_t kind = random.below(4);
+        if (kind < 2 && !positions.empty()) {
+            const SetPosition& target = positions[random.below(static_cast<uint32_t>(positions.size()))];
+            const string& bytes = outside[target.set];
+            if (!bytes.empty()) {
+                out[target.offset] = bytes[random.below(static_cast<uint32_t>(bytes.size()))];
+                return end;
+            }
+        }
+        if (length == 0) {
+            *end = static_cast<char>('!' + random.below(94));
+            return end + 1;
+        }
+        size_t offset = random.below(static_cast<uint32_t>(length));
+        if (kind == 2) {
+            memmove(out + offset, out + offset + 1, length - offset - 1);
+            return end - 1;
+        }
+        memmove(out + offset + 1, out + offset, length - offset);
+        return end + 1;
+    }
+
+private:
+    enum GenerateOp : uint8_t {
+        GEN_LITERAL,    // 复制 pool[first, first + count), 各字节依次对应字节集 set, set + 1, ...
+        GEN_SET,        // 从 pool[first, first + count) 中随机选一个字节
+        GEN_SET_REPEAT, // 同 GEN_SET, 重复 minRepeat + [0, extraRepeat] 次 (最常见的重复, 不必逐次进入子指令)
+        GEN_CODEPOINT,  // 从 codepoints[first] 中随机选一个码点, 按 UTF-8 写出
+        GEN_REPEAT,     // 把 [下一条, end) 重复 first + [0, count] 次
+        GEN_ALTERNATE   // 执行 branches[first, first + count) 中随机的一个, 然后跳到 end
+    };
+    struct Instruction {
+        GenerateOp kind;
+        uint32_t first;
+        uint32_t count;
+        uint32_t end;
+        uint32_t set;  // 近似串用: 对应的字节集编号 (outside 的下标)
+        uint32_t minRepeat;
+        uint32_t extraRepeat;
+    };
+    struct SetPosition {
+        size_t offset;
+        uint32_t set;
+    };
+
+    // 短字面量和字节集的重复按 LITERAL_SLACK 字节成组写入, 可能越过样本结尾这么多字节
+    static const size_t LITERAL_SLACK = 8;
+
+    FastRandom& random;
+    vector<Instruction> ops;
+    vector<pair<uint32_t, uint32_t>> branches;  // 分支的指令区间
+    string pool;                                // 字面量和字节集候选字节
+    vector<string> outside;                     // 按字节集编号: 字节集之外的候选字节
+    vector<const CodepointRanges*> codepoints;
+    size_t bound = 0;
+    int openLiteral = -1;  // 可以继续追加字节的字面量指令, 结构指令之后不再追加
+    vector<SetPosition> positions;
+    bool recording = false;
+    const char* sampleBegin = nullptr;
+
+    static size_t saturatingAdd(size_t a, size_t b) { return a > SIZE_MAX - b ? SIZE_MAX : a + b; }
+    static size_t saturatingMultiply(size_t a, size_t b) { return b != 0 && a > SIZE_MAX / b ? SIZE_MAX : a * b; }
+
+    uint32_t add(GenerateOp kind, uint32_t first, uint32_t count, uint32_t set = 0) {
+        ops.push_back(Instruction{kind, first, count, 0, set, 0, 0});
+        openLiteral = -1;
+        return static_cast<uint32_t>(ops.size() - 1);
+    }
+
+    // 生成 id 子树的指令, 返回它最多写出的字节数
+    size_t compile(const RegexAst& ast, int id) {
+        const RegexNode& node = ast.node(id);
+        switch (node.type) {
+            case NODE_SET: {
+                uint32_t set = static_cast<uint32_t>(outside.size());
+                ByteSet complement = node.set;
+                complement.invert();
+                // 样本按行输出, 替换用的字节不选换行
+                outside.push_back(candidates(complement));
+                outside.back().erase(remove(outside.back().begin(), outside.back().end(), '\n'), outside.back().end());
+                string bytes = candidates(node.set);
+                if (bytes.empty() && !node.codepoints.empty()) {
+                    add(GEN_CODEPOINT, static_cast<uint32_t>(codepoints.size()), 1, set);
+                    codepoints.push_back(&node.codepoints);
+                    return 4;
+                }
+                if (bytes.empty()) bytes = " ";
+                if (bytes.size() == 1 && openLiteral >= 0) {
+                    ++ops[openLiteral].count;
+                    pool += bytes;
+                    return 1;
+                }
+                uint32_t op = add(bytes.size() == 1 ? GEN_LITERAL : GEN_SET, static_cast<uint32_t>(pool.size()),
+                                  static_cast<uint32_t>(bytes.size()), set);
+                if (bytes.size() == 1) openLiteral = static_cast<int>(op);
+                pool += bytes;
+                return 1;
+            }
+            case NODE_CONCAT:
+            case NODE_GROUP: {
+                size_t total = 0;
+                for (int k = 0; k < node.childCount; ++k) total = saturatingAdd(total, compile(ast, ast.child(node, k)));
+                return total;
+            }
+            case NODE_ALTERNATE: {
+                uint32_t op = add(GEN_ALTERNATE, static_cast<uint32_t>(branches.size()),
+                                  static_cast<uint32_t>(node.childCount));
+                size_t first = branches.size();
+                branches.resize(first + node.childCount);
+                size_t longest = 0;
+                for (int k = 0; k < node.childCount; ++k) {
+                    openLiteral = -1;
+                    branches[first + k].first = static_cast<uint32_t>(ops.size());
+                    longest = max(longest, compile(ast, ast.child(node, k)));
+                    branches[first + k].second = static_cast<uint32_t>(ops.size());
+                }
+                ops[op].end = static_cast<uint32_t>(ops.size());
+                openLiteral = -1;
+                return longest;
+            }
+            case NODE_REPEAT: {
+                int extra = node.maxRepeat < 0 ? 4 : min(node.maxRepeat - node.minRepeat, 8);
+                const RegexNode& child = ast.node(ast.child(node, 0));
+                if (child.type == NODE_SET && (!candidates(child.set).empty() || child.codepoints.empty())) {
+                    openLiteral = -1;
+                    compile(ast, ast.child(node, 0));
+                    Instruction& op = ops.back();
+                    op.kind = GEN_SET_REPEAT;
+                    op.minRepeat = static_cast<uint32_t>(node.minRepeat);
+                    op.extraRepeat = static_cast<uint32_t>(extra);
+                    openLiteral = -1;
+                    return static_cast<size_t>(node.minRepeat + extra);
+                }
+                uint32_t op = add(GEN_REPEAT, static_cast<uint32_t>(node.minRepeat), static_cast<uint32_t>(extra));
+                size_t body = compile(ast, ast.child(node, 0));
+                ops[op].end = static_cast<uint32_t>(ops.size());
+                openLiteral = -1;
+                return saturatingMultiply(body, static_cast<size_t>(node.minRepeat + extra));
+            }
+            default:
+                return 0;
+        }
+    }
+
+    void record(const char* out, uint32_t set) {
+        positions.push_back(SetPosition{static_cast<size_t>(out - sampleBegin), set});
+    }
+
+    char* run(size_t begin, size_t end, char* out) {
+        for (size_t i = begin; i < end;) {
+            const Instruction& op = ops[i];
+            switch (op.kind) {
+                case GEN_LITERAL:
+                    if (recording) {
+                        for (uint32_t k = 0; k < op.count; ++k) record(out + k, op.set + k);
+                    }
+                    if (op.count <= LITERAL_SLACK) {
+                        memcpy(out, pool.data() + op.first, LITERAL_SLACK);  // 定长复制, 编译为一次 8 字节存储
+                    } else {
+                        memcpy(out, pool.data() + op.first, op.count);
+                    }
+                    out += op.count;
+                    ++i;
+                    break;
+                case GEN_SET:
+                    if (recording) record(out, op.set);
+                    *out++ = pool[op.first + random.below(op.count)];
+                    ++i;
+                    break;
+                case GEN_SET_REPEAT: {
+                    // 总是写满最多的 minRepeat + extraRepeat 个字节 (循环次数固定, 不随随机长度而预测失败),
+                    // 再按随机的次数前进; 多写的字节在 maxLength() 之内, 会被后面的指令覆盖或丢弃
+                    uint32_t count = op.minRepeat + (op.extraRepeat == 0 ? 0 : random.below(op.extraRepeat + 1));
+                    fillFromSet(out, pool.data() + op.first, op.count, op.minRepeat + op.extraRepeat);
+                    if (recording) {
+                        for (uint32_t k = 0; k < count; ++k) record(out + k, op.set);
+                    }
+                    out += count;
+                    ++i;
+                    break;
+                }
+                case GEN_CODEPOINT:
+                    if (recording) record(out, op.set);
+                    out = writeCodepoint(out, *codepoints[op.first]);
+                    ++i;
+                    break;
+                case GEN_REPEAT: {
+                    uint32_t count = op.first + (op.count == 0 ? 0 : random.below(op.count + 1));
+                    for (uint32_t k = 0; k < count; ++k) out = run(i + 1, op.end, out);
+                    i = op.end;
+                    break;
+                }
+                case GEN_ALTERNATE: {
+                    const pair<uint32_t, uint32_t>& branch = branches[op.first + random.below(op.count)];
+                    out = run(branch.first, branch.second, out);
+                    i = op.end;
+                    break;
+                }
+            }
+        }
+        return out;
+    }
+
+    // 从 bytes[0, size) (size 不超过 256) 中随机选 count 个字节写到 out; 每次 64 位抽取用作 4 个 16 位随机数
+    void fillFromSet(char* out, const char* bytes, uint32_t size, uint32_t count) {
+        for (uint32_t k = 0; k < count; k += 4) {
+            uint64_t bits = random.next();
+            out[k] = bytes[((bits & 0xffff) * size) >> 16];
+            out[k + 1] = bytes[((bits >> 16 & 0xffff) * size) >> 16];
+            out[k + 2] = bytes[((bits >> 32 & 0xffff) * size) >> 16];
+            out[k + 3] = bytes[((bits >> 48) * size) >> 16];
+        }
+    }
+
+    // 只能匹配非 ASCII 字符的码点集合: 随机选一个码点, 落在代理区时换成最近的可编码码点.
+    // 不内联, run 保持精简
+    __attribute__((noinline)) char* writeCodepoint(char* out, const CodepointRanges& ranges) {
+        const auto& range = ranges[random.below(static_cast<uint32_t>(ranges.size()))];
+        uint32_t codepoint = range.first + random.below(range.second - range.first + 1);
+        if (codepoint >= 0xD800 && codepoint <= 0xDFFF) codepoint = range.second >= 0xE000 ? 0xE000 : 0xD7FF;
+        string encoded;
+        appendUtf8(encoded, codepoint);
+        memcpy(out, encoded.data(), encoded.size());
+        return out + encoded.size();
+    }
+
+    // 优先选择可打印字符, 其次空格, 最后任意字节
+    static string candidates(const ByteSet& set) {
+        string bytes;
+        for (int c = 0x21; c < 0x7f; ++c) {
+            if (set.has(static_cast<uint8_t>(c))) bytes.push_back(static_cast<char>(c));
+        }
+        if (bytes.empty() && set.has(' ')) bytes.push_back(' ');
+        if (bytes.empty()) {
+            for (int c = 0; c < 256; ++c) {
+                if (set.has(static_cast<uint8_t>(c))) bytes.push_back(static_cast<char>(c));
+            }
+        }
+        return bytes;
+    }
+};
+
+// 合成语料: 由 g-z 组成的随机单词行 (不含数字和十六进制字母, 避免偶然匹配预设),
+// density 为含一个植入样本的行所占比例
+string generateCorpus(const RegexAst& ast, size_t bytes, double density, uint64_t seed) {
+    FastRandom random(seed);
+    SampleGenerator generator(ast, random);
+    string corpus;
+    corpus.reserve(bytes + 256);
+    while (corpus.size() < bytes) {
+        int words = 6 + static_cast<int>(random.below(10));
+        int planted = random.unit() < density ? static_cast<int>(random.below(words + 1)) : -1;
+        for (int w = 0; w <= words; ++w) {
+            if (w > 0) corpus.push_back(' ');
+            if (w == planted) {
+                generator.generate(corpus);
+                corpus.push_back(' ');
+            }
+            if (w == words) break;
+            int length = 2 + static_cast<int>(random.below(8));
+            for (int k = 0; k < length; ++k) corpus.push_back(static_cast<char>('g' + random.below(20)));
+        }
+        corpus.push_back('\n');
+    }
+    corpus.resize(bytes);
+    return corpus;
+}
+
+struct BenchSettings {
+    size_t bytes = 4u << 20;
+    double density = 0.1;
+    uint64_t seed = 1;
+    int runs = 3;
+    bool json = false;
+};
+
+struct BenchResult {
+    string name;
+    string engine;
+    size_t matches = 0;
+    double seconds = 0;
+    long peakRssKb = 0;
+    string error;
+};
+
+// 在子进程中运行一次测量, 使峰值内存 (RSS) 只反映该引擎; 子进程通过管道返回结果
+BenchResult measureInChild(const string& name, const string& engine, const function<size_t(string&)>& run,
+                           int runs) {
+    BenchResult result;
+    result.name = name;
+    result.engine = engine;
+    struct Report {
+        uint64_t matches;
+        double seconds;
+        char error[256];
+    };
+    int channel[2];
+    if (pipe(channel) != 0) {
+        result.error = strerror(errno);
+        return result;
+    }
+    fflush(stdout);
+    pid_t child = fork();
+    if (child < 0) {
+        result.error = strerror(errno);
+        ::close(channel[0]);
+        ::close(channel[1]);
+        return result;
+    }
+    if (child == 0) {
+        ::close(channel[0]);
+        Report report;
+        memset(&report, 0, sizeof(report));
+        report.seconds = -1;
+        string error;
+        for (int k = 0; k < runs && error.empty(); ++k) {
+            auto start = chrono::steady_clock::now();
+            size_t matches = run(error);
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            report.matches = matches;
+            if (report.seconds < 0 || seconds < report.seconds) report.seconds = seconds;
+        }
+        snprintf(report.error, sizeof(report.error), "%s", error.c_str());
+        ssize_t written = write(channel[1], &report, sizeof(report));
+        _exit(written == static_cast<ssize_t>(sizeof(report)) ? 0 : 1);
+    }
+    ::close(channel[1]);
+    Report report;
+    size_t received = 0;
+    ssize_t n;
+    while (received < sizeof(report) &&
+           (n = read(channel[0], reinterpret_cast<char*>(&report) + received, sizeof(report) - received)) > 0) {
+        received += static_cast<size_t>(n);
+    }
+    ::close(channel[0]);
+    int status = 0;
+    struct rusage usage;
+    memset(&usage, 0, sizeof(usage));
+    wait4(child, &status, 0, &usage);
+    result.peakRssKb = usage.ru_maxrss;
+    if (received != sizeof(report)) {
+        result.error = WIFSIGNALED(status) ? string("terminated by signal ") + to_string(WTERMSIG(status))
+                                           : string("no result");
+    } else if (report.error[0] != '\0') {
+        result.error = report.error;
+    } else {
+        result.matches = report.matches;
+        result.seconds = report.seconds;
+    }
+    return result;
+}
+
+// 基准测试模式: 为每个模式生成合成语料, 分别测量 regen 引擎和 std::regex
+int benchMode(const vector<pair<string, string>>& namedPatterns, const GenerationOptions& options,
+              const BenchSettings& settings) {
+    vector<BenchResult> results;
+    for (const auto& named : namedPatterns) {
+        const string& pattern = named.second;
+        RegexAst ast;
+        string error;
+        string corpus;
+        bool supported = parseRegex(pattern, options, ast, error) && matcherSupports(ast, error);
+        if (supported) {
+            corpus = generateCorpus(ast, settings.bytes, settings.density, settings.seed);
+        } else {
+            // 引擎不支持的语法仍可以测量 std::regex, 语料中不植入样本
+            RegexAst empty;
+            empty.nodes.push_back(RegexNode());
+            empty.root = 0;
+            corpus = generateCorpus(empty, settings.bytes, 0, settings.seed);
+        }
+        const char* begin = corpus.data();
+        const char* end = corpus.data() + corpus.size();
+
+        results.push_back(measureInChild(named.first, "regen", [&](string& runError) -> size_t {
+            CompiledPattern compiled;
+            if (!supported) {
+                runError = error;
+                return 0;
+            }
+            if (!compilePattern(ast, compiled, runError)) return 0;
+            PatternScanner scanner(compiled);
+            size_t matches = 0;
+            scanner.findAll(reinterpret_cast<const uint8_t*>(begin), corpus.size(),
+                            [&](size_t, size_t) { ++matches; });
+            return matches;
+        }, settings.runs));
+
+        results.push_back(measureInChild(named.first, "std::regex", [&](string& runError) -> size_t {
+            try {
+                auto flags = regex::ECMAScript | regex::optimize;
+                if (options.caseInsensitive) flags |= regex::icase;
+                regex compiled(pattern, flags);
+                size_t matches = 0;
+                for (cregex_iterator it(begin, end, compiled), last; it != last; ++it) ++matches;
+                return matches;
+            } catch (const regex_error& e) {
+                runError = e.what();
+                return 0;
+            }
+        }, settings.runs));
+    }
+
+    if (settings.json) {
+        cout << "{\n  \"corpus\": {\"bytes\": " << settings.bytes << ", \"density\": " << settings.density
+             << ", \"seed\": " << settings.seed << ", \"runs\": " << settings.runs << "},\n  \"results\": [";
+        for (size_t k = 0; k < results.size(); ++k) {
+            const BenchResult& r = results[k];
+            cout << (k == 0 ? "\n" : ",\n") << "    {\"pattern\": \"" << jsonEscape(r.name) << "\", \"engine\": \""
+                 << r.engine << "\", ";
+            if (!r.error.empty()) {
+                cout << "\"error\": \"" << jsonEscape(r.error) << "\", ";
+            } else {
+                double mb = settings.bytes / 1048576.0;
+                cout << "\"matches\": " << r.matches << ", \"seconds\": " << fixed << setprecision(6) << r.seconds
+                     << ", \"mb_per_s\": " << setprecision(2) << (r.seconds > 0 ? mb / r.seconds : 0)
+                     << ", \"matches_per_s\": " << setprecision(0) << (r.seconds > 0 ? r.matches / r.seconds : 0)
+                     << ", ";
+                cout.unsetf(ios::floatfield);
+                cout << setprecision(6);
+            }
+            cout << "\"peak_rss_kb\": " << r.peakRssKb << "}";
+        }
+        cout << "\n  ]\n}\n";
+    } else {
+        char megabytes[32];
+        char density[32];
+        snprintf(megabytes, sizeof(megabytes), "%.1f", settings.bytes / 1048576.0);
+        snprintf(density, sizeof(density), "%.2f", settings.density);
+        printMessage(cout, MSG_BENCH_CORPUS, megabytes, density, settings.seed, settings.runs);
+        cout << padColumn(msg(MSG_COLUMN_PATTERN), 14, true) << padColumn(msg(MSG_COLUMN_ENGINE), 12, true)
+             << padColumn(msg(MSG_COLUMN_MATCHES), 10, false) << padColumn(msg(MSG_COLUMN_TIME), 11, false)
+             << padColumn(msg(MSG_COLUMN_THROUGHPUT), 10, false) << padColumn(msg(MSG_COLUMN_MATCH_RATE), 13, false)
+             << padColumn(msg(MSG_COLUMN_PEAK_RSS), 12, false) << "\n";
+        cout << fixed;
+        for (const BenchResult& r : results) {
+            cout << padColumn(r.name, 14, true) << padColumn(r.engine, 12, true);
+            if (!r.error.empty()) {
+                cout << "  " << msg(MSG_BENCH_FAILED) << r.error << "\n";
+                continue;
+            }
+            double mb = settings.bytes / 1048576.0;
+            cout << setw(10) << r.matches << setw(11) << setprecision(2) << r.seconds * 1000 << setw(10)
+                 << setprecision(1) << (r.seconds > 0 ? mb / r.seconds : 0) << setw(13) << setprecision(0)
+                 << (r.seconds > 0 ? r.matches / r.seconds : 0) << setw(9) << setprecision(1)
+                 << r.peakRssKb / 1024.0 << " MB\n";
+        }
+        cout.unsetf(ios::floatfield);
+    }
+
+    // 两个引擎的匹配数应当一致
+    int status = 0;
+    for (size_t k = 0; k + 1 < results.size(); k += 2) {
+        const BenchResult& ours = results[k];
+        const BenchResult& reference = results[k + 1];
+        if (ours.error.empty() && reference.error.empty() && ours.matches != reference.matches) {
+            printMessage(cerr, MSG_BENCH_MISMATCH, ours.name, ours.matches, reference.matches);
+            status = 1;
+        }
+    }
+    return status;
+}
+
+// ============================================================
+// 资源报告 (--stats): 部署前估计模式的代价, JSON 输出供 CI 按内存预算拒绝模式
+// ============================================================
+
+// 估计回溯代价时假设的输入长度
+const int STATS_INPUT_LENGTH = 100;
+
+string formatEstimate(double value) {
+    char text[32];
+    snprintf(text, sizeof(text), "%.3g", value);
+    return text;
+}
+
+int statsMode(const ParsedPattern& parsed, const GenerationOptions& options, bool json) {
+    PatternStats stats;
+    string error;
+    if (!computePatternStats(parsed, options, stats, error)) {
+        printMessage(cerr, MSG_ERROR_STATS, error);
+        return 2;
+    }
+    const RedosReport& redos = stats.redos;
+    const char* risk = redos.risk == RISK_EXPONENTIAL ? "exponential"
+                       : redos.risk == RISK_POLYNOMIAL ? "polynomial"
+                                                       : "linear";
+    string steps = formatEstimate(backtrackingStepsPerByte(redos, STATS_INPUT_LENGTH));
+    if (json) {
+        const Prefilter& prefilter = stats.prefilter;
+        cout << "{\n  \"pattern\": \"" << jsonEscape(parsed.pattern) << "\",\n  \"ast_nodes\": " << stats.astNodes
+             << ",\n  \"nfa_states\": {\"forward\": " << stats.forwardStates << ", \"reverse\": " << stats.reverseStates
+             << "},\n  \"dfa\": {\"within_budget\": " << (stats.dfaWithinBudget ? "true" : "false")
+             << ", \"budget_states\": " << DENSE_DFA_MAX_STATES;
+        if (stats.dfaWithinBudget) {
+            cout << ", \"search_states\": " << stats.dfaStates[0] << ", \"reverse_states\": " << stats.dfaStates[1]
+                 << ", \"whole_states\": " << stats.dfaStates[2] << ", \"byte_classes\": " << stats.byteClasses
+                 << ", \"table_bytes\": " << stats.tableBytes << ", \"uncompressed_bytes\": " << stats.uncompressedBytes;
+        } else {
+            cout << ", \"error\": \"" << jsonEscape(stats.dfaError) << "\"";
+        }
+        cout << "},\n  \"prefilter\": {\"kind\": \""
+             << (prefilter.kind == PREFILTER_LITERAL ? "literal" : prefilter.kind == PREFILTER_BYTES ? "bytes" : "none")
+             << "\", \"literals\": [";
+        if (prefilter.kind == PREFILTER_LITERAL) cout << "\"" << jsonEscape(prefilter.literal) << "\"";
+        for (int k = 0; prefilter.kind == PREFILTER_BYTES && k < prefilter.byteCount; ++k) {
+            cout << (k ? ", " : "") << "\"" << jsonEscape(string(1, static_cast<char>(prefilter.bytes[k]))) << "\"";
+        }
+        cout << "], \"description\": \"" << jsonEscape(prefilter.describe()) << "\"},\n  \"engine\": {";
+        if (stats.engine == BIT_PARALLEL_OK) {
+            cout << "\"name\": \"lazy-dfa+bit-parallel\", \"positions\": " << stats.positions;
+        } else {
+            cout << "\"name\": \"lazy-dfa\", \"reason\": \"" << jsonEscape(msg(bitParallelReason(stats.engine))) << "\"";
+        }
+        cout << "},\n  \"backtracking\": {";
+        if (stats.redosAnalyzed) {
+            cout << "\"risk\": \"" << risk << "\", \"degree\": " << (redos.risk == RISK_POLYNOMIAL ? redos.degree : 1)
+                 << ", \"steps_per_byte\": \"" << backtrackingStepsFormula(redos) << "\", \"input_bytes\": "
+                 << STATS_INPUT_LENGTH << ", \"estimated_steps_per_byte\": " << steps
+                 << ", \"verified\": " << (redos.verified ? "true" : "false")
+                 << ", \"complete\": " << (redos.complete ? "true" : "false");
+        } else {
+            cout << "\"error\": \"" << jsonEscape(stats.redosError) << "\"";
+        }
+        cout << "}\n}\n";
+    } else {
+        vector<pair<string, string>> rows;
+        rows.emplace_back(msg(MSG_COLUMN_PATTERN), parsed.pattern);
+        rows.emplace_back(msg(MSG_STATS_AST_NODES), to_string(stats.astNodes));
+        rows.emplace_back(msg(MSG_STATS_NFA_STATES),
+                          formatMessage(MSG_STATS_NFA_VALUE, stats.forwardStates, stats.reverseStates));
+        if (stats.dfaWithinBudget) {
+            rows.emplace_back(msg(MSG_STATS_DFA_STATES), formatMessage(MSG_STATS_DFA_VALUE, stats.dfaStates[0],
+                                                                       stats.dfaStates[1], stats.dfaStates[2]));
+            rows.emplace_back(msg(MSG_STATS_TABLES), formatMessage(MSG_STATS_TABLES_VALUE, stats.tableBytes,
+                                                                   stats.byteClasses, stats.uncompressedBytes));
+        } else {
+            rows.emplace_back(msg(MSG_STATS_DFA_STATES), formatMessage(MSG_STATS_EXCEEDS_BUDGET, stats.dfaError));
+            rows.emplace_back(msg(MSG_STATS_TABLES), "-");
+        }
+        rows.emplace_back(msg(MSG_STATS_PREFILTER), stats.prefilter.describe());
+        rows.emplace_back(msg(MSG_COLUMN_ENGINE),
+                          stats.engine == BIT_PARALLEL_OK
+                              ? formatMessage(MSG_STATS_ENGINE_BIT_PARALLEL, stats.positions)
+                              : formatMessage(MSG_STATS_ENGINE_LAZY_DFA, msg(bitParallelReason(stats.engine))));
+        rows.emplace_back(msg(MSG_STATS_BACKTRACKING),
+                          stats.redosAnalyzed ? formatMessage(MSG_STATS_STEPS_VALUE, backtrackingStepsFormula(redos),
+                                                              steps, STATS_INPUT_LENGTH)
+                                              : formatMessage(MSG_STATS_NOT_ANALYZED, stats.redosError));
+        size_t width = 0;
+        for (const auto& row : rows) width = max(width, displayWidth(row.first));
+        for (const auto& row : rows) cout << padColumn(row.first, width + 2, true) << row.second << "\n";
+        if (stats.redosAnalyzed && !redos.complete) cout << msg(MSG_ANALYSIS_INCOMPLETE);
+    }
+    return stats.dfaWithinBudget ? 0 : 1;
+}
+
+// ============================================================
+// 语言比较 (--equiv、--subset): 判断两个模式是否等价或包含, 不成立时给出最短的区分串
+// ============================================================
+
+// 带引号的字节串: 不可打印的字节和非 ASCII 字节写成 \xHH
+string quoteBytes(const string& text) {
+    string quoted = "\"";
+    for (unsigned char c : text) {
+        if (c == '"' || c == '\\') {
+            quoted.push_back('\\');
+            quoted.push_back(static_cast<char>(c));
+        } else if (c == '\n') {
+            quoted += "\\n";
+        } else if (c == '\t') {
+            quoted += "\\t";
+        } else if (c >= 0x20 && c < 0x7f) {
+            quoted.push_back(static_cast<char>(c));
+        } else {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\x%02x", c);
+            quoted += escaped;
+        }
+    }
+    return quoted + "\"";
+}
+
+// 成立返回 0, 不成立返回 1, 错误返回 2
+int compareMode(const string& first, const string& second, bool subset, const GenerationOptions& options, bool json) {
+    ParsedPattern parsedFirst, parsedSecond;
+    parseForMatching(first, options, parsedFirst);
+    parseForMatching(second, options, parsedSecond);
+    LanguageComparison result;
+    string error;
+    if (!compareLanguages(parsedFirst, parsedSecond, subset, result, error)) {
+        printMessage(cerr, MSG_ERROR_COMPARE, error);
+        return 2;
+    }
+    if (json) {
+        cout << "{\"relation\": \"" << (subset ? "subset" : "equivalent") << "\", \"holds\": "
+             << (result.holds ? "true" : "false");
+        if (!result.holds) {
+            // witness 是转义后的可读形式 (不含引号), witness_hex 是原始字节
+            string quoted = quoteBytes(result.witness);
+            cout << ", \"witness\": \"" << jsonEscape(quoted.substr(1, quoted.size() - 2)) << "\", \"witness_hex\": \"";
+            for (unsigned char c : result.witness) cout << hex << setw(2) << setfill('0') << static_cast<int>(c) << dec;
+            cout << "\", \"matched_by\": \"" << (result.witnessInFirst ? "first" : "second") << "\"";
+        }
+        cout << "}\n";
+    } else if (result.holds) {
+        cout << msg(subset ? MSG_SUBSET_HOLDS : MSG_EQUIV_HOLDS);
+    } else {
+        cout << msg(subset ? MSG_SUBSET_FAILS : MSG_EQUIV_FAILS);
+        printMessage(cout, result.witnessInFirst ? MSG_WITNESS_FIRST : MSG_WITNESS_SECOND, quoteBytes(result.witness));
+    }
+    return result.holds ? 0 : 1;
+}
+
+// ============================================================
+// 样本生成 (--generate): 输出随机的匹配串或近似串, 用于压力测试和模糊测试
+// ============================================================
+
+struct GenerateSettings {
+    unsigned long long count = 0;
+    bool negative = false;
+    uint64_t seed = 1;
+    size_t threads = 1;
+};
+
+// 每块样本由块号和种子决定随机序列, 输出与线程数无关, 相同种子得到相同结果
+const size_t GENERATE_BLOCK_SAMPLES = 1 << 16;
+
+// 每个线程独立的生成器; 样本用整串匹配的程序检查: 近似串必须不匹配,
+// 模式含断言时 (生成器不为断言产生字符) 匹配串也要检查
+class SampleWorker {
+public:
+    SampleWorker(const RegexAst& ast, const CompiledPattern& whole, bool checkPositive)
+        : ast(ast), checker(whole.forward, false), checkPositive(checkPositive) {}
+
+    // 生成一块样本追加到 output, 每个一行 (含换行的样本不要); 连续多次得不到合格样本时返回 false.
+    // 样本直接写在 output 的末尾, 不合格时原地覆盖
+    bool generateBlock(uint64_t seed, size_t block, size_t count, bool negative, string& output) {
+        FastRandom random(FastRandom(seed + block).next());
+        SampleGenerator generator(ast, random);
+        const int attempts = 64;
+        size_t room = generator.maxLength() + 1;  // 加上换行
+        size_t used = output.size();
+        for (size_t k = 0; k < count; ++k) {
+            if (output.size() - used < room) output.resize(max(output.size() * 2, used + room));
+            char* begin = &output[used];
+            char* end;
+            int attempt = 0;
+            for (;; ++attempt) {
+                if (attempt == attempts) {
+                    output.resize(used);
+                    return false;
+                }
+                end = negative ? generator.generateNearMiss(begin) : generator.generate(begin);
+                size_t length = static_cast<size_t>(end - begin);
+                if (memchr(begin, '\n', length) != nullptr) continue;
+                if (negative ? !matchesWhole(begin, length) : !checkPositive || matchesWhole(begin, length)) break;
+            }
+            *end = '\n';
+            used = static_cast<size_t>(end + 1 - output.data());
+        }
+        output.resize(used);
+        return true;
+    }
+
+private:
+    const RegexAst& ast;
+    LazyDfa checker;  // \A(?:模式)\z 的正向程序, 从锚定起点读完样本即可判断, 不需要查找匹配边界
+    bool checkPositive;
+
+    bool matchesWhole(const char* sample, size_t length) {
+        int state = checker.startState(checker.edgeContext(), true);
+        for (size_t k = 0; k < length; ++k) {
+            uint8_t byte = static_cast<uint8_t>(sample[k]);
+            int32_t next = checker.transitions()[(static_cast<size_t>(state) << checker.classShift()) |
+                                                  checker.byteClasses()[byte]];
+            if (next == LazyDfa::UNKNOWN) next = checker.computeNext(state, byte);
+            state = next & ~LazyDfa::SPECIAL;
+            if (state == LazyDfa::DEAD) return false;
+        }
+        return checker.matchesAtEnd(state);
+    }
+};
+
+// 生成模式: 输出 count 行样本; 多线程时各块并行生成, 按块号顺序输出
+int generateMode(const string& pattern, const GenerationOptions& options, const GenerateSettings& settings) {
+    ParsedPattern parsed;
+    parseForMatching(pattern, options, parsed);
+    CompiledPattern whole;
+    string error = parsed.error;
+    if (!parsed.valid() || !matcherSupports(parsed.ast, error) ||
+        !compilePattern("\\A(?:" + pattern + ")\\z", options, whole, error)) {
+        printMessage(cerr, MSG_ERROR_COMPILE, error);
+        return 2;
+    }
+    bool hasAssertion = false;
+    for (const RegexNode& node : parsed.ast.nodes) hasAssertion = hasAssertion || node.type == NODE_ASSERT;
+
+    size_t blocks = static_cast<size_t>((settings.count + GENERATE_BLOCK_SAMPLES - 1) / GENERATE_BLOCK_SAMPLES);
+    size_t threads = max<size_t>(settings.threads, 1);
+    vector<unique_ptr<SampleWorker>> workers;
+    for (size_t k = 0; k < threads; ++k) {
+        workers.push_back(unique_ptr<SampleWorker>(new SampleWorker(parsed.ast, whole, hasAssertion)));
+    }
+    vector<string> results(blocks);
+    atomic<bool> failed(false);
+    auto execute = [&](SampleWorker& worker, size_t block) {
+        if (failed) return;
+        size_t count = block + 1 == blocks ? static_cast<size_t>(settings.count - block * GENERATE_BLOCK_SAMPLES)
+                                           : GENERATE_BLOCK_SAMPLES;
+        if (!worker.generateBlock(settings.seed, block, count, settings.negative, results[block])) failed = true;
+    };
+
+    OutputBuffer out;
+    auto emit = [&](size_t block) {
+        if (!failed) out.write(results[block]);
+        string().swap(results[block]);
+    };
+    if (threads == 1) {
+        for (size_t block = 0; block < blocks; ++block) {
+            execute(*workers[0], block);
+            emit(block);
+        }
+    } else {
+        vector<char> done(blocks, 0);
+        mutex lock;
+        condition_variable blockDone;
+        condition_variable windowMoved;
+        size_t written = 0;
+        const size_t window = threads * 4;  // 限制已生成但尚未输出的块数
+        WorkStealingPool pool(threads);
+        thread generating([&]() {
+            pool.run(blocks, [&](size_t worker, size_t block) {
+                {
+                    unique_lock<mutex> guard(lock);
+                    windowMoved.wait(guard, [&]() { return block < written + window; });
+                }
+                execute(*workers[worker], block);
+                lock_guard<mutex> guard(lock);
+                done[block] = 1;
+                blockDone.notify_all();
+            });
+        });
+        for (size_t block = 0; block < blocks; ++block) {
+            {
+                unique_lock<mutex> guard(lock);
+                blockDone.wait(guard, [&]() { return done[block] != 0; });
+            }
+            emit(block);
+            lock_guard<mutex> guard(lock);
+            written = block + 1;
+            windowMoved.notify_all();
+        }
+        generating.join();
+    }
+    out.flush();
+    if (failed) {
+        printMessage(cerr, settings.negative ? MSG_GENERATE_NO_NEAR_MISS : MSG_GENERATE_NO_SAMPLE, pattern);
+        return 2;
+    }
+    return 0;
+}
+
+// ============================================================
+// 批处理模式: 每行一个任务, 结果以 NDJSON 流式输出
+// ============================================================
+
+// 把任务行拆成参数: 空白分隔, 单引号内原样保留, 双引号内只有 \" 和 \\ 是转义;
+// 引号外的反斜杠原样保留, 方便直接书写 \d 之类的模式
+bool splitJobLine(const string& line, vector<string>& tokens, string& error) {
+    tokens.clear();
+    size_t i = 0;
+    while (true) {
+        while (i < line.size() && isspace(static_cast<unsigned char>(line[i]))) ++i;
+        if (i >= line.size()) return true;
+        string token;
+        while (i < line.size() && !isspace(static_cast<unsigned char>(line[i]))) {
+            char quote = line[i];
+            if (quote != '\'' && quote != '"') {
+                token.push_back(line[i++]);
+                continue;
+            }
+            ++i;
+            while (i < line.size() && line[i] != quote) {
+                if (quote == '"' && line[i] == '\\' && i + 1 < line.size() &&
+                    (line[i + 1] == '"' || line[i + 1] == '\\')) {
+                    ++i;
+                }
+                token.push_back(line[i++]);
+            }
+            if (i >= line.size()) {
+                error = string("unterminated ") + quote + " quote";
+                return false;
+            }
+            ++i;
+        }
+        tokens.push_back(token);
+    }
+}
+
+// 单个任务: 模式或预设, 以及覆盖命令行默认值的选项
+struct BatchJob {
+    GenerationOptions options;
+    string pattern;
+    string preset;
+    string description;
+};
+
+// 展开预设并应用整行匹配, 得到任务最终的模式
+bool resolveBatchJob(BatchJob& job, string& error) {
+    if (!job.preset.empty()) {
+        if (!regen::presetPattern(job.preset, job.pattern)) {
+            error = "unknown preset pattern '" + job.preset + "'";
+            return false;
+        }
+    }
+    if (job.options.matchWholeLine) job.pattern = "^" + job.pattern + "$";
+    return true;
+}
+
+bool parseBatchJob(const vector<string>& tokens, BatchJob& job, string& error) {
+    vector<string> positional;
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        const string& token = tokens[i];
+        if (token == "-m" || token == "--match-whole") {
+            job.options.matchWholeLine = true;
+        } else if (token == "-i" || token == "--case-insensitive") {
+            job.options.caseInsensitive = true;
+        } else if (token == "--multiline") {
+            job.options.multiline = true;
+        } else if (token == "--dotall") {
+            job.options.dotAll = true;
+        } else if (token == "--utf8" || token == "--bytes") {
+            job.options.utf8 = token == "--utf8";
+        } else if (token == "-e" || token == "--explain") {
+            job.options.outputExplanation = true;
+        } else if (token == "--optimize") {
+            job.options.optimize = true;
+        } else if (token == "-p" || token == "--preset" || token == "-f" || token == "--format") {
+            if (i + 1 >= tokens.size()) {
+                error = token + " requires an argument";
+                return false;
+            }
+            const string& value = tokens[++i];
+            if (token == "-p" || token == "--preset") {
+                job.preset = value;
+            } else if (value == "regex") {
+                job.options.outputFormat = "regex";
+                job.options.language.clear();
+            } else {
+                job.options.outputFormat = "code";
+                job.options.language = value;
+            }
+        } else if (token.size() > 1 && token[0] == '-') {
+            // 以 - 开头的模式或描述需要写在 -- 之后
+            if (token != "--") {
+                error = "unknown option " + token;
+                return false;
+            }
+            positional.insert(positional.end(), tokens.begin() + i + 1, tokens.end());
+            break;
+        } else {
+            positional.push_back(token);
+        }
+    }
+    size_t next = 0;
+    if (job.preset.empty()) {
+        if (positional.empty()) {
+            error = "regular expression pattern is required";
+            return false;
+        }
+        job.pattern = positional[next++];
+    }
+    if (next < positional.size()) job.description = positional[next++];
+    if (next < positional.size()) {
+        error = "unexpected argument " + positional[next];
+        return false;
+    }
+    return resolveBatchJob(job, error);
+}
+
+// 向输出写入 ,"key":"value"
+template <typename Output>
+void writeJsonField(Output& out, const char* key, const string& value) {
+    out.write(",\"", 2);
+    out.write(key, strlen(key));
+    out.write("\":\"", 3);
+    out.write(jsonEscape(value));
+    out.put('"');
+}
+
+// 同一模式生成过的解释和各语言代码; 代码片段含回溯风险分析, 重复的模式不再重新生成
+struct JobOutputs {
+    bool explained = false;
+    string explanation;
+    map<string, string> code;  // 按语言
+};
+
+// 写出任务结果的字段: 模式、解析错误以及按选项生成的解释和代码
+template <typename Output>
+void writeJobResult(Output& out, const BatchJob& job, const ParsedPattern& parsed, const string& original,
+                    JobOutputs& outputs) {
+    if (!job.preset.empty()) writeJsonField(out, "preset", job.preset);
+    writeJsonField(out, "pattern", parsed.pattern);
+    if (parsed.pattern != original) writeJsonField(out, "original", original);
+    if (!job.description.empty()) writeJsonField(out, "description", job.description);
+    if (!parsed.valid()) writeJsonField(out, "parse_error", parsed.error);
+    if (job.options.outputExplanation) {
+        if (!outputs.explained) {
+            outputs.explanation = generateExplanation(parsed) + generateMatcherReport(parsed);
+            outputs.explained = true;
+        }
+        writeJsonField(out, "explanation", outputs.explanation);
+    }
+    if (job.options.outputFormat == "code" && !job.options.language.empty()) {
+        auto code = outputs.code.find(job.options.language);
+        if (code == outputs.code.end()) {
+            string snippet = generateCodeSnippet(parsed, parsed.pattern, job.options.language, job.options);
+            code = outputs.code.insert(make_pair(job.options.language, snippet)).first;
+        }
+        writeJsonField(out, "language", job.options.language);
+        writeJsonField(out, "code", code->second);
+    }
+}
+
+// 按模式和影响语义的选项缓存解析 (和优化) 结果, 超出个数容量或字节预算时淘汰最久未用的模式.
+// Entry 需要有 parsed、bytes 和 position 成员; bytes 由调用方通过 account 更新
+template <typename Entry>
+class PatternCache {
+public:
+    explicit PatternCache(size_t capacity, size_t byteLimit = SIZE_MAX) : capacity(capacity), byteLimit(byteLimit) {}
+
+    // 记录 entry 当前占用的字节数, 总量超出预算时淘汰其他最久未用的模式 (entry 本身保留)
+    void account(Entry& entry, size_t bytes) {
+        totalBytes = totalBytes - entry.bytes + bytes;
+        entry.bytes = bytes;
+        while (totalBytes > byteLimit && order.size() > 1 && &entry != entries[order.back()].get()) evictOldest();
+    }
+
+    Entry& lookup(const string& pattern, const GenerationOptions& options) {
+        string key;
+        key.push_back(static_cast<char>('0' + (options.caseInsensitive ? 1 : 0) + (options.multiline ? 2 : 0) +
+                                        (options.dotAll ? 4 : 0) + (options.optimize ? 8 : 0) +
+                                        (options.utf8 ? 16 : 0)));
+        key += pattern;
+        auto found = entries.find(key);
+        if (found != entries.end()) {
+            Entry& entry = *found->second;
+            order.splice(order.begin(), order, entry.position);
+            return entry;
+        }
+        if (entries.size() >= capacity) evictOldest();
+        unique_ptr<Entry> entry(new Entry());
+        parsePattern(pattern, options, entry->parsed);
+        if (options.optimize) {
+            ParsedPattern optimized;
+            optimizePattern(entry->parsed, options, optimized);
+            swap(entry->parsed, optimized);
+        }
+        order.push_front(key);
+        entry->position = order.begin();
+        Entry& result = *entry;
+        entries[key] = move(entry);
+        return result;
+    }
+
+private:
+    size_t capacity;
+    size_t byteLimit;
+    size_t totalBytes = 0;
+    list<string> order;  // 最近使用的在前
+    unordered_map<string, unique_ptr<Entry>> entries;
+
+    void evictOldest() {
+        auto oldest = entries.find(order.back());
+        totalBytes -= oldest->second->bytes;
+        entries.erase(oldest);
+        order.pop_back();
+    }
+};
+
+// 批处理中重复出现的模式
+struct BatchCacheEntry {
+    ParsedPattern parsed;
+    JobOutputs outputs;
+    size_t bytes = 0;  // 不按字节计算, 只受个数容量限制
+    list<string>::iterator position;
+};
+typedef PatternCache<BatchCacheEntry> BatchCache;
+
+// 处理一行任务, 输出一行 JSON; 成功返回 true
+bool runBatchJob(const string& line, size_t lineNumber, const GenerationOptions& defaults, BatchCache& cache,
+                 OutputBuffer& out) {
+    out.write("{\"line\":", 8);
+    out.writeNumber(lineNumber);
+    vector<string> tokens;
+    string error;
+    BatchJob job;
+    job.options = defaults;
+    BatchCacheEntry* entry;
+    {
+        ProfileScope scope(PHASE_PARSE, "parse job", 0, line.size());
+        if (!splitJobLine(line, tokens, error) || !parseBatchJob(tokens, job, error)) {
+            writeJsonField(out, "error", error);
+            out.write("}\n", 2);
+            return false;
+        }
+        entry = &cache.lookup(job.pattern, job.options);
+    }
+    ProfileScope scope(PHASE_OUTPUT, "format result");
+    writeJobResult(out, job, entry->parsed, job.pattern, entry->outputs);
+    out.write("}\n", 2);
+    return true;
+}
+
+// 批处理缓存的模式数; 重复的模式 (同一预设、同一规则集) 只解析和分析一次
+const size_t BATCH_CACHE_CAPACITY = 4096;
+
+// 逐块读取任务并处理其中的完整行; 每块处理完后刷新输出, 管道输入也能及时得到结果
+int batchMode(const string& path, const GenerationOptions& defaults) {
+    int fd = path == "-" ? STDIN_FILENO : open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        printMessage(cerr, MSG_ERROR_READ_FILE, path, strerror(errno));
+        return 2;
+    }
+    OutputBuffer out(stdout);
+    vector<char> chunk(1 << 16);
+    string pending;
+    size_t lineNumber = 0;
+    bool allSucceeded = true;
+    BatchCache cache(BATCH_CACHE_CAPACITY);
+    auto runLine = [&](const string& line) {
+        ++lineNumber;
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == string::npos || line[first] == '#') return;
+        string job = line;
+        if (!job.empty() && job.back() == '\r') job.pop_back();
+        allSucceeded = runBatchJob(job, lineNumber, defaults, cache, out) && allSucceeded;
+    };
+    while (true) {
+        ssize_t n;
+        {
+            ProfileScope scope(PHASE_INPUT, "read");
+            n = read(fd, chunk.data(), chunk.size());
+            scope.setBytes(n > 0 ? static_cast<uint64_t>(n) : 0);
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        pending.append(chunk.data(), static_cast<size_t>(n));
+        size_t begin = 0;
+        size_t newline;
+        while ((newline = pending.find('\n', begin)) != string::npos) {
+            runLine(pending.substr(begin, newline - begin));
+            begin = newline + 1;
+        }
+        pending.erase(0, begin);
+        ProfileScope scope(PHASE_OUTPUT, "flush");
+        out.flush();
+    }
+    if (!pending.empty()) runLine(pending);
+    if (fd != STDIN_FILENO) close(fd);
+    out.flush();
+    return allSucceeded ? 0 : 1;
+}
+
+// ============================================================
+// 守护进程模式: 常驻在 Unix 套接字上, 每行一个 JSON 请求, 每行一个 JSON 响应
+// ============================================================
+
+// 请求中的标量值: 字符串已解码, 数字、true/false/null 保留原文
+struct JsonValue {
+    bool isString = false;
+    string text;
+};
+
+// 解析只含标量值的单层 JSON 对象
+class FlatJsonParser {
+public:
+    explicit FlatJsonParser(const string& text) : text(text) {}
+
+    bool parse(map<string, JsonValue>& fields, string& error) {
+        skipSpace();
+        if (!consume('{')) return fail("expected '{'", error);
+        skipSpace();
+        if (consume('}')) return finish(error);
+        while (true) {
+            string key;
+            skipSpace();
+            if (!parseString(key, error)) return false;
+            skipSpace();
+            if (!consume(':')) return fail("expected ':'", error);
+            skipSpace();
+            JsonValue value;
+            if (pos < text.size() && text[pos] == '"') {
+                value.isString = true;
+                if (!parseString(value.text, error)) return false;
+            } else if (!parseScalar(value.text, error)) {
+                return false;
+            }
+            fields[key] = value;
+            skipSpace();
+            if (consume('}')) return finish(error);
+            if (!consume(',')) return fail("expected ',' or '}'", error);
+        }
+    }
+
+private:
+    const string& text;
+    size_t pos = 0;
+
+    bool fail(const char* message, string& error) {
+        error = string(message) + " at position " + to_string(pos);
+        return false;
+    }
+
+    bool finish(string& error) {
+        skipSpace();
+        return pos == text.size() || fail("unexpected trailing characters", error);
+    }
+
+    void skipSpace() {
+        while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\r' || text[pos] == '\n')) {
+            ++pos;
+        }
+    }
+
+    bool consume(char c) {
+        if (pos >= text.size() || text[pos] != c) return false;
+        ++pos;
+        return true;
+    }
+
+    // 数字和字面量只检查字符范围, 嵌套的对象和数组不支持
+    bool parseScalar(string& out, string& error) {
+        size_t begin = pos;
+        while (pos < text.size() && (isalnum(static_cast<unsigned char>(text[pos])) || text[pos] == '-' ||
+                                     text[pos] == '+' || text[pos] == '.')) {
+            ++pos;
+        }
+        out = text.substr(begin, pos - begin);
+        if (out.empty()) return fail("expected a string, number or literal", error);
+        return true;
+    }
+
+    bool parseHex4(unsigned& value) {
+        if (pos + 4 > text.size()) return false;
+        value = 0;
+        for (int k = 0; k < 4; ++k) {
+            char c = text[pos++];
+            value <<= 4;
+            if (c >= '0' && c <= '9') {
+                value |= c - '0';
+            } else if (c >= 'a' && c <= 'f') {
+                value |= c - 'a' + 10;
+            } else if (c >= 'A' && c <= 'F') {
+                value |= c - 'A' + 10;
+            } else {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static void appendUtf8(string& out, unsigned code) {
+        if (code < 0x80) {
+            out.push_back(static_cast<char>(code));
+        } else if (code < 0x800) {
+            out.push_back(static_cast<char>(0xc0 | (code >> 6)));
+            out.push_back(static_cast<char>(0x80 | (code & 0x3f)));
+        } else if (code < 0x10000) {
+            out.push_back(static_cast<char>(0xe0 | (code >> 12)));
+            out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3f)));
+            out.push_back(static_cast<char>(0x80 | (code & 0x3f)));
+        } else {
+            out.push_back(static_cast<char>(0xf0 | (code >> 18)));
+            out.push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3f)));
+            out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3f)));
+            out.push_back(static_cast<char>(0x80 | (code & 0x3f)));
+        }
+    }
+
+    bool parseString(string& out, string& error) {
+        if (!consume('"')) return fail("expected a string", error);
+        while (pos < text.size() && text[pos] != '"') {
+            char c = text[pos++];
+            if (c != '\\') {
+                out.push_back(c);
+                continue;
+            }
+            if (pos >= text.size()) break;
+            char escape = text[pos++];
+            switch (escape) {
+                case '"': case '\\': case '/': out.push_back(escape); break;
+                case 'b': out.push_back('\b'); break;
+                case 'f': out.push_back('\f'); break;
+                case 'n': out.push_back('\n'); break;
+                case 'r': out.push_back('\r'); break;
+                case 't': out.push_back('\t'); break;
+                case 'u': {
+                    unsigned code;
+                    if (!parseHex4(code)) return fail("invalid \\u escape", error);
+                    // 代理对合并为一个码点
+                    unsigned low;
+                    if (code >= 0xd800 && code < 0xdc00 && pos + 1 < text.size() && text[pos] == '\\' &&
+                        text[pos + 1] == 'u') {
+                        pos += 2;
+                        if (!parseHex4(low) || low < 0xdc00 || low >= 0xe000) {
+                            return fail("invalid surrogate pair", error);
+                        }
+                        code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+                    }
+                    appendUtf8(out, code);
+                    break;
+                }
+                default:
+                    --pos;
+                    return fail("invalid escape", error);
+            }
+        }
+        if (!consume('"')) return fail("unterminated string", error);
+        return true;
+    }
+};
+
+// 守护进程的限制: 请求在事件循环线程上同步处理, 限制模式和文本的长度使单个请求的耗时有界;
+// 常驻模式的总内存 (含各自惰性 DFA 的缓存) 超出预算时淘汰最久未用的
+const size_t SERVE_MAX_PATTERN = 64 << 10;
+const size_t SERVE_MAX_TEXT = 1 << 20;
+const size_t SERVE_CACHE_CAPACITY = 256;
+const size_t SERVE_CACHE_BYTES = 256u << 20;
+
+// 一个请求: 与批处理任务相同的生成选项, 可附带要匹配的文本
+struct ServeRequest {
+    BatchJob job;
+    string id = "null";  // 原样写回响应的 JSON 值
+    bool match = false;
+    string text;
+};
+
+bool parseServeRequest(const string& line, ServeRequest& request, string& error) {
+    map<string, JsonValue> fields;
+    FlatJsonParser parser(line);
+    if (!parser.parse(fields, error)) return false;
+    GenerationOptions& options = request.job.options;
+    const pair<const char*, bool*> flags[] = {
+        {"match_whole", &options.matchWholeLine}, {"case_insensitive", &options.caseInsensitive},
+        {"multiline", &options.multiline},        {"dotall", &options.dotAll},
+        {"explain", &options.outputExplanation},  {"optimize", &options.optimize},
+        {"utf8", &options.utf8},
+    };
+    // 先取出 id, 出错的响应也能对应到请求
+    auto id = fields.find("id");
+    if (id != fields.end()) {
+        request.id = id->second.isString ? "\"" + jsonEscape(id->second.text) + "\"" : id->second.text;
+        fields.erase(id);
+    }
+    bool hasPattern = false;
+    for (const auto& field : fields) {
+        const string& key = field.first;
+        const JsonValue& value = field.second;
+        bool* flag = nullptr;
+        for (const auto& candidate : flags) {
+            if (key == candidate.first) flag = candidate.second;
+        }
+        if (flag != nullptr) {
+            if (value.isString || (value.text != "true" && value.text != "false")) {
+                error = "field " + key + " must be true or false";
+                return false;
+            }
+            *flag = value.text == "true";
+            continue;
+        }
+        if (key != "pattern" && key != "preset" && key != "description" && key != "language" && key != "text") {
+            error = "unknown field " + key;
+            return false;
+        }
+        if (!value.isString) {
+            error = "field " + key + " must be a string";
+            return false;
+        }
+        if (key == "pattern") {
+            request.job.pattern = value.text;
+            hasPattern = true;
+        } else if (key == "preset") {
+            request.job.preset = value.text;
+        } else if (key == "description") {
+            request.job.description = value.text;
+        } else if (key == "language") {
+            options.outputFormat = value.text == "regex" ? "regex" : "code";
+            options.language = value.text == "regex" ? "" : value.text;
+        } else {
+            request.match = true;
+            request.text = value.text;
+        }
+    }
+    if (!hasPattern && request.job.preset.empty()) {
+        error = "regular expression pattern is required";
+        return false;
+    }
+    if (request.text.size() > SERVE_MAX_TEXT) {
+        error = "text exceeds " + to_string(SERVE_MAX_TEXT) + " bytes";
+        return false;
+    }
+    if (!resolveBatchJob(request.job, error)) return false;
+    if (request.job.pattern.size() > SERVE_MAX_PATTERN) {
+        error = "pattern exceeds " + to_string(SERVE_MAX_PATTERN) + " bytes";
+        return false;
+    }
+    return true;
+}
+
+// 常驻的模式: 解析 (和优化) 结果、生成的输出, 以及第一次匹配时编译的自动机
+struct ServeCacheEntry {
+    ParsedPattern parsed;
+    JobOutputs outputs;
+    bool compiled = false;
+    string compileError;
+    CompiledPattern program;
+    unique_ptr<PatternScanner> scanner;  // 惰性 DFA 的状态在请求之间保留
+    size_t bytes = 0;
+    list<string>::iterator position;
+
+    // 估计的内存占用: 语法树、生成的输出、编译的程序和惰性 DFA 当前的缓存
+    size_t memoryUsage() const {
+        size_t total = sizeof(*this) + parsed.pattern.size() + parsed.ast.nodes.size() * sizeof(RegexNode) +
+                       parsed.ast.children.size() * sizeof(int) + outputs.explanation.size();
+        for (const auto& code : outputs.code) total += code.first.size() + code.second.size();
+        for (const RegexProgram* compiled : {&program.forward, &program.reverse}) {
+            total += compiled->states.size() * sizeof(NfaState) + compiled->sets.size() * sizeof(ByteSet);
+        }
+        if (scanner) total += sizeof(PatternScanner) + scanner->memoryUsage();
+        return total;
+    }
+};
+typedef PatternCache<ServeCacheEntry> ServeCache;
+
+// 连接上待发送的响应, 写入接口与 OutputBuffer 相同
+class ResponseBuffer {
+public:
+    void write(const char* data, size_t n) { pending.append(data, n); }
+    void write(const string& text) { pending += text; }
+    void put(char c) { pending.push_back(c); }
+
+    void writeNumber(unsigned long long value) {
+        char digits[24];
+        write(digits, snprintf(digits, sizeof(digits), "%llu", value));
+    }
+
+    bool empty() const { return sent == pending.size(); }
+    size_t size() const { return pending.size() - sent; }
+
+    // 尽量写出, 返回 false 表示连接已断开
+    bool send(int fd) {
+        while (sent < pending.size()) {
+            ssize_t n = ::send(fd, pending.data() + sent, pending.size() - sent, MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return errno == EAGAIN || errno == EWOULDBLOCK;
+            }
+            sent += static_cast<size_t>(n);
+        }
+        pending.clear();
+        sent = 0;
+        return true;
+    }
+
+private:
+    string pending;
+    size_t sent = 0;
+};
+
+// 处理一个请求, 向 out 写入一行 JSON 响应
+void handleServeRequest(const string& line, const GenerationOptions& defaults, size_t dfaCacheLimit, ServeCache& cache,
+                        ResponseBuffer& out) {
+    ServeRequest request;
+    request.job.options = defaults;
+    string error;
+    bool valid = parseServeRequest(line, request, error);
+    out.write("{\"id\":", 6);
+    out.write(request.id);
+    if (!valid) {
+        writeJsonField(out, "error", error);
+        out.write("}\n", 2);
+        return;
+    }
+    ServeCacheEntry& entry = cache.lookup(request.job.pattern, request.job.options);
+    writeJobResult(out, request.job, entry.parsed, request.job.pattern, entry.outputs);
+    if (request.match && entry.parsed.valid()) {
+        if (!entry.compiled) {
+            entry.compiled = true;
+            if (compilePattern(entry.parsed.ast, entry.program, entry.compileError)) {
+                entry.scanner.reset(new PatternScanner(entry.program, dfaCacheLimit));
+            }
+        }
+        if (!entry.scanner) {
+            writeJsonField(out, "match_error", entry.compileError);
+        } else {
+            // 每个匹配输出为 [偏移, 长度]
+            out.write(",\"matches\":[", 12);
+            bool first = true;
+            const uint8_t* data = reinterpret_cast<const uint8_t*>(request.text.data());
+            entry.scanner->findAll(data, request.text.size(), [&](size_t start, size_t end) {
+                if (!first) out.put(',');
+                first = false;
+                out.put('[');
+                out.writeNumber(start);
+                out.put(',');
+                out.writeNumber(end - start);
+                out.put(']');
+            });
+            out.put(']');
+        }
+    }
+    out.write("}\n", 2);
+    cache.account(entry, entry.memoryUsage());
+}
+
+// 一个客户端连接: 累积请求行, 缓冲未写出的响应
+class ServeConnection {
+public:
+    static const size_t MAX_REQUEST = 16 << 20;
+    static const size_t MAX_PENDING = 4 << 20;  // 客户端不读取响应时暂停读取它的请求
+
+    explicit ServeConnection(int fd) : fd(fd) {}
+    ~ServeConnection() { close(fd); }
+
+    // 读取一块数据并处理其中的完整请求行
+    void receive(vector<char>& chunk, const GenerationOptions& defaults, size_t dfaCacheLimit, ServeCache& cache) {
+        ssize_t n = read(fd, chunk.data(), chunk.size());
+        if (n < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) broken = true;
+            return;
+        }
+        if (n == 0) {
+            // 对端关闭写入: 处理最后一个没有换行的请求, 发完响应后关闭
+            if (input.find_first_not_of(" \t\r") != string::npos) handleServeRequest(input, defaults, dfaCacheLimit, cache, output);
+            input.clear();
+            closing = true;
+            return;
+        }
+        input.append(chunk.data(), static_cast<size_t>(n));
+        size_t begin = 0;
+        size_t newline;
+        while ((newline = input.find('\n', begin)) != string::npos) {
+            string line = input.substr(begin, newline - begin);
+            begin = newline + 1;
+            if (line.find_first_not_of(" \t\r") != string::npos) handleServeRequest(line, defaults, dfaCacheLimit, cache, output);
+        }
+        input.erase(0, begin);
+        if (input.size() > MAX_REQUEST) {
+            output.write("{\"id\":null", 10);
+            writeJsonField(output, "error", "request too large");
+            output.write("}\n", 2);
+            input.clear();
+            closing = true;
+        }
+    }
+
+    void send() {
+        if (!output.send(fd)) broken = true;
+    }
+
+    bool finished() const { return broken || (closing && output.empty()); }
+
+    // 需要关注的事件; 与当前注册的不同时更新 epoll
+    void updateInterest(int epollFd) {
+        uint32_t wanted = 0;
+        if (!closing && output.size() < MAX_PENDING) wanted |= EPOLLIN;
+        if (!output.empty()) wanted |= EPOLLOUT;
+        if (wanted == registered) return;
+        epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = wanted;
+        event.data.fd = fd;
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &event);
+        registered = wanted;
+    }
+
+private:
+    int fd;
+    string input;
+    ResponseBuffer output;
+    bool closing = false;
+    bool broken = false;
+    uint32_t registered = EPOLLIN;
+};
+
+// 监听套接字 (权限 0600); 上次异常退出留下的套接字文件会被替换, 仍有进程在监听时报错
+int listenOnSocket(const string& path, string& error) {
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        error = strerror(ENAMETOOLONG);
+        return -1;
+    }
+    memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    sockaddr* raw = reinterpret_cast<sockaddr*>(&address);
+    struct stat info;
+    if (lstat(path.c_str(), &info) == 0 && S_ISSOCK(info.st_mode)) {
+        int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        bool inUse = probe >= 0 && connect(probe, raw, sizeof(address)) == 0;
+        if (probe >= 0) close(probe);
+        if (inUse) {
+            error = strerror(EADDRINUSE);
+            return -1;
+        }
+        unlink(path.c_str());
+    }
+    // 套接字文件只允许属主读写 (0600): 在 bind 时用 umask 设定, 不存在先按默认权限创建再修改的窗口
+    int listener = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    mode_t previousMask = umask(0177);
+    bool bound = listener >= 0 && bind(listener, raw, sizeof(address)) == 0;
+    int bindError = errno;
+    umask(previousMask);
+    if (!bound || listen(listener, SOMAXCONN) < 0) {
+        error = strerror(bound ? errno : bindError);
+        if (listener >= 0) close(listener);
+        return -1;
+    }
+    return listener;
+}
+
+// 单线程 epoll 事件循环; SIGINT/SIGTERM 经 signalfd 进入循环, 退出时删除套接字文件
+int serveMode(const string& path, const GenerationOptions& defaults, size_t dfaCacheLimit) {
+    string error;
+    int listener = listenOnSocket(path, error);
+    if (listener < 0) {
+        printMessage(cerr, MSG_ERROR_LISTEN, path, error);
+        return 2;
+    }
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    sigprocmask(SIG_BLOCK, &signals, nullptr);
+    int signalFd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    int epollFd = epoll_create1(EPOLL_CLOEXEC);
+    auto watch = [&](int fd) {
+        epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+    };
+    watch(listener);
+    watch(signalFd);
+    printMessage(cerr, MSG_SERVE_READY, path);
+
+    ServeCache cache(SERVE_CACHE_CAPACITY, SERVE_CACHE_BYTES);
+    unordered_map<int, unique_ptr<ServeConnection>> connections;
+    vector<char> chunk(1 << 16);
+    epoll_event events[64];
+    bool running = true;
+    while (running) {
+        int ready = epoll_wait(epollFd, events, 64, -1);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        for (int k = 0; k < ready && running; ++k) {
+            int fd = events[k].data.fd;
+            if (fd == signalFd) {
+                running = false;
+            } else if (fd == listener) {
+                int client;
+                while ((client = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+                    connections[client].reset(new ServeConnection(client));
+                    watch(client);
+                }
+            } else {
+                auto found = connections.find(fd);
+                if (found == connections.end()) continue;
+                ServeConnection& connection = *found->second;
+                if (events[k].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) connection.receive(chunk, defaults, dfaCacheLimit, cache);
+                connection.send();
+                if (connection.finished()) {
+                    epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+                    connections.erase(found);
+                } else {
+                    connection.updateInterest(epollFd);
+                }
+            }
+        }
+    }
+    connections.clear();
+    close(listener);
+    unlink(path.c_str());
+    close(signalFd);
+    close(epollFd);
+    return 0;
+}
+
+// 命令行选项中影响模式语义的部分
+regen::Options publicOptions(const GenerationOptions& options) {
+    regen::Options result;
+    result.matchWholeLine = options.matchWholeLine;
+    result.caseInsensitive = options.caseInsensitive;
+    result.multiline = options.multiline;
+    result.dotAll = options.dotAll;
+    result.optimize = options.optimize;
+    result.utf8 = options.utf8;
+    return result;
+}
+
+// 输出生成结果: 模式、优化前后的大小、描述、解释和代码片段
+void printGeneratedResult(const regen::Pattern& generated, const GenerationOptions& options,
+                          const string& description) {
+    cout << msg(MSG_GENERATED_RESULT) << msg(MSG_RULE);
+    cout << msg(MSG_REGULAR_EXPRESSION) << generated.pattern() << "\n";
+    if (options.optimize) {
+        cout << msg(MSG_OPTIMIZED) << describeOptimization(generated.original(), generated.pattern(), options) << "\n";
+    }
+    if (!description.empty()) {
+        cout << msg(MSG_DESCRIPTION) << description << "\n";
+    }
+    
+    if (options.outputExplanation) {
+        cout << "\n" << generated.explain() << "\n";
+    }
+    
+    if (options.outputFormat == "code" && !options.language.empty()) {
+        string code = generated.code(options.language);
+        if (!code.empty()) {
+            cout << "\n" << code << "\n";
+        }
+    }
+    
+    cout << msg(MSG_RULE);
+}
+
+// ============================================================
+// 模式学习 (--learn): 从正例和反例归纳出接受所有正例、拒绝所有反例的模式
+// ============================================================
+
+// 样本按字节切成片段: 分隔字节各自成段, 空白和其余字节 (单词) 各取连续段.
+// 片段种类的序列 (形状) 相同的正例归为一组, 组内逐个片段对齐, 统计出现的字节和长度.
+// 每组从最一般的写法开始, 只要还接受某个同形状的反例, 就把最能排除反例的片段收紧一级:
+//   级别 0: 所见字符类别的完整类 (\d、[a-z]、\w 等), 长度都相同时为 {n}, 否则为 +
+//   级别 1: 同一个类, 长度限定为出现过的长度
+//   级别 2: 只含实际出现过的字节, 长度同上
+//   级别 3: 所有正例在此处的文本都相同时, 写成字面量
+// 单词类、空白类和分隔字节互不相交, 所以形状不同的反例不可能被该组接受,
+// 检查只在同形状的反例中进行, 并且收紧只会缩小语言, 每一步只需复查仍被接受的反例.
+// 收紧到底仍不能区分时, 该组按片段长度细分, 再不行则退化为正例文本的分支.
+// 分隔字节有三种选法: 所有标点 (形状最细); 只取每个正例都含有的标点; 只取在每个正例中出现次数都相同的标点
+// (锚点, 例如 email 的 @). 后两种把其余标点并入单词段: 分隔字节不同的正例 (a.b@c.d 与 a@c.d.e) 形状相同,
+// 按对齐的片段合并字符类和长度, 而不是各成一个分支. 三种都学习一遍, 取最短的结果
+enum LearnSegmentKind {
+    SEGMENT_WORD,
+    SEGMENT_SPACE,
+    SEGMENT_BYTE
+};
+
+struct LearnSample {
+    const uint8_t* data;
+    size_t size;
+};
+
+// 一次学习的输入; lastOnly 中的字节只在它于样本中最后一次出现的位置作为分隔字节 (例如域名的最后一个点)
+struct LearnInput {
+    const vector<LearnSample>& positives;
+    const vector<LearnSample>& negatives;
+    ByteSet delimiters;
+    ByteSet lastOnly;
+};
+
+inline bool isLearnSpace(uint8_t c) { return c == ' ' || (c >= '\t' && c <= '\r'); }
+
+// 切分样本, 输出各片段的 [起点, 终点); 返回形状 (单词段为 'w', 空白段为 's', 分隔字节为 'b' + 该字节)
+string segmentSample(const LearnSample& sample, const LearnInput& input, vector<pair<size_t, size_t>>& segments) {
+    // lastOnly 的字节: 从后向前找出各自最后一次出现的位置
+    vector<size_t> lastPositions;
+    if (input.lastOnly.count() != 0) {
+        ByteSet pending = input.lastOnly;
+        for (size_t pos = sample.size; pos-- > 0 && pending.count() != 0;) {
+            if (pending.has(sample.data[pos])) {
+                pending.remove(sample.data[pos]);
+                lastPositions.push_back(pos);
+            }
+        }
+    }
+    auto kindAt = [&](size_t pos) {
+        uint8_t c = sample.data[pos];
+        if (isLearnSpace(c)) return SEGMENT_SPACE;
+        if (input.delimiters.has(c)) return SEGMENT_BYTE;
+        if (input.lastOnly.has(c) && find(lastPositions.begin(), lastPositions.end(), pos) != lastPositions.end()) {
+            return SEGMENT_BYTE;
+        }
+        return SEGMENT_WORD;
+    };
+
+    string shape;
+    segments.clear();
+    size_t pos = 0;
+    while (pos < sample.size) {
+        LearnSegmentKind kind = kindAt(pos);
+        size_t end = pos + 1;
+        if (kind == SEGMENT_BYTE) {
+            shape.push_back('b');
+            shape.push_back(static_cast<char>(sample.data[pos]));
+        } else {
+            while (end < sample.size && kindAt(end) == kind) ++end;
+            shape.push_back(kind == SEGMENT_WORD ? 'w' : 's');
+        }
+        segments.push_back(make_pair(pos, end));
+        pos = end;
+    }
+    return shape;
+}
+
+// 形状中各片段的种类
+vector<LearnSegmentKind> shapeKinds(const string& shape) {
+    vector<LearnSegmentKind> kinds;
+    for (size_t k = 0; k < shape.size(); ++k) {
+        if (shape[k] == 'b') {
+            kinds.push_back(SEGMENT_BYTE);
+            ++k;
+        } else {
+            kinds.push_back(shape[k] == 'w' ? SEGMENT_WORD : SEGMENT_SPACE);
+        }
+    }
+    return kinds;
+}
+
+struct LearnSegment {
+    LearnSegmentKind kind = SEGMENT_BYTE;
+    ByteSet seen;         // 正例在此处出现过的字节
+    ByteSet general;      // 级别 0 和 1 的类
+    set<size_t> lengths;  // 正例在此处出现过的长度
+    string literal;       // 第一个正例的文本
+    bool uniform = true;  // 所有正例的文本都与 literal 相同
+    int level = 0;
+
+    int maxLevel() const { return kind == SEGMENT_BYTE ? 0 : uniform ? 3 : 2; }
+
+    bool accepts(int atLevel, const uint8_t* text, size_t length) const {
+        if (kind == SEGMENT_BYTE || atLevel == 3) {
+            return length == literal.size() && memcmp(text, literal.data(), length) == 0;
+        }
+        if ((atLevel > 0 || lengths.size() == 1) && lengths.count(length) == 0) return false;
+        const ByteSet& allowed = atLevel == 2 ? seen : general;
+        for (size_t k = 0; k < length; ++k) {
+            if (!allowed.has(text[k])) return false;
+        }
+        return true;
+    }
+
+    // 长度集合按连续段写成量词, 不连续时写成各段的分支
+    string format() const {
+        if (kind == SEGMENT_BYTE || level == 3) {
+            string out;
+            for (unsigned char c : literal) out += formatRegexByte(c, false);
+            return out;
+        }
+        string atom = formatByteSet(level == 2 ? seen : general, GenerationOptions(), ALL_SHORTHANDS);
+        if (level == 0 && lengths.size() > 1) return atom + "+";
+        vector<string> runs;
+        for (auto it = lengths.begin(); it != lengths.end();) {
+            int low = static_cast<int>(*it);
+            int high = low;
+            while (++it != lengths.end() && static_cast<int>(*it) == high + 1) ++high;
+            runs.push_back(atom + (low == 1 && high == 1 ? string() : formatQuantifier(low, high, true)));
+        }
+        if (runs.size() == 1) return runs[0];
+        string out = "(?:";
+        for (size_t k = runs.size(); k-- > 0;) out += runs[k] + (k > 0 ? "|" : ")");
+        return out;
+    }
+};
+
+struct LearnGroup {
+    vector<size_t> positives;
+    vector<size_t> negatives;
+    vector<LearnSegment> segments;
+    vector<string> branches;  // 学到的分支 (正例文本分支可能有多个)
+    string conflict;          // 同时出现在正例和反例中的样本
+    size_t rejectedPositives = 0;  // 引擎复核的结果, 正常情况下都为 0
+    size_t acceptedNegatives = 0;
+};
+
+// 单词段的一般类: 出现过的字符类别 (数字、小写、大写、下划线) 的并集, 加上出现过的标点
+ByteSet generalWordClass(const ByteSet& seen) {
+    ByteSet general;
+    for (int c = 0; c < 256; ++c) {
+        if (seen.has(static_cast<uint8_t>(c)) && !isalnum(c)) general.add(static_cast<uint8_t>(c));
+    }
+    const pair<char, char> ranges[] = {{'0', '9'}, {'a', 'z'}, {'A', 'Z'}, {'_', '_'}};
+    for (const auto& range : ranges) {
+        for (int c = range.first; c <= range.second; ++c) {
+            if (seen.has(static_cast<uint8_t>(c))) {
+                general.addRange(static_cast<uint8_t>(range.first), static_cast<uint8_t>(range.second));
+                break;
+            }
+        }
+    }
+    return general;
+}
+
+// 各片段的长度, 用于把一组再按长度细分
+vector<size_t> segmentLengths(const vector<pair<size_t, size_t>>& spans) {
+    vector<size_t> lengths;
+    for (const auto& span : spans) lengths.push_back(span.second - span.first);
+    return lengths;
+}
+
+// 用匹配引擎复核归纳出的分支: 只需检查本组的正例和同形状的反例
+void verifyLearnedBranch(const string& branch, LearnGroup& group, const LearnInput& input) {
+    CompiledPattern compiled;
+    string error;
+    if (!compilePattern("\\A" + branch + "\\z", GenerationOptions(), compiled, error)) {
+        group.rejectedPositives += group.positives.size();
+        return;
+    }
+    PatternScanner scanner(compiled);
+    auto matches = [&](const LearnSample& sample) {
+        bool matched = false;
+        scanner.findAll(sample.data, sample.size, [&](size_t, size_t) { matched = true; });
+        return matched;
+    };
+    for (size_t index : group.positives) group.rejectedPositives += matches(input.positives[index]) ? 0 : 1;
+    for (size_t index : group.negatives) group.acceptedNegatives += matches(input.negatives[index]) ? 1 : 0;
+}
+
+// 学习一组: 统计片段, 再逐级收紧直到不接受任何同形状的反例.
+// 收紧到底仍不能区分时, 先按各片段的长度细分 (处理长度之间的关联, 例如 3 位或 6 位的颜色值), 最后退化为正例文本
+void learnGroup(LearnGroup& group, const LearnInput& input, bool split) {
+    const vector<LearnSample>& positives = input.positives;
+    const vector<LearnSample>& negatives = input.negatives;
+    vector<pair<size_t, size_t>> spans;
+    for (size_t index : group.positives) {
+        const LearnSample& sample = positives[index];
+        string shape = segmentSample(sample, input, spans);
+        if (group.segments.empty()) {
+            vector<LearnSegmentKind> kinds = shapeKinds(shape);
+            group.segments.resize(spans.size());
+            for (size_t s = 0; s < spans.size(); ++s) {
+                group.segments[s].kind = kinds[s];
+                group.segments[s].literal.assign(reinterpret_cast<const char*>(sample.data) + spans[s].first,
+                                                 spans[s].second - spans[s].first);
+            }
+        }
+        for (size_t s = 0; s < spans.size(); ++s) {
+            LearnSegment& segment = group.segments[s];
+            const uint8_t* text = sample.data + spans[s].first;
+            size_t length = spans[s].second - spans[s].first;
+            for (size_t k = 0; k < length; ++k) segment.seen.add(text[k]);
+            segment.lengths.insert(length);
+            if (segment.uniform && (length != segment.literal.size() || memcmp(text, segment.literal.data(), length) != 0)) {
+                segment.uniform = false;
+            }
+        }
+    }
+    for (LearnSegment& segment : group.segments) {
+        segment.general = segment.kind == SEGMENT_WORD ? generalWordClass(segment.seen) : segment.seen;
+    }
+
+    // 仍被接受的反例及其片段
+    struct Accepted {
+        size_t index;
+        vector<pair<size_t, size_t>> spans;
+    };
+    vector<Accepted> accepted;
+    for (size_t index : group.negatives) {
+        Accepted candidate;
+        candidate.index = index;
+        segmentSample(negatives[index], input, candidate.spans);
+        accepted.push_back(move(candidate));
+    }
+    auto segmentAccepts = [&](const Accepted& negative, size_t s, int level) {
+        const pair<size_t, size_t>& span = negative.spans[s];
+        return group.segments[s].accepts(level, negatives[negative.index].data + span.first, span.second - span.first);
+    };
+    auto groupAccepts = [&](const Accepted& negative) {
+        for (size_t s = 0; s < group.segments.size(); ++s) {
+            if (!segmentAccepts(negative, s, group.segments[s].level)) return false;
+        }
+        return true;
+    };
+    accepted.erase(remove_if(accepted.begin(), accepted.end(), [&](const Accepted& n) { return !groupAccepts(n); }),
+                   accepted.end());
+
+    while (!accepted.empty()) {
+        // 选排除反例最多的一步; 数量相同时选收紧幅度小的
+        size_t bestSegment = 0;
+        int bestLevel = -1;
+        size_t bestRejected = 0;
+        for (size_t s = 0; s < group.segments.size(); ++s) {
+            const LearnSegment& segment = group.segments[s];
+            for (int level = segment.level + 1; level <= segment.maxLevel(); ++level) {
+                size_t rejected = 0;
+                for (const Accepted& negative : accepted) rejected += segmentAccepts(negative, s, level) ? 0 : 1;
+                if (rejected > bestRejected ||
+                    (rejected == bestRejected && rejected > 0 &&
+                     level - segment.level < bestLevel - group.segments[bestSegment].level)) {
+                    bestSegment = s;
+                    bestLevel = level;
+                    bestRejected = rejected;
+                }
+            }
+        }
+        if (bestRejected == 0) break;
+        group.segments[bestSegment].level = bestLevel;
+        accepted.erase(remove_if(accepted.begin(), accepted.end(),
+                                 [&](const Accepted& n) { return !segmentAccepts(n, bestSegment, bestLevel); }),
+                       accepted.end());
+    }
+
+    if (accepted.empty()) {
+        string branch;
+        for (const LearnSegment& segment : group.segments) branch += segment.format();
+        verifyLearnedBranch(branch, group, input);
+        group.branches.push_back(branch);
+        return;
+    }
+
+    if (split) {
+        map<vector<size_t>, LearnGroup> byLengths;
+        for (size_t index : group.positives) {
+            segmentSample(positives[index], input, spans);
+            byLengths[segmentLengths(spans)].positives.push_back(index);
+        }
+        if (byLengths.size() > 1) {
+            // 长度不同的反例必然被拒绝, 每个子组只需检查长度相同的反例
+            for (size_t index : group.negatives) {
+                segmentSample(negatives[index], input, spans);
+                auto found = byLengths.find(segmentLengths(spans));
+                if (found != byLengths.end()) found->second.negatives.push_back(index);
+            }
+            for (auto& entry : byLengths) {
+                LearnGroup& part = entry.second;
+                learnGroup(part, input, false);
+                if (!part.conflict.empty()) {
+                    group.conflict = part.conflict;
+                    return;
+                }
+                group.branches.insert(group.branches.end(), part.branches.begin(), part.branches.end());
+                group.rejectedPositives += part.rejectedPositives;
+                group.acceptedNegatives += part.acceptedNegatives;
+            }
+            return;
+        }
+    }
+
+    // 片段级的写法区分不了: 退化为正例文本的分支 (按文本比较, 不需要复核)
+    set<string> texts;
+    for (size_t index : group.positives) {
+        texts.insert(string(reinterpret_cast<const char*>(positives[index].data), positives[index].size));
+    }
+    for (const Accepted& negative : accepted) {
+        string text(reinterpret_cast<const char*>(negatives[negative.index].data), negatives[negative.index].size);
+        if (texts.count(text) != 0) {
+            group.conflict = text;
+            return;
+        }
+    }
+    for (const string& text : texts) {
+        string branch;
+        for (unsigned char c : text) branch += formatRegexByte(c, false);
+        group.branches.push_back(branch);
+    }
+}
+
+// 读入样本文件的非空行 (去掉行尾的 \r)
+bool readLearnSamples(const string& path, MappedFile& file, vector<LearnSample>& samples) {
+    string error;
+    if (!file.open(path, error)) {
+        printMessage(cerr, MSG_ERROR_READ_FILE, path, error);
+        return false;
+    }
+    const uint8_t* data = file.data();
+    size_t size = file.size();
+    size_t pos = 0;
+    while (pos < size) {
+        const void* newline = memchr(data + pos, '\n', size - pos);
+        size_t end = newline != nullptr ? static_cast<size_t>(static_cast<const uint8_t*>(newline) - data) : size;
+        size_t length = end - pos;
+        if (length > 0 && data[end - 1] == '\r') --length;
+        if (length > 0) samples.push_back(LearnSample{data + pos, length});
+        pos = end + 1;
+    }
+    return true;
+}
+
+struct LearnResult {
+    size_t branches = 0;
+    string conflict;
+    size_t rejectedPositives = 0;
+    size_t acceptedNegatives = 0;
+};
+
+// 按一种分隔字节学习: 按形状分组, 各组并行学习, 正例多的组的分支排在前面
+string learnPattern(const LearnInput& input, size_t threads, LearnResult& result) {
+    vector<pair<size_t, size_t>> spans;
+    unordered_map<string, size_t> groupByShape;
+    vector<LearnGroup> groups;
+    for (size_t k = 0; k < input.positives.size(); ++k) {
+        auto inserted =
+            groupByShape.insert(make_pair(segmentSample(input.positives[k], input, spans), groups.size()));
+        if (inserted.second) groups.push_back(LearnGroup());
+        groups[inserted.first->second].positives.push_back(k);
+    }
+    for (size_t k = 0; k < input.negatives.size(); ++k) {
+        auto found = groupByShape.find(segmentSample(input.negatives[k], input, spans));
+        if (found != groupByShape.end()) groups[found->second].negatives.push_back(k);
+    }
+
+    // 各组互不影响
+    if (threads > 1 && groups.size() > 1) {
+        WorkStealingPool pool(threads);
+        pool.run(groups.size(), [&](size_t, size_t g) { learnGroup(groups[g], input, true); });
+    } else {
+        for (LearnGroup& group : groups) learnGroup(group, input, true);
+    }
+
+    vector<size_t> order(groups.size());
+    for (size_t g = 0; g < groups.size(); ++g) order[g] = g;
+    stable_sort(order.begin(), order.end(),
+                [&](size_t a, size_t b) { return groups[a].positives.size() > groups[b].positives.size(); });
+    string pattern;
+    for (size_t g : order) {
+        if (!groups[g].conflict.empty()) {
+            result.conflict = groups[g].conflict;
+            return string();
+        }
+        result.rejectedPositives += groups[g].rejectedPositives;
+        result.acceptedNegatives += groups[g].acceptedNegatives;
+        for (const string& branch : groups[g].branches) {
+            if (result.branches++ > 0) pattern += "|";
+            pattern += branch;
+        }
+    }
+    return result.branches > 1 ? "(?:" + pattern + ")" : pattern;
+}
+
+// 学习模式: 归纳出模式后按直接模式输出 (解释、代码生成等选项照常生效), 模式总是整行匹配
+int learnMode(const string& positivePath, const string& negativePath, GenerationOptions options, size_t threads) {
+    MappedFile positiveFile, negativeFile;
+    vector<LearnSample> positives, negatives;
+    if (!readLearnSamples(positivePath, positiveFile, positives)) return 2;
+    if (!negativePath.empty() && !readLearnSamples(negativePath, negativeFile, negatives)) return 2;
+    if (positives.empty()) {
+        printMessage(cerr, MSG_LEARN_NO_POSITIVES, positivePath);
+        return 2;
+    }
+
+    // 分隔字节: 所有标点, 每个正例都含有的标点, 或每个正例中出现次数都相同的标点 (锚点, 例如 '@')
+    LearnInput fine{positives, negatives, ByteSet(), ByteSet()};
+    for (int c = 0; c < 256; ++c) {
+        if (!isWordByte(c) && !isLearnSpace(static_cast<uint8_t>(c))) fine.delimiters.add(static_cast<uint8_t>(c));
+    }
+    LearnInput coarse{positives, negatives, fine.delimiters, ByteSet()};
+    LearnInput anchored{positives, negatives, fine.delimiters, ByteSet()};
+    vector<size_t> firstCounts;
+    for (const LearnSample& sample : positives) {
+        vector<size_t> counts(256, 0);
+        for (size_t k = 0; k < sample.size; ++k) ++counts[sample.data[k]];
+        if (firstCounts.empty()) firstCounts = counts;
+        for (int c = 0; c < 256; ++c) {
+            if (counts[c] == 0) coarse.delimiters.remove(static_cast<uint8_t>(c));
+            if (counts[c] == 0 || counts[c] != firstCounts[c]) anchored.delimiters.remove(static_cast<uint8_t>(c));
+        }
+    }
+
+    // 锚点之外每个正例都含有的标点只在最后一次出现处分隔, 例如邮箱里顶级域名前的点
+    LearnInput trailing{positives, negatives, anchored.delimiters, coarse.delimiters};
+    for (int c = 0; c < 256; ++c) {
+        if (anchored.delimiters.has(static_cast<uint8_t>(c))) trailing.lastOnly.remove(static_cast<uint8_t>(c));
+    }
+
+    LearnResult result;
+    string pattern = learnPattern(fine, threads, result);
+    const LearnInput* coarser[] = {&coarse, &anchored, &trailing};
+    for (size_t k = 0; k < 3 && result.conflict.empty(); ++k) {
+        if (k == 0 && coarse.delimiters == fine.delimiters) continue;
+        if (k == 1 && anchored.delimiters == coarse.delimiters) continue;
+        if (k == 2 && trailing.lastOnly.count() == 0) continue;
+        LearnResult coarseResult;
+        string coarsePattern = learnPattern(*coarser[k], threads, coarseResult);
+        if (coarsePattern.size() < pattern.size()) {
+            pattern = coarsePattern;
+            result = coarseResult;
+        }
+    }
+    if (!result.conflict.empty()) {
+        printMessage(cerr, MSG_LEARN_CONFLICT, result.conflict);
+        return 2;
+    }
+    if (result.rejectedPositives != 0 || result.acceptedNegatives != 0) {
+        printMessage(cerr, MSG_LEARN_VERIFY_FAILED, result.rejectedPositives, result.acceptedNegatives);
+        return 2;
+    }
+
+    options.matchWholeLine = true;
+    regen::Pattern learned(pattern, publicOptions(options));
+    printGeneratedResult(learned, options,
+                         formatMessage(MSG_LEARN_DESCRIPTION, positives.size(), negatives.size(), result.branches));
+    return 0;
+}
+
+// ============================================================
+// 词表模式 (--from-wordlist): 把大量字面量合成为前缀、后缀共享的模式
+// ============================================================
+
+// 单词先插入字典树, 节点放在同一个数组 (节点池) 中, 子节点以兄弟链表相连, 每个字节的插入是常数时间.
+// 再自底向上最小化为 DAWG: 结束标记和出边 (字节, 目标) 相同的节点合并为同一个状态, 用散列表登记.
+// 输出时同一状态指向同一目标的出边合并为字符类 (cat|bat -> [bc]at), 共享的后缀只保留一份结构
+struct WordTrieNode {
+    int firstChild = -1;
+    int nextSibling = -1;
+    uint8_t byte = 0;
+    bool final = false;
+};
+
+class WordlistBuilder {
+public:
+    explicit WordlistBuilder(size_t expectedBytes) {
+        nodes.reserve(expectedBytes + 1);
+        nodes.push_back(WordTrieNode());
+    }
+
+    void insert(const uint8_t* word, size_t length) {
+        int node = 0;
+        for (size_t k = 0; k < length; ++k) {
+            int child = nodes[node].firstChild;
+            while (child >= 0 && nodes[child].byte != word[k]) child = nodes[child].nextSibling;
+            if (child < 0) {
+                child = static_cast<int>(nodes.size());
+                WordTrieNode created;
+                created.byte = word[k];
+                created.nextSibling = nodes[node].firstChild;
+                nodes.push_back(created);
+                nodes[node].firstChild = child;
+            }
+            node = child;
+        }
+        if (!nodes[node].final) ++words;
+        nodes[node].final = true;
+    }
+
+    size_t wordCount() const { return words; }
+    size_t trieNodes() const { return nodes.size(); }
+    size_t dawgStates() const { return states.size(); }
+
+    // 最小化并释放字典树, 返回模式; 含多个分支时整体加上非捕获组, 便于再加锚点
+    string build() {
+        minimize();
+        vector<WordTrieNode>().swap(nodes);
+        return emit(root);
+    }
+
+private:
+    struct DawgState {
+        bool final = false;
+        vector<pair<ByteSet, int>> groups;  // 指向同一目标的出边合并为一组, 按最小字节排序
+    };
+
+    vector<WordTrieNode> nodes;
+    vector<DawgState> states;
+    size_t words = 0;
+    int root = 0;
+
+    // 迭代的后序遍历: 子节点都有了规范状态后, 按 (结束标记, 排好序的出边) 查找或登记父节点的状态.
+    // 子状态总是先于父状态登记, 因此状态编号是拓扑序
+    void minimize() {
+        vector<int> canonical(nodes.size(), -1);
+        unordered_map<string, int> registry;
+        vector<pair<int, bool>> stack(1, make_pair(0, false));
+        vector<pair<uint8_t, int>> edges;
+        string key;
+        while (!stack.empty()) {
+            int node = stack.back().first;
+            if (!stack.back().second) {
+                stack.back().second = true;
+                for (int child = nodes[node].firstChild; child >= 0; child = nodes[child].nextSibling) {
+                    stack.push_back(make_pair(child, false));
+                }
+                continue;
+            }
+            stack.pop_back();
+            edges.clear();
+            for (int child = nodes[node].firstChild; child >= 0; child = nodes[child].nextSibling) {
+                edges.push_back(make_pair(nodes[child].byte, canonical[child]));
+            }
+            sort(edges.begin(), edges.end());
+            key.assign(1, nodes[node].final ? '1' : '0');
+            for (const auto& edge : edges) {
+                key.push_back(static_cast<char>(edge.first));
+                key.append(reinterpret_cast<const char*>(&edge.second), sizeof(edge.second));
+            }
+            auto inserted = registry.insert(make_pair(key, static_cast<int>(states.size())));
+            if (inserted.second) {
+                DawgState state;
+                state.final = nodes[node].final;
+                for (const auto& edge : edges) {
+                    size_t g = 0;
+                    while (g < state.groups.size() && state.groups[g].second != edge.second) ++g;
+                    if (g == state.groups.size()) state.groups.push_back(make_pair(ByteSet(), edge.second));
+                    state.groups[g].first.add(edge.first);
+                }
+                states.push_back(move(state));
+            }
+            canonical[node] = inserted.first->second;
+        }
+        root = canonical[0];
+    }
+
+    // 按状态展开为正则表达式 (显式栈, 单词再长也不会耗尽调用栈).
+    // 多个分支或可选的状态写成 (?:...) 或 (?:...)?, 只有一个单字符类且可选时写成 [..]?
+    string emit(int start) const {
+        struct Frame {
+            int state;
+            size_t next;
+            bool wrapped;
+        };
+        string out;
+        vector<Frame> stack;
+        auto enter = [&](int id) {
+            const DawgState& state = states[id];
+            if (state.groups.empty()) return;
+            if (state.final && state.groups.size() == 1 && states[state.groups[0].second].groups.empty()) {
+                out += formatByteSet(state.groups[0].first, GenerationOptions(), ALL_SHORTHANDS) + "?";
+                return;
+            }
+            bool wrapped = state.groups.size() > 1 || state.final;
+            if (wrapped) out += "(?:";
+            stack.push_back(Frame{id, 0, wrapped});
+        };
+        enter(start);
+        while (!stack.empty()) {
+            Frame& frame = stack.back();
+            const DawgState& state = states[frame.state];
+            if (frame.next < state.groups.size()) {
+                const pair<ByteSet, int>& group = state.groups[frame.next];
+                if (frame.next++ > 0) out.push_back('|');
+                out += formatByteSet(group.first, GenerationOptions(), ALL_SHORTHANDS);
+                enter(group.second);
+                continue;
+            }
+            if (frame.wrapped) out += state.final ? ")?" : ")";
+            stack.pop_back();
+        }
+        return out;
+    }
+};
+
+// 词表模式: 每行一个字面量 (忽略空行和行尾的 \r), 生成的模式按直接模式输出
+int wordlistMode(const string& path, const GenerationOptions& options) {
+    MappedFile file;
+    string error;
+    if (!file.open(path, error)) {
+        printMessage(cerr, MSG_ERROR_READ_FILE, path, error);
+        return 2;
+    }
+    const uint8_t* data = file.data();
+    size_t size = file.size();
+    WordlistBuilder builder(size);
+    size_t pos = 0;
+    while (pos < size) {
+        const void* newline = memchr(data + pos, '\n', size - pos);
+        size_t end = newline != nullptr ? static_cast<size_t>(static_cast<const uint8_t*>(newline) - data) : size;
+        size_t length = end - pos;
+        if (length > 0 && data[end - 1] == '\r') --length;
+        if (length > 0) builder.insert(data + pos, length);
+        pos = end + 1;
+    }
+    file.close();
+    if (builder.wordCount() == 0) {
+        printMessage(cerr, MSG_WORDLIST_EMPTY, path);
+        return 2;
+    }
+    size_t trieNodes = builder.trieNodes();
+    string pattern = builder.build();
+    regen::Pattern generated(pattern, publicOptions(options));
+    printGeneratedResult(generated, options,
+                         formatMessage(MSG_WORDLIST_DESCRIPTION, builder.wordCount(), trieNodes, builder.dawgStates()));
+    return 0;
+}
+
+// 向导: 列出预设模式
+void listPresets() {
+    cout << msg(MSG_AVAILABLE_PRESETS);
+    for (const auto& preset : PRESET_PATTERNS) {
+        cout << "  " << left << setw(12) << preset.first << " - " << preset.second.first;
+        if (isChineseLocale()) {
+            cout << " (" << preset.second.second << ")";
+        }
+        cout << "\n";
+    }
+}
+
+// 向导: 选择一个预设模式, 名称未知时返回 false
+bool addPresetComponent(vector<RegexComponent>& components) {
+    string presetName = getInput(msg(MSG_PROMPT_PRESET));
+    string pattern;
+    if (!regen::presetPattern(presetName, pattern)) {
+        printMessage(cerr, MSG_ERROR_UNKNOWN_PRESET, presetName);
+        return false;
+    }
+    components.push_back({pattern, formatMessage(MSG_PRESET_DESCRIPTION, presetName)});
+    return true;
+}
+
+// 向导: 输入一个自定义模式
+void addCustomComponent(vector<RegexComponent>& components) {
+    string pattern = getInput(msg(MSG_PROMPT_PATTERN));
+    string description = getInput(msg(MSG_PROMPT_DESCRIPTION), "");
+    components.push_back({pattern, description.empty() ? msg(MSG_CUSTOM_PATTERN) : description});
+}
+
+// 向导模式
+void wizardMode() {
+    cout << msg(MSG_WIZARD_TITLE);
+    cout << msg(MSG_RULE) << "\n";
+    
+    vector<RegexComponent> components;
+    GenerationOptions options;
+    options.utf8 = localeIsUtf8;
+    
+    // 选择模式
+    cout << msg(MSG_WIZARD_MODE_MENU);
+    string choice = getInput(msg(MSG_PROMPT_CHOICE_1_3), "1");
+    
+    if (choice == "1") {
+        // 预设模式
+        listPresets();
+        if (!addPresetComponent(components)) return;
+    } else if (choice == "2") {
+        // 自定义模式
+        cout << msg(MSG_CUSTOM_BUILDER);
+        addCustomComponent(components);
+    } else if (choice == "3") {
+        // 组合模式
+        cout << msg(MSG_COMBINE_TITLE);
+        
+        while (true) {
+            cout << msg(MSG_CURRENT_PATTERN);
+            if (components.empty()) {
+                cout << msg(MSG_NONE);
+            } else {
+                for (const auto& comp : components) {
+                    cout << comp.pattern;
+                }
+                cout << "\n";
+            }
+            
+            cout << msg(MSG_COMBINE_MENU);
+            string subChoice = getInput(msg(MSG_PROMPT_CHOICE_1_3), "3");
+            
+            if (subChoice == "1") {
+                // 添加预设
+                listPresets();
+                addPresetComponent(components);
+            } else if (subChoice == "2") {
+                // 添加自定义
+                addCustomComponent(components);
+            } else if (subChoice == "3") {
+                break;
+            }
+        }
+    }
+    
+    // 设置选项
+    cout << msg(MSG_OPTIONS_TITLE);
+    options.matchWholeLine = getInput(msg(MSG_PROMPT_MATCH_WHOLE), "n") == "y";
+    options.caseInsensitive = getInput(msg(MSG_PROMPT_CASE_INSENSITIVE), "n") == "y";
+    options.multiline = getInput(msg(MSG_PROMPT_MULTILINE), "n") == "y";
+    options.dotAll = getInput(msg(MSG_PROMPT_DOTALL), "n") == "y";
+    options.outputExplanation = getInput(msg(MSG_PROMPT_EXPLAIN), "y") == "y";
+    options.optimize = getInput(msg(MSG_PROMPT_OPTIMIZE), "n") == "y";
+    
+    // 输出格式
+    cout << msg(MSG_FORMAT_MENU);
+    string formatChoice = getInput(msg(MSG_PROMPT_CHOICE_1_2), "1");
+    
+    if (formatChoice == "2") {
+        cout << msg(MSG_LANGUAGE_LIST);
+        options.language = getInput(msg(MSG_PROMPT_LANGUAGE));
+        options.outputFormat = "code";
+    }
+    
+    // 组合所有模式并输出结果
+    vector<string> parts;
+    for (const auto& comp : components) {
+        parts.push_back(comp.pattern);
+    }
+    regen::Pattern generated(regen::compose(parts), publicOptions(options));
+    cout << "\n";
+    printGeneratedResult(generated, options, "");
+}
+
+// 直接参数模式
+int directMode(const vector<string>& args) {
+    string pattern;
+    string description;
+    GenerationOptions options;
+    options.utf8 = localeIsUtf8;
+    bool usePreset = false;
+    string presetName;
+    bool scan = false;
+    ScanSettings scanSettings;
+    bool bench = false;
+    bool analyze = false;
+    bool stats = false;
+    string batchPath;
+    string servePath;
+    BenchSettings benchSettings;
+    string validatePreset;
+    ValidateSettings validateSettings;
+    bool generate = false;
+    GenerateSettings generateSettings;
+    string learnPositives;
+    string learnNegatives;
+    string wordlistPath;
+    vector<string> redactPresets;
+    RedactSettings redactSettings;
+    string compareOption;  // --equiv 或 --subset
+    vector<string> scanPresets;
+    vector<string> positional;
+    
+    // 解析参数
+    for (size_t i = 1; i < args.size(); ++i) {
+        if (args[i] == "-h" || args[i] == "--help") {
+            printHelp();
+            return 0;
+        } else if (args[i] == "-w" || args[i] == "--wizard") {
+            wizardMode();
+            return 0;
+        } else if (args[i] == "-p" || args[i] == "--preset") {
+            if (i + 1 < args.size()) {
+                usePreset = true;
+                presetName = args[++i];
+            } else {
+                printMessage(cerr, MSG_ERROR_MISSING_ARGUMENT, "--preset");
+                return 1;
+            }
+        } else if (args[i] == "-m" || args[i] == "--match-whole") {
+            options.matchWholeLine = true;
+        } else if (args[i] == "-i" || args[i] == "--case-insensitive") {
+            options.caseInsensitive = true;
+        } else if (args[i] == "--multiline") {
+            options.multiline = true;
+        } else if (args[i] == "--dotall") {
+            options.dotAll = true;
+        } else if (args[i] == "--utf8" || args[i] == "--bytes") {
+            options.utf8 = args[i] == "--utf8";
+        } else if (args[i] == "-e" || args[i] == "--explain") {
+            options.outputExplanation = true;
+        } else if (args[i] == "-f" || args[i] == "--format") {
+            if (i + 1 < args.size()) {
+                options.outputFormat = args[++i];
+                if (options.outputFormat != "regex") {
+                    options.language = options.outputFormat;
+                    options.outputFormat = "code";
+                }
+            } else {
+                printMessage(cerr, MSG_ERROR_MISSING_ARGUMENT, "--format");
+                return 1;
+            }
+        } else if (args[i] == "--scan") {
+            scan = true;
+        } else if (args[i] == "--presets") {
+            if (i + 1 < args.size()) {
+                stringstream list(args[++i]);
+                string name;
+                while (getline(list, name, ',')) {
+                    if (!name.empty()) scanPresets.push_back(name);
+                }
+            } else {
+                printMessage(cerr, MSG_ERROR_MISSING_ARGUMENT, "--presets");
+                return 1;
+            }
+        } else if (args[i] == "--threads") {
+            if (i + 1 < args.size()) {
+                long threads = atol(args[++i].c_str());
+                scanSettings.threads = threads > 0 ? static_cast<size_t>(threads)
+                                                   : max<size_t>(thread::hardware_concurrency(), 1);
+            } else {
+                printMessage(cerr, MSG_ERROR_MISSING_ARGUMENT, "--threads");
+                return 1;
+            }
+        } else if (args[i] == "--no-cache") {
+            scanSettings.useCache = false;
+        } else if (args[i] == "--cache-size") {
+            if (i + 1 < args.size()) {
+                double megabytes = atof(args[++i].c_str());
+                scanSettings.cacheLimit = megabytes > 0 ? static_cast<size_t>(megabytes * 1048576) : 0;
+            } else {
+                printMessage(cerr, MSG_ERROR_MISSING_ARGUMENT, "--cache-size");
+                return 1;
+            }
+        } else if (args[i] == "--dfa-cache-mb") {
+            if (i + 1 < args.size()) {
+                double megabytes = atof(args[++i].c_str());
+                if (megabytes > 0) scanSettings.dfaCacheLimit = static_cast<size_t>(megabytes * 1048576);
+            } else {
+                printMessage(cerr, MSG_ERROR_MISSING_ARGUMENT, "--dfa-cache-mb");
+                return 1;
+            }
+        } else if (args[i] == "--scan-stats") {
+            scanSettings.printStats = true;
+        } else if (args[i] == "--optimize") {
+            options.optimize = true;
+        } else if (args[i] == "--analyze") {
+            analyze = true;
+        } else if (args[i] == "--stats") {
+            stats = true;
+        } else if (args[i] == "--profile" || args[i].compare(0, 10, "--profile=") == 0) {
+            // 由 main 处理
+        } else if (args[i] == "--bench") {
+            bench = true;
+        } else if (args[i] == "--serve") {
+            if (i + 1 < args.size()) {
+                servePath = args[++i];
+            } else {
+                printMessage(cerr, MSG_ERROR_MISSING_ARGUMENT, "--serve");
+                return 1;
+            }
+        } else if (args[i] == "--batch") {
+            if (i + 1 < args.size()) {
+                batchPath = args[++i];
+            } else {
+                printMessage(cerr, MSG_ERROR_MISSING_ARGUMENT, "--batch");
+                return 1;
+            }
+        } else if (args[i] == "--bench-size") {
+            if (i + 1 < args.size()) {
+                double megabytes = atof(args[++i].c_str());
+                benchSettings.bytes = megabytes > 0 ? static_cast<size_t>(megabytes * 1048576) : benchSettings.bytes;
+            } else {
+                printMessage(cerr, MSG_ERROR_MISSING_ARGUMENT, "--bench-size");
+                return 1;
+            }
+        } else if (args[i] == "--density") {
+            if (i + 1 < args.size()) {
+                benchSettings.density = min(max(atof(args[++i].c_str()), 0.0), 1.0);
+            } else {
+                printMessage(cerr, MSG_ERROR_MISSING_ARGUMENT, "--density");
+                return 1;
+            }
+        } else if (args[i] == "--seed") {
+            if (i + 1 < args.size()) {
+                benchSettings.seed = strtoull(args[++i].c_str(), nullptr, 10);
+                generateSettings.seed = benchSettings.seed;
+            } else {
+                printMessage(cerr, MSG_ERROR_MISSING_ARGUMENT, "--seed");
+                return 1;
+            }
+        } else if (args[i] == "--runs") {
+            if (i + 1 < args.size()) {
+                benchSettings.runs = max(atoi(args[++i].c_str()), 1);
+            } else {
+                printMessage(cerr, MSG_ERROR_MISSING_ARGUMENT, "--runs");
+                return 1;
+            }
+        } else if (args[i] == "--json") {
+            benchSettings.json = true;
+            validateSettings.json = true;
+        } else if (args[i] == "--validate") {
+            if (i + 1 < args.size()) {
+                validatePreset = args[++i];
+            } else {
+                printMessage(cerr, MSG_ERROR_MISSING_ARGUMENT, "--validate");
+                return 1;
+            }
+        } else if (args[i] == "--count") {
+            validateSettings.countOnly = true;
+        } else if (args[i] == "--generate") {
+            if (i + 1 < args.size()) {
+                generate = true;
+                generateSettings.count = strtoull(args[++i].c_str(), nullptr, 10);
+            } else {
+                printMessage(cerr, MSG_ERROR_MISSING_ARGUMENT, "--generate");
+                return 1;
+            }
+        } else if (args[i] == "--negative") {
+            generateSettings.negative = true;
+        } else if (args[i] == "--redact") {
+            if (i + 1 < args.size()) {
+                stringstream list(args[++i]);
+                string name;
+                while (getline(list, name, ',')) {
+                    if (!name.empty()) redactPresets.push_back(name);
+                }
+            } else {
+                printMessage(cerr, MSG_ERROR_MISSING_ARGUMENT, "--redact");
+                return 1;
+            }
+        } else if (args[i] == "--mask") {
+            if (i + 1 < args.size()) {
+                redactSettings.mask = args[++i];
+            } else {
+                printMessage(cerr, MSG_ERROR_MISSING_ARGUMENT, "--mask");
+                return 1;
+            }
+        } else if (args[i] == "--redact-key") {
+            if (i + 1 < args.size()) {
+                redactSettings.hashed = true;
+                redactSettings.key = args[++i];
+            } else {
+                printMessage(cerr, MSG_ERROR_MISSING_ARGUMENT, "--redact-key");
+                return 1;
+            }
+        } else if (args[i] == "--from-wordlist") {
+            if (i + 1 < args.size()) {
+                wordlistPath = args[++i];
+            } else {
+                printMessage(cerr, MSG_ERROR_MISSING_ARGUMENT, "--from-wordlist");
+                return 1;
+            }
+        } else if (args[i] == "--learn") {
+            if (i + 1 < args.size()) {
+                learnPositives = args[++i];
+                if (i + 1 < args.size() && (args[i + 1] == "-" || args[i + 1][0] != '-')) learnNegatives = args[++i];
+            } else {
+                printMessage(cerr, MSG_ERROR_MISSING_ARGUMENT, "--learn");
+                return 1;
+            }
+        } else if (args[i] == "--equiv" || args[i] == "--subset") {
+            // 两个模式在所有选项解析完后从位置参数中取
+            compareOption = args[i];
+        } else if (args[i] == "--") {
+            // 之后的参数都是位置参数, 以 - 开头的模式写在 -- 之后
+            positional.insert(positional.end(), args.begin() + i + 1, args.end());
+            break;
+        } else if (args[i] == "--all-presets") {
+            scanPresets = regen::presetNames();
+        } else {
+            positional.push_back(args[i]);
+        }
+    }
+    
+    // 批处理: 命令行上的选项作为每个任务的默认值
+    if (!servePath.empty()) {
+        return serveMode(servePath, options, scanSettings.dfaCacheLimit);
+    }
+    if (!batchPath.empty()) {
+        return batchMode(batchPath, options);
+    }
+    if (!validatePreset.empty()) {
+        return validateMode(validatePreset, positional, options, validateSettings);
+    }
+    if (!learnPositives.empty()) {
+        return learnMode(learnPositives, learnNegatives, options, scanSettings.threads);
+    }
+    if (!wordlistPath.empty()) {
+        return wordlistMode(wordlistPath, options);
+    }
+    if (!redactPresets.empty()) {
+        return redactMode(redactPresets, positional, options, scanSettings, redactSettings);
+    }
+    if (!compareOption.empty()) {
+        if (positional.size() != 2) {
+            printMessage(cerr, MSG_ERROR_TWO_PATTERNS, compareOption, positional.size(), compareOption);
+            return 1;
+        }
+        return compareMode(positional[0], positional[1], compareOption == "--subset", options, benchSettings.json);
+    }
+    
+    // 基准测试: 指定预设或自定义模式, 默认测量所有预设
+    if (bench) {
+        vector<pair<string, string>> namedPatterns;
+        if (usePreset) {
+            string presetPattern;
+            if (!regen::presetPattern(presetName, presetPattern)) {
+                printMessage(cerr, MSG_ERROR_UNKNOWN_PRESET, presetName);
+                return 1;
+            }
+            namedPatterns.push_back(make_pair(presetName, presetPattern));
+        }
+        for (const string& custom : positional) namedPatterns.push_back(make_pair(custom, custom));
+        if (namedPatterns.empty()) {
+            for (const string& name : regen::presetNames()) {
+                string presetPattern;
+                regen::presetPattern(name, presetPattern);
+                namedPatterns.push_back(make_pair(name, presetPattern));
+            }
+        }
+        if (options.matchWholeLine) {
+            for (auto& named : namedPatterns) named.second = "^" + named.second + "$";
+        }
+        return benchMode(namedPatterns, options, benchSettings);
+    }
+
+    // 多预设扫描: 所有位置参数都是文件
+    if (!scanPresets.empty()) {
+        return multiScanMode(scanPresets, positional, options, scanSettings);
+    }
+    
+    // 扫描模式下, 使用预设时所有位置参数都是文件, 否则第一个是模式
+    vector<string> files;
+    size_t nextPositional = 0;
+    if (!(scan && usePreset) && nextPositional < positional.size()) {
+        pattern = positional[nextPositional++];
+    }
+    if (scan) {
+        files.assign(positional.begin() + nextPositional, positional.end());
+    } else if (nextPositional < positional.size()) {
+        description = positional[nextPositional];
+    }
+    
+    // 获取模式
+    if (usePreset) {
+        if (!regen::presetPattern(presetName, pattern)) {
+            printMessage(cerr, MSG_ERROR_UNKNOWN_PRESET, presetName);
+            return 1;
+        }
+        description = formatMessage(MSG_PRESET_DESCRIPTION, presetName);
+    } else if (pattern.empty()) {
+        cerr << msg(MSG_ERROR_PATTERN_REQUIRED);
+        printHelp();
+        return 1;
+    }
+    
+    if (generate) {
+        if (options.matchWholeLine) pattern = "^" + pattern + "$";
+        generateSettings.threads = scanSettings.threads;
+        return generateMode(pattern, options, generateSettings);
+    }
+    if (scan || analyze || stats) {
+        // 模式只解析一次, 扫描、分析和统计直接使用语法树; 扫描命中自动机缓存时不再解析
+        if (options.matchWholeLine) {
+            pattern = "^" + pattern + "$";
+        }
+        if (scan) return scanMode(pattern, options, files, scanSettings);
+        ParsedPattern parsed;
+        parseForMatching(pattern, options, parsed);
+        if (stats) return statsMode(parsed, options, benchSettings.json);
+        return analyzeMode(parsed, options);
+    }
+    
+    regen::Pattern generated(pattern, publicOptions(options));
+    printGeneratedResult(generated, options, description);
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    // 设置本地化, 界面语言只在启动时确定一次
+    initLocale();
+    
+    vector<string> args(argv, argv + argc);
+    
+    if (argc == 1) {
+        printHelp();
+        return 0;
+    }
+    
+    // 检查是否是向导模式
+    for (const auto& arg : args) {
+        if (arg == "-w" || arg == "--wizard") {
+            wizardMode();
+            return 0;
+        }
+    }
+    
+    // --profile[=跟踪文件] 在所有模式外层计时, 结束后写出跟踪并汇总
+    string tracePath;
+    for (const auto& arg : args) {
+        if (arg == "--profile") tracePath = "trace.json";
+        if (arg.compare(0, 10, "--profile=") == 0) tracePath = arg.substr(10);
+    }
+    if (tracePath.empty()) return directMode(args);
+    Profiler profiler(tracePath);
+    activeProfiler = &profiler;
+    int status = directMode(args);
+    activeProfiler = nullptr;
+    bool written = profiler.finish();
+    return written || status != 0 ? status : 2;
+}
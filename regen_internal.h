@@ -0,0 +1,1568 @@
+// regen 内部接口: 解析器、匹配引擎和分析器共用的类型与声明
+// 由库的实现 regen.cpp 和命令行前端 regen_cli.cpp 包含, 不随库安装
+#ifndef REGEN_INTERNAL_H
+#define REGEN_INTERNAL_H
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "regen.h"
+
+// 只在本项目的源文件中使用, 不会泄漏到库的使用者
+using namespace std;
+
+namespace regen {
+namespace detail {
+
+// 界面语言, 启动时由 initLocale() 解析一次
+enum UiLanguage {
+    LANG_EN,
+    LANG_ZH,
+    LANG_COUNT
+};
+
+extern UiLanguage currentLanguage;
+
+// 本地化字符集是否为 UTF-8, 命令行据此决定 . 和取反字符类按码点还是按字节匹配
+extern bool localeIsUtf8;
+
+void initLocale();
+
+// 系统语言检测
+inline bool isChineseLocale() {
+    return currentLanguage == LANG_ZH;
+}
+
+// 消息编号, 与 MESSAGES 中的行一一对应; {} 为参数占位符
+enum MessageId {
+    // 通用输出
+    MSG_HELP,
+    MSG_RULE,
+    MSG_GENERATED_RESULT,
+    MSG_REGULAR_EXPRESSION,
+    MSG_OPTIMIZED,
+    MSG_DESCRIPTION,
+    MSG_PRESET_DESCRIPTION,
+    MSG_CUSTOM_PATTERN,
+    MSG_SIZE_CHANGE,
+    MSG_COST_CHANGE,
+    MSG_ORIGINAL,
+    // 错误
+    MSG_ERROR_MISSING_ARGUMENT,
+    MSG_ERROR_TWO_PATTERNS,
+    MSG_ERROR_UNKNOWN_PRESET,
+    MSG_ERROR_PATTERN_REQUIRED,
+    MSG_ERROR_READ_FILE,
+    MSG_ERROR_COMPILE,
+    MSG_ERROR_ANALYZE,
+    MSG_ERROR_LISTEN,
+    MSG_SERVE_READY,
+    // 向导
+    MSG_WIZARD_TITLE,
+    MSG_WIZARD_MODE_MENU,
+    MSG_PROMPT_CHOICE_1_3,
+    MSG_PROMPT_CHOICE_1_2,
+    MSG_AVAILABLE_PRESETS,
+    MSG_PROMPT_PRESET,
+    MSG_CUSTOM_BUILDER,
+    MSG_PROMPT_PATTERN,
+    MSG_PROMPT_DESCRIPTION,
+    MSG_COMBINE_TITLE,
+    MSG_CURRENT_PATTERN,
+    MSG_NONE,
+    MSG_COMBINE_MENU,
+    MSG_OPTIONS_TITLE,
+    MSG_PROMPT_MATCH_WHOLE,
+    MSG_PROMPT_CASE_INSENSITIVE,
+    MSG_PROMPT_MULTILINE,
+    MSG_PROMPT_DOTALL,
+    MSG_PROMPT_EXPLAIN,
+    MSG_PROMPT_OPTIMIZE,
+    MSG_FORMAT_MENU,
+    MSG_LANGUAGE_LIST,
+    MSG_PROMPT_LANGUAGE,
+    // 解释
+    MSG_EXPLANATION_TITLE,
+    MSG_CANNOT_PARSE,
+    MSG_EMPTY,
+    MSG_EXPLAIN_DIGIT,
+    MSG_EXPLAIN_WORD,
+    MSG_EXPLAIN_SPACE,
+    MSG_EXPLAIN_NOT_DIGIT,
+    MSG_EXPLAIN_NOT_WORD,
+    MSG_EXPLAIN_NOT_SPACE,
+    MSG_EXPLAIN_ANY,
+    MSG_EXPLAIN_ANY_EXCEPT_NEWLINE,
+    MSG_EXPLAIN_IN_SET,
+    MSG_EXPLAIN_NOT_IN_SET,
+    MSG_EXPLAIN_CHARACTER,
+    MSG_EXPLAIN_TEXT,
+    MSG_EXPLAIN_NEWLINE,
+    MSG_EXPLAIN_CARRIAGE_RETURN,
+    MSG_EXPLAIN_TAB,
+    MSG_EXPLAIN_BYTE,
+    MSG_EXPLAIN_LINE_BEGIN,  // 以下六项按 AssertKind 的顺序排列
+    MSG_EXPLAIN_LINE_END,
+    MSG_EXPLAIN_TEXT_BEGIN,
+    MSG_EXPLAIN_TEXT_END,
+    MSG_EXPLAIN_WORD_BOUNDARY,
+    MSG_EXPLAIN_NOT_WORD_BOUNDARY,
+    MSG_EXPLAIN_EMPTY_STRING,
+    MSG_EXPLAIN_BACKREF,
+    MSG_EXPLAIN_BACKREF_SHORT,
+    MSG_EXPLAIN_SEQUENCE,
+    MSG_EXPLAIN_ALTERNATIVES,
+    MSG_EXPLAIN_ALTERNATIVE,
+    MSG_EXPLAIN_NON_CAPTURING,
+    MSG_EXPLAIN_CAPTURING,
+    MSG_EXPLAIN_LOOKAHEAD,  // 以下四项按 向后 × 2 + 否定 排列
+    MSG_EXPLAIN_NEGATIVE_LOOKAHEAD,
+    MSG_EXPLAIN_LOOKBEHIND,
+    MSG_EXPLAIN_NEGATIVE_LOOKBEHIND,
+    MSG_QUANTIFIER_STAR,
+    MSG_QUANTIFIER_PLUS,
+    MSG_QUANTIFIER_OPTIONAL,
+    MSG_QUANTIFIER_EXACT,
+    MSG_QUANTIFIER_AT_LEAST,
+    MSG_QUANTIFIER_RANGE,
+    MSG_QUANTIFIER_LAZY,
+    MSG_MATCHER_UNSUPPORTED,
+    MSG_PREFILTER,
+    MSG_ENGINE_BIT_PARALLEL,
+    MSG_ENGINE_LAZY_DFA,
+    MSG_ENGINE_TOO_MANY_POSITIONS,
+    MSG_ENGINE_ASSERTIONS,
+    MSG_ENGINE_NULLABLE,
+    // ReDoS 分析
+    MSG_RISK_EXPONENTIAL,
+    MSG_RISK_POLYNOMIAL,
+    MSG_RISK_LINEAR,
+    MSG_LIST_SEPARATOR,
+    MSG_CAUSE_EXPONENTIAL,
+    MSG_CAUSE_UNANCHORED_LOOP,
+    MSG_CAUSE_UNANCHORED_ADJACENT,
+    MSG_CAUSE_ADJACENT,
+    MSG_WARNING_RISK,
+    MSG_WARNING_ADVICE,
+    MSG_CAUSE,
+    MSG_ATTACK_INPUT,
+    MSG_ATTACK_UNVERIFIED,
+    MSG_WORST_CASE,
+    MSG_AFFECTED_ENGINES,
+    MSG_UNAFFECTED_ENGINES,
+    MSG_ANALYSIS_INCOMPLETE,
+    MSG_DFA_UNAVAILABLE,
+    // 基准测试
+    MSG_BENCH_CORPUS,
+    MSG_COLUMN_PATTERN,
+    MSG_COLUMN_ENGINE,
+    MSG_COLUMN_MATCHES,
+    MSG_COLUMN_TIME,
+    MSG_COLUMN_THROUGHPUT,
+    MSG_COLUMN_MATCH_RATE,
+    MSG_COLUMN_PEAK_RSS,
+    MSG_BENCH_FAILED,
+    MSG_BENCH_MISMATCH,
+    MSG_VALIDATE_COUNTS,
+    MSG_GENERATE_NO_SAMPLE,
+    MSG_GENERATE_NO_NEAR_MISS,
+    MSG_LEARN_DESCRIPTION,
+    MSG_LEARN_NO_POSITIVES,
+    MSG_LEARN_CONFLICT,
+    MSG_LEARN_VERIFY_FAILED,
+    MSG_WORDLIST_DESCRIPTION,
+    MSG_WORDLIST_EMPTY,
+    MSG_STATS_AST_NODES,
+    MSG_STATS_NFA_STATES,
+    MSG_STATS_NFA_VALUE,
+    MSG_STATS_DFA_STATES,
+    MSG_STATS_DFA_VALUE,
+    MSG_STATS_EXCEEDS_BUDGET,
+    MSG_STATS_TABLES,
+    MSG_STATS_TABLES_VALUE,
+    MSG_STATS_PREFILTER,
+    MSG_STATS_ENGINE_BIT_PARALLEL,
+    MSG_STATS_ENGINE_LAZY_DFA,
+    MSG_STATS_BACKTRACKING,
+    MSG_STATS_STEPS_VALUE,
+    MSG_STATS_NOT_ANALYZED,
+    MSG_ERROR_STATS,
+    MSG_PROFILE_SUMMARY,
+    MSG_COLUMN_PHASE,
+    MSG_COLUMN_BYTES,
+    MSG_COLUMN_ALLOCATIONS,
+    MSG_COLUMN_EVENTS,
+    MSG_PROFILE_TRACE,
+    MSG_ERROR_PROFILE_WRITE,
+    MSG_EQUIV_HOLDS,
+    MSG_EQUIV_FAILS,
+    MSG_SUBSET_HOLDS,
+    MSG_SUBSET_FAILS,
+    MSG_WITNESS_FIRST,
+    MSG_WITNESS_SECOND,
+    MSG_ERROR_COMPARE,
+    MSG_DFA_STATS_HEADER,
+    MSG_DFA_STATS_ROW,
+    MSG_DFA_STATS_FALLBACK,
+    MSG_DFA_COMBINED,
+    MSG_DFA_FORWARD,
+    MSG_DFA_REVERSE,
+    MSG_COUNT
+};
+
+extern const char* const MESSAGES[][LANG_COUNT];
+
+// 当前语言的消息文本
+inline const char* msg(MessageId id) {
+    return MESSAGES[id][currentLanguage];
+}
+
+// 依次用参数替换 text 中的 {} 并写入流
+inline void writeFormatted(ostream& out, const char* text) {
+    out << text;
+}
+
+template <typename T, typename... Rest>
+void writeFormatted(ostream& out, const char* text, const T& first, const Rest&... rest) {
+    const char* slot = strstr(text, "{}");
+    if (slot == nullptr) {
+        out << text;
+        return;
+    }
+    out.write(text, slot - text);
+    out << first;
+    writeFormatted(out, slot + 2, rest...);
+}
+
+template <typename... Args>
+void printMessage(ostream& out, MessageId id, const Args&... args) {
+    writeFormatted(out, msg(id), args...);
+}
+
+template <typename... Args>
+string formatMessage(MessageId id, const Args&... args) {
+    stringstream out;
+    writeFormatted(out, msg(id), args...);
+    return out.str();
+}
+
+// 预设正则表达式模式
+extern const map<string, pair<string, string>> PRESET_PATTERNS;
+
+// 正则表达式组件
+struct RegexComponent {
+    string pattern;
+    string description;
+};
+
+// 生成选项
+struct GenerationOptions {
+    bool matchWholeLine = false;
+    bool caseInsensitive = false;
+    bool multiline = false;
+    bool dotAll = false;
+    bool outputExplanation = false;
+    bool optimize = false;
+    bool utf8 = false;  // . 、\D \W \S、取反字符类和非 ASCII 字面量按 UTF-8 码点匹配
+    string outputFormat = "regex";
+    string language = "";
+};
+
+struct ParsedPattern;
+
+string generateCodeSnippet(const ParsedPattern& parsed, const string& pattern, const string& language,
+                           const GenerationOptions& options);
+
+// ============================================================
+// 正则引擎: 解析、解释、打印与优化
+// ============================================================
+
+// 256 位字节集合
+struct ByteSet {
+    uint64_t bits[4] = {0, 0, 0, 0};
+
+    void add(unsigned char c) { bits[c >> 6] |= uint64_t(1) << (c & 63); }
+    void addRange(unsigned char lo, unsigned char hi) {
+        for (int c = lo; c <= hi; ++c) add(static_cast<unsigned char>(c));
+    }
+    void remove(unsigned char c) { bits[c >> 6] &= ~(uint64_t(1) << (c & 63)); }
+    bool has(unsigned char c) const { return (bits[c >> 6] >> (c & 63)) & 1; }
+    bool contains(const ByteSet& other) const {
+        for (int i = 0; i < 4; ++i) {
+            if ((other.bits[i] & ~bits[i]) != 0) return false;
+        }
+        return true;
+    }
+    void merge(const ByteSet& other) {
+        for (int i = 0; i < 4; ++i) bits[i] |= other.bits[i];
+    }
+    void invert() {
+        for (int i = 0; i < 4; ++i) bits[i] = ~bits[i];
+    }
+    int count() const {
+        int n = 0;
+        for (int i = 0; i < 4; ++i) n += __builtin_popcountll(bits[i]);
+        return n;
+    }
+    bool operator==(const ByteSet& other) const {
+        return memcmp(bits, other.bits, sizeof(bits)) == 0;
+    }
+};
+
+inline bool isWordByte(int c) {
+    return c >= 0 && (isalnum(c) || c == '_') && c < 128;
+}
+
+// UTF-8 模式下的码点区间 [first, second], 只保存 U+0080 以上的部分, ASCII 仍由 ByteSet 表示
+typedef vector<pair<uint32_t, uint32_t>> CodepointRanges;
+
+const uint32_t MAX_CODEPOINT = 0x10FFFF;
+
+int decodeUtf8(const string& text, size_t pos, uint32_t& codepoint);
+void appendUtf8(string& out, uint32_t codepoint);
+
+// 语法树节点类型
+enum RegexNodeType {
+    NODE_EMPTY,      // 空串
+    NODE_SET,        // 单个字节: 字面量、字符类、.; 带码点区间时为一个 UTF-8 字符
+    NODE_CONCAT,     // 连接
+    NODE_ALTERNATE,  // 分支 |
+    NODE_REPEAT,     // 量词
+    NODE_GROUP,      // 分组
+    NODE_ASSERT,     // 零宽断言
+    NODE_LOOKAROUND, // 环视 (?=x) (?!x) (?<=x) (?<!x), 内置匹配器不支持
+    NODE_BACKREF     // 反向引用 \1 \k<name> (?P=name), 内置匹配器不支持
+};
+
+enum AssertKind {
+    ASSERT_LINE_BEGIN,
+    ASSERT_LINE_END,
+    ASSERT_TEXT_BEGIN,
+    ASSERT_TEXT_END,
+    ASSERT_WORD_BOUNDARY,
+    ASSERT_NOT_WORD_BOUNDARY
+};
+
+struct RegexNode {
+    RegexNodeType type = NODE_EMPTY;
+    ByteSet set;
+    CodepointRanges codepoints;  // NODE_SET: UTF-8 模式下另外匹配的非 ASCII 码点, 编译时展开为字节序列
+    char shorthand = 0;      // NODE_SET: 'd' 'w' 's' 'D' 'W' 'S' '.' 或 0
+    AssertKind assertion = ASSERT_LINE_BEGIN;
+    int minRepeat = 1;
+    int maxRepeat = 1;       // -1 表示无上限
+    bool greedy = true;
+    bool capturing = false;
+    int group = 0;           // NODE_GROUP: 捕获组编号 (从 1 开始); NODE_BACKREF: 引用的组
+    bool lookBehind = false; // NODE_LOOKAROUND: 向后环视
+    bool negated = false;    // NODE_LOOKAROUND: 否定环视
+    int childBegin = 0;
+    int childCount = 0;
+    int srcBegin = 0;        // 在原始模式中的位置 [srcBegin, srcEnd)
+    int srcEnd = 0;
+};
+
+// 语法树: 所有节点存放在同一个数组中, 子节点通过下标引用
+struct RegexAst {
+    vector<RegexNode> nodes;
+    vector<int> children;
+    int root = -1;
+    int groupCount = 0;
+    vector<string> groupNames;  // 按组编号索引, 未命名的组为空串; 下标 0 不用
+    bool utf8 = false;          // 按 UTF-8 模式解析: 多字节字符是一个原子
+
+    const RegexNode& node(int id) const { return nodes[id]; }
+    int child(const RegexNode& n, int k) const { return children[n.childBegin + k]; }
+};
+
+bool parseRegex(const string& pattern, const GenerationOptions& options, RegexAst& ast, string& error);
+
+// 解析一次的模式: 解释、优化、代码生成、分析和匹配共用同一棵语法树
+struct ParsedPattern {
+    string pattern;
+    RegexAst ast;
+    string error;  // 非空表示解析失败
+
+    bool valid() const { return error.empty(); }
+};
+
+void parsePattern(const string& pattern, const GenerationOptions& options, ParsedPattern& parsed);
+bool matcherSupports(const RegexAst& ast, string& error);
+string generateExplanation(const ParsedPattern& parsed);
+string formatRegexByte(unsigned char c, bool inClass);
+int decodeUtf8(const string& text, size_t pos, uint32_t& codepoint);
+string escapeStrayBytes(const string& text);
+
+// 允许使用的全部简写, 用于从集合推断模式时
+extern const char* const ALL_SHORTHANDS;
+
+string sourceShorthands(const string& source);
+string formatByteSet(const ByteSet& input, const GenerationOptions& options, const string& shorthands);
+string formatQuantifier(int minRepeat, int maxRepeat, bool greedy);
+void optimizePattern(const ParsedPattern& input, const GenerationOptions& options, ParsedPattern& output);
+// 模式在回溯引擎中的代价: 捕获组、多出的分支和字符类成员 (连续区间或简写) 越少越快
+struct PatternCost {
+    int capturingGroups = 0;
+    int extraBranches = 0;
+    int classMembers = 0;
+
+    int total() const { return 2 * capturingGroups + 2 * extraBranches + classMembers; }
+};
+
+PatternCost patternCost(const RegexAst& ast);
+string describeOptimization(const string& before, const string& after, const GenerationOptions& options);
+
+// ============================================================
+// 匹配引擎: Thompson NFA、惰性 DFA、位并行自动机与预过滤
+// ============================================================
+
+// NFA 指令
+enum NfaOp {
+    NFA_SET,      // 消耗一个属于 sets[setIndex] 的字节
+    NFA_SPLIT,    // 分叉, out 优先于 out1
+    NFA_EPSILON,
+    NFA_ASSERT,
+    NFA_MATCH     // 匹配成功, out 为模式编号
+};
+
+struct NfaState {
+    uint8_t op;
+    uint8_t assertion;
+    int out;
+    int out1;
+    int setIndex;
+};
+
+// 程序的状态表或字节集表: 编译时由自己的 vector 持有元素; 从自动机缓存载入时只记录指向映射文件的
+// 指针和长度, 扫描直接读映射的页面, 映射由 CompiledPatternSet::storage 保持到扫描结束
+template <typename T>
+class ProgramTable {
+public:
+    size_t size() const { return external != nullptr ? externalSize : owned.size(); }
+    bool empty() const { return size() == 0; }
+    const T* data() const { return external != nullptr ? external : owned.data(); }
+    const T* begin() const { return data(); }
+    const T* end() const { return data() + size(); }
+    const T& operator[](size_t index) const { return data()[index]; }
+
+    // 修改只用于编译时自己持有的表
+    T& operator[](size_t index) { return owned[index]; }
+    T& back() { return owned.back(); }
+    void push_back(const T& value) { owned.push_back(value); }
+    void resize(size_t count) { owned.resize(count); }
+
+    // 改为引用外部的只读表, 调用方保证其生命周期
+    void view(const T* items, size_t count) {
+        owned.clear();
+        external = items;
+        externalSize = count;
+    }
+
+private:
+    vector<T> owned;
+    const T* external = nullptr;
+    size_t externalSize = 0;
+};
+
+// 编译后的 NFA 程序
+struct RegexProgram {
+    ProgramTable<NfaState> states;
+    ProgramTable<ByteSet> sets;
+    int start = -1;            // 锚定起点
+    int unanchoredStart = -1;  // 带 (?s:.)*? 前缀的起点, 反向程序为 -1
+    bool usesLineBegin = false;
+    bool usesTextBegin = false;
+    bool usesWordBoundary = false;
+};
+
+// 扫描上下文: 前一个字节的类别
+enum ScanContext {
+    CTX_EDGE = 0,     // 文本开头 (反向时为文本结尾)
+    CTX_NEWLINE = 1,
+    CTX_WORD = 2,
+    CTX_OTHER = 3
+};
+
+// 惰性 DFA 的统计, 供 --scan-stats 输出 (合并多个自动机时累加)
+struct DfaStats {
+    uint64_t steps = 0;      // 经过的转移
+    uint64_t misses = 0;     // 不在缓存中、需要计算的转移
+    uint64_t flushes = 0;    // 因超出内存预算而清空缓存的次数
+    uint64_t built = 0;      // 构造的状态数
+    size_t peakStates = 0;   // 缓存中同时存在的最大状态数
+    size_t automata = 0;
+    size_t simulating = 0;   // 改用 NFA 模拟的自动机数
+    size_t byteClasses = 0;  // 转移表每行的字节类数 (多个自动机时取最大)
+
+    void merge(const DfaStats& other) {
+        steps += other.steps;
+        misses += other.misses;
+        flushes += other.flushes;
+        built += other.built;
+        peakStates = max(peakStates, other.peakStates);
+        automata += other.automata;
+        simulating += other.simulating;
+        byteClasses = max(byteClasses, other.byteClasses);
+    }
+};
+
+// 惰性 DFA: 状态在扫描过程中按需构造并缓存
+// 状态 = (有序的 NFA 状态列表, 前一字节类别, 在前一字节之前结束匹配的模式编号)
+// 匹配结果延迟一个字节报告, 以便在转移时判断 $ 和 \b
+// 缓存超出内存预算时清空重建; 若清空后每个新状态平均只用了不到 10 个字节就再次清空 (缓存抖动),
+// 改用 NFA 模拟: 只保留两个轮换的状态槽, 不缓存转移, 每个字节直接由 NFA 状态集计算下一状态
+class LazyDfa {
+public:
+    enum : int32_t {
+        UNKNOWN = -1,
+        SPECIAL = 1 << 30,  // 匹配状态或死状态
+        DEAD = 0
+    };
+
+    // leftmostFirst: 遇到匹配时截断低优先级线程 (与回溯引擎的语义一致)
+    LazyDfa(const RegexProgram& program, bool leftmostFirst, size_t memoryLimit = 64u << 20)
+        : program(program), leftmostFirst(leftmostFirst), memoryLimit(memoryLimit),
+          closureMark(program.states.size(), 0), kernelMark(program.states.size(), 0) {
+        counters.automata = 1;
+        computeByteClasses();
+        reset();
+    }
+
+    // 扫描器在计算转移之前报告已经经过的转移数, 用于统计命中率和判断缓存抖动
+    void countSteps(size_t count) {
+        counters.steps += count;
+        stepsSinceFlush += count;
+    }
+
+    const DfaStats& stats() const { return counters; }
+    bool isSimulating() const { return simulating; }
+
+    // 转移表按 (状态 << classShift()) | byteClasses()[字节] 索引
+    const int32_t* transitions() const { return table.data(); }
+    const uint8_t* byteClasses() const { return classOf; }
+    int classShift() const { return shift; }
+    int classCount() const { return classes; }
+
+    int contextOf(int byte) const {
+        if (program.usesWordBoundary && isWordByte(byte)) return CTX_WORD;
+        if (program.usesLineBegin && byte == '\n') return CTX_NEWLINE;
+        return CTX_OTHER;
+    }
+
+    int edgeContext() const {
+        return (program.usesLineBegin || program.usesTextBegin) ? CTX_EDGE : CTX_OTHER;
+    }
+
+    int startState(int context, bool anchored) {
+        if (simulating) {
+            vector<int> kernel(1, anchored ? program.start : program.unanchoredStart);
+            return assignSlot(1, kernel, context, noMatches);
+        }
+        int& cached = startCache[anchored ? 1 : 0][context];
+        if (cached < 0) {
+            vector<int> kernel(1, anchored ? program.start : program.unanchoredStart);
+            cached = intern(kernel, context, noMatches);
+        }
+        return cached;
+    }
+
+    // 计算并缓存转移, 返回带 SPECIAL 标记的目标状态
+    int32_t computeNext(int state, unsigned char byte) {
+        ++counters.misses;
+        if (!simulating && memoryUsage() > memoryLimit) {
+            state = flush(state);
+        }
+        bool matched = closure(state, byte);
+        nextKernel.clear();
+        ++kernelGeneration;
+        for (int s : closureList) {
+            const NfaState& nfa = program.states[s];
+            if (nfa.op == NFA_SET && program.sets[nfa.setIndex].has(byte) && kernelMark[nfa.out] != kernelGeneration) {
+                kernelMark[nfa.out] = kernelGeneration;
+                nextKernel.push_back(nfa.out);
+            }
+        }
+        const vector<int>& ids = matched ? closureMatches : noMatches;
+        if (simulating) {
+            int target = assignSlot(state == 1 ? 2 : 1, nextKernel, contextOf(byte), ids);
+            return target | (isSpecial(target) ? SPECIAL : 0);
+        }
+        int target = intern(nextKernel, contextOf(byte), ids);
+        int32_t tagged = target | (isSpecial(target) ? SPECIAL : 0);
+        table[(static_cast<size_t>(state) << shift) | classOf[byte]] = tagged;
+        return tagged;
+    }
+
+    // 输入结束时是否匹配
+    bool matchesAtEnd(int state) {
+        int8_t& cached = states[state].eofMatch;
+        if (cached < 0) cached = closure(state, -1) ? 1 : 0;
+        return cached == 1;
+    }
+
+    bool isMatchState(int state) const { return states[state].matchCount > 0; }
+    size_t stateCount() const { return states.size(); }
+    // 缓存的状态和转移表占用的字节数, 与 memoryLimit 比较
+    size_t memoryUsage() const {
+        return table.size() * sizeof(int32_t) + (kernels.size() + matchIdStore.size()) * sizeof(int) +
+               states.size() * sizeof(DfaState) + indexBytes;
+    }
+
+    // 在该状态之前结束的匹配所属的模式编号
+    const int* matchIds(int state, int& count) const {
+        count = states[state].matchCount;
+        return matchIdStore.data() + states[state].matchBegin;
+    }
+
+    // 输入结束时匹配的模式编号
+    const vector<int>& matchIdsAtEnd(int state) {
+        if (!closure(state, -1)) closureMatches.clear();
+        return closureMatches;
+    }
+
+private:
+    struct DfaState {
+        int kernelBegin;
+        int kernelSize;
+        int matchBegin;
+        int matchCount;
+        uint8_t context;
+        int8_t eofMatch;
+    };
+
+    const RegexProgram& program;
+    bool leftmostFirst;
+    size_t memoryLimit;
+    bool simulating = false;
+    DfaStats counters;
+    uint64_t stepsSinceFlush = 0;
+    size_t indexBytes = 0;  // 状态索引占用的内存估计
+    vector<DfaState> states;
+    vector<int> kernels;
+    vector<int> matchIdStore;
+    vector<int32_t> table;
+    uint8_t classOf[256];
+    int classes = 1;
+    int shift = 0;
+    unordered_map<string, int> index;
+    int startCache[2][4];
+
+    vector<int> closureList;
+    vector<int> closureMatches;
+    const vector<int> noMatches;
+    vector<int> closureStack;
+    vector<uint32_t> closureMark;
+    uint32_t closureGeneration = 0;
+    vector<int> nextKernel;
+    vector<uint32_t> kernelMark;
+    uint32_t kernelGeneration = 0;
+    string keyBuffer;
+
+    bool isSpecial(int state) const { return state == DEAD || states[state].matchCount > 0; }
+
+    // 字节等价类: 程序中所有集合 (以及换行符、单词字符边界) 都不区分的字节归为一类,
+    // 同类字节的转移必然相同. 按相邻字节是否被某个集合分开划分, 每行只需 2^shift 个槽
+    void computeByteClasses() {
+        bool boundary[256] = {false};
+        for (const ByteSet& set : program.sets) {
+            for (int c = 1; c < 256; ++c) {
+                if (set.has(static_cast<unsigned char>(c)) != set.has(static_cast<unsigned char>(c - 1))) boundary[c] = true;
+            }
+        }
+        boundary['\n'] = boundary['\n' + 1] = true;  // 行尾断言看下一个字节是否为换行
+        if (program.usesWordBoundary) {
+            for (int c = 1; c < 256; ++c) {
+                if (isWordByte(c) != isWordByte(c - 1)) boundary[c] = true;
+            }
+        }
+        classOf[0] = 0;
+        for (int c = 1; c < 256; ++c) classOf[c] = static_cast<uint8_t>(classOf[c - 1] + (boundary[c] ? 1 : 0));
+        classes = classOf[255] + 1;
+        counters.byteClasses = static_cast<size_t>(classes);
+        shift = 0;
+        while ((1 << shift) < classes) ++shift;
+    }
+
+    void reset() {
+        states.clear();
+        kernels.clear();
+        matchIdStore.clear();
+        table.clear();
+        index.clear();
+        indexBytes = 0;
+        for (int a = 0; a < 2; ++a)
+            for (int c = 0; c < 4; ++c) startCache[a][c] = -1;
+        vector<int> empty;
+        intern(empty, CTX_OTHER, noMatches);  // DEAD
+    }
+
+    // 缓存超出内存上限时清空, 仅保留当前状态; 抖动时转为 NFA 模拟
+    int flush(int state) {
+        vector<int> kernel(kernels.begin() + states[state].kernelBegin,
+                           kernels.begin() + states[state].kernelBegin + states[state].kernelSize);
+        vector<int> ids(matchIdStore.begin() + states[state].matchBegin,
+                        matchIdStore.begin() + states[state].matchBegin + states[state].matchCount);
+        uint8_t context = states[state].context;
+        bool thrashing = ++counters.flushes >= 3 && stepsSinceFlush < 10 * states.size();
+        stepsSinceFlush = 0;
+        if (thrashing) {
+            startSimulating();
+            return assignSlot(1, kernel, context, ids);
+        }
+        reset();
+        return intern(kernel, context, ids);
+    }
+
+    // 状态表只剩 DEAD 和两个槽, 每个槽预留足够容纳任意状态的空间; 转移表全为 UNKNOWN
+    void startSimulating() {
+        reset();
+        simulating = true;
+        counters.simulating = 1;
+        size_t capacity = program.states.size();
+        kernels.assign(3 * capacity, 0);
+        matchIdStore.assign(3 * capacity, 0);
+        DfaState slot = {0, 0, 0, 0, CTX_OTHER, -1};
+        for (int k = 1; k <= 2; ++k) {
+            slot.kernelBegin = slot.matchBegin = static_cast<int>(k * capacity);
+            states.push_back(slot);
+        }
+        table.assign(states.size() << shift, UNKNOWN);
+    }
+
+    int assignSlot(int slot, const vector<int>& kernel, int context, const vector<int>& ids) {
+        if (kernel.empty() && ids.empty()) return DEAD;
+        DfaState& state = states[slot];
+        copy(kernel.begin(), kernel.end(), kernels.begin() + state.kernelBegin);
+        copy(ids.begin(), ids.end(), matchIdStore.begin() + state.matchBegin);
+        state.kernelSize = static_cast<int>(kernel.size());
+        state.matchCount = static_cast<int>(ids.size());
+        state.context = static_cast<uint8_t>(context);
+        state.eofMatch = -1;
+        return slot;
+    }
+
+    bool assertionHolds(int kind, int context, int next) const {
+        switch (kind) {
+            case ASSERT_TEXT_BEGIN: return context == CTX_EDGE;
+            case ASSERT_LINE_BEGIN: return context == CTX_EDGE || context == CTX_NEWLINE;
+            case ASSERT_TEXT_END: return next < 0;
+            case ASSERT_LINE_END: return next < 0 || next == '\n';
+            case ASSERT_WORD_BOUNDARY: return (context == CTX_WORD) != isWordByte(next);
+            case ASSERT_NOT_WORD_BOUNDARY: return (context == CTX_WORD) == isWordByte(next);
+        }
+        return false;
+    }
+
+    // 按优先级顺序计算 epsilon 闭包, next 为下一个字节 (-1 表示输入结束)
+    bool closure(int state, int next) {
+        closureList.clear();
+        closureMatches.clear();
+        ++closureGeneration;
+        const DfaState& dfaState = states[state];
+        bool matched = false;
+        for (int k = 0; k < dfaState.kernelSize; ++k) {
+            closureStack.push_back(kernels[dfaState.kernelBegin + k]);
+            while (!closureStack.empty()) {
+                int s = closureStack.back();
+                closureStack.pop_back();
+                if (closureMark[s] == closureGeneration) continue;
+                closureMark[s] = closureGeneration;
+                const NfaState& nfa = program.states[s];
+                switch (nfa.op) {
+                    case NFA_SET:
+                        closureList.push_back(s);
+                        break;
+                    case NFA_MATCH:
+                        matched = true;
+                        if (find(closureMatches.begin(), closureMatches.end(), nfa.out) == closureMatches.end()) {
+                            closureMatches.push_back(nfa.out);
+                        }
+                        if (leftmostFirst) {
+                            closureStack.clear();
+                            return true;
+                        }
+                        break;
+                    case NFA_SPLIT:
+                        closureStack.push_back(nfa.out1);
+                        closureStack.push_back(nfa.out);
+                        break;
+                    case NFA_EPSILON:
+                        closureStack.push_back(nfa.out);
+                        break;
+                    case NFA_ASSERT:
+                        if (assertionHolds(nfa.assertion, dfaState.context, next)) closureStack.push_back(nfa.out);
+                        break;
+                }
+            }
+        }
+        return matched;
+    }
+
+    int intern(const vector<int>& kernel, int context, const vector<int>& ids) {
+        if (kernel.empty() && ids.empty() && !states.empty()) return DEAD;
+        keyBuffer.assign(1, static_cast<char>(context));
+        int idCount = static_cast<int>(ids.size());
+        keyBuffer.append(reinterpret_cast<const char*>(&idCount), sizeof(idCount));
+        keyBuffer.append(reinterpret_cast<const char*>(ids.data()), ids.size() * sizeof(int));
+        keyBuffer.append(reinterpret_cast<const char*>(kernel.data()), kernel.size() * sizeof(int));
+        auto found = index.find(keyBuffer);
+        if (found != index.end()) return found->second;
+        DfaState state;
+        state.kernelBegin = static_cast<int>(kernels.size());
+        state.kernelSize = static_cast<int>(kernel.size());
+        state.matchBegin = static_cast<int>(matchIdStore.size());
+        state.matchCount = static_cast<int>(ids.size());
+        state.context = static_cast<uint8_t>(context);
+        state.eofMatch = -1;
+        kernels.insert(kernels.end(), kernel.begin(), kernel.end());
+        matchIdStore.insert(matchIdStore.end(), ids.begin(), ids.end());
+        states.push_back(state);
+        table.resize(states.size() << shift, UNKNOWN);
+        int id = static_cast<int>(states.size()) - 1;
+        index.emplace(keyBuffer, id);
+        indexBytes += keyBuffer.size() + 64;
+        ++counters.built;
+        counters.peakStates = max(counters.peakStates, states.size());
+        return id;
+    }
+};
+
+// 位并行 Glushkov 自动机: 位置 (程序中消耗字节的状态) 不超过 64 个时, 自动机状态是一个 64 位字,
+// 第 k 位表示刚读入的字节匹配了位置 k. 读入字节 c 时
+//   D' = (Follow(D) | first) & byteMask[c]
+// Follow 按 8 位一块查表后按位或, 不需要构造状态, 内存固定, 也没有分支
+// 只处理不含断言、不匹配空串的程序, 其他情况由惰性 DFA 负责
+enum BitParallelStatus {
+    BIT_PARALLEL_OK,
+    BIT_PARALLEL_TOO_MANY_POSITIONS,
+    BIT_PARALLEL_ASSERTIONS,
+    BIT_PARALLEL_NULLABLE
+};
+
+class BitParallelAutomaton {
+public:
+    static const int MAX_POSITIONS = 64;
+    static const int SHIFTS = 3;
+
+    BitParallelStatus build(const RegexProgram& program) {
+        vector<int> positionOf(program.states.size(), -1);
+        vector<int> stateOf;
+        bool assertions = false;
+        for (size_t s = 0; s < program.states.size(); ++s) {
+            assertions = assertions || program.states[s].op == NFA_ASSERT;
+            if (program.states[s].op != NFA_SET) continue;
+            positionOf[s] = static_cast<int>(stateOf.size());
+            stateOf.push_back(static_cast<int>(s));
+        }
+        positions = static_cast<int>(stateOf.size());
+        if (positions > MAX_POSITIONS) return BIT_PARALLEL_TOO_MANY_POSITIONS;
+        if (assertions) return BIT_PARALLEL_ASSERTIONS;
+        if (closure(program, positionOf, program.start, first)) return BIT_PARALLEL_NULLABLE;
+
+        final = 0;
+        for (uint64_t& mask : byteMask) mask = 0;
+        vector<uint64_t> followOf(positions, 0);
+        for (int p = 0; p < positions; ++p) {
+            const NfaState& state = program.states[stateOf[p]];
+            uint64_t bit = uint64_t(1) << p;
+            if (closure(program, positionOf, state.out, followOf[p])) final |= bit;
+            const ByteSet& set = program.sets[state.setIndex];
+            for (int c = 0; c < 256; ++c) {
+                if (set.has(static_cast<unsigned char>(c))) byteMask[c] |= bit;
+            }
+        }
+
+        // 边 p -> p + d 中 d 为 0 (自循环)、1 (下一位置)、2 (跳过一个可选位置) 的用常数移位完成,
+        // 其余的边 (分支汇合、向后的循环等) 按 8 位一块查表
+        for (int d = 0; d < SHIFTS; ++d) {
+            shiftMask[d] = 0;
+            for (int p = 0; p + d < positions; ++p) {
+                uint64_t target = uint64_t(1) << (p + d);
+                if (followOf[p] & target) {
+                    shiftMask[d] |= uint64_t(1) << p;
+                    followOf[p] &= ~target;
+                }
+            }
+        }
+        chunks.clear();
+        follow.clear();
+        for (int begin = 0; begin < positions; begin += 8) {
+            int end = min(positions, begin + 8);
+            bool needed = false;
+            for (int p = begin; p < end; ++p) needed = needed || followOf[p] != 0;
+            if (!needed) continue;
+            chunks.push_back(begin);
+            size_t base = follow.size();
+            follow.resize(base + 256, 0);
+            for (int index = 0; index < 256; ++index) {
+                for (int p = begin; p < end; ++p) {
+                    if ((index >> (p - begin)) & 1) follow[base + index] |= followOf[p];
+                }
+            }
+        }
+        return BIT_PARALLEL_OK;
+    }
+
+    int positionCount() const { return positions; }
+
+    // 非锚定地从 pos 开始查找最早的匹配结尾, 没有时返回 false.
+    // restart 为此前最后一个没有活跃线程的位置: 任何从 pos 起的匹配都不会在 restart 之前开始
+    bool findEarliestEnd(const uint8_t* data, size_t pos, size_t limit, size_t& end, size_t& restart) const {
+        switch (chunks.size()) {
+            case 0: return findEarliestEnd<0>(data, pos, limit, end, restart);
+            case 1: return findEarliestEnd<1>(data, pos, limit, end, restart);
+            default: return findEarliestEnd<-1>(data, pos, limit, end, restart);
+        }
+    }
+
+    // 锚定在 end 的反向程序: 向前读到 lowerBound 为止, 返回最长匹配的起点 (没有匹配时返回 end)
+    size_t findLongestReverse(const uint8_t* data, size_t end, size_t lowerBound) const {
+        size_t best = end;
+        uint64_t state = first;
+        for (size_t i = end; i > lowerBound; --i) {
+            state &= byteMask[data[i - 1]];
+            if (state == 0) break;
+            if (state & final) best = i - 1;
+            state = step<-1>(state);
+        }
+        return best;
+    }
+
+private:
+    int positions = 0;
+    uint64_t first = 0;  // 可以作为匹配第一个字节的位置
+    uint64_t final = 0;  // 读入后即构成完整匹配的位置
+    uint64_t byteMask[256];
+    uint64_t shiftMask[SHIFTS];  // shiftMask[d]: 有到 p + d 的边的位置 p
+    vector<int> chunks;          // 需要查表的块的起始位
+    vector<uint64_t> follow;     // 每块一张 256 项的表
+
+    // Chunks 为查表的块数, -1 表示任意块数
+    template <int Chunks>
+    uint64_t step(uint64_t state) const {
+        uint64_t next = (state & shiftMask[0]) | ((state & shiftMask[1]) << 1) | ((state & shiftMask[2]) << 2);
+        size_t count = Chunks < 0 ? chunks.size() : static_cast<size_t>(Chunks);
+        for (size_t k = 0; k < count; ++k) next |= follow[k * 256 + ((state >> chunks[k]) & 255)];
+        return next;
+    }
+
+    template <int Chunks>
+    bool findEarliestEnd(const uint8_t* data, size_t pos, size_t limit, size_t& end, size_t& restart) const {
+        uint64_t state = 0;
+        size_t lastIdle = pos;
+        for (size_t i = pos; i < limit; ++i) {
+            state = (step<Chunks>(state) | first) & byteMask[data[i]];
+            if (state & final) {
+                end = i + 1;
+                restart = lastIdle;
+                return true;
+            }
+            lastIdle = state == 0 ? i + 1 : lastIdle;
+        }
+        return false;
+    }
+
+    // from 的 epsilon 闭包中的位置写入 result, 返回闭包是否含匹配状态
+    static bool closure(const RegexProgram& program, const vector<int>& positionOf, int from, uint64_t& result) {
+        result = 0;
+        bool matched = false;
+        vector<int> stack(1, from);
+        vector<char> seen(program.states.size(), 0);
+        while (!stack.empty()) {
+            int s = stack.back();
+            stack.pop_back();
+            if (seen[s]) continue;
+            seen[s] = 1;
+            const NfaState& state = program.states[s];
+            switch (state.op) {
+                case NFA_SET: result |= uint64_t(1) << positionOf[s]; break;
+                case NFA_MATCH: matched = true; break;
+                case NFA_SPLIT:
+                    stack.push_back(state.out1);
+                    stack.push_back(state.out);
+                    break;
+                case NFA_EPSILON: stack.push_back(state.out); break;
+            }
+        }
+        return matched;
+    }
+};
+
+#if defined(__x86_64__) || defined(__i386__)
+#define REGEN_X86_SIMD 1
+#include <immintrin.h>
+
+inline bool cpuHasAvx2() {
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+}
+
+inline size_t findBytesSse2(const uint8_t* data, size_t pos, size_t size, const unsigned char* bytes, int count) {
+    __m128i b0 = _mm_set1_epi8(static_cast<char>(bytes[0]));
+    __m128i b1 = _mm_set1_epi8(static_cast<char>(bytes[count > 1 ? 1 : 0]));
+    __m128i b2 = _mm_set1_epi8(static_cast<char>(bytes[count > 2 ? 2 : 0]));
+    for (; pos + 16 <= size; pos += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+        __m128i hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, b0), _mm_cmpeq_epi8(chunk, b1)),
+                                    _mm_cmpeq_epi8(chunk, b2));
+        int mask = _mm_movemask_epi8(hits);
+        if (mask != 0) return pos + __builtin_ctz(mask);
+    }
+    return pos;
+}
+
+__attribute__((target("avx2")))
+inline size_t findBytesAvx2(const uint8_t* data, size_t pos, size_t size, const unsigned char* bytes, int count) {
+    __m256i b0 = _mm256_set1_epi8(static_cast<char>(bytes[0]));
+    __m256i b1 = _mm256_set1_epi8(static_cast<char>(bytes[count > 1 ? 1 : 0]));
+    __m256i b2 = _mm256_set1_epi8(static_cast<char>(bytes[count > 2 ? 2 : 0]));
+    for (; pos + 32 <= size; pos += 32) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+        __m256i hits = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, b0), _mm256_cmpeq_epi8(chunk, b1)),
+                                       _mm256_cmpeq_epi8(chunk, b2));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(hits));
+        if (mask != 0) return pos + __builtin_ctz(mask);
+    }
+    return pos;
+}
+
+// 同时比较字面量中两个稀有字节的位置, 返回第一个候选或停止扫描的位置
+inline size_t findPairSse2(const uint8_t* data, size_t pos, size_t last, unsigned char c1, size_t o1,
+                    unsigned char c2, size_t o2, uint32_t& mask) {
+    __m128i v1 = _mm_set1_epi8(static_cast<char>(c1));
+    __m128i v2 = _mm_set1_epi8(static_cast<char>(c2));
+    for (; pos + 16 <= last; pos += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos + o1));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos + o2));
+        mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, v1), _mm_cmpeq_epi8(b, v2))));
+        if (mask != 0) return pos;
+    }
+    mask = 0;
+    return pos;
+}
+
+__attribute__((target("avx2")))
+inline size_t findPairAvx2(const uint8_t* data, size_t pos, size_t last, unsigned char c1, size_t o1,
+                    unsigned char c2, size_t o2, uint32_t& mask) {
+    __m256i v1 = _mm256_set1_epi8(static_cast<char>(c1));
+    __m256i v2 = _mm256_set1_epi8(static_cast<char>(c2));
+    for (; pos + 32 <= last; pos += 32) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos + o1));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos + o2));
+        mask = static_cast<uint32_t>(_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(a, v1), _mm256_cmpeq_epi8(b, v2))));
+        if (mask != 0) return pos;
+    }
+    mask = 0;
+    return pos;
+}
+#endif
+
+enum PrefilterKind {
+    PREFILTER_NONE,
+    PREFILTER_BYTES,    // 任意 1-3 个字节之一 (memchr/memchr2/memchr3)
+    PREFILTER_LITERAL   // 子串 (按两个稀有字节定位的 memmem)
+};
+
+// 在运行完整自动机之前快速跳到可能匹配的位置
+struct Prefilter {
+    PrefilterKind kind = PREFILTER_NONE;
+    unsigned char bytes[3] = {0, 0, 0};
+    int byteCount = 0;
+    string literal;
+    size_t rareOffset = 0;    // 字面量中最稀有字节的位置
+    size_t secondOffset = 0;  // 次稀有字节的位置
+
+    // 返回 [pos, size) 中第一个候选的位置 (字面量的起点), 没有时返回 size
+    size_t find(const uint8_t* data, size_t pos, size_t size) const {
+        if (kind == PREFILTER_BYTES) return findBytes(data, pos, size);
+        if (kind == PREFILTER_LITERAL) return findLiteral(data, pos, size);
+        return pos;
+    }
+
+    size_t length() const { return kind == PREFILTER_LITERAL ? literal.size() : 1; }
+
+    string describe() const {
+        stringstream text;
+        auto show = [&](unsigned char c) {
+            if (isprint(c)) text << '\'' << static_cast<char>(c) << '\'';
+            else text << "0x" << hex << setw(2) << setfill('0') << static_cast<int>(c) << dec;
+        };
+        if (kind == PREFILTER_BYTES) {
+            text << (byteCount == 1 ? "memchr" : byteCount == 2 ? "memchr2" : "memchr3") << " ";
+            for (int k = 0; k < byteCount; ++k) {
+                if (k > 0) text << ", ";
+                show(bytes[k]);
+            }
+        } else if (kind == PREFILTER_LITERAL) {
+            text << "memmem \"" << escapeStrayBytes(literal) << "\" (";
+            show(static_cast<unsigned char>(literal[rareOffset]));
+            text << " + ";
+            show(static_cast<unsigned char>(literal[secondOffset]));
+            text << ")";
+        } else {
+            text << "none";
+        }
+#ifdef REGEN_X86_SIMD
+        if (kind != PREFILTER_NONE) text << (cpuHasAvx2() ? " [AVX2]" : " [SSE2]");
+#endif
+        return text.str();
+    }
+
+private:
+    size_t findBytes(const uint8_t* data, size_t pos, size_t size) const {
+        if (byteCount == 1) {
+            const void* hit = memchr(data + pos, bytes[0], size - pos);
+            return hit != nullptr ? static_cast<size_t>(static_cast<const uint8_t*>(hit) - data) : size;
+        }
+#ifdef REGEN_X86_SIMD
+        pos = cpuHasAvx2() ? findBytesAvx2(data, pos, size, bytes, byteCount)
+                           : findBytesSse2(data, pos, size, bytes, byteCount);
+#endif
+        for (; pos < size; ++pos) {
+            unsigned char c = data[pos];
+            if (c == bytes[0] || (byteCount > 1 && c == bytes[1]) || (byteCount > 2 && c == bytes[2])) return pos;
+        }
+        return size;
+    }
+
+    size_t findLiteral(const uint8_t* data, size_t pos, size_t size) const {
+        size_t n = literal.size();
+        if (size < n || pos > size - n) return size;
+        size_t last = size - n + 1;  // 候选起点的上界 (不含)
+        unsigned char c1 = static_cast<unsigned char>(literal[rareOffset]);
+        unsigned char c2 = static_cast<unsigned char>(literal[secondOffset]);
+#ifdef REGEN_X86_SIMD
+        size_t span = max(rareOffset, secondOffset);
+        while (pos < last) {
+            uint32_t mask;
+            size_t limit = last + n - 1 - span;  // 保证加载不越过 size
+            pos = cpuHasAvx2() ? findPairAvx2(data, pos, limit, c1, rareOffset, c2, secondOffset, mask)
+                               : findPairSse2(data, pos, limit, c1, rareOffset, c2, secondOffset, mask);
+            if (mask == 0) break;
+            while (mask != 0) {
+                size_t candidate = pos + __builtin_ctz(mask);
+                mask &= mask - 1;
+                if (candidate < last && memcmp(data + candidate, literal.data(), n) == 0) return candidate;
+            }
+            pos += cpuHasAvx2() ? 32 : 16;
+        }
+#endif
+        for (; pos < last; ++pos) {
+            if (data[pos + rareOffset] == c1 && data[pos + secondOffset] == c2 &&
+                memcmp(data + pos, literal.data(), n) == 0) {
+                return pos;
+            }
+        }
+        return size;
+    }
+};
+
+// 编译后的模式: 正向程序用于查找匹配结尾, 反向程序用于确定匹配起点
+struct CompiledPattern {
+    RegexProgram forward;
+    RegexProgram reverse;
+    ByteSet consumable;  // 匹配中可能出现的所有字节
+    Prefilter prefilter;
+};
+
+bool compilePattern(const RegexAst& source, CompiledPattern& compiled, string& error);
+bool compilePattern(const string& pattern, const GenerationOptions& options, CompiledPattern& compiled, string& error);
+
+// 在内存缓冲区中查找匹配 (最左优先, 不重叠), 每个线程使用独立的扫描器
+// 预过滤所用的时间和跳过的字节 (--profile 用来区分预过滤和自动机匹配)
+struct PrefilterProfile {
+    uint64_t nanoseconds = 0;
+    uint64_t bytes = 0;
+    uint64_t candidates = 0;
+};
+
+class PatternScanner {
+public:
+    // cacheLimit: 正向和反向惰性 DFA 各自的内存预算
+    explicit PatternScanner(const CompiledPattern& pattern, size_t cacheLimit = 64u << 20)
+        : pattern(pattern), forward(pattern.forward, true, cacheLimit), reverse(pattern.reverse, false, cacheLimit) {
+        bitParallel = forwardBits.build(pattern.forward) == BIT_PARALLEL_OK &&
+                      reverseBits.build(pattern.reverse) == BIT_PARALLEL_OK;
+    }
+
+    void addStats(DfaStats& forwardStats, DfaStats& reverseStats) const {
+        forwardStats.merge(forward.stats());
+        reverseStats.merge(reverse.stats());
+    }
+
+    // 两个惰性 DFA 当前的缓存占用
+    size_t memoryUsage() const { return forward.memoryUsage() + reverse.memoryUsage(); }
+
+    // 非空时为每次预过滤计时; 为空时只多一次按候选 (而不是按字节) 的判断
+    void setPrefilterProfile(PrefilterProfile* profile) { prefilterProfile = profile; }
+
+    // 有预过滤器时只在候选附近运行自动机: 匹配不会跨越不可消耗的字节,
+    // 因此只需扫描包含候选的那一段可消耗字节
+    template <typename Callback>
+    void findAll(const uint8_t* data, size_t size, Callback onMatch) {
+        findAll(data, size, 0, size, onMatch);
+    }
+
+    // 查找 [begin, end) 中的匹配; end 之前的字节必须不可消耗 (或 end == size)
+    template <typename Callback>
+    void findAll(const uint8_t* data, size_t size, size_t begin, size_t end, Callback onMatch) {
+        const Prefilter& prefilter = pattern.prefilter;
+        if (prefilter.kind == PREFILTER_NONE) {
+            findAllInRange(data, size, begin, end, onMatch);
+            return;
+        }
+        const ByteSet& consumable = pattern.consumable;
+        size_t pos = begin;
+        size_t candidates = 0;
+        while (pos < end) {
+            size_t hit = prefilterProfile == nullptr ? prefilter.find(data, pos, end) : profiledFind(data, pos, end);
+            if (hit >= end) return;
+            // 候选过于密集时预过滤得不偿失, 剩余部分直接交给自动机
+            if (++candidates > 256 && candidates * 64 > hit - begin) {
+                findAllInRange(data, size, pos, end, onMatch);
+                return;
+            }
+            size_t windowBegin = hit;
+            while (windowBegin > pos && consumable.has(data[windowBegin - 1])) --windowBegin;
+            size_t limit = hit + prefilter.length();
+            while (limit < end && consumable.has(data[limit])) ++limit;
+            findAllInRange(data, size, windowBegin, limit, onMatch);
+            pos = limit;
+        }
+    }
+
+    // 只在 [begin, limit) 中查找, 断言仍参考范围外的字节
+    template <typename Callback>
+    void findAllInRange(const uint8_t* data, size_t size, size_t begin, size_t limit, Callback onMatch) {
+        size_t pos = begin;
+        while (pos <= limit) {
+            long long end = searchForward(data, size, pos, limit);
+            if (end < 0) break;
+            size_t start = searchReverse(data, size, static_cast<size_t>(end), pos);
+            onMatch(start, static_cast<size_t>(end));
+            pos = (static_cast<size_t>(end) == start) ? start + 1 : static_cast<size_t>(end);
+        }
+    }
+
+private:
+    const CompiledPattern& pattern;
+    LazyDfa forward;
+    LazyDfa reverse;
+    // 模式足够短时由位并行自动机确定匹配起点 (反向查找只需要最长匹配, 与分支优先级无关).
+    // 正向的惰性 DFA 缓存有效时每字节只查一次表, 比位并行的移位和按位运算更快;
+    // 缓存抖动改用 NFA 模拟后, 改由位并行自动机扫过不匹配的文本, 惰性 DFA 只在匹配附近
+    // 确定最左优先的结尾 (位并行自动机不区分分支的优先级)
+    bool bitParallel = false;
+    BitParallelAutomaton forwardBits;
+    BitParallelAutomaton reverseBits;
+    PrefilterProfile* prefilterProfile = nullptr;
+
+    size_t profiledFind(const uint8_t* data, size_t pos, size_t end) {
+        auto start = chrono::steady_clock::now();
+        size_t hit = pattern.prefilter.find(data, pos, end);
+        prefilterProfile->nanoseconds += static_cast<uint64_t>(
+            chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count());
+        prefilterProfile->bytes += min(hit, end) - pos;
+        if (hit < end) ++prefilterProfile->candidates;
+        return hit;
+    }
+
+    // 返回 [pos, limit) 中最左匹配的结尾, 没有匹配时返回 -1
+    long long searchForward(const uint8_t* data, size_t size, size_t pos, size_t limit) {
+        if (bitParallel && forward.isSimulating()) {
+            size_t earliestEnd, restart;
+            if (!forwardBits.findEarliestEnd(data, pos, limit, earliestEnd, restart)) return -1;
+            pos = restart;
+        }
+        int context = pos == 0 ? forward.edgeContext() : forward.contextOf(data[pos - 1]);
+        uint32_t state = static_cast<uint32_t>(forward.startState(context, false));
+        long long lastMatch = -1;
+        size_t i = pos;
+        size_t counted = pos;  // 已计入统计的位置, 只在缓存未命中时更新, 不拖慢快速路径
+        const uint8_t* classes = forward.byteClasses();
+        const int shift = forward.classShift();
+        while (true) {
+            const int32_t* table = forward.transitions();
+            while (i < limit) {
+                uint32_t next = static_cast<uint32_t>(table[(static_cast<size_t>(state) << shift) | classes[data[i]]]);
+                if (next >= static_cast<uint32_t>(LazyDfa::SPECIAL)) break;
+                state = next;
+                ++i;
+            }
+            if (i >= limit) break;
+            int32_t next = table[(static_cast<size_t>(state) << shift) | classes[data[i]]];
+            if (next == LazyDfa::UNKNOWN) {
+                forward.countSteps(i - counted);
+                counted = i;
+                next = forward.computeNext(static_cast<int>(state), data[i]);
+            }
+            if (next & LazyDfa::SPECIAL) {
+                int target = next & ~LazyDfa::SPECIAL;
+                if (target == LazyDfa::DEAD) {
+                    forward.countSteps(i + 1 - counted);
+                    return lastMatch;
+                }
+                lastMatch = static_cast<long long>(i);
+                state = static_cast<uint32_t>(target);
+            } else {
+                state = static_cast<uint32_t>(next);
+            }
+            ++i;
+        }
+        forward.countSteps(i - counted);
+        if (limit == size) {
+            if (forward.matchesAtEnd(static_cast<int>(state))) lastMatch = static_cast<long long>(size);
+        } else {
+            forward.countSteps(1);
+            int32_t next = forward.transitions()[(static_cast<size_t>(state) << shift) | classes[data[limit]]];
+            if (next == LazyDfa::UNKNOWN) next = forward.computeNext(static_cast<int>(state), data[limit]);
+            if ((next & LazyDfa::SPECIAL) && (next & ~LazyDfa::SPECIAL) != LazyDfa::DEAD) {
+                lastMatch = static_cast<long long>(limit);
+            }
+        }
+        return lastMatch;
+    }
+
+    // 从 end 向前查找最长的反向匹配, 得到匹配起点 (不早于 lowerBound)
+    size_t searchReverse(const uint8_t* data, size_t size, size_t end, size_t lowerBound) {
+        if (bitParallel) return reverseBits.findLongestReverse(data, end, lowerBound);
+        int context = end == size ? reverse.edgeContext() : reverse.contextOf(data[end]);
+        int state = reverse.startState(context, true);
+        size_t best = end;
+        size_t i = end;
+        size_t counted = end;
+        const uint8_t* classes = reverse.byteClasses();
+        const int shift = reverse.classShift();
+        while (i > lowerBound) {
+            int32_t next = reverse.transitions()[(static_cast<size_t>(state) << shift) | classes[data[i - 1]]];
+            if (next == LazyDfa::UNKNOWN) {
+                reverse.countSteps(counted - i);
+                counted = i;
+                next = reverse.computeNext(state, data[i - 1]);
+            }
+            if (next & LazyDfa::SPECIAL) {
+                int target = next & ~LazyDfa::SPECIAL;
+                if (target == LazyDfa::DEAD) {
+                    reverse.countSteps(counted - i + 1);
+                    return best;
+                }
+                best = i;
+                state = target;
+            } else {
+                state = next;
+            }
+            --i;
+        }
+        reverse.countSteps(counted - i);
+        if (lowerBound == 0) {
+            if (reverse.matchesAtEnd(state)) best = 0;
+        } else {
+            reverse.countSteps(1);
+            int32_t next = reverse.transitions()[(static_cast<size_t>(state) << shift) | classes[data[lowerBound - 1]]];
+            if (next == LazyDfa::UNKNOWN) next = reverse.computeNext(state, data[lowerBound - 1]);
+            if ((next & LazyDfa::SPECIAL) && (next & ~LazyDfa::SPECIAL) != LazyDfa::DEAD) best = lowerBound;
+        }
+        return best;
+    }
+};
+
+// 多模式集合: 所有模式编译进同一个正向自动机, 匹配状态带有模式编号
+struct CompiledPatternSet {
+    vector<string> names;
+    vector<CompiledPattern> patterns;  // 用于确认每个命中的精确边界
+    RegexProgram combined;
+    shared_ptr<const void> storage;  // 从自动机缓存载入时持有文件映射, 各程序的表引用其中的内容
+};
+
+bool compilePatternSet(const vector<pair<string, string>>& namedPatterns, const GenerationOptions& options,
+                       CompiledPatternSet& compiled, string& error);
+
+// 单遍多模式扫描: 组合自动机报告每个模式的匹配结尾,
+// 再在包含该结尾的可匹配字节区间内用该模式自己的扫描器确认边界
+class MultiPatternScanner {
+public:
+    explicit MultiPatternScanner(const CompiledPatternSet& set, size_t cacheLimit = 64u << 20)
+        : set(set), combined(set.combined, false, cacheLimit) {
+        for (const CompiledPattern& pattern : set.patterns) {
+            scanners.push_back(unique_ptr<PatternScanner>(new PatternScanner(pattern, cacheLimit)));
+        }
+    }
+
+    void addStats(DfaStats& combinedStats, DfaStats& forwardStats, DfaStats& reverseStats) const {
+        combinedStats.merge(combined.stats());
+        for (const auto& scanner : scanners) scanner->addStats(forwardStats, reverseStats);
+    }
+
+    // onMatch(模式编号, 起点, 结尾)
+    template <typename Callback>
+    void findAll(const uint8_t* data, size_t size, Callback onMatch) {
+        findAll(data, size, 0, size, onMatch);
+    }
+
+    // 查找 [begin, end) 中的匹配; end 之前的字节必须不可被任何模式消耗 (或 end == size)
+    template <typename Callback>
+    void findAll(const uint8_t* data, size_t size, size_t begin, size_t end, Callback onMatch) {
+        size_t count = set.patterns.size();
+        scannedUntil.assign(count, begin);
+        lastEnd.assign(count, begin);
+        int context = begin == 0 ? combined.edgeContext() : combined.contextOf(data[begin - 1]);
+        uint32_t state = static_cast<uint32_t>(combined.startState(context, false));
+        size_t i = begin;
+        size_t counted = begin;
+        const uint8_t* classes = combined.byteClasses();
+        const int shift = combined.classShift();
+        while (true) {
+            const int32_t* table = combined.transitions();
+            while (i < end) {
+                uint32_t next = static_cast<uint32_t>(table[(static_cast<size_t>(state) << shift) | classes[data[i]]]);
+                if (next >= static_cast<uint32_t>(LazyDfa::SPECIAL)) break;
+                state = next;
+                ++i;
+            }
+            if (i >= end) break;
+            int32_t next = table[(static_cast<size_t>(state) << shift) | classes[data[i]]];
+            if (next == LazyDfa::UNKNOWN) {
+                combined.countSteps(i - counted);
+                counted = i;
+                next = combined.computeNext(static_cast<int>(state), data[i]);
+            }
+            state = static_cast<uint32_t>(next & ~LazyDfa::SPECIAL);
+            if (next & LazyDfa::SPECIAL) {
+                int idCount;
+                const int* ids = combined.matchIds(static_cast<int>(state), idCount);
+                for (int k = 0; k < idCount; ++k) confirm(data, size, ids[k], i, onMatch);
+            }
+            ++i;
+        }
+        combined.countSteps(i - counted);
+        if (end == size) {
+            const vector<int>& ids = combined.matchIdsAtEnd(static_cast<int>(state));
+            vector<int> endIds(ids.begin(), ids.end());
+            for (int id : endIds) confirm(data, size, id, size, onMatch);
+        } else {
+            combined.countSteps(1);
+            int32_t next = combined.transitions()[(static_cast<size_t>(state) << shift) | classes[data[end]]];
+            if (next == LazyDfa::UNKNOWN) next = combined.computeNext(static_cast<int>(state), data[end]);
+            if (next & LazyDfa::SPECIAL) {
+                int idCount;
+                const int* ids = combined.matchIds(static_cast<int>(next & ~LazyDfa::SPECIAL), idCount);
+                vector<int> endIds(ids, ids + idCount);
+                for (int id : endIds) confirm(data, size, id, end, onMatch);
+            }
+        }
+    }
+
+private:
+    const CompiledPatternSet& set;
+    LazyDfa combined;
+    vector<unique_ptr<PatternScanner>> scanners;
+    vector<size_t> scannedUntil;
+    vector<size_t> lastEnd;
+
+    template <typename Callback>
+    void confirm(const uint8_t* data, size_t size, int id, size_t end, Callback& onMatch) {
+        if (end <= scannedUntil[id]) return;
+        const ByteSet& consumable = set.patterns[id].consumable;
+        size_t begin = end;
+        while (begin > lastEnd[id] && consumable.has(data[begin - 1])) --begin;
+        size_t limit = end;
+        while (limit < size && consumable.has(data[limit])) ++limit;
+        scanners[id]->findAllInRange(data, size, begin, limit, [&](size_t start, size_t stop) {
+            if (stop == start) return;
+            onMatch(id, start, stop);
+            lastEnd[id] = stop;
+        });
+        scannedUntil[id] = limit;
+    }
+};
+
+// ============================================================
+// ReDoS 分析、语言比较与统计
+// ============================================================
+
+enum BacktrackingRisk {
+    RISK_LINEAR,
+    RISK_POLYNOMIAL,
+    RISK_EXPONENTIAL
+};
+
+// 攻击串片段: text 重复 repeat 次
+struct AttackSegment {
+    string text;
+    size_t repeat;
+};
+
+struct RedosReport {
+    BacktrackingRisk risk = RISK_LINEAR;
+    int degree = 1;                 // 多项式风险时为 O(n^degree)
+    vector<AttackSegment> attack;
+    vector<pair<int, int>> loops;   // 引起风险的量词在模式中的位置 [begin, end)
+    bool implicitPrefix = false;    // 风险来自非锚定搜索在每个起点重试
+    bool complete = true;           // 分析是否在预算内完成
+    bool verified = true;           // 攻击串是否经内置匹配器确认会使回溯尝试失败
+};
+
+bool analyzeBacktracking(const ParsedPattern& parsed, const GenerationOptions& options, RedosReport& report,
+                         string& error);
+string describeAttack(const vector<AttackSegment>& attack);
+string describeRisk(const RedosReport& report);
+string describeCause(const string& pattern, const RedosReport& report);
+bool usesBacktrackingEngine(const string& language);
+string backtrackingWarning(const ParsedPattern& parsed, const string& language, const GenerationOptions& options);
+
+// 生成匹配器时每个 DFA 的状态数上限
+const int DENSE_DFA_MAX_STATES = 20000;
+
+struct LanguageComparison {
+    bool holds = false;           // 两个模式等价, 或第一个包含于第二个
+    string witness;               // 不成立时的最短区分串
+    bool witnessInFirst = false;  // 区分串只被第一个模式匹配 (否则只被第二个)
+};
+
+bool compareLanguages(const ParsedPattern& first, const ParsedPattern& second, bool subset,
+                      LanguageComparison& result, string& error);
+string generateDfaCode(const ParsedPattern& parsed, bool cStyle);
+BitParallelStatus chooseBitParallel(const CompiledPattern& compiled, int& positions);
+MessageId bitParallelReason(BitParallelStatus status);
+string generateMatcherReport(const ParsedPattern& parsed);
+
+struct PatternStats {
+    size_t astNodes = 0;
+    size_t forwardStates = 0;       // NFA 状态数
+    size_t reverseStates = 0;
+    bool dfaWithinBudget = false;
+    string dfaError;
+    int dfaStates[3] = {0, 0, 0};   // 最小化后: 搜索、反向、整体匹配 (与 -f cpp-dfa 相同)
+    int byteClasses = 0;
+    size_t tableBytes = 0;          // 按字节类压缩后的转移表, 含 256 字节的字节类映射
+    size_t uncompressedBytes = 0;   // 每个状态 256 项时的转移表
+    Prefilter prefilter;
+    BitParallelStatus engine = BIT_PARALLEL_OK;
+    int positions = 0;
+    bool redosAnalyzed = false;
+    string redosError;
+    RedosReport redos;
+};
+
+bool computePatternStats(const ParsedPattern& parsed, const GenerationOptions& options, PatternStats& stats,
+                         string& error);
+string backtrackingStepsFormula(const RedosReport& report);
+double backtrackingStepsPerByte(const RedosReport& report, double length);
+
+}  // namespace detail
+}  // namespace regen
+
+#endif  // REGEN_INTERNAL_H
@@ -0,0 +1,313 @@
+#!/bin/sh
+# make check: 在小语料 tests/corpus.txt 上做回归测试, 每个功能一节, 任何一项失败时返回非零
+# 由 Makefile 调用; 可用 REGEN、REFERENCE、CXX 环境变量覆盖默认路径和编译器
+
+REGEN=${REGEN:-./regen}
+REFERENCE=${REFERENCE:-tests/reference}
+CXX=${CXX:-c++}
+CORPUS=tests/corpus.txt
+
+# 固定为英文界面和按字节匹配, 输出不随本地化变化
+LC_ALL=C
+LANG=C
+LANGUAGE=
+export LC_ALL LANG LANGUAGE
+
+WORK=$(mktemp -d) || exit 1
+trap 'rm -rf "$WORK"' EXIT
+
+passed=0
+failed=0
+
+pass() {
+    passed=$((passed + 1))
+}
+
+fail() {
+    failed=$((failed + 1))
+    printf 'FAIL: %s\n' "$1"
+}
+
+# 比较两个输出文件, 不同时显示前几行差异; 预期输出为空说明模式没有覆盖语料, 也算失败
+same() {
+    if [ -s "$2" ] && cmp -s "$2" "$3"; then
+        pass
+    else
+        fail "$1"
+        diff "$2" "$3" | head -5
+    fi
+}
+
+# 扫描 (--scan) 与参照引擎 std::regex 逐个匹配对照: 只用 ASCII、不匹配空串、不含 ^ $ 的模式, 两种引擎的语义在这些模式上一致
+for pattern in \
+    '[0-9]+' \
+    '\d{4}-\d{2}-\d{2}' \
+    '(\d{1,3}\.){3}\d{1,3}' \
+    '[a-zA-Z0-9._%+-]+@[a-zA-Z0-9.-]+\.[a-zA-Z]{2,}' \
+    'https?://[a-z.]+/[a-z]+' \
+    '\b[A-Z][a-z]+\b' \
+    '\w+ing\b' \
+    'foo|foobar' \
+    '(a|ab)(c|bcd)' \
+    'colou?r' \
+    'x[^y\n]{2}z' \
+    '[aeiou]{2,3}' \
+    '#[0-9a-f]{6}\b' \
+    '\s[A-Z]{4,5}\s'
+do
+    "$REGEN" --no-cache "$pattern" --scan "$CORPUS" > "$WORK/scan" 2>&1
+    "$REFERENCE" "$pattern" "$CORPUS" > "$WORK/reference" 2>&1
+    same "scan vs std::regex: $pattern" "$WORK/reference" "$WORK/scan"
+done
+
+# 多预设扫描 (--presets): 与逐个预设单独扫描的结果合并后相同, 同一块内按 (起点, 预设在列表中的次序) 输出;
+# 只选匹配中不含换行符的预设, 单独扫描的输出才能逐行解析
+TAB=$(printf '\t')
+for presets in 'email,hex,ip' 'date,time,credit-card' 'hex,url,email'; do
+    index=0
+    for preset in $(echo "$presets" | tr ',' ' '); do
+        "$REGEN" --no-cache -p "$preset" --scan "$CORPUS" |
+            awk -v name="$preset" -v index_="$index" 'BEGIN { OFS = "\t" } {
+                colon = index($0, ":"); offset = substr($0, 1, colon - 1); text = substr($0, colon + 1)
+                print offset, index_, name ":" offset ":" length(text) ":" text
+            }'
+        index=$((index + 1))
+    done | sort -t "$TAB" -k1,1n -k2,2n | cut -f3- > "$WORK/expected"
+    "$REGEN" --no-cache --presets "$presets" --scan "$CORPUS" > "$WORK/multi" 2>&1
+    same "--presets $presets vs single-preset scans" "$WORK/expected" "$WORK/multi"
+done
+printf 'contact: abc@def.com\n' > "$WORK/order"
+printf 'email:9:11:abc@def.com\nhex:9:3:abc\nhex:13:3:def\n' > "$WORK/expected"
+"$REGEN" --no-cache --presets email,hex --scan "$WORK/order" > "$WORK/multi" 2>&1
+same "--presets hits in input order" "$WORK/expected" "$WORK/multi"
+
+# 多线程扫描 (--threads): 把语料重复到约 6MB, 多线程时每个文件切成多个块, 输出与单线程逐字节相同
+i=0
+while [ $i -lt 1000 ]; do
+    cat "$CORPUS"
+    i=$((i + 1))
+done > "$WORK/large"
+for args in \
+    '[0-9]+' \
+    '\b[A-Z][a-z]+\b' \
+    '[a-zA-Z0-9._%+-]+@[a-zA-Z0-9.-]+\.[a-zA-Z]{2,}' \
+    '(a|ab)(c|bcd)' \
+    '-p url' \
+    '--all-presets'
+do
+    "$REGEN" --no-cache --threads 1 $args --scan "$WORK/large" > "$WORK/baseline" 2>&1
+    for threads in 2 4 7; do
+        "$REGEN" --no-cache --threads $threads $args --scan "$WORK/large" > "$WORK/other" 2>&1
+        same "--threads $threads: $args" "$WORK/baseline" "$WORK/other"
+    done
+done
+
+# ReDoS 分析 (--analyze): 风险模式返回 1 并给出已验证的攻击串, 线性模式返回 0
+analyze() {
+    expected=$1
+    pattern=$2
+    "$REGEN" --analyze "$pattern" > "$WORK/analyze" 2>&1
+    status=$?
+    if [ -n "$expected" ]; then
+        if [ $status -eq 1 ] && grep -qxF "Worst case in backtracking engines: $expected" "$WORK/analyze" &&
+           grep -q '^Attack input: ' "$WORK/analyze"; then
+            pass
+        else
+            fail "--analyze $pattern should report $expected"
+            cat "$WORK/analyze"
+        fi
+    elif [ $status -eq 0 ]; then
+        pass
+    else
+        fail "--analyze $pattern should be linear"
+        cat "$WORK/analyze"
+    fi
+}
+analyze 'polynomial O(n^3)' '\s*#?\s*$'
+analyze 'polynomial O(n^2)' '[ab]*a[ab]{3}'
+analyze 'polynomial O(n^2)' '(a|b)*a(a|b){20}'
+analyze 'exponential O(2^n)' '(a+)+$'
+analyze '' '^\d{4}-\d{2}-\d{2}$'
+analyze '' '^[a-z]+@[a-z]+\.com$'
+
+# 生成的 DFA 匹配器 (-f cpp-dfa): 从输出中截取代码, 与驱动一起编译后扫描同一语料; 模式可以带选项
+for args in \
+    '[0-9]+' \
+    '(\d{1,3}\.){3}\d{1,3}' \
+    '\b[A-Z][a-z]+\b' \
+    '(a|ab)(c|bcd)' \
+    '^\d{4}-\d{2}' \
+    '[0-9.]+\s$' \
+    '--multiline ^\d{4}-\d{2}' \
+    '--multiline \d+$' \
+    '-i \bnote\b'
+do
+    "$REGEN" -f cpp-dfa $args | sed -n '/^\/\/ Generated by regen/,/^}  \/\/ namespace regen_dfa/p' > "$WORK/dfa.h"
+    if ! "$CXX" -std=c++11 -O1 -I"$WORK" tests/dfa_main.cpp -o "$WORK/dfa_main" 2> "$WORK/compile"; then
+        fail "cpp-dfa does not compile: $args"
+        head -5 "$WORK/compile"
+        continue
+    fi
+    "$WORK/dfa_main" "$CORPUS" > "$WORK/dfa"
+    "$REGEN" --no-cache $args --scan "$CORPUS" > "$WORK/scan" 2>&1
+    same "cpp-dfa vs scan: $args" "$WORK/scan" "$WORK/dfa"
+done
+
+# 惰性 DFA 内存预算 (--dfa-cache-mb): 预算很小时缓存反复清空, 最终退回 NFA 模拟, 结果与默认预算相同
+for args in \
+    '[0-9]+' \
+    '[a-zA-Z0-9._%+-]+@[a-zA-Z0-9.-]+\.[a-zA-Z]{2,}' \
+    '(a|ab)(c|bcd)' \
+    '-p url' \
+    '--all-presets'
+do
+    "$REGEN" --no-cache $args --scan "$WORK/large" > "$WORK/baseline" 2>&1
+    for settings in '--dfa-cache-mb 0.01' '--dfa-cache-mb 0.02' '--threads 3 --dfa-cache-mb 0.01'; do
+        "$REGEN" --no-cache $settings $args --scan "$WORK/large" > "$WORK/other" 2>&1
+        same "$settings: $args" "$WORK/baseline" "$WORK/other"
+    done
+done
+if "$REGEN" --no-cache --dfa-cache-mb 0.01 --scan-stats -p url --scan "$WORK/large" 2>&1 >/dev/null |
+   grep -q 'switched to NFA simulation'; then
+    pass
+else
+    fail "--dfa-cache-mb 0.01 should make the url preset fall back to NFA simulation"
+fi
+
+# 模式优化 (--optimize): 改写后的扫描结果与原模式相同; 按代价取舍, 捕获组改为非捕获组即使变长也采用;
+# 合并的字符类不写跨类别的范围
+for args in \
+    '-p ip' \
+    '-p hex' \
+    '-p url' \
+    'a|ab|abc' \
+    'abc|ab|a' \
+    '(foo|foobar)\s' \
+    '(\d+)(\.\d+)?' \
+    'cat|car|cab|dog|[0-9]|\.|:|-'
+do
+    optimized=$("$REGEN" --optimize $args | sed -n 's/^Regular Expression: //p')
+    "$REGEN" --no-cache $args --scan "$CORPUS" > "$WORK/baseline" 2>&1
+    "$REGEN" --no-cache --scan -- "$optimized" "$CORPUS" > "$WORK/other" 2>&1
+    same "--optimize keeps the matches: $args -> $optimized" "$WORK/baseline" "$WORK/other"
+    case $optimized in
+        *'\--'* | *'@-Z'* | *'.-:'*) fail "--optimize writes an unreadable range: $optimized" ;;
+        *) pass ;;
+    esac
+done
+expect_optimized() {
+    optimized=$("$REGEN" --optimize -- "$1" | sed -n 's/^Regular Expression: //p')
+    if [ "$optimized" = "$2" ]; then
+        pass
+    else
+        fail "--optimize $1: expected $2, got $optimized"
+    fi
+}
+expect_optimized '(\d{1,3}\.){3}\d{1,3}' '(?:\d{1,3}\.){3}\d{1,3}'
+expect_optimized 'abc|ab|a' 'a(?:bc?)?'
+expect_optimized 'cat|car|cab|dog' 'ca[brt]|dog'
+
+# 自动机缓存: 第二次扫描直接使用映射的缓存文件, 结果与不用缓存时相同; 构建指纹不符或载荷损坏的文件
+# 被当作未命中, 重新编译后覆盖为正确的内容
+XDG_CACHE_HOME="$WORK/cache"
+export XDG_CACHE_HOME
+for args in '[0-9]+' '(a|ab)(c|bcd)' '-p url' '--presets email,hex,ip' '--all-presets'; do
+    "$REGEN" --no-cache $args --scan "$CORPUS" > "$WORK/baseline" 2>&1
+    rm -rf "$WORK/cache"
+    "$REGEN" $args --scan "$CORPUS" > /dev/null 2>&1
+    cached=$(ls "$WORK/cache/regen"/*.automaton 2>/dev/null)
+    if [ $(echo "$cached" | grep -c .) -ne 1 ]; then
+        fail "cache file for $args"
+        continue
+    fi
+    cp "$cached" "$WORK/stored"
+    "$REGEN" $args --scan "$CORPUS" > "$WORK/other" 2>&1
+    same "cached scan: $args" "$WORK/baseline" "$WORK/other"
+    for offset in 16 60; do
+        cp "$WORK/stored" "$cached"
+        printf 'X' | dd of="$cached" bs=1 seek=$offset conv=notrunc 2> /dev/null
+        "$REGEN" $args --scan "$CORPUS" > "$WORK/other" 2>&1
+        same "cache file modified at byte $offset: $args" "$WORK/baseline" "$WORK/other"
+        if cmp -s "$WORK/stored" "$cached"; then
+            pass
+        else
+            fail "cache file modified at byte $offset should be rewritten: $args"
+        fi
+    done
+done
+unset XDG_CACHE_HOME
+
+# 样本生成 (--generate): 每个样本都被整行匹配, 近似串 (--negative) 都不被匹配; 输出与线程数无关
+for args in '-p email' '-p ip' '-p url' '-p date' '\bfoo\b,?(bar|baz)+' '--utf8 [é-ü]{2,3}x'; do
+    "$REGEN" --generate 20000 $args > "$WORK/samples" 2>&1
+    "$REGEN" --no-cache --multiline -m $args --scan "$WORK/samples" 2>&1 | cut -d: -f2- > "$WORK/matched"
+    same "--generate: every sample matches: $args" "$WORK/samples" "$WORK/matched"
+    "$REGEN" --generate 20000 --negative $args > "$WORK/samples" 2>&1
+    if [ $(wc -l < "$WORK/samples") -eq 20000 ] &&
+       [ $("$REGEN" --no-cache --multiline -m $args --scan "$WORK/samples" | wc -l) -eq 0 ]; then
+        pass
+    else
+        fail "--generate --negative: no sample matches: $args"
+    fi
+    "$REGEN" --generate 200000 --threads 1 $args > "$WORK/baseline" 2>&1
+    "$REGEN" --generate 200000 --threads 3 $args > "$WORK/other" 2>&1
+    same "--generate --threads 3: $args" "$WORK/baseline" "$WORK/other"
+done
+
+# 学习模式 (--learn): 形状相同的分支按对齐的片段合并, 结果的分支数与长度有界; 所有正例整行匹配, 反例都不匹配
+for args in '-p email' '-p ip' '-p date'; do
+    "$REGEN" --generate 20000 $args > "$WORK/positives" 2>&1
+    "$REGEN" --generate 20000 --negative $args > "$WORK/negatives" 2>&1
+    "$REGEN" --learn "$WORK/positives" "$WORK/negatives" > "$WORK/learned" 2>&1
+    learned=$(sed -n 's/^Regular Expression: //p' "$WORK/learned")
+    branches=$(sed -n 's/.*(alternatives: \([0-9]*\)).*/\1/p' "$WORK/learned")
+    if [ -n "$learned" ] && [ "${branches:-99}" -le 4 ] && [ ${#learned} -le 200 ]; then
+        pass
+    else
+        fail "--learn $args: expected at most 4 alternatives, got ${branches:-none}: $learned"
+    fi
+    "$REGEN" --no-cache --multiline -m "$learned" --scan "$WORK/positives" 2>&1 | cut -d: -f2- > "$WORK/matched"
+    same "--learn $args: every positive matches" "$WORK/positives" "$WORK/matched"
+    if [ $("$REGEN" --no-cache --multiline -m "$learned" --scan "$WORK/negatives" | wc -l) -eq 0 ]; then
+        pass
+    else
+        fail "--learn $args: no negative matches"
+    fi
+done
+
+# UTF-8 模式: 解释按整个字符说明多字节字符, 不完整的高位字节写作 \xNN; -i 也对常见的非 ASCII 字母生效
+explain_contains() {
+    if "$REGEN" $1 -e | grep -F -q "$2"; then
+        pass
+    else
+        fail "$1 -e should contain: $2"
+    fi
+}
+explain_contains '--utf8 é+' "é+ - Match character 'é', repeated one or more times"
+explain_contains '--utf8 aéb' 'aéb - Match the text "aéb"'
+explain_contains '--utf8 (é|ü)x' "ü - Match character 'ü'"
+explain_contains '--utf8 -i É' "É - Match character 'É'"
+explain_contains '--bytes é' '\xc3 - Match byte 0xc3'
+explain_contains '--utf8 (é|ü)x' 'Prefilter: memchr 0xc3'
+printf 'é É ž Ž ж Ж Σ σ x X\n' > "$WORK/letters"
+for pair in 'É:é,É' 'ž:ž,Ž' 'Ж:ж,Ж' 'σ:Σ,σ' '[à-þ]+:é,É'; do
+    found=$("$REGEN" --no-cache --utf8 -i "${pair%%:*}" --scan "$WORK/letters" | cut -d: -f2 | tr '\n' ',')
+    if [ "$found" = "${pair#*:}," ]; then
+        pass
+    else
+        fail "--utf8 -i ${pair%%:*}: expected ${pair#*:}, got $found"
+    fi
+done
+
+# 校验模式 (--validate): 邮箱在正则之外检查长度; --json 不带 --count 时每行输出一个 JSON 对象
+label63=$(printf '%063d' 0)
+printf 'a@b.com\nx@%s.com\nx@%s1.com\nq@a..com\n' "$label63" "$label63" > "$WORK/emails"
+printf 'valid:a@b.com\nvalid:x@%s.com\ninvalid:x@%s1.com\ninvalid:q@a..com\n' "$label63" "$label63" > "$WORK/expected"
+"$REGEN" --validate email "$WORK/emails" > "$WORK/other" 2>&1
+same "--validate email: label lengths" "$WORK/expected" "$WORK/other"
+printf '{"value":"a\\"b","valid":false}\n{"value":"1.2.3.4","valid":true}\n' > "$WORK/expected"
+printf 'a"b\n1.2.3.4\n' | "$REGEN" --validate ip --json > "$WORK/other" 2>&1
+same "--validate --json: one object per line" "$WORK/expected" "$WORK/other"
+
+echo "$passed passed, $failed failed"
+[ $failed -eq 0 ]
@@ -0,0 +1,30 @@
+// make check 使用的驱动: 包含 regen -f cpp-dfa 生成的 dfa.h, 用 find_all 扫描文件,
+// 按 regen --scan 的格式逐行输出 "偏移:匹配"
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "dfa.h"
+
+using namespace std;
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        cerr << "Usage: dfa_main <file>\n";
+        return 2;
+    }
+    ifstream input(argv[1], ios::binary);
+    if (!input) {
+        cerr << "Error: cannot open " << argv[1] << "\n";
+        return 2;
+    }
+    stringstream buffer;
+    buffer << input.rdbuf();
+    const string text = buffer.str();
+
+    regen_dfa::find_all(text.data(), text.size(), [&](size_t start, size_t end) {
+        cout << start << ":" << text.substr(start, end - start) << "\n";
+    });
+    return 0;
+}
@@ -0,0 +1,31 @@
+// make check 使用的参照引擎: 用 std::regex (ECMAScript, 最左优先) 扫描文件,
+// 按 regen --scan 的格式逐行输出 "偏移:匹配"; 只用于不会匹配空串的模式
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <regex>
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        cerr << "Usage: reference <pattern> <file>\n";
+        return 2;
+    }
+    ifstream input(argv[2], ios::binary);
+    if (!input) {
+        cerr << "Error: cannot open " << argv[2] << "\n";
+        return 2;
+    }
+    stringstream buffer;
+    buffer << input.rdbuf();
+    const string text = buffer.str();
+
+    regex pattern(argv[1]);
+    for (sregex_iterator it(text.begin(), text.end(), pattern), end; it != end; ++it) {
+        cout << it->position() << ":" << it->str() << "\n";
+    }
+    return 0;
+}